@@ -130,9 +130,11 @@
  */
 
 #include "fixio.h"
+#include "fix_reactor.h"
 
 #include <ctype.h>
 #include <stdio.h>
+#include <string.h>
 #include <errno.h>
 #include <unistd.h>
 #include <sys/uio.h>
@@ -147,6 +149,7 @@
 #include "stdlib/macros/macros.h"
 #include "stdlib/network/network.h"
 #include "stdlib/log/log.h"
+#include "stdlib/network/uring.h"
 #include "applib/fixlib/defines.h"
 #include "applib/fixmsg/fixmsg.h"
 #include "applib/fixmsg/fix_types.h"
@@ -167,6 +170,8 @@ struct splitter_thread_args_t {
         int *begin_string_length;
         FIX_Version *fix_ver;
         FIX_PushBase *pusher;
+        struct wait_strategy_t *wait_strategy;
+        struct thread_placement_t *placement;
         char soh;
 };
 
@@ -176,7 +181,12 @@ struct sucker_thread_args_t {
         int *sucker_is_running;
         int *error;
         int *source_fd;
+        int *zero_copy;
+        struct rx_slab_t **slabs;
         foxtrot_io_t *foxtrot;
+        struct wait_strategy_t *wait_strategy;
+        int *io_backend;
+        struct thread_placement_t *placement;
 };
 
 /*
@@ -200,17 +210,20 @@ struct sucker_thread_args_t {
  *
  */
 #define DELTA_QUEUE_LENGTH (128) // MUST be a power of two
+#define DELTA_MAX_PENDING (DELTA_QUEUE_LENGTH/4) // most entries the splitter holds back before committing
 #define DELTA_ENTRY_PROCESSORS (8) // maybe more later
 struct delta_t {
         uint32_t size;
         uint32_t msgtype_offset;
         uint8_t *data;
+        struct rx_slab_t *slab; // slab holding data, NULL if data is malloc'ed
 };
 
 DEFINE_ENTRY_TYPE(struct delta_t, delta_entry_t);
 DEFINE_RING_BUFFER_TYPE(DELTA_ENTRY_PROCESSORS, DELTA_QUEUE_LENGTH, delta_entry_t, delta_io_t);
-DEFINE_RING_BUFFER_MALLOC(delta_io_t, delta_);
+DEFINE_RING_BUFFER_MAP(delta_io_t, delta_);
 DEFINE_RING_BUFFER_INIT(DELTA_QUEUE_LENGTH, delta_io_t, delta_);
+DEFINE_RING_BUFFER_SET_WAIT_STRATEGY_FUNCTION(delta_io_t, delta_);
 DEFINE_RING_BUFFER_SHOW_ENTRY_FUNCTION(delta_entry_t, delta_io_t, delta_);
 DEFINE_RING_BUFFER_ACQUIRE_ENTRY_FUNCTION(delta_entry_t, delta_io_t, delta_);
 DEFINE_ENTRY_PROCESSOR_BARRIER_REGISTER_FUNCTION(delta_io_t, delta_);
@@ -220,6 +233,7 @@ DEFINE_ENTRY_PROCESSOR_BARRIER_WAITFOR_NONBLOCKING_FUNCTION(delta_io_t, delta_);
 DEFINE_ENTRY_PROCESSOR_BARRIER_RELEASEENTRY_FUNCTION(delta_io_t, delta_);
 DEFINE_ENTRY_PUBLISHER_NEXTENTRY_BLOCKING_FUNCTION(delta_io_t, delta_);
 DEFINE_ENTRY_PUBLISHER_COMMITENTRY_BLOCKING_FUNCTION(delta_io_t, delta_);
+DEFINE_ENTRY_PUBLISHER_COMMITENTRIES_BLOCKING_FUNCTION(delta_io_t, delta_);
 
 /*
  * Echo) One publisher, one entry processor, 512 byte entry size, 512
@@ -235,8 +249,9 @@ typedef uint8_t echo_t[ECHO_ENTRY_SIZE];
 
 DEFINE_ENTRY_TYPE(echo_t, echo_entry_t);
 DEFINE_RING_BUFFER_TYPE(ECHO_ENTRY_PROCESSORS, ECHO_QUEUE_LENGTH, echo_entry_t, echo_io_t);
-DEFINE_RING_BUFFER_MALLOC(echo_io_t, echo_);
+DEFINE_RING_BUFFER_MAP(echo_io_t, echo_);
 DEFINE_RING_BUFFER_INIT(ECHO_QUEUE_LENGTH, echo_io_t, echo_);
+DEFINE_RING_BUFFER_SET_WAIT_STRATEGY_FUNCTION(echo_io_t, echo_);
 DEFINE_RING_BUFFER_SHOW_ENTRY_FUNCTION(echo_entry_t, echo_io_t, echo_);
 DEFINE_RING_BUFFER_ACQUIRE_ENTRY_FUNCTION(echo_entry_t, echo_io_t, echo_);
 DEFINE_ENTRY_PROCESSOR_BARRIER_REGISTER_FUNCTION(echo_io_t, echo_);
@@ -251,17 +266,26 @@ DEFINE_ENTRY_PUBLISHER_COMMITENTRY_BLOCKING_FUNCTION(echo_io_t, echo_);
  * Foxtrot) One publisher, one entry processor, 4K entry size, 1024
  * entries
  *
+ * data points to buf unless in zero-copy mode where it points into
+ * the slab the data was read into. Each entry holds a reference to
+ * its slab until the splitter thread is done with it.
  */
 #define FOXTROT_QUEUE_LENGTH (1024) // MUST be a power of two
 #define FOXTROT_ENTRY_PROCESSORS (1)
 #define FOXTROT_ENTRY_SIZE (1024*4) // if changing, please check the test_FIX_challenge_buffer_boundaries_*
 #define FOXTROT_MAX_DATA_SIZE (FOXTROT_ENTRY_SIZE - sizeof(uint32_t))
-typedef uint8_t foxtrot_t[FOXTROT_ENTRY_SIZE];
+struct foxtrot_t {
+        uint32_t length;        // number of bytes at data
+        uint8_t *data;          // the recieved bytes
+        struct rx_slab_t *slab; // slab holding data, NULL if data is buf
+        uint8_t buf[FOXTROT_MAX_DATA_SIZE];
+};
 
-DEFINE_ENTRY_TYPE(foxtrot_t, foxtrot_entry_t);
+DEFINE_ENTRY_TYPE(struct foxtrot_t, foxtrot_entry_t);
 DEFINE_RING_BUFFER_TYPE(FOXTROT_ENTRY_PROCESSORS, FOXTROT_QUEUE_LENGTH, foxtrot_entry_t, foxtrot_io_t);
-DEFINE_RING_BUFFER_MALLOC(foxtrot_io_t, foxtrot_);
+DEFINE_RING_BUFFER_MAP(foxtrot_io_t, foxtrot_);
 DEFINE_RING_BUFFER_INIT(FOXTROT_QUEUE_LENGTH, foxtrot_io_t, foxtrot_);
+DEFINE_RING_BUFFER_SET_WAIT_STRATEGY_FUNCTION(foxtrot_io_t, foxtrot_);
 DEFINE_RING_BUFFER_SHOW_ENTRY_FUNCTION(foxtrot_entry_t, foxtrot_io_t, foxtrot_);
 DEFINE_RING_BUFFER_ACQUIRE_ENTRY_FUNCTION(foxtrot_entry_t, foxtrot_io_t, foxtrot_);
 DEFINE_ENTRY_PROCESSOR_BARRIER_REGISTER_FUNCTION(foxtrot_io_t, foxtrot_);
@@ -273,6 +297,42 @@ DEFINE_ENTRY_PUBLISHER_NEXTENTRY_BLOCKING_FUNCTION(foxtrot_io_t, foxtrot_);
 DEFINE_ENTRY_PUBLISHER_NEXTENTRY_NONBLOCKING_FUNCTION(foxtrot_io_t, foxtrot_);
 DEFINE_ENTRY_PUBLISHER_COMMITENTRY_BLOCKING_FUNCTION(foxtrot_io_t, foxtrot_);
 
+/*
+ * Recieve slabs for zero-copy mode. The sucker thread reads the
+ * source into the slabs one after the other and wraps around to the
+ * first when the last is full. Complete messages are framed in place
+ * and handed to pop_view() as (slab, offset, length) views.
+ *
+ * Each foxtrot entry and each view references its slab, as does the
+ * sucker thread while it is filling it. A slab is not reused before
+ * every reference is dropped.
+ */
+#define RX_SLAB_COUNT (16)
+#define RX_SLAB_SIZE (1024*1024) // must be much larger than FOXTROT_MAX_DATA_SIZE
+struct rx_slab_t {
+        uint32_t refcount;
+        size_t used;   // bytes written to data by the sucker thread
+        uint8_t *data; // RX_SLAB_SIZE bytes
+};
+
+static inline void
+rx_slab_ref(struct rx_slab_t * const slab)
+{
+        __atomic_fetch_add(&slab->refcount, 1, __ATOMIC_RELAXED);
+}
+
+static inline void
+rx_slab_unref(struct rx_slab_t * const slab)
+{
+        __atomic_fetch_sub(&slab->refcount, 1, __ATOMIC_RELEASE);
+}
+
+static inline int
+rx_slab_is_free(const struct rx_slab_t * const slab)
+{
+        return (0 == __atomic_load_n(&slab->refcount, __ATOMIC_ACQUIRE));
+}
+
 /*********************
  *      FIX_Pusher
  *********************/
@@ -386,6 +446,112 @@ enum FIX_Parse_State
         CopyingBody,
 };
 
+/*
+ * Longest BodyLength value accepted by the fast framing path. Nine
+ * digits can not overflow an uint32_t. Anything longer is left to the
+ * byte-wise state machine.
+ */
+#define FAST_BODY_LENGTH_MAX_DIGITS (9)
+
+/*
+ * Fast framing path of the splitter thread. Tries to match a complete
+ * "8=FIX.X.Y<SOH>9=<LENGTH><SOH>" header at data in one go instead of
+ * feeding it through the byte-wise state machine.
+ *
+ * On success length_str holds the zero terminated BodyLength value,
+ * body_length the parsed value and header_length the offset of the
+ * <SOH> terminating the BodyLength field.
+ *
+ * Returns 1 (one) if a complete and valid header was found, 0 (zero)
+ * if not. The caller must fall back to the byte-wise state machine in
+ * the latter case as the header may be split across entries.
+ */
+static inline int
+scan_frame_header(const uint8_t * const data,
+                  const size_t len,
+                  const char * const begin_string,
+                  const size_t begin_string_length,
+                  const char soh,
+                  char * const length_str,
+                  uint32_t & body_length,
+                  size_t & header_length)
+{
+        size_t n;
+        uint32_t digit;
+        uint32_t value = 0;
+        const uint8_t *pos;
+
+        if (len <= begin_string_length)
+                return 0;
+        if (memcmp(data, begin_string, begin_string_length))
+                return 0;
+
+        pos = data + begin_string_length;
+        for (n = 0; (n < FAST_BODY_LENGTH_MAX_DIGITS) && (begin_string_length + n < len); ++n) {
+                digit = (uint32_t)(pos[n] - '0'); // wraps around for anything below '0'
+                if (digit > 9)
+                        break;
+                value = 10*value + digit;
+                length_str[n] = (char)pos[n];
+        }
+        if (!n || !value || (begin_string_length + n >= len) || (soh != (char)pos[n]))
+                return 0;
+        length_str[n] = '\0';
+
+        body_length = value;
+        header_length = begin_string_length + n;
+
+        return 1;
+}
+
+/*
+ * Makes delta_entry ready to recieve a message with the given
+ * BodyLength value and copies the BeginString and BodyLength into
+ * it.
+ *
+ * Returns the offset at which the rest of the message must be
+ * copied or 0 (zero) if out of memory.
+ */
+static size_t
+prepare_delta_entry(struct delta_entry_t * const delta_entry,
+                    const char * const begin_string,
+                    const int begin_string_length,
+                    const char * const length_str,
+                    const uint32_t bytes_left_to_copy)
+{
+        const size_t length_str_length = strlen(length_str);
+        const size_t size = begin_string_length + length_str_length + bytes_left_to_copy;
+
+        if (delta_entry->content.size < size) {
+                free(delta_entry->content.data);
+                delta_entry->content.data = (uint8_t*)malloc(size);
+                if (!delta_entry->content.data) {
+                        delta_entry->content.size = 0;
+                        M_ALERT("no memory");
+                        return 0;
+                }
+        }
+        delta_entry->content.size = size;
+        memcpy(delta_entry->content.data, begin_string, begin_string_length); // 8=FIX.X.Y<SOH>9=
+        memcpy(delta_entry->content.data + begin_string_length, length_str, length_str_length); // <LENGTH>
+
+        return begin_string_length + length_str_length;
+}
+
+/*
+ * Places the calling popper thread as it is started. Failing to do
+ * so is not fatal.
+ */
+static void
+place_popper_thread(const char * const name,
+                    const struct thread_placement_t * const placement)
+{
+        const int err = place_thread(placement);
+
+        if (err)
+                M_WARNING("could not place %s thread: %s", name, strerror(err));
+}
+
 /*
  * Officially the function from hell...
  */
@@ -401,15 +567,25 @@ splitter_thread_func(void *arg)
         uint32_t body_length;
         uint32_t bytes_left_to_copy = 0;
         char length_str[32] = { '\0' };
+        size_t header_length;
+        uint8_t *data;
+        const uint8_t *pos;
+        uint8_t *frame_start = NULL;                  // first byte of the BeginString candidate
+        const struct rx_slab_t *frame_start_slab = NULL;
+        struct rx_slab_t *frame_slab = NULL;          // referenced slab if framing in place, NULL if copying
         const uint8_t *msg_type;
         FIX_MsgType fix_msg_type;
         uint64_t msg_seq_number_expected;
         uint64_t msg_seq_number_recieved;
+        unsigned int polls = 0;
         struct cursor_t n;
 
         // split onto these
         struct cursor_t delta_cursor;
         struct delta_entry_t *delta_entry;
+        struct cursor_t delta_first_pending = { 0, { 0 } }; // first delta entry not yet committed
+        struct cursor_t delta_last_pending = { 0, { 0 } };  // last delta entry not yet committed
+        unsigned int delta_pending = 0;          // number of delta entries not yet committed
         struct cursor_t echo_cursor;
         struct echo_entry_t *echo_entry;
 
@@ -449,7 +625,8 @@ splitter_thread_func(void *arg)
 
         set_flag(args->db_is_open, 0);
         while (get_flag(args->pause_thread))
-                sched_yield();
+                wait_strategy_wait(args->wait_strategy, &polls, NULL, 0);
+        place_popper_thread("splitter", args->placement);
         if (!args->db->open()) {
                 M_ERROR("could not open local database");
                 abort();
@@ -488,9 +665,11 @@ splitter_thread_func(void *arg)
                         }
                         set_flag(args->db_is_open, 0);
 
+                        polls = 0;
                         do {
-                                sched_yield();
+                                wait_strategy_wait(args->wait_strategy, &polls, NULL, 0);
                         } while (get_flag_weak(args->pause_thread));
+                        place_popper_thread("splitter", args->placement);
 
                         if (!fixmsg_rx.init()) {
                                 M_ERROR("splitter thread cannot run");
@@ -503,25 +682,56 @@ splitter_thread_func(void *arg)
                         set_flag(args->db_is_open, 1);
                 }
 
-                if (!foxtrot_entry_processor_barrier_wait_for_nonblocking(args->foxtrot, &cursor_upper_limit))
+                if (!foxtrot_entry_processor_barrier_wait_for_nonblocking(args->foxtrot, &cursor_upper_limit)) {
+                        // parks on foxtrot if so configured
+                        wait_strategy_wait(&args->foxtrot->wait_strategy, &polls, &args->foxtrot->max_read_cursor.sequence, cursor_upper_limit.sequence);
                         continue;
+                }
+                polls = 0;
 
                 for (n.sequence = foxtrot_cursor.sequence; n.sequence <= cursor_upper_limit.sequence; ++n.sequence) { // batching
                         foxtrot_entry = foxtrot_ring_buffer_show_entry(args->foxtrot, &n);
 
-                        entry_length = getu32(foxtrot_entry->content);
+                        entry_length = foxtrot_entry->content.length;
+                        data = foxtrot_entry->content.data;
                         for (k = 0; k < entry_length; ++k) {
                                 switch (state) {
                                 case FindingBeginString:
-                                        if (args->begin_string[l] == *(foxtrot_entry->content + sizeof(uint32_t) + k)) {
+                                        if (!l) {
+                                                /*
+                                                 * Fast path. Skip straight to the next
+                                                 * candidate BeginString and parse the
+                                                 * entire header in one go. Headers split
+                                                 * across entries or mangled by noise are
+                                                 * left to the byte-wise state machine
+                                                 * below which resynchronizes one byte at a
+                                                 * time.
+                                                 */
+                                                pos = (const uint8_t*)memchr(data + k, args->begin_string[0], entry_length - k);
+                                                if (!pos) {
+                                                        k = entry_length;
+                                                        break;
+                                                }
+                                                k = (uint32_t)(pos - data);
+                                                frame_start = data + k;
+                                                frame_start_slab = foxtrot_entry->content.slab;
+                                                if (scan_frame_header(pos, entry_length - k, args->begin_string, *args->begin_string_length,
+                                                                      args->soh, length_str, body_length, header_length)) {
+                                                        k += header_length; // at the <SOH> following the BodyLength value
+                                                        goto begin_body;
+                                                }
+                                        }
+                                        if (args->begin_string[l] == *(data + k)) {
                                                 ++l;
                                                 continue;
                                         } else {
-                                                if (!args->begin_string[l] && isdigit(*(foxtrot_entry->content + sizeof(uint32_t) + k))) {
+                                                if (!args->begin_string[l] && isdigit(*(data + k))) {
                                                         l = 0;
                                                         state = FindingBodyLength;
                                                 } else {
-                                                        if (args->begin_string[0] == *(foxtrot_entry->content + sizeof(uint32_t) + k)) {
+                                                        if (args->begin_string[0] == *(data + k)) {
+                                                                frame_start = data + k;
+                                                                frame_start_slab = foxtrot_entry->content.slab;
                                                                 l = 1;
                                                                 continue;
                                                         }
@@ -535,7 +745,7 @@ splitter_thread_func(void *arg)
                                                 state = FindingBeginString; // not a valid number, skip this message
                                                 continue;
                                         }
-                                        length_str[l] = *(foxtrot_entry->content + sizeof(uint32_t) + k);
+                                        length_str[l] = *(data + k);
                                         if (!isdigit(length_str[l]) && (args->soh != length_str[l])) {
                                                 state = FindingBeginString; // not a valid number, skip this message
                                                 l = 0;
@@ -550,32 +760,58 @@ splitter_thread_func(void *arg)
                                                 state = FindingBeginString; // not a valid number, skip this message
                                                 continue;
                                         }
+                                begin_body:
                                         /*
                                          * we need to copy the soh_ following the BodyLength field (it isn't included in
                                          * the field value) and the CheckSum plus ending soh_
                                          */
                                         bytes_left_to_copy = body_length + 1 + 7;
-                                        if (delta_entry->content.size < *args->begin_string_length + strlen(length_str) + bytes_left_to_copy) {
-                                                free(delta_entry->content.data);
-                                                delta_entry->content.size = *args->begin_string_length + strlen(length_str) + bytes_left_to_copy;
-                                                delta_entry->content.data = (uint8_t*)malloc(delta_entry->content.size);
-                                                if (!delta_entry->content.data) {
-                                                        M_ALERT("no memory");
+                                        offset = *args->begin_string_length + strlen(length_str);
+                                        if (foxtrot_entry->content.slab
+                                            && (frame_start_slab == foxtrot_entry->content.slab)
+                                            && (frame_start + offset == data + k)) {
+                                                // zero-copy mode - frame the message in place
+                                                frame_slab = foxtrot_entry->content.slab;
+                                                rx_slab_ref(frame_slab);
+                                        } else {
+                                                offset = prepare_delta_entry(delta_entry, args->begin_string, *args->begin_string_length, length_str, bytes_left_to_copy);
+                                                if (!offset) {
                                                         state = FindingBeginString; // skip this message and hope for better memory conditions later
                                                         continue;
                                                 }
-                                        } else {
-                                                delta_entry->content.size = *args->begin_string_length + strlen(length_str) + bytes_left_to_copy;
                                         }
-                                        memcpy(delta_entry->content.data, args->begin_string, *args->begin_string_length); // 8=FIX.X.Y<SOH>9=
-                                        memcpy(delta_entry->content.data + *args->begin_string_length, length_str, strlen(length_str)); // <LENGTH>
-                                        offset = *args->begin_string_length + strlen(length_str);
                                         state = CopyingBody;
                                 case CopyingBody:
+                                        if (frame_slab && ((frame_slab != foxtrot_entry->content.slab) || (frame_start + offset != data + k))) {
+                                                /*
+                                                 * The message straddles two slabs. Copy what
+                                                 * we have so far and go on copying the rest.
+                                                 */
+                                                header_length = *args->begin_string_length + strlen(length_str);
+                                                if (prepare_delta_entry(delta_entry, args->begin_string, *args->begin_string_length, length_str, offset - header_length + bytes_left_to_copy))
+                                                        memcpy(delta_entry->content.data + header_length, frame_start + header_length, offset - header_length);
+                                                else
+                                                        offset = 0;
+                                                rx_slab_unref(frame_slab);
+                                                frame_slab = NULL;
+                                                if (!offset) {
+                                                        state = FindingBeginString; // skip this message and hope for better memory conditions later
+                                                        continue;
+                                                }
+                                        }
                                         if (entry_length - k >= bytes_left_to_copy) { // one memcpy enough
-                                                memcpy(delta_entry->content.data + offset,
-                                                       foxtrot_entry->content + sizeof(uint32_t) + k,
-                                                       bytes_left_to_copy); // <SOH>ya-da ya-da<SOH>10=ABC<SOH>
+                                                if (frame_slab) {
+                                                        if (!delta_entry->content.slab)
+                                                                free(delta_entry->content.data);
+                                                        delta_entry->content.data = frame_start;
+                                                        delta_entry->content.size = offset + bytes_left_to_copy;
+                                                        delta_entry->content.slab = frame_slab; // the reference goes with the entry
+                                                        frame_slab = NULL;
+                                                } else {
+                                                        memcpy(delta_entry->content.data + offset,
+                                                               data + k,
+                                                               bytes_left_to_copy); // <SOH>ya-da ya-da<SOH>10=ABC<SOH>
+                                                }
                                                 sprintf(chksum, "%03u", get_FIX_checksum(delta_entry->content.data, delta_entry->content.size - 7));
                                                 if (memcmp(delta_entry->content.data + delta_entry->content.size - 4, chksum, 3)) // validate checksum
                                                         goto go_on; // drop it - resend request later when gap is detected
@@ -601,7 +837,14 @@ splitter_thread_func(void *arg)
                                                                 delta_entry->content.msgtype_offset = (uint32_t)(msg_type - delta_entry->content.data);
                                                                 args->db->store_recv_msg(msg_seq_number_recieved, delta_entry->content.size, delta_entry->content.data);
 
-                                                                delta_publisher_commit_entry_blocking(args->delta, &delta_cursor);
+                                                                // committed with the rest of the foxtrot entry
+                                                                if (!delta_pending)
+                                                                        delta_first_pending.sequence = delta_cursor.sequence;
+                                                                delta_last_pending.sequence = delta_cursor.sequence;
+                                                                if (DELTA_MAX_PENDING == ++delta_pending) {
+                                                                        delta_publisher_commit_entries_blocking(args->delta, &delta_first_pending, &delta_last_pending);
+                                                                        delta_pending = 0;
+                                                                }
                                                                 delta_publisher_next_entry_blocking(args->delta, &delta_cursor);
                                                                 delta_entry = delta_ring_buffer_acquire_entry(args->delta, &delta_cursor);
                                                         } else { // ResendRequest recieved
@@ -670,12 +913,19 @@ splitter_thread_func(void *arg)
                                                         echo_entry = echo_ring_buffer_acquire_entry(args->echo, &echo_cursor);
                                                 }
                                         go_on:
+                                                if (delta_entry->content.slab) { // drop the view of a message not handed on
+                                                        rx_slab_unref(delta_entry->content.slab);
+                                                        delta_entry->content.slab = NULL;
+                                                        delta_entry->content.data = NULL;
+                                                        delta_entry->content.size = 0;
+                                                }
                                                 state = FindingBeginString;
                                                 k += bytes_left_to_copy - 1;
                                         } else {
-                                                memcpy(delta_entry->content.data + offset,
-                                                       foxtrot_entry->content + sizeof(uint32_t) + k,
-                                                       entry_length - k); // <SOH>ya-da ya-da<SOH>10=ABC<SOH>
+                                                if (!frame_slab)
+                                                        memcpy(delta_entry->content.data + offset,
+                                                               data + k,
+                                                               entry_length - k); // <SOH>ya-da ya-da<SOH>10=ABC<SOH>
                                                 bytes_left_to_copy -= entry_length - k;
                                                 offset += entry_length - k;
                                                 k = entry_length;
@@ -700,6 +950,12 @@ splitter_thread_func(void *arg)
                          * to process it. Maybe the approach below
                          * really is the safest...
                          */
+                        if (delta_pending) {
+                                delta_publisher_commit_entries_blocking(args->delta, &delta_first_pending, &delta_last_pending);
+                                delta_pending = 0;
+                        }
+                        if (foxtrot_entry->content.slab)
+                                rx_slab_unref(foxtrot_entry->content.slab);
                         foxtrot_entry_processor_barrier_release_entry(args->foxtrot, &foxtrot_reg_number, &n);
                 }
                 foxtrot_cursor.sequence = ++cursor_upper_limit.sequence;
@@ -709,14 +965,433 @@ splitter_thread_func(void *arg)
         return NULL;
 }
 
+/*
+ * Returns when the sucker thread is no longer paused.
+ */
+static inline void
+sucker_pause(struct sucker_thread_args_t * const args)
+{
+        unsigned int polls = 0;
+
+        set_flag(args->sucker_is_running, 0);
+        do {
+                wait_strategy_wait(args->wait_strategy, &polls, NULL, 0);
+        } while (get_flag(args->pause_thread));
+        place_popper_thread("sucker", args->placement);
+        set_flag(args->sucker_is_running, 1);
+}
+
+/*
+ * Returns the slab to read the next FOXTROT_MAX_DATA_SIZE bytes into
+ * in zero-copy mode. The sucker thread holds a reference to the
+ * returned slab. *slab_idx is the index of the current slab in
+ * args->slabs or -1 if no slab is held.
+ *
+ * Blocks until the next slab is no longer referenced if the current
+ * is full.
+ */
+static struct rx_slab_t*
+sucker_slab(struct sucker_thread_args_t * const args,
+            int * const slab_idx)
+{
+        unsigned int polls = 0;
+        struct rx_slab_t *slab;
+
+        if (0 <= *slab_idx) {
+                slab = *args->slabs + *slab_idx;
+                if (RX_SLAB_SIZE - slab->used >= FOXTROT_MAX_DATA_SIZE)
+                        return slab;
+                rx_slab_unref(slab);
+        }
+        *slab_idx = (*slab_idx + 1) % RX_SLAB_COUNT;
+        slab = *args->slabs + *slab_idx;
+
+        while (!rx_slab_is_free(slab)) {
+                if (UNLIKELY(get_flag(args->pause_thread)))
+                        sucker_pause(args);
+                wait_strategy_wait(args->wait_strategy, &polls, NULL, 0);
+        }
+        slab->used = 0;
+        rx_slab_ref(slab);
+
+        return slab;
+}
+
+#ifdef HAVE_LINUX_IO_URING_H
+/*
+ * Number of foxtrot entries lent to the kernel as provided buffers
+ * for the multishot recv(). Must be a power of two and no larger than
+ * FOXTROT_QUEUE_LENGTH.
+ */
+#define SUCKER_URING_WINDOW (64)
+
+/*
+ * Submission queue size of the sucker ring. Room for providing every
+ * entry in the window besides a recv() and its cancellation.
+ */
+#define SUCKER_URING_ENTRIES (2*SUCKER_URING_WINDOW)
+
+/*
+ * How long the sucker thread waits for data before it checks whether
+ * it must pause.
+ */
+#define SUCKER_URING_WAIT_NS (100*1000*1000)
+
+#define SUCKER_URING_BUFFER_GROUP (0)
+
+// user_data of the submissions
+#define SUCKER_URING_RECV (1)
+#define SUCKER_URING_CANCEL (2)
+#define SUCKER_URING_PROVIDE (3)
+
+/*
+ * State of the sucker thread when reading by io_uring. The foxtrot
+ * entries lent to the kernel are claimed, but not committed, and
+ * their buffers are provided to the kernel in claim order. The kernel
+ * fills the buffers in the same order, so the buffer id of a
+ * completion is always that of the oldest lent entry.
+ */
+struct sucker_uring_t {
+        struct uring_t ring;
+        int backend;                                  // enum FIXIOBackend, SYSCALL_IO if there is no ring
+        int armed;                                    // 1 (one) if a multishot recv() is in flight, 0 (zero) if not
+        unsigned int head;                            // index of oldest lent entry in lent
+        unsigned int count;                           // number of lent entries
+        struct cursor_t lent[SUCKER_URING_WINDOW];
+};
+
+/*
+ * Creates the ring.
+ *
+ * Returns 0 (zero) if all is well or an errno value if not.
+ */
+static int
+sucker_uring_init(struct sucker_uring_t * const su,
+                  const int backend)
+{
+        int err;
+
+        err = uring_init(&su->ring, SUCKER_URING_ENTRIES, (URING_SQPOLL_IO == backend));
+        if (err)
+                return err;
+
+        su->backend = backend;
+        su->armed = 0;
+        su->head = 0;
+        su->count = 0;
+
+        return 0;
+}
+
+/*
+ * Destroys the ring, which also drops the provided buffers. No recv()
+ * may be in flight. The entries still lent to the kernel are
+ * committed as empty entries.
+ */
+static void
+sucker_uring_destroy(struct sucker_thread_args_t * const args,
+                     struct sucker_uring_t * const su)
+{
+        struct foxtrot_entry_t *foxtrot_entry;
+
+        if (SYSCALL_IO == su->backend)
+                return;
+
+        uring_destroy(&su->ring);
+        for (; su->count; --su->count, ++su->head) {
+                foxtrot_entry = foxtrot_ring_buffer_acquire_entry(args->foxtrot, &su->lent[su->head & (SUCKER_URING_WINDOW - 1)]);
+                foxtrot_entry->content.length = 0;
+                foxtrot_publisher_commit_entry_blocking(args->foxtrot, &su->lent[su->head & (SUCKER_URING_WINDOW - 1)]);
+        }
+        su->backend = SYSCALL_IO;
+}
+
+/*
+ * Lends as many free foxtrot entries to the kernel as the window
+ * allows. The buffers are provided by the next uring_submit().
+ */
+static void
+sucker_uring_lend(struct sucker_thread_args_t * const args,
+                  struct sucker_uring_t * const su)
+{
+        unsigned int idx;
+        struct io_uring_sqe *sqe;
+        struct foxtrot_entry_t *foxtrot_entry;
+
+        while (SUCKER_URING_WINDOW > su->count) {
+                idx = (su->head + su->count) & (SUCKER_URING_WINDOW - 1);
+                if (!foxtrot_publisher_next_entry_nonblocking(args->foxtrot, &su->lent[idx]))
+                        break;
+
+                foxtrot_entry = foxtrot_ring_buffer_acquire_entry(args->foxtrot, &su->lent[idx]);
+                foxtrot_entry->content.data = foxtrot_entry->content.buf;
+                foxtrot_entry->content.slab = NULL;
+
+                sqe = uring_get_sqe(&su->ring);
+                sqe->opcode = IORING_OP_PROVIDE_BUFFERS;
+                sqe->fd = 1; // number of buffers
+                sqe->addr = (uint64_t)(uintptr_t)foxtrot_entry->content.buf;
+                sqe->len = FOXTROT_MAX_DATA_SIZE;
+                sqe->off = idx; // buffer id
+                sqe->buf_group = SUCKER_URING_BUFFER_GROUP;
+                sqe->user_data = SUCKER_URING_PROVIDE;
+                ++su->count;
+        }
+}
+
+/*
+ * Handles all available completions. Filled entries are committed
+ * to foxtrot.
+ *
+ * Returns 0 (zero) if all is well, ECONNRESET if the peer closed the
+ * connection or another errno value on errors.
+ */
+static int
+sucker_uring_reap(struct sucker_thread_args_t * const args,
+                  struct sucker_uring_t * const su)
+{
+        int res;
+        unsigned int idx;
+        unsigned int flags;
+        uint64_t user_data;
+        struct io_uring_cqe *cqe;
+        struct foxtrot_entry_t *foxtrot_entry;
+
+        while ((cqe = uring_peek_cqe(&su->ring))) {
+                res = cqe->res;
+                flags = cqe->flags;
+                user_data = cqe->user_data;
+                uring_cqe_seen(&su->ring);
+
+                if (SUCKER_URING_RECV != user_data) {
+                        if ((SUCKER_URING_PROVIDE == user_data) && (0 > res)) {
+                                M_ERROR("could not provide buffer: %s", strerror(-res));
+                                return -res;
+                        }
+                        continue;
+                }
+
+                if (!(flags & IORING_CQE_F_MORE))
+                        su->armed = 0;
+
+                if (0 < res) {
+                        idx = su->head & (SUCKER_URING_WINDOW - 1);
+                        if (!(flags & IORING_CQE_F_BUFFER) || ((flags >> IORING_CQE_BUFFER_SHIFT) != idx)) {
+                                M_ERROR("recieved into unexpected buffer");
+                                return EIO;
+                        }
+                        foxtrot_entry = foxtrot_ring_buffer_acquire_entry(args->foxtrot, &su->lent[idx]);
+                        foxtrot_entry->content.length = res;
+                        foxtrot_publisher_commit_entry_blocking(args->foxtrot, &su->lent[idx]);
+                        ++su->head;
+                        --su->count;
+                        continue;
+                }
+                if (!res)
+                        return ECONNRESET;
+
+                switch (-res) {
+                case ENOBUFS:   // all lent entries are filled, re-armed when more are lent
+                case ECANCELED:
+                case EAGAIN:
+                case EINTR:
+                        break;
+                default:
+                        return -res;
+                }
+        }
+
+        return 0;
+}
+
+/*
+ * Cancels the multishot recv() and waits until it has ended.
+ *
+ * Returns 0 (zero) if all is well or an errno value if not.
+ */
+static int
+sucker_uring_cancel(struct sucker_thread_args_t * const args,
+                    struct sucker_uring_t * const su)
+{
+        int err;
+        struct io_uring_sqe *sqe;
+        const struct timespec timeout = { 0, SUCKER_URING_WAIT_NS };
+
+        if (!su->armed)
+                return 0;
+
+        sqe = uring_get_sqe(&su->ring);
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->addr = SUCKER_URING_RECV;
+        sqe->user_data = SUCKER_URING_CANCEL;
+        do {
+                err = uring_submit(&su->ring, 1, &timeout);
+                if (err && (ETIME != err) && (EINTR != err) && (EBUSY != err) && (EAGAIN != err))
+                        return err;
+                err = sucker_uring_reap(args, su);
+                if (err && (ECONNRESET != err))
+                        return err;
+        } while (su->armed);
+
+        return 0;
+}
+
+/*
+ * Reads the source by io_uring into foxtrot until the sucker thread
+ * must pause.
+ *
+ * Returns 0 (zero) if the thread must pause, ENOSYS if io_uring is
+ * not usable, ECONNRESET if the peer closed the connection or
+ * another errno value on errors.
+ */
+static int
+suck_by_uring(struct sucker_thread_args_t * const args,
+              struct sucker_uring_t * const su,
+              const int backend)
+{
+        int err;
+        unsigned int polls = 0;
+        struct io_uring_sqe *sqe;
+        const struct timespec timeout = { 0, SUCKER_URING_WAIT_NS };
+
+        if (backend != su->backend) {
+                sucker_uring_destroy(args, su);
+                if (sucker_uring_init(su, backend))
+                        return ENOSYS;
+        }
+
+        while (!get_flag(args->pause_thread)) {
+                sucker_uring_lend(args, su);
+                if (!su->count) {
+                        wait_strategy_wait(args->wait_strategy, &polls, NULL, 0); // foxtrot is full
+                        continue;
+                }
+                polls = 0;
+
+                if (!su->armed) {
+                        sqe = uring_get_sqe(&su->ring);
+                        sqe->opcode = IORING_OP_RECV;
+                        sqe->fd = *args->source_fd;
+                        sqe->ioprio = IORING_RECV_MULTISHOT;
+                        sqe->flags = IOSQE_BUFFER_SELECT;
+                        sqe->buf_group = SUCKER_URING_BUFFER_GROUP;
+                        sqe->user_data = SUCKER_URING_RECV;
+                        su->armed = 1;
+                }
+                // EBUSY and EAGAIN are resolved by reaping
+                err = uring_submit(&su->ring, 1, &timeout);
+                if (err && (ETIME != err) && (EINTR != err) && (EBUSY != err) && (EAGAIN != err))
+                        return err;
+
+                err = sucker_uring_reap(args, su);
+                if (err)
+                        return err;
+        }
+
+        return sucker_uring_cancel(args, su);
+}
+#endif
+
+/*
+ * State of a source read by a reactor thread. The foxtrot entry
+ * claimed last stays open between calls to reactor_suck() if recv()
+ * would block.
+ */
+struct reactor_sucker_t {
+        struct reactor_source_t source;
+        struct sucker_thread_args_t *args;
+        struct cursor_t foxtrot_cursor;
+        int entry_open; // 1 (one) if foxtrot_cursor is claimed, 0 (zero) if not
+};
+
+/*
+ * Commits the open foxtrot entry, if any, as an empty entry and marks
+ * the source as no longer being read.
+ */
+static void
+reactor_sucker_close(struct reactor_sucker_t * const rs)
+{
+        struct foxtrot_entry_t *foxtrot_entry;
+
+        if (rs->entry_open) {
+                foxtrot_entry = foxtrot_ring_buffer_acquire_entry(rs->args->foxtrot, &rs->foxtrot_cursor);
+                foxtrot_entry->content.length = 0;
+                foxtrot_publisher_commit_entry_blocking(rs->args->foxtrot, &rs->foxtrot_cursor);
+                rs->entry_open = 0;
+        }
+        set_flag(rs->args->sucker_is_running, 0);
+}
+
+/*
+ * Called by a reactor thread when the source is readable. Reads the
+ * source into foxtrot until recv() would block. Please see struct
+ * reactor_source_t.
+ */
+static int
+reactor_suck(struct reactor_source_t * const source)
+{
+        int err;
+        ssize_t rval;
+        struct foxtrot_entry_t *foxtrot_entry;
+        struct reactor_sucker_t *rs = (struct reactor_sucker_t*)source->arg;
+        struct sucker_thread_args_t *args = rs->args;
+
+        do {
+                if (!rs->entry_open) {
+                        if (!foxtrot_publisher_next_entry_nonblocking(args->foxtrot, &rs->foxtrot_cursor))
+                                return EAGAIN; // foxtrot is full
+                        rs->entry_open = 1;
+                }
+                foxtrot_entry = foxtrot_ring_buffer_acquire_entry(args->foxtrot, &rs->foxtrot_cursor);
+                foxtrot_entry->content.data = foxtrot_entry->content.buf;
+                foxtrot_entry->content.slab = NULL;
+
+                rval = recv(source->fd, foxtrot_entry->content.buf, FOXTROT_MAX_DATA_SIZE, MSG_DONTWAIT);
+                switch (rval) {
+                case 0:
+                        M_ERROR("peer closed connection");
+                        reactor_sucker_close(rs);
+                        return ECONNRESET;
+                case -1:
+                        switch (errno) {
+                        case EAGAIN:
+                                return 0;
+                        case EINTR:
+                                continue;
+                        default:
+                                err = errno;
+                                set_flag(args->error, err);
+                                M_ERROR("error reading data: %s", strerror(err));
+                                reactor_sucker_close(rs);
+                                return err;
+                        }
+                default:
+                        foxtrot_entry->content.length = rval;
+                        foxtrot_publisher_commit_entry_blocking(args->foxtrot, &rs->foxtrot_cursor);
+                        rs->entry_open = 0;
+                        break;
+                }
+        } while (1);
+}
+
 void*
 sucker_thread_func(void *arg)
 {
         void *buf;
         ssize_t rval;
         int entry_open = 0;
+        int slab_idx = -1;
+        unsigned int polls = 0;
+        struct rx_slab_t *slab = NULL;
         struct cursor_t foxtrot_cursor;
         struct foxtrot_entry_t *foxtrot_entry = NULL;
+#ifdef HAVE_LINUX_IO_URING_H
+        int backend;
+        int uring_failed = 0;
+        struct sucker_uring_t su;
+
+        su.backend = SYSCALL_IO;
+#endif
 
         struct sucker_thread_args_t *args = (struct sucker_thread_args_t*)arg;
         if (!args) {
@@ -726,25 +1401,63 @@ sucker_thread_func(void *arg)
 
         // wait for start
         while (get_flag(args->pause_thread))
-                sched_yield();
+                wait_strategy_wait(args->wait_strategy, &polls, NULL, 0);
+        place_popper_thread("sucker", args->placement);
 
         // pull data from source_fd onto foxtrot until told to stop
         set_flag(args->sucker_is_running, 1);
         do {
-                if (UNLIKELY(get_flag(args->pause_thread))) {
-                        set_flag(args->sucker_is_running, 0);
-                        do {
-                                sched_yield();
-                        } while (get_flag(args->pause_thread));
-                        set_flag(args->sucker_is_running, 1);
+                if (UNLIKELY(get_flag(args->pause_thread)))
+                        sucker_pause(args);
+
+#ifdef HAVE_LINUX_IO_URING_H
+                backend = get_flag_weak(args->io_backend);
+                if ((SYSCALL_IO != backend) && !uring_failed && !get_flag_weak(args->zero_copy)) {
+                        if (0 <= slab_idx) { // left zero-copy mode
+                                rx_slab_unref(*args->slabs + slab_idx);
+                                slab_idx = -1;
+                        }
+                        rval = suck_by_uring(args, &su, backend);
+                        switch (rval) {
+                        case 0:
+                                continue;
+                        case ENOSYS:
+                                M_WARNING("sucker thread falls back to recvfrom()");
+                                uring_failed = 1;
+                                break;
+                        case ECONNRESET:
+                                M_ERROR("peer closed connection");
+                                goto out;
+                        default:
+                                set_flag(args->error, rval);
+                                M_ERROR("error reading data: %s", strerror(rval));
+                                goto out;
+                        }
                 }
+                sucker_uring_destroy(args, &su); // returns the lent entries, if any
+#endif
 
-                if (!foxtrot_publisher_next_entry_nonblocking(args->foxtrot, &foxtrot_cursor))
+                if (!foxtrot_publisher_next_entry_nonblocking(args->foxtrot, &foxtrot_cursor)) {
+                        wait_strategy_wait(args->wait_strategy, &polls, NULL, 0); // foxtrot is full
                         continue;
+                }
+                polls = 0;
 
                 entry_open = 1;
                 foxtrot_entry = foxtrot_ring_buffer_acquire_entry(args->foxtrot, &foxtrot_cursor);
-                buf = foxtrot_entry->content + sizeof(uint32_t);
+                if (get_flag_weak(args->zero_copy)) {
+                        slab = sucker_slab(args, &slab_idx);
+                        foxtrot_entry->content.data = slab->data + slab->used;
+                } else {
+                        if (0 <= slab_idx) { // left zero-copy mode
+                                rx_slab_unref(*args->slabs + slab_idx);
+                                slab_idx = -1;
+                        }
+                        slab = NULL;
+                        foxtrot_entry->content.data = foxtrot_entry->content.buf;
+                }
+                foxtrot_entry->content.slab = NULL;
+                buf = foxtrot_entry->content.data;
         again:
                 rval = recvfrom(*args->source_fd, buf, FOXTROT_MAX_DATA_SIZE, 0, NULL, NULL);
                 switch (rval) {
@@ -756,13 +1469,8 @@ sucker_thread_func(void *arg)
                         case ETIMEDOUT:
                         case EAGAIN:
                         case EINTR:
-                                if (UNLIKELY(get_flag(args->pause_thread))) {
-                                        set_flag(args->sucker_is_running, 0);
-                                        do {
-                                                sched_yield();
-                                        } while (get_flag(args->pause_thread));
-                                        set_flag(args->sucker_is_running, 1);
-                                }
+                                if (UNLIKELY(get_flag(args->pause_thread)))
+                                        sucker_pause(args);
                                 goto again;
                         default:
                                 set_flag(args->error, errno);
@@ -770,7 +1478,12 @@ sucker_thread_func(void *arg)
                                 goto out;
                         }
                 default:
-                        setu32(foxtrot_entry->content, rval);
+                        foxtrot_entry->content.length = rval;
+                        if (slab) {
+                                slab->used += rval;
+                                rx_slab_ref(slab);
+                                foxtrot_entry->content.slab = slab;
+                        }
                         break;
                 }
                 foxtrot_publisher_commit_entry_blocking(args->foxtrot, &foxtrot_cursor);
@@ -778,14 +1491,22 @@ sucker_thread_func(void *arg)
         } while (1);
 out:
         if (entry_open) {
-                setu32(foxtrot_entry->content, 0);
+                foxtrot_entry->content.length = 0;
                 foxtrot_publisher_commit_entry_blocking(args->foxtrot, &foxtrot_cursor);
         }
+#ifdef HAVE_LINUX_IO_URING_H
+        if (SYSCALL_IO != su.backend) {
+                if (sucker_uring_cancel(args, &su))
+                        M_WARNING("could not cancel recieve");
+                sucker_uring_destroy(args, &su);
+        }
+#endif
+        if (0 <= slab_idx)
+                rx_slab_unref(*args->slabs + slab_idx);
 
         return NULL;
 }
 
-
 FIX_Popper::FIX_Popper(const char soh)
         : echo_max_data_length_(ECHO_MAX_DATA_SIZE),
           foxtrot_max_data_length_(FOXTROT_MAX_DATA_SIZE),
@@ -805,19 +1526,32 @@ FIX_Popper::FIX_Popper(const char soh)
         db_is_open_ = 0;
         sucker_is_running_ = 0;
         started_ = 0;
+        zero_copy_ = 0;
+        slabs_ = NULL;
+        io_backend_ = SYSCALL_IO;
+        reactor_ = NULL;
+        reactor_sucker_ = NULL;
+        memset(&sucker_placement_, 0, sizeof(sucker_placement_));
+        memset(&splitter_placement_, 0, sizeof(splitter_placement_));
+        ring_mem_flags_ = 0;
+        wait_strategy_init(&wait_strategy_, WAIT_SPIN_YIELD);
 }
 
 int
 FIX_Popper::init(void)
 {
+        int granted;
+
         stop();
 
         if (!delta_) {
-                delta_ = delta_ring_buffer_malloc();
+                delta_ = delta_ring_buffer_map(ring_mem_flags_, &granted);
                 if (!delta_) {
                         M_ALERT("no memory");
                         goto err;
                 }
+                if (granted != ring_mem_flags_)
+                        M_WARNING("delta ring memory flags 0x%x granted of 0x%x", granted, ring_mem_flags_);
                 delta_ring_buffer_init(delta_);
 
                 // register and setup single entry processor for pop()
@@ -826,11 +1560,13 @@ FIX_Popper::init(void)
         }
 
         if (!echo_) {
-                echo_ = echo_ring_buffer_malloc();
+                echo_ = echo_ring_buffer_map(ring_mem_flags_, &granted);
                 if (!echo_) {
                         M_ALERT("no memory");
                         goto err;
                 }
+                if (granted != ring_mem_flags_)
+                        M_WARNING("echo ring memory flags 0x%x granted of 0x%x", granted, ring_mem_flags_);
                 echo_ring_buffer_init(echo_);
 
                 // register and setup single entry processor for session_pop()
@@ -839,12 +1575,18 @@ FIX_Popper::init(void)
         }
 
         if (!foxtrot_) {
-                foxtrot_ = foxtrot_ring_buffer_malloc();
+                foxtrot_ = foxtrot_ring_buffer_map(ring_mem_flags_, &granted);
                 if (!foxtrot_) {
                         M_ALERT("no memory");
                         goto err;
                 }
+                if (granted != ring_mem_flags_)
+                        M_WARNING("foxtrot ring memory flags 0x%x granted of 0x%x", granted, ring_mem_flags_);
                 foxtrot_ring_buffer_init(foxtrot_);
+                foxtrot_ring_buffer_set_wait_strategy(foxtrot_,
+                                                      (enum wait_strategy_kind_t)wait_strategy_.kind,
+                                                      wait_strategy_.spin_count,
+                                                      &wait_strategy_.timeout); // only the popper threads wait on foxtrot
         }
 
         if (!splitter_args_) {
@@ -862,6 +1604,8 @@ FIX_Popper::init(void)
                 splitter_args_->echo = echo_;
                 splitter_args_->foxtrot = foxtrot_;
                 splitter_args_->fix_ver = &fix_ver_;
+                splitter_args_->wait_strategy = &wait_strategy_;
+                splitter_args_->placement = &splitter_placement_;
                 splitter_args_->soh = soh_;
                 splitter_args_->pusher = pusher_;
 
@@ -882,12 +1626,29 @@ FIX_Popper::init(void)
                 sucker_args_->sucker_is_running = &sucker_is_running_;
                 sucker_args_->source_fd = &source_fd_;
                 sucker_args_->error = &error_;
+                sucker_args_->zero_copy = &zero_copy_;
+                sucker_args_->slabs = &slabs_;
                 sucker_args_->foxtrot = foxtrot_;
-
-                pthread_t sucker_thread_id;
-                if (!create_detached_thread(&sucker_thread_id, sucker_args_, sucker_thread_func)) {
-                        M_ALERT("could not create sucker thread");
-                        goto err;
+                sucker_args_->wait_strategy = &wait_strategy_;
+                sucker_args_->io_backend = &io_backend_;
+                sucker_args_->placement = &sucker_placement_;
+
+                if (reactor_) {
+                        reactor_sucker_ = (reactor_sucker_t*)calloc(1, sizeof(struct reactor_sucker_t));
+                        if (!reactor_sucker_) {
+                                M_ALERT("no memory");
+                                goto err;
+                        }
+                        reactor_sucker_->source.fd = -1;
+                        reactor_sucker_->source.on_readable = reactor_suck;
+                        reactor_sucker_->source.arg = reactor_sucker_;
+                        reactor_sucker_->args = sucker_args_;
+                } else {
+                        pthread_t sucker_thread_id;
+                        if (!create_detached_thread(&sucker_thread_id, sucker_args_, sucker_thread_func)) {
+                                M_ALERT("could not create sucker thread");
+                                goto err;
+                        }
                 }
         }
 
@@ -919,9 +1680,54 @@ FIX_Popper::pop(uint32_t * const len,
         *len = delta_entry->content.size;
         *msgtype_offset = delta_entry->content.msgtype_offset;
         *data = delta_entry->content.data;
+        if (delta_entry->content.slab) { // zero-copy mode - copy it out of the slab
+                *data = (uint8_t*)malloc(*len);
+                if (*data)
+                        memcpy(*data, delta_entry->content.data, *len);
+                rx_slab_unref(delta_entry->content.slab);
+        }
+        delta_entry->content.size = 0;
+        delta_entry->content.msgtype_offset = 0;
+        delta_entry->content.data = NULL;
+        delta_entry->content.slab = NULL;
+        delta_entry_processor_barrier_release_entry(delta_, &delta_reg_number_, &n);
+
+        guard_.leave();
+
+        if (!*data) {
+                M_ALERT("no memory");
+                return 1;
+        }
+
+        return 0;
+}
+
+int
+FIX_Popper::pop_view(struct MessageView * const view)
+{
+        struct delta_entry_t *delta_entry;
+        struct cursor_t n;
+
+        if (guard_.enter()) {
+                M_ALERT("could not lock");
+                return 1;
+        }
+
+        n.sequence = __atomic_fetch_add(&delta_n_.sequence, 1, __ATOMIC_RELEASE);
+        if (n.sequence == delta_cursor_upper_limit_.sequence) {
+                delta_entry_processor_barrier_wait_for_blocking(delta_, &delta_cursor_upper_limit_);
+                __atomic_fetch_add(&delta_cursor_upper_limit_.sequence, 1, __ATOMIC_RELEASE);
+        }
+        delta_entry = delta_ring_buffer_acquire_entry(delta_, &n);
+
+        view->len = delta_entry->content.size;
+        view->msgtype_offset = delta_entry->content.msgtype_offset;
+        view->data = delta_entry->content.data;
+        view->slab = delta_entry->content.slab;
         delta_entry->content.size = 0;
         delta_entry->content.msgtype_offset = 0;
         delta_entry->content.data = NULL;
+        delta_entry->content.slab = NULL;
         delta_entry_processor_barrier_release_entry(delta_, &delta_reg_number_, &n);
 
         guard_.leave();
@@ -929,12 +1735,27 @@ FIX_Popper::pop(uint32_t * const len,
         return 0;
 }
 
+void
+FIX_Popper::release_view(struct MessageView * const view)
+{
+        if (view->slab)
+                rx_slab_unref(view->slab);
+        else
+                free(view->data);
+
+        view->len = 0;
+        view->msgtype_offset = 0;
+        view->data = NULL;
+        view->slab = NULL;
+}
+
 void
 FIX_Popper::pop(const struct count_t * const reg_number,
                 struct cursor_t * const cursor,
                 std::queue<struct FIX_Popper::RawMessage> * const messages)
 {
         static const struct FIX_Popper::RawMessage msg = { 0 , 0, NULL };
+        uint8_t *data;
         struct delta_entry_t *entry;
         struct cursor_t n;
         struct cursor_t cursor_upper_limit;
@@ -943,12 +1764,24 @@ FIX_Popper::pop(const struct count_t * const reg_number,
         delta_entry_processor_barrier_wait_for_blocking(delta_, &cursor_upper_limit);
         for (n.sequence = cursor->sequence; n.sequence <= cursor_upper_limit.sequence; ++n.sequence) {
                 entry = delta_ring_buffer_acquire_entry(delta_, &n);
-                messages->push(msg);
-                messages->back().msgtype_offset = entry->content.msgtype_offset;
-                messages->back().len = entry->content.size;
-                messages->back().data = entry->content.data;
+                data = entry->content.data;
+                if (entry->content.slab) { // zero-copy mode - copy it out of the slab
+                        data = (uint8_t*)malloc(entry->content.size);
+                        if (data)
+                                memcpy(data, entry->content.data, entry->content.size);
+                        else
+                                M_ALERT("no memory");
+                        rx_slab_unref(entry->content.slab);
+                }
+                if (data) {
+                        messages->push(msg);
+                        messages->back().msgtype_offset = entry->content.msgtype_offset;
+                        messages->back().len = entry->content.size;
+                        messages->back().data = data;
+                }
                 entry->content.size = 0;
                 entry->content.data = NULL;
+                entry->content.slab = NULL;
         }
         delta_entry_processor_barrier_release_entry(delta_, reg_number, &cursor_upper_limit);
         cursor->sequence = ++cursor_upper_limit.sequence;
@@ -1060,8 +1893,20 @@ FIX_Popper::start(const char * const local_cache,
         while (!get_flag(&db_is_open_)) {
                 sched_yield();
         }
-        while (!get_flag(&sucker_is_running_)) {
-                sched_yield();
+        if (reactor_) {
+                reactor_sucker_->source.fd = source_fd_;
+                reactor_sucker_->entry_open = 0;
+                set_flag(&sucker_is_running_, 1);
+                if (!reactor_->attach(&reactor_sucker_->source)) {
+                        M_ALERT("could not attach source to reactor");
+                        set_flag(&sucker_is_running_, 0);
+                        set_flag_weak(&pause_threads_, 1);
+                        goto out;
+                }
+        } else {
+                while (!get_flag(&sucker_is_running_)) {
+                        sched_yield();
+                }
         }
 
         set_flag(&started_, 1);
@@ -1069,12 +1914,173 @@ out:
         return get_flag(&started_);
 }
 
+int
+FIX_Popper::set_zero_copy(const int zero_copy)
+{
+        unsigned int n;
+
+        if (get_flag(&started_)) {
+                M_ALERT("attempt to change zero-copy mode while popper is started");
+                return 0;
+        }
+        if (zero_copy && reactor_) {
+                M_ALERT("zero-copy mode is not available with a reactor");
+                return 0;
+        }
+
+        if (zero_copy && !slabs_) {
+                slabs_ = (struct rx_slab_t*)calloc(RX_SLAB_COUNT, sizeof(struct rx_slab_t));
+                if (!slabs_) {
+                        M_ALERT("no memory");
+                        return 0;
+                }
+                for (n = 0; n < RX_SLAB_COUNT; ++n) {
+                        slabs_[n].data = (uint8_t*)malloc(RX_SLAB_SIZE);
+                        if (!slabs_[n].data) {
+                                M_ALERT("no memory");
+                                goto err;
+                        }
+                }
+        }
+        set_flag(&zero_copy_, zero_copy ? 1 : 0);
+
+        return 1;
+err:
+        for (n = 0; n < RX_SLAB_COUNT; ++n)
+                free(slabs_[n].data);
+        free(slabs_);
+        slabs_ = NULL;
+
+        return 0;
+}
+
+int
+FIX_Popper::set_wait_strategy(const enum wait_strategy_kind_t kind,
+                              const unsigned int spin_count,
+                              const struct timespec * const timeout)
+{
+        if (get_flag(&started_)) {
+                M_ALERT("attempt to change wait strategy while popper is started");
+                return 0;
+        }
+        if (!delta_ || !echo_ || !foxtrot_) {
+                M_ALERT("popper not initialized");
+                return 0;
+        }
+
+        wait_strategy_set(&wait_strategy_, kind, spin_count, timeout);
+        delta_ring_buffer_set_wait_strategy(delta_, kind, spin_count, timeout);
+        echo_ring_buffer_set_wait_strategy(echo_, kind, spin_count, timeout);
+        foxtrot_ring_buffer_set_wait_strategy(foxtrot_, kind, spin_count, timeout);
+
+        return 1;
+}
+
+int
+FIX_Popper::set_io_backend(const enum FIXIOBackend backend)
+{
+        if (get_flag(&started_)) {
+                M_ALERT("attempt to change I/O backend while popper is started");
+                return 0;
+        }
+#ifndef HAVE_LINUX_IO_URING_H
+        if (SYSCALL_IO != backend) {
+                M_ALERT("io_uring is not available");
+                return 0;
+        }
+#endif
+        set_flag(&io_backend_, backend);
+
+        return 1;
+}
+
+int
+FIX_Popper::set_ring_memory(const int flags)
+{
+        if (delta_) {
+                M_ALERT("attempt to set ring memory after init()");
+                return 0;
+        }
+        if (flags & ~(RING_MEM_HUGE_PAGES | RING_MEM_PREFAULT | RING_MEM_LOCK)) {
+                M_ALERT("invalid ring memory flags: 0x%x", flags);
+                return 0;
+        }
+        ring_mem_flags_ = flags;
+
+        return 1;
+}
+
+int
+FIX_Popper::set_thread_placement(const enum FIXPopperThread thread,
+                                 const struct thread_placement_t * const placement)
+{
+        int err;
+        int foxtrot_cpu_tag;
+
+        if (get_flag(&started_)) {
+                M_ALERT("attempt to change thread placement while popper is started");
+                return 0;
+        }
+        if (!delta_ || !echo_ || !foxtrot_) {
+                M_ALERT("popper not initialized");
+                return 0;
+        }
+        if ((0 > placement->cpu_tag) || (0 > placement->fifo_priority) || (99 < placement->fifo_priority)) {
+                M_ALERT("invalid thread placement");
+                return 0;
+        }
+
+        switch (thread) {
+        case SUCKER_THREAD:
+                sucker_placement_ = *placement;
+                break;
+        case SPLITTER_THREAD:
+                splitter_placement_ = *placement;
+                break;
+        default:
+                M_ALERT("unknown popper thread");
+                return 0;
+        }
+
+        // foxtrot follows the sucker thread if it is pinned
+        foxtrot_cpu_tag = (sucker_placement_.cpu_tag && !reactor_) ? sucker_placement_.cpu_tag : splitter_placement_.cpu_tag;
+        err = bind_memory_to_cpu_node(foxtrot_, sizeof(foxtrot_io_t), foxtrot_cpu_tag);
+        if (!err)
+                err = bind_memory_to_cpu_node(delta_, sizeof(delta_io_t), splitter_placement_.cpu_tag);
+        if (!err)
+                err = bind_memory_to_cpu_node(echo_, sizeof(echo_io_t), splitter_placement_.cpu_tag);
+        if (err)
+                M_WARNING("could not move popper queues: %s", strerror(err)); // the placement still holds
+
+        return 1;
+}
+
+int
+FIX_Popper::set_reactor(FIX_Reactor * const reactor)
+{
+        if (sucker_args_) {
+                M_ALERT("attempt to set reactor after init()");
+                return 0;
+        }
+        if (reactor && get_flag(&zero_copy_)) {
+                M_ALERT("zero-copy mode is not available with a reactor");
+                return 0;
+        }
+        reactor_ = reactor;
+
+        return 1;
+}
+
 int
 FIX_Popper::stop(void)
 {
         if (!get_flag(&started_))
                 return 1;
 
+        if (reactor_) {
+                reactor_->detach(&reactor_sucker_->source);
+                reactor_sucker_close(reactor_sucker_);
+        }
         set_flag_weak(&pause_threads_, 1);
         while (get_flag(&db_is_open_)) {
                 sched_yield();
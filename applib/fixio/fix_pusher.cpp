@@ -140,6 +140,7 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <sys/uio.h>
+#include <sys/socket.h>
 #include <sys/time.h>
 
 #ifdef HAVE_CONFIG_H
@@ -150,9 +151,11 @@
 #include "stdlib/marshal/primitives.h"
 #include "stdlib/macros/macros.h"
 #include "stdlib/log/log.h"
+#include "stdlib/network/uring.h"
 #include "applib/fixlib/defines.h"
 #include "applib/fixmsg/fixmsg.h"
 #include "applib/fixmsg/fix_fields.h"
+#include "applib/fixmsg/fix_timestamp.h"
 #include "applib/fixutils/stack_utils.h"
 #include "applib/fixutils/fixmsg_utils.h"
 
@@ -211,10 +214,64 @@
  */
 #define MSG_TYPE_MAX_LENGTH (16)
 
+/*
+ * Number of MsgType header templates cached per session. Must be a
+ * power of two.
+ */
+#define HEADER_TEMPLATE_CACHE_SIZE (64)
+
+/*
+ * Room for "<SOH>35=<MsgType><SOH>34=" with the longest message type.
+ */
+#define HEADER_TEMPLATE_SIZE (32)
+
+/*
+ * Room for the digits of any uint64_t.
+ */
+#define SEQNUM_STRING_SIZE (24)
+
+/*
+ * The "<SOH>35=<MsgType><SOH>34=" part of the standard header for one
+ * message type. The bytes are right-aligned in bytes[] so that the
+ * template can be written in front of the sequence number with one
+ * fixed-size copy. sum is the byte sum of the template, which is
+ * folded into the checksum. length is 0 (zero) for unused templates.
+ */
+struct header_template_t {
+        char msg_type[MSG_TYPE_MAX_LENGTH];
+        char bytes[HEADER_TEMPLATE_SIZE];
+        unsigned int length;
+        unsigned int sum;
+};
+
+/*
+ * The ASCII digits of the most recently sent sequence number,
+ * right-aligned in digits[], and their byte sum. The digits are
+ * incremented in place when the next sequence number is sent.
+ */
+struct seqnum_string_t {
+        uint64_t value;
+        unsigned int length;
+        unsigned int sum;
+        char digits[SEQNUM_STRING_SIZE];
+};
+
+/*
+ * Per session cache of everything in the standard header that does
+ * not depend on the body length. Only touched by the thread pushing
+ * into the sink.
+ */
+struct header_cache_t {
+        struct seqnum_string_t seqnum;
+        struct header_template_t templates[HEADER_TEMPLATE_CACHE_SIZE];
+};
+
 struct pusher_thread_args_t {
 	uint64_t *msg_seq_number;
 	uint64_t *loop_count;
         int *pause_thread;
+        int *hold_thread;
+        int *thread_is_held;
         int *db_is_open;
         MsgDB *db;
         int *error;
@@ -225,9 +282,30 @@ struct pusher_thread_args_t {
         romeo_io_t *romeo;
         const char *FIX_start;
         int *FIX_start_length;
+        int *FIX_start_checksum;
+        struct wait_strategy_t *wait_strategy;
+        int *io_backend;
+        struct thread_placement_t *placement;
+        struct uring_t *ring; // NULL if the pusher thread writes with writev()
         char soh;
+        struct header_cache_t header_cache;
 };
 
+#ifdef HAVE_LINUX_IO_URING_H
+/*
+ * Submission queue size of the pusher ring. The pusher thread waits
+ * for each sendmsg() to complete, so it only uses one entry at a
+ * time.
+ */
+#define PUSHER_URING_ENTRIES (8)
+
+/*
+ * Number of times the pusher thread polls the completion queue
+ * before it waits in the kernel in SQPOLL mode.
+ */
+#define PUSHER_URING_SQPOLL_SPIN (1024*16)
+#endif
+
 /*
  * Content of alfa, bravo and charlie disruptor entries:
  *
@@ -255,8 +333,9 @@ typedef uint8_t alfa_t[ALFA_ENTRY_SIZE];
 
 DEFINE_ENTRY_TYPE(alfa_t, alfa_entry_t);
 DEFINE_RING_BUFFER_TYPE(ALFA_ENTRY_PROCESSORS, ALFA_QUEUE_LENGTH, alfa_entry_t, alfa_io_t);
-DEFINE_RING_BUFFER_MALLOC(alfa_io_t, alfa_);
+DEFINE_RING_BUFFER_MAP(alfa_io_t, alfa_);
 DEFINE_RING_BUFFER_INIT(ALFA_QUEUE_LENGTH, alfa_io_t, alfa_);
+DEFINE_RING_BUFFER_SET_WAIT_STRATEGY_FUNCTION(alfa_io_t, alfa_);
 DEFINE_RING_BUFFER_SHOW_ENTRY_FUNCTION(alfa_entry_t, alfa_io_t, alfa_);
 DEFINE_RING_BUFFER_ACQUIRE_ENTRY_FUNCTION(alfa_entry_t, alfa_io_t, alfa_);
 DEFINE_ENTRY_PROCESSOR_BARRIER_REGISTER_FUNCTION(alfa_io_t, alfa_);
@@ -266,6 +345,8 @@ DEFINE_ENTRY_PROCESSOR_BARRIER_WAITFOR_NONBLOCKING_FUNCTION(alfa_io_t, alfa_);
 DEFINE_ENTRY_PROCESSOR_BARRIER_RELEASEENTRY_FUNCTION(alfa_io_t, alfa_);
 DEFINE_ENTRY_PUBLISHER_NEXTENTRY_BLOCKING_FUNCTION(alfa_io_t, alfa_);
 DEFINE_ENTRY_PUBLISHER_COMMITENTRY_BLOCKING_FUNCTION(alfa_io_t, alfa_);
+DEFINE_ENTRY_PUBLISHER_NEXTENTRIES_BLOCKING_FUNCTION(alfa_io_t, alfa_);
+DEFINE_ENTRY_PUBLISHER_COMMITENTRIES_BLOCKING_FUNCTION(alfa_io_t, alfa_);
 
 /*
  * Bravo) Many publishers, one entry processor,
@@ -280,8 +361,9 @@ struct bravo_t {
 
 DEFINE_ENTRY_TYPE(struct bravo_t, bravo_entry_t);
 DEFINE_RING_BUFFER_TYPE(BRAVO_ENTRY_PROCESSORS, BRAVO_QUEUE_LENGTH, bravo_entry_t, bravo_io_t);
-DEFINE_RING_BUFFER_MALLOC(bravo_io_t, bravo_);
+DEFINE_RING_BUFFER_MAP(bravo_io_t, bravo_);
 DEFINE_RING_BUFFER_INIT(BRAVO_QUEUE_LENGTH, bravo_io_t, bravo_);
+DEFINE_RING_BUFFER_SET_WAIT_STRATEGY_FUNCTION(bravo_io_t, bravo_);
 DEFINE_RING_BUFFER_SHOW_ENTRY_FUNCTION(bravo_entry_t, bravo_io_t, bravo_);
 DEFINE_RING_BUFFER_ACQUIRE_ENTRY_FUNCTION(bravo_entry_t, bravo_io_t, bravo_);
 DEFINE_ENTRY_PROCESSOR_BARRIER_REGISTER_FUNCTION(bravo_io_t, bravo_);
@@ -305,8 +387,9 @@ typedef uint8_t charlie_t[CHARLIE_ENTRY_SIZE];
 
 DEFINE_ENTRY_TYPE(charlie_t, charlie_entry_t);
 DEFINE_RING_BUFFER_TYPE(CHARLIE_ENTRY_PROCESSORS, CHARLIE_QUEUE_LENGTH, charlie_entry_t, charlie_io_t);
-DEFINE_RING_BUFFER_MALLOC(charlie_io_t, charlie_);
+DEFINE_RING_BUFFER_MAP(charlie_io_t, charlie_);
 DEFINE_RING_BUFFER_INIT(CHARLIE_QUEUE_LENGTH, charlie_io_t, charlie_);
+DEFINE_RING_BUFFER_SET_WAIT_STRATEGY_FUNCTION(charlie_io_t, charlie_);
 DEFINE_RING_BUFFER_SHOW_ENTRY_FUNCTION(charlie_entry_t, charlie_io_t, charlie_);
 DEFINE_RING_BUFFER_ACQUIRE_ENTRY_FUNCTION(charlie_entry_t, charlie_io_t, charlie_);
 DEFINE_ENTRY_PROCESSOR_BARRIER_REGISTER_FUNCTION(charlie_io_t, charlie_);
@@ -319,19 +402,32 @@ DEFINE_ENTRY_PUBLISHER_COMMITENTRY_BLOCKING_FUNCTION(charlie_io_t, charlie_);
 
 /*
  * Romeo) One internal publisher, one entry processor,
- * sizeof(size_t)+sizeof(char*) entry size, 128 entries
+ * sizeof(uint64_t)+sizeof(size_t)+sizeof(char*) entry size, 1024
+ * entries
+ *
+ * Each entry carries its own sequence number as resent messages and
+ * GapFill messages do not follow each other one by one.
  */
-#define ROMEO_QUEUE_LENGTH (128) // MUST be a power of two
+#define ROMEO_QUEUE_LENGTH (1024) // MUST be a power of two
 #define ROMEO_ENTRY_PROCESSORS (1)
 struct romeo_t {
+        uint64_t msg_seq_number; // 0 (zero) if the entry must be skipped
         size_t allocated_size;
         uint8_t *data;
 };
 
+/*
+ * Number of stored messages read per chunk when resending. Every
+ * message in a chunk may give rise to two romeo entries, a GapFill
+ * and the message itself, so a whole chunk always fits into romeo.
+ */
+#define RESEND_CHUNK_LENGTH (ROMEO_QUEUE_LENGTH / 2)
+
 DEFINE_ENTRY_TYPE(struct romeo_t, romeo_entry_t);
 DEFINE_RING_BUFFER_TYPE(ROMEO_ENTRY_PROCESSORS, ROMEO_QUEUE_LENGTH, romeo_entry_t, romeo_io_t);
-DEFINE_RING_BUFFER_MALLOC(romeo_io_t, romeo_);
+DEFINE_RING_BUFFER_MAP(romeo_io_t, romeo_);
 DEFINE_RING_BUFFER_INIT(ROMEO_QUEUE_LENGTH, romeo_io_t, romeo_);
+DEFINE_RING_BUFFER_SET_WAIT_STRATEGY_FUNCTION(romeo_io_t, romeo_);
 DEFINE_RING_BUFFER_SHOW_ENTRY_FUNCTION(romeo_entry_t, romeo_io_t, romeo_);
 DEFINE_RING_BUFFER_ACQUIRE_ENTRY_FUNCTION(romeo_entry_t, romeo_io_t, romeo_);
 DEFINE_ENTRY_PROCESSOR_BARRIER_REGISTER_FUNCTION(romeo_io_t, romeo_);
@@ -381,55 +477,99 @@ get_ttl(uint8_t * const push_buffer,
 }
 
 /*
- * OK, this is butt ugly, but I need a fast, not a pretty,
- * solution. The maximum value of a uin64_t (18446744073709551615 as
- * it is) has 20 digits. 0 (zero) is returned for larger numbers.
+ * Writes the decimal digits of value so that the last digit is placed
+ * immediately before end. The byte sum of the digits is added to
+ * *sum.
+ *
+ * Returns a pointer to the first digit.
  */
-static inline int
-get_digit_count(const uint64_t num)
+static inline char*
+put_uint_before(char *end,
+                uint64_t value,
+                unsigned int * const sum)
 {
-        if (10 > num)
-                return 1;
-        if (100 > num)
-                return 2;
-        if (1000 > num)
-                return 3;
-        if (10000 > num)
-                return 4;
-        if (100000 > num)
-                return 5;
-        if (1000000 > num)
-                return 6;
-        if (10000000 > num)
-                return 7;
-        if (100000000 > num)
-                return 8;
-        if (1000000000 > num)
-                return 9;
-        if (10000000000 > num)
-                return 10;
-        if (100000000000 > num)
-                return 11;
-        if (1000000000000 > num)
-                return 12;
-        if (10000000000000 > num)
-                return 13;
-        if (100000000000000 > num)
-                return 14;
-        if (1000000000000000 > num)
-                return 15;
-        if (10000000000000000 > num)
-                return 16;
-        if (100000000000000000 > num)
-                return 17;
-        if (1000000000000000000 > num)
-                return 18;
-        if (10000000000000000000ULL > num)
-                return 19;
-        if (UINT64_MAX >= num)
-                return 20;
+        unsigned int digit;
 
-        return 0;
+        do {
+                digit = (unsigned int)(value % 10);
+                value /= 10;
+                *(--end) = (char)('0' + digit);
+                *sum += '0' + digit;
+        } while (value);
+
+        return end;
+}
+
+/*
+ * Makes seqnum hold the digits of value. The common case of value
+ * being one more than the previous value is handled by incrementing
+ * the ASCII digits in place.
+ */
+static inline void
+set_seqnum_string(struct seqnum_string_t * const seqnum,
+                  const uint64_t value)
+{
+        char *pos;
+        unsigned int n;
+
+        if (LIKELY(seqnum->length && value == seqnum->value + 1)) {
+                pos = &seqnum->digits[SEQNUM_STRING_SIZE - 1];
+                for (n = 0; n < seqnum->length && '9' == *pos; ++n, --pos) {
+                        *pos = '0';
+                        seqnum->sum -= 9;
+                }
+                if (n == seqnum->length) {
+                        *pos = '1';
+                        seqnum->sum += '1';
+                        ++seqnum->length;
+                } else {
+                        ++(*pos);
+                        ++seqnum->sum;
+                }
+        } else {
+                seqnum->sum = 0;
+                pos = put_uint_before(&seqnum->digits[SEQNUM_STRING_SIZE], value, &seqnum->sum);
+                seqnum->length = (unsigned int)(&seqnum->digits[SEQNUM_STRING_SIZE] - pos);
+        }
+        seqnum->value = value;
+}
+
+/*
+ * Returns the header template of msg_type, building it if it is not
+ * already cached. Colliding message types simply replace each other.
+ */
+static inline const struct header_template_t*
+get_header_template(struct header_cache_t * const cache,
+                    const char * const msg_type,
+                    const char soh)
+{
+        size_t len;
+        size_t n;
+        char *pos;
+        const unsigned int hash = (unsigned char)msg_type[0] * 31 + (msg_type[0] ? (unsigned char)msg_type[1] : 0);
+        struct header_template_t * const tmpl = &cache->templates[hash & (HEADER_TEMPLATE_CACHE_SIZE - 1)];
+
+        if (LIKELY(tmpl->length && !strcmp(tmpl->msg_type, msg_type)))
+                return tmpl;
+
+        len = strlen(msg_type);
+        memcpy(tmpl->msg_type, msg_type, len + 1);
+
+        tmpl->length = (unsigned int)(len + strlen("|35=|34="));
+        pos = &tmpl->bytes[HEADER_TEMPLATE_SIZE - tmpl->length];
+        *pos++ = soh;
+        memcpy(pos, "35=", 3);
+        pos += 3;
+        memcpy(pos, msg_type, len);
+        pos += len;
+        *pos++ = soh;
+        memcpy(pos, "34=", 3);
+
+        tmpl->sum = 0;
+        for (n = HEADER_TEMPLATE_SIZE - tmpl->length; n < HEADER_TEMPLATE_SIZE; ++n)
+                tmpl->sum += (unsigned char)tmpl->bytes[n];
+
+        return tmpl;
 }
 
 static int
@@ -468,15 +608,155 @@ do_writev(int fd,
                         if (sum > (size_t)written)
                                 break;
                 }
+                // sum - written bytes of iov[n] are left, skip the rest
                 len_offset = n;
                 iov_tmp = &iov[len_offset];
-                iov[len_offset].iov_base = (uint8_t*)iov[len_offset].iov_base + (sum - written);
-                iov[len_offset].iov_len -= sum - written;
+                iov[len_offset].iov_base = (uint8_t*)iov[len_offset].iov_base + (iov[len_offset].iov_len - (sum - written));
+                iov[len_offset].iov_len = sum - written;
         } while (1);
 
         return 0;
 }
 
+#ifdef HAVE_LINUX_IO_URING_H
+/*
+ * As do_writev(), but the iovecs are written by a sendmsg() submitted
+ * to ring. Waits until all bytes are written.
+ */
+static int
+do_uring_sendmsg(struct uring_t * const ring,
+                 const int fd,
+                 size_t total_bytes_to_write,
+                 size_t len,
+                 struct iovec *iov)
+{
+        int err;
+        int res;
+        size_t n;
+        size_t sum;
+        unsigned int polls;
+        size_t len_offset = 0;
+        struct msghdr msg;
+        struct io_uring_sqe *sqe;
+        struct io_uring_cqe *cqe;
+
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = len;
+
+        while (total_bytes_to_write) {
+                sqe = uring_get_sqe(ring); // never NULL, only one is in flight
+                sqe->opcode = IORING_OP_SENDMSG;
+                sqe->fd = fd;
+                sqe->addr = (uint64_t)(uintptr_t)&msg;
+                sqe->len = 1;
+
+                // the only completion is reaped below, so there is
+                // nothing to reap on EBUSY or EAGAIN either
+                err = uring_submit(ring, 0, NULL);
+                if (err) {
+                        M_ERROR("could not submit to io_uring: %s", strerror(err));
+                        return err;
+                }
+                if (ring->sqpoll) {
+                        for (polls = 0; (PUSHER_URING_SQPOLL_SPIN > polls) && !uring_peek_cqe(ring); ++polls)
+                                cpu_relax__();
+                }
+                do {
+                        err = uring_submit(ring, 1, NULL);
+                } while (EINTR == err);
+                if (err) {
+                        M_ERROR("could not wait for io_uring: %s", strerror(err));
+                        return err;
+                }
+                cqe = uring_peek_cqe(ring);
+                res = cqe->res;
+                uring_cqe_seen(ring);
+
+                if (0 > res) {
+                        switch (-res) {
+                        case EAGAIN:
+                        case EINTR:
+                                continue;
+                        default:
+                                M_ERROR("error writing data: %s", strerror(-res));
+                                return -res;
+                        }
+                }
+                total_bytes_to_write -= res;
+                if (!total_bytes_to_write)
+                        break;
+
+                sum = 0;
+                for (n = len_offset; n < len; ++n) {
+                        sum += iov[n].iov_len;
+                        if (sum > (size_t)res)
+                                break;
+                }
+                // sum - res bytes of iov[n] are left, skip the rest
+                len_offset = n;
+                iov[len_offset].iov_base = (uint8_t*)iov[len_offset].iov_base + (iov[len_offset].iov_len - (sum - res));
+                iov[len_offset].iov_len = sum - res;
+                msg.msg_iov = &iov[len_offset];
+                msg.msg_iovlen = len - len_offset;
+        }
+
+        return 0;
+}
+#endif
+
+/*
+ * Writes a batch of completed messages to the sink. The pusher
+ * thread writes by io_uring if it has a ring and by writev() if not.
+ */
+static inline int
+flush_to_sink(const struct pusher_thread_args_t * const args,
+              size_t total_bytes_to_write,
+              size_t len,
+              struct iovec *iov)
+{
+#ifdef HAVE_LINUX_IO_URING_H
+        if (args->ring)
+                return do_uring_sendmsg(args->ring, *args->sink_fd, total_bytes_to_write, len, iov);
+#endif
+        return do_writev(*args->sink_fd, total_bytes_to_write, len, iov);
+}
+
+/*
+ * Creates or destroys the ring of the pusher thread according to the
+ * selected backend. *ring_backend is the backend the ring was made
+ * for. The thread keeps using writev() if the ring cannot be created.
+ */
+static void
+update_pusher_ring(struct pusher_thread_args_t * const args,
+                   struct uring_t * const ring,
+                   int * const ring_backend)
+{
+#ifdef HAVE_LINUX_IO_URING_H
+        const int backend = get_flag(args->io_backend);
+
+        if (backend == *ring_backend)
+                return;
+
+        if (args->ring) {
+                uring_destroy(ring);
+                args->ring = NULL;
+        }
+        *ring_backend = backend;
+        if (SYSCALL_IO == backend)
+                return;
+
+        if (uring_init(ring, PUSHER_URING_ENTRIES, (URING_SQPOLL_IO == backend)))
+                M_WARNING("pusher thread falls back to writev()");
+        else
+                args->ring = ring;
+#else
+        (void)args;
+        (void)ring;
+        (void)ring_backend;
+#endif
+}
+
 /*
  * This function is ugly, butt ugly, but it has to be as we are trying
  * to build the complete FIX message in-situ whitout any temporary
@@ -529,64 +809,74 @@ do_writev(int fd,
  *                  complete FIX message
  *
  * args           - Thread parameters
+ *
+ * store_it       - 1 (one) if the message must be stored in the local
+ *                  database, 0 (zero) if not (resent messages are
+ *                  already there)
  */
 static const char*
 complete_FIX_message(uint64_t * const msg_seq_number,
                      uint8_t * const buffer,
                      size_t * const msg_length,
-                     const struct pusher_thread_args_t * const args)
+                     struct pusher_thread_args_t * const args,
+                     const int store_it)
 {
         size_t body_length;
-        int total_prefix_length;
-        int body_length_digits;
-        int msg_seq_number_digits;
         unsigned int checksum;
         char * const buf = (char*)buffer;
+        char * const partial_msg = buf + MSG_TYPE_STRING_OFFSET + FIX_BUFFER_RESERVED_HEAD;
+        char *pos;
         uint64_t ttl_tv_sec;
         uint64_t ttl_tv_usec;
+        struct seqnum_string_t * const seqnum = &args->header_cache.seqnum;
+        const struct header_template_t *tmpl;
 
         ++(*msg_seq_number);
-        msg_seq_number_digits = get_digit_count(*msg_seq_number);
 
         get_ttl(buffer, ttl_tv_sec, ttl_tv_usec);
 
-        args->db->store_sent_msg(*msg_seq_number,
-                                 *msg_length,
-                                 ttl_tv_sec,
-                                 ttl_tv_usec,
-                                 buffer + MSG_TYPE_STRING_OFFSET + FIX_BUFFER_RESERVED_HEAD,
-                                 (char*)buffer + MSG_TYPE_STRING_OFFSET);
-
-        // We must construct the prefix string,
-        // e.g. "8=FIX.4.1|9=49|35=0". So one thing we must know is
-        // the body length. The body length fills a variable amount of
-        // characters, therefore we must know it beforehand.
-        body_length =
-                + 3                                    /* 35= */
-                + strlen(buf + MSG_TYPE_STRING_OFFSET) /* msg type */
-                + 1                                    /* <SOH> */
-                + 3                                    /* 34= */
-                + msg_seq_number_digits                /* digits in sequence number */
-                + *msg_length                          /* length of partial FIX message */
-                - 3;                                   /* the 3 bytes comprising "10=" in the end of the partial FIX message must not be included in the body length */
-        body_length_digits = get_digit_count(body_length);
-        total_prefix_length = *args->FIX_start_length + body_length_digits + 1  + strlen(buf + MSG_TYPE_STRING_OFFSET) + 1 + get_digit_count(*msg_seq_number) + strlen("35=34=");
-
-        // build message
-        sprintf(buf + MSG_TYPE_STRING_OFFSET + FIX_BUFFER_RESERVED_HEAD - total_prefix_length,
-                "%s%lu%c35=%s%c34=%llu",
-                args->FIX_start, body_length, args->soh, buf + MSG_TYPE_STRING_OFFSET, args->soh, *msg_seq_number);
-        *(buf + MSG_TYPE_STRING_OFFSET + FIX_BUFFER_RESERVED_HEAD) = args->soh;
-
-        // add final checksum
-        checksum = get_FIX_checksum((uint8_t*)buf + MSG_TYPE_STRING_OFFSET + FIX_BUFFER_RESERVED_HEAD - total_prefix_length, total_prefix_length + *msg_length - 3);
-	char *str = buf + MSG_TYPE_STRING_OFFSET + FIX_BUFFER_RESERVED_HEAD + *msg_length;
+        // only queued here - the journal thread of the database
+        // writes it to disk
+        if (store_it)
+                args->db->store_sent_msg(*msg_seq_number,
+                                         *msg_length,
+                                         ttl_tv_sec,
+                                         ttl_tv_usec,
+                                         buffer + MSG_TYPE_STRING_OFFSET + FIX_BUFFER_RESERVED_HEAD,
+                                         (char*)buffer + MSG_TYPE_STRING_OFFSET);
+
+        set_seqnum_string(seqnum, *msg_seq_number);
+        tmpl = get_header_template(&args->header_cache, buf + MSG_TYPE_STRING_OFFSET, args->soh);
+
+        // The header is built backwards from the partial message,
+        // e.g. "8=FIX.4.1|9=49" + "|35=0|34=" + "2". The sequence
+        // number and the template are written with fixed-size
+        // copies, the bytes spilling in front of them are
+        // overwritten by what comes next. The body length counts
+        // everything following "9=49|" up to, and including, the
+        // delimiter immediately preceeding "10=".
+        pos = partial_msg - SEQNUM_STRING_SIZE;
+        memcpy(pos, seqnum->digits, SEQNUM_STRING_SIZE);
+        pos = partial_msg - seqnum->length - HEADER_TEMPLATE_SIZE;
+        memcpy(pos, tmpl->bytes, HEADER_TEMPLATE_SIZE);
+        pos += HEADER_TEMPLATE_SIZE - tmpl->length;
+
+        body_length = tmpl->length - 1 + seqnum->length + *msg_length - 3;
+        checksum = *args->FIX_start_checksum + tmpl->sum + seqnum->sum;
+        pos = put_uint_before(pos, body_length, &checksum);
+        pos -= *args->FIX_start_length;
+        memcpy(pos, args->FIX_start, *args->FIX_start_length);
+
+        // add final checksum, the checksum of the header is folded
+        // in from the precomputed sums
+        checksum = fold_FIX_checksum(checksum, (uint8_t*)partial_msg, *msg_length - 3);
+	char *str = partial_msg + *msg_length;
 	uint_to_str_zero_padded(4, args->soh, checksum, &str);
 
         // adjust data length to new value
-        *msg_length += total_prefix_length + 4; // 4 is CHK<SOH>
+        *msg_length += (partial_msg - pos) + 4; // 4 is CHK<SOH>
 
-        return (buf + MSG_TYPE_STRING_OFFSET + FIX_BUFFER_RESERVED_HEAD - total_prefix_length);
+        return pos;
 }
 
 static int
@@ -611,20 +901,21 @@ push_alfa(struct cursor_t * const alfa_cursor,
                         alfa_entry = alfa_ring_buffer_acquire_entry(args->alfa, &n);
 
                         vdata[idx].iov_len = get_length_of_partial_msg(alfa_entry->content);
-                        vdata[idx].iov_base = (void*)complete_FIX_message(msg_seq_number, alfa_entry->content, &vdata[idx].iov_len, args);
+                        vdata[idx].iov_base = (void*)complete_FIX_message(msg_seq_number, alfa_entry->content, &vdata[idx].iov_len, args, 1);
                         total += vdata[idx].iov_len;
 
                         ++idx;
                         if (UNLIKELY(IOV_MAX == idx)) {
-                                retv = do_writev(*args->sink_fd, total, idx, vdata);
+                                retv = flush_to_sink(args, total, idx, vdata);
                                 if (retv) {
                                         M_WARNING("%s", strerror(retv));
                                         return retv; // we don't bother to release the entries as we are shutting down when in error anyways
                                 }
                                 idx = 0;
+                                total = 0;
                         }
                 }
-                retv = do_writev(*args->sink_fd, total, idx, vdata);
+                retv = flush_to_sink(args, total, idx, vdata);
                 if (retv) {
                         M_WARNING("%s", strerror(retv));
                         return retv;
@@ -658,20 +949,21 @@ push_bravo(struct cursor_t * const bravo_cursor,
                         bravo_entry = bravo_ring_buffer_acquire_entry(args->bravo, &n);
 
                         vdata[idx].iov_len = get_length_of_partial_msg(bravo_entry->content.data);
-                        vdata[idx].iov_base = (void*)complete_FIX_message(msg_seq_number, bravo_entry->content.data, &vdata[idx].iov_len, args);
+                        vdata[idx].iov_base = (void*)complete_FIX_message(msg_seq_number, bravo_entry->content.data, &vdata[idx].iov_len, args, 1);
                         total += vdata[idx].iov_len;
 
                         ++idx;
                         if (UNLIKELY(IOV_MAX == idx)) {
-                                retv = do_writev(*args->sink_fd, total, idx, vdata);
+                                retv = flush_to_sink(args, total, idx, vdata);
                                 if (retv) {
                                         M_WARNING("%s", strerror(retv));
                                         return retv; // we don't bother to release the entries as we are shutting down when in error anyways
                                 }
                                 idx = 0;
+                                total = 0;
                         }
                 }
-                retv = do_writev(*args->sink_fd, total, idx, vdata);
+                retv = flush_to_sink(args, total, idx, vdata);
                 if (retv) {
                         M_WARNING("%s", strerror(retv));
                         return retv;
@@ -705,20 +997,21 @@ push_charlie(struct cursor_t * const charlie_cursor,
                         charlie_entry = charlie_ring_buffer_acquire_entry(args->charlie, &n);
 
                         vdata[idx].iov_len = get_length_of_partial_msg(charlie_entry->content);
-                        vdata[idx].iov_base = (void*)complete_FIX_message(msg_seq_number, charlie_entry->content, &vdata[idx].iov_len, args);
+                        vdata[idx].iov_base = (void*)complete_FIX_message(msg_seq_number, charlie_entry->content, &vdata[idx].iov_len, args, 1);
                         total += vdata[idx].iov_len;
 
                         ++idx;
                         if (UNLIKELY(IOV_MAX == idx)) {
-                                retv = do_writev(*args->sink_fd, total, idx, vdata);
+                                retv = flush_to_sink(args, total, idx, vdata);
                                 if (retv) {
                                         M_WARNING("%s", strerror(retv));
                                         return retv; // we don't bother to release the entries as we are shutting down when in error anyways
                                 }
                                 idx = 0;
+                                total = 0;
                         }
                 }
-                retv = do_writev(*args->sink_fd, total, idx, vdata);
+                retv = flush_to_sink(args, total, idx, vdata);
                 if (retv) {
                         M_WARNING("%s", strerror(retv));
                         return retv;
@@ -733,17 +1026,20 @@ push_charlie(struct cursor_t * const charlie_cursor,
 /*
  * This pusher is using the blocking variant of wait_for to guarantee
  * that an entry has been pushed into the sink.
+ *
+ * The messages are numbered by the sequence number of their romeo
+ * entry and are not stored in the local database.
  */
 static int
 push_romeo(struct cursor_t * const romeo_cursor,
            const struct count_t * const romeo_reg_number,
-           uint64_t * const msg_seq_number,
            struct pusher_thread_args_t * const args,
            struct iovec * const vdata)
 {
         int retv;
         size_t idx = 0;
         size_t total = 0;
+        uint64_t msg_seq_number;
         struct cursor_t n;
         struct cursor_t cursor_upper_limit;
         struct romeo_entry_t *romeo_entry;
@@ -753,9 +1049,12 @@ push_romeo(struct cursor_t * const romeo_cursor,
 
 	for (n.sequence = romeo_cursor->sequence; n.sequence <= cursor_upper_limit.sequence; ++n.sequence) { // batching
 		romeo_entry = romeo_ring_buffer_acquire_entry(args->romeo, &n);
+		if (UNLIKELY(!romeo_entry->content.msg_seq_number))
+			continue;
 
+		msg_seq_number = romeo_entry->content.msg_seq_number - 1; // incremented by complete_FIX_message()
 		vdata[idx].iov_len = get_length_of_partial_msg(romeo_entry->content.data);
-		vdata[idx].iov_base = (void*)complete_FIX_message(msg_seq_number, romeo_entry->content.data, &vdata[idx].iov_len, args);
+		vdata[idx].iov_base = (void*)complete_FIX_message(&msg_seq_number, romeo_entry->content.data, &vdata[idx].iov_len, args, 0);
 		total += vdata[idx].iov_len;
 
 		++idx;
@@ -766,6 +1065,7 @@ push_romeo(struct cursor_t * const romeo_cursor,
 				return retv;
 			}
 			idx = 0;
+			total = 0;
 		}
 	}
 	retv = do_writev(*args->sink_fd, total, idx, vdata);
@@ -797,6 +1097,11 @@ pusher_thread_func(void *arg)
         struct cursor_t charlie_cursor;
         struct count_t charlie_reg_number;
 
+        unsigned int polls = 0;
+        uint_fast64_t progress;
+        struct uring_t ring;
+        int ring_backend = SYSCALL_IO;
+
         struct pusher_thread_args_t *args = (struct pusher_thread_args_t*)arg;
         if (!args) {
                 M_ERROR("pusher thread cannot run");
@@ -820,6 +1125,17 @@ pusher_thread_func(void *arg)
 
         // Push data into sink until told to stop.
         do {
+                if (UNLIKELY(get_flag_weak(args->hold_thread))) {
+                        // FIX_Pusher::resend() owns the sink until
+                        // it lets go
+                        set_flag(args->thread_is_held, 1);
+                        polls = 0;
+                        do {
+                                wait_strategy_wait(args->wait_strategy, &polls, NULL, 0);
+                        } while (get_flag_weak(args->hold_thread));
+                        set_flag(args->thread_is_held, 0);
+                }
+
                 if (UNLIKELY(get_flag_weak(args->pause_thread))) {
 			__atomic_store_n(args->msg_seq_number, msg_seq_number, __ATOMIC_RELEASE);
 
@@ -829,10 +1145,15 @@ pusher_thread_func(void *arg)
                         }
                         set_flag(args->db_is_open, 0);
 
+                        polls = 0;
                         do {
-                                sched_yield();
+                                wait_strategy_wait(args->wait_strategy, &polls, NULL, 0);
                         } while (get_flag_weak(args->pause_thread));
 			msg_seq_number = __atomic_load_n(args->msg_seq_number, __ATOMIC_ACQUIRE);
+                        update_pusher_ring(args, &ring, &ring_backend);
+                        rval = place_thread(args->placement);
+                        if (rval)
+                                M_WARNING("could not place pusher thread: %s", strerror(rval));
 
                         if (!args->db->open()) {
                                 M_ERROR("could not open local database");
@@ -840,6 +1161,7 @@ pusher_thread_func(void *arg)
                         }
                         set_flag(args->db_is_open, 1);
                 }
+                progress = alfa_cursor.sequence + bravo_cursor.sequence + charlie_cursor.sequence;
 
                 // alfa
                 rval = push_alfa(&alfa_cursor, &alfa_reg_number, &msg_seq_number, args, vdata);
@@ -861,9 +1183,21 @@ pusher_thread_func(void *arg)
                         set_flag(args->error, rval);
                         goto out;
                 }
+
+                // nothing to send
+                if (progress == alfa_cursor.sequence + bravo_cursor.sequence + charlie_cursor.sequence)
+                        wait_strategy_wait(args->wait_strategy, &polls, NULL, 0);
+                else
+                        polls = 0;
         } while (1);
 out:
         free(vdata);
+#ifdef HAVE_LINUX_IO_URING_H
+        if (args->ring) {
+                uring_destroy(args->ring);
+                args->ring = NULL;
+        }
+#endif
         alfa_entry_processor_barrier_unregister(args->alfa, &alfa_reg_number);
         bravo_entry_processor_barrier_unregister(args->bravo, &bravo_reg_number);
         charlie_entry_processor_barrier_unregister(args->charlie, &charlie_reg_number);
@@ -885,6 +1219,7 @@ FIX_Pusher::FIX_Pusher(const char soh)
 	sprintf(sending_time_tag_, "%c52=", soh_);
         memset(FIX_start_bytes_, '\0', sizeof(FIX_start_bytes_));
         FIX_start_bytes_length_ = 0;
+        FIX_start_bytes_checksum_ = 0;
         sink_fd_ = -1;
         error_ = 0;
         alfa_ = NULL;
@@ -894,48 +1229,65 @@ FIX_Pusher::FIX_Pusher(const char soh)
         args_ = NULL;
         db_is_open_ = 0;
         pause_thread_ = 1;
+        hold_thread_ = 0;
+        thread_is_held_ = 0;
         started_ = 0;
 	msg_seq_number_ = 0;
+        wait_strategy_init(&wait_strategy_, WAIT_SPIN_YIELD);
+        io_backend_ = SYSCALL_IO;
+        placement_.cpu_tag = 0;
+        placement_.fifo_priority = 0;
+        ring_mem_flags_ = 0;
 }
 
 int
 FIX_Pusher::init(const char * const local_cache)
 {
+        int granted;
+
         stop();
 
         if (!alfa_) {
-                alfa_ = alfa_ring_buffer_malloc();
+                alfa_ = alfa_ring_buffer_map(ring_mem_flags_, &granted);
                 if (!alfa_) {
                         M_ALERT("no memory");
                         goto err;
                 }
+                if (granted != ring_mem_flags_)
+                        M_WARNING("alfa ring memory flags 0x%x granted of 0x%x", granted, ring_mem_flags_);
                 alfa_ring_buffer_init(alfa_);
         }
 
         if (!bravo_) {
-                bravo_ = bravo_ring_buffer_malloc();
+                bravo_ = bravo_ring_buffer_map(ring_mem_flags_, &granted);
                 if (!bravo_) {
                         M_ALERT("no memory");
                         goto err;
                 }
+                if (granted != ring_mem_flags_)
+                        M_WARNING("bravo ring memory flags 0x%x granted of 0x%x", granted, ring_mem_flags_);
                 bravo_ring_buffer_init(bravo_);
         }
 
         if (!charlie_) {
-                charlie_ = charlie_ring_buffer_malloc();
+                charlie_ = charlie_ring_buffer_map(ring_mem_flags_, &granted);
                 if (!charlie_) {
                         M_ALERT("no memory");
                         goto err;
                 }
+                if (granted != ring_mem_flags_)
+                        M_WARNING("charlie ring memory flags 0x%x granted of 0x%x", granted, ring_mem_flags_);
                 charlie_ring_buffer_init(charlie_);
         }
 
         if (!romeo_) {
-                romeo_ = romeo_ring_buffer_malloc();
+                romeo_ = romeo_ring_buffer_map(ring_mem_flags_, &granted);
                 if (!romeo_) {
                         M_ALERT("no memory");
                         goto err;
                 }
+                if (granted != ring_mem_flags_)
+                        M_WARNING("romeo ring memory flags 0x%x granted of 0x%x", granted, ring_mem_flags_);
                 romeo_ring_buffer_init(romeo_);
 		romeo_cursor_.sequence = romeo_entry_processor_barrier_register(romeo_, &romeo_reg_number_);
         }
@@ -970,6 +1322,8 @@ FIX_Pusher::init(const char * const local_cache)
                 args_->db = &db_;
                 args_->db_is_open = &db_is_open_;
                 args_->pause_thread = &pause_thread_;
+                args_->hold_thread = &hold_thread_;
+                args_->thread_is_held = &thread_is_held_;
 		args_->msg_seq_number = &msg_seq_number_;
 		args_->loop_count = &push_loop_count_;
                 args_->sink_fd = &sink_fd_;
@@ -980,7 +1334,13 @@ FIX_Pusher::init(const char * const local_cache)
                 args_->romeo = romeo_;
                 args_->FIX_start = FIX_start_bytes_;
                 args_->FIX_start_length = &FIX_start_bytes_length_;
+                args_->FIX_start_checksum = &FIX_start_bytes_checksum_;
+                args_->wait_strategy = &wait_strategy_;
+                args_->io_backend = &io_backend_;
+                args_->placement = &placement_;
+                args_->ring = NULL;
                 args_->soh = soh_;
+                memset(&args_->header_cache, '\0', sizeof(args_->header_cache));
 
                 pthread_t pusher_thread_id;
                 if (!create_detached_thread(&pusher_thread_id, args_, pusher_thread_func)) {
@@ -1069,7 +1429,57 @@ FIX_Pusher::push(const struct timeval * const ttl,
 }
 
 int
-FIX_Pusher::push_to_romeo(const struct timeval * const ttl,
+FIX_Pusher::push_batch(const size_t count,
+                       const struct BatchMessage * const msgs)
+{
+        size_t n;
+        struct timeval now;
+        struct timeval time_to_live;
+        struct cursor_t first;
+        struct cursor_t last;
+        struct cursor_t alfa_cursor;
+        struct alfa_entry_t *alfa_entry;
+
+        if (!count)
+                return 0;
+        if (UNLIKELY(ALFA_QUEUE_LENGTH < count))
+                return EINVAL;
+
+        // validate all before claiming as claimed entries must be committed
+        for (n = 0; n < count; ++n) {
+                if (UNLIKELY(MSG_TYPE_MAX_LENGTH < strnlen(msgs[n].msg_type, MSG_TYPE_MAX_LENGTH + 1) + 1))
+                        return EINVAL;
+                /* the "- FIX_BUFFER_RESERVED_TAIL" is because we need room for the checksum and the final delimiter */
+                if (UNLIKELY(msgs[n].len > (alfa_max_data_length_ - MSG_TYPE_STRING_OFFSET - FIX_BUFFER_RESERVED_HEAD - FIX_BUFFER_RESERVED_TAIL)))
+                        return EMSGSIZE;
+        }
+
+        gettimeofday(&now, NULL);
+        alfa_publisher_next_entries_blocking(alfa_, count, &first, &last);
+        for (n = 0, alfa_cursor.sequence = first.sequence; n < count; ++n, ++alfa_cursor.sequence) {
+                alfa_entry = alfa_ring_buffer_acquire_entry(alfa_, &alfa_cursor);
+
+                /* calculate resend expire time */
+                time_to_live.tv_sec = now.tv_sec + msgs[n].ttl->tv_sec;
+                time_to_live.tv_usec = now.tv_usec + msgs[n].ttl->tv_usec;
+                if (time_to_live.tv_usec >= 1000000) {
+                        time_to_live.tv_usec -= 1000000;
+                        ++time_to_live.tv_sec;
+                }
+
+                set_length_of_partial_msg(alfa_entry->content, msgs[n].len);
+                set_msg_type(alfa_entry->content, msgs[n].msg_type);
+                set_ttl(alfa_entry->content, &time_to_live);
+                memcpy(alfa_entry->content + MSG_TYPE_STRING_OFFSET + FIX_BUFFER_RESERVED_HEAD, msgs[n].data, msgs[n].len);
+        }
+        alfa_publisher_commit_entries_blocking(alfa_, &first, &last);
+
+        return get_flag(&error_);
+}
+
+int
+FIX_Pusher::push_to_romeo(const uint64_t msg_seq_number,
+			  const struct timeval * const ttl,
 			  const size_t len,
 			  const uint8_t * const data,
 			  const char * const msg_type)
@@ -1111,11 +1521,13 @@ FIX_Pusher::push_to_romeo(const struct timeval * const ttl,
 			romeo_entry->content.allocated_size = len + MSG_TYPE_STRING_OFFSET + FIX_BUFFER_RESERVED_HEAD + FIX_BUFFER_RESERVED_TAIL;
 		} else {
 			romeo_entry->content.allocated_size = 0;
+			romeo_entry->content.msg_seq_number = 0;
 			romeo_publisher_commit_entry_blocking(romeo_, &romeo_cursor);
 
 			return ENOMEM;
 		}
 	}
+	romeo_entry->content.msg_seq_number = msg_seq_number;
 	set_length_of_partial_msg(romeo_entry->content.data, len);
 	set_msg_type(romeo_entry->content.data, msg_type);
 	set_ttl(romeo_entry->content.data, &time_to_live);
@@ -1174,85 +1586,93 @@ FIX_Pusher::session_push(const struct timeval * const ttl,
 void 
 FIX_Pusher::get_sendingtime(char sendingtime[24]) const
 {
-	char *pos;
-        time_t curtime;
-	struct timeval st;
+	const size_t len = get_FIX_utc_timestamp(get_FIX_sending_time_precision(fix_ver_), sendingtime);
 
-	if (gettimeofday(&st, NULL)) {
-		M_ALERT("gettimeofday() failed: %s", strerror(errno));
-		abort();
-	}
-        curtime = st.tv_sec;
-	
-	switch (fix_ver_) {
-        case FIX_4_0:
-        case FIX_4_1:
-		strftime(sendingtime, strlen("YYYYMMDD-HH:MM:SS") + 1, "%Y%m%d-%H:%M:%S", gmtime(&curtime));
-		break;
-	case CUSTOM:
-        default:
-		strftime(sendingtime, strlen("YYYYMMDD-HH:MM:SS.") + 1, "%Y%m%d-%H:%M:%S.", gmtime(&curtime));
-		pos = &sendingtime[strlen("YYYYMMDD-HH:MM:SS.")];
-		sprintf(pos, "%03d", st.tv_usec/1000);
-		break;
-	}
+	sendingtime[len] = '\0';
 }
 
-void 
-FIX_Pusher::update_sendingtime(PartialMessage * const pmsg,
+int
+FIX_Pusher::update_sendingtime(uint8_t * const part_msg,
+			       const size_t length,
 			       char orig_sendingtime[24]) const
 {
 	char *pos;
-        time_t curtime;
-	struct timeval st;
+	size_t len;
+	char sendingtime[FIX_TIMESTAMP_MAX_LENGTH];
 
-	if (gettimeofday(&st, NULL)) {
-		M_ALERT("gettimeofday() failed: %s", strerror(errno));
-		abort();
-	}
-        curtime = st.tv_sec;
-	
 	// pending bug if "<SOH>52=" is present in a data field...
-	pos = strnstr((const char*)pmsg->part_msg, sending_time_tag_, pmsg->length);
+	pos = strnstr((const char*)part_msg, sending_time_tag_, length);
+	if (!pos)
+		return 0;
 	pos += strlen(sending_time_tag_); // or maybe just "4"...?
 
-	switch (fix_ver_) {
-        case FIX_4_0:
-        case FIX_4_1:
-		strncpy(orig_sendingtime, pos, strlen("YYYYMMDD-HH:MM:SS"));
-		orig_sendingtime[strlen("YYYYMMDD-HH:MM:SS")] = '\0';
-		strftime(pos, strlen("YYYYMMDD-HH:MM:SS") + 1, "%Y%m%d-%H:%M:%S", gmtime(&curtime));
-		pos += strlen("YYYYMMDD-HH:MM:SS");
-		*pos = soh_;
-		break;
-	case CUSTOM:
-        default:
-		strncpy(orig_sendingtime, pos, strlen("YYYYMMDD-HH:MM:SS.sss"));
-		orig_sendingtime[strlen("YYYYMMDD-HH:MM:SS.sss")] = '\0';
-		strftime(pos, strlen("YYYYMMDD-HH:MM:SS.") + 1, "%Y%m%d-%H:%M:%S.", gmtime(&curtime));
-		pos += strlen("YYYYMMDD-HH:MM:SS.");
-		sprintf(pos, "%03d", st.tv_usec/1000);
-		pos += 3;
-		*pos = soh_;
-		break;
-	}
+	len = get_FIX_utc_timestamp(get_FIX_sending_time_precision(fix_ver_), sendingtime);
+	memcpy(orig_sendingtime, pos, len);
+	orig_sendingtime[len] = '\0';
+	memcpy(pos, sendingtime, len);
+	pos[len] = soh_;
+
+	return 1;
+}
+
+int
+FIX_Pusher::push_gap_fill_to_romeo(FIXMessageTX & tx_msg,
+				   const uint64_t begin,
+				   const uint64_t new_seqnum)
+{
+	const struct timeval *ttl;
+        size_t len;
+        const uint8_t *data;
+        const char *msg_type;
+	char tmp[24];
+
+	if (!tx_msg.clone_from(NULL))
+		return ENOMEM;
+
+	// the header fields go in front of the body fields
+	tx_msg.append_field(35, strlen("4"), (const uint8_t*)"4");  // SequenceReset
+	tx_msg.append_field(43, strlen("Y"), (const uint8_t*)"Y");  // PossDupFlag
+	get_sendingtime(tmp);
+	tx_msg.append_field(52, strlen(tmp), (const uint8_t*)tmp);  // SendingTime
+
+	tx_msg.append_field(123, strlen("Y"), (const uint8_t*)"Y"); // GapFill
+	sprintf(tmp, "%llu", (unsigned long long)new_seqnum);
+	tx_msg.append_field(36, strlen(tmp), (const uint8_t*)tmp);  // NewSeqNo
+
+	if (!tx_msg.expose(&ttl, len, &data, &msg_type))
+		return EINVAL;
+
+	return push_to_romeo(begin, ttl, len, data, msg_type);
 }
 
+/*
+ * The stored messages are streamed in chunks of RESEND_CHUNK_LENGTH
+ * so that the memory used is independent of the size of the
+ * range. Each chunk is written to the sink in as few writev() calls
+ * as possible. Runs of expired or missing messages are replaced by a
+ * single SequenceReset-GapFill message.
+ *
+ * The pusher thread is held, not stopped, while resending. Stopping
+ * it would close the database.
+ */
 int 
 FIX_Pusher::resend(const uint64_t start,
 		   const uint64_t end)
 {
-        PartialMessageList *pmsg_list;
-        PartialMessage *pmsg;
+        SentMsgChunk chunk;
         FIXMessageTX tx_msg(soh_);
+	const struct timeval no_ttl = { 0, 0 }; // resent messages are not stored again
 	const struct timeval *ttl;
         size_t len;
         const uint8_t *data;
         const char *msg_type;
 	char tmp[24];
-	uint64_t orig_seqnum;
-	uint64_t seqnum = start - 1;
-	uint64_t n;
+	uint64_t next = start;   // next sequence number to read from the database
+	uint64_t expected;       // next sequence number to account for
+	uint64_t gap_begin = 0;  // first sequence number of the open gap, 0 (zero) if none
+	uint64_t seqnum;
+	size_t queued = 0;       // romeo entries not yet pushed
+	size_t n;
 	int retv = 1;
 
         struct iovec *vdata = (struct iovec*)malloc(sizeof(struct iovec)*IOV_MAX);
@@ -1261,55 +1681,101 @@ FIX_Pusher::resend(const uint64_t start,
                 return 1;
         }
 
-	if (!tx_msg.init())
+	if (!tx_msg.init()) {
+		free(vdata);
 		return 1;
+	}
+
+	if (!start)
+		next = 1;
+	expected = next;
 
 	/*
-	 * This is to pause alfa, bravo and charlie so that the resend
+	 * This is to hold alfa, bravo and charlie so that the resend
 	 * messages are guaranteed to be send in one coherent chunk.
 	 */
-	this->stop();
-	orig_seqnum = __atomic_load_n(&msg_seq_number_, __ATOMIC_ACQUIRE);
-
-        pmsg_list = db_.get_sent_msgs(start, end);
-	for (n = 0; n < pmsg_list->size(); ++n) {
-		pmsg = pmsg_list->get_at(n);
-
-		if (!pmsg || !pmsg->length) { // GapFill
-			if (!tx_msg.clone_from(pmsg))
-				goto out;;
-
-			tx_msg.append_field(35, strlen("4"), (const uint8_t*)"4");  // SequenseReset
-			tx_msg.append_field(123, strlen("Y"), (const uint8_t*)"Y"); // GapFill	
+	set_flag(&hold_thread_, 1);
+	while (!get_flag(&thread_is_held_)) {
+		if (!get_flag(&db_is_open_)) { // stopped
+			M_ALERT("cannot resend while stopped");
+			goto out;
+		}
+		sched_yield();
+	}
 
-			sprintf(tmp, "%llu", seqnum + 1);
-			tx_msg.append_field(36, strlen(tmp), (const uint8_t*)tmp);  // NewSeqNo
+	do {
+		if (!db_.get_sent_msgs_chunk(next, end, RESEND_CHUNK_LENGTH, chunk)) {
+			M_ALERT("could not read sent messages");
+			goto out;
+		}
+		if (!chunk.size())
+			break;
+
+		for (n = 0; n < chunk.size(); ++n) {
+			seqnum = chunk.seqnum(n);
+
+			if (chunk.is_expired(n) || (seqnum != expected)) {
+				if (!gap_begin)
+					gap_begin = expected;
+				if (chunk.is_expired(n)) {
+					expected = seqnum + 1;
+					continue;
+				}
+			}
+			if (gap_begin) {
+				if (push_gap_fill_to_romeo(tx_msg, gap_begin, seqnum))
+					goto out;
+				++queued;
+				gap_begin = 0;
+			}
 
-			get_sendingtime(tmp);
-			tx_msg.append_field(52, strlen(tmp), (const uint8_t*)tmp);  // SendingTime
-		} else { // resend
-			update_sendingtime(pmsg, tmp);			
-			if (!tx_msg.clone_from(pmsg))
-				goto out;;
+			// header fields are prepended, not appended after the body
+			if (update_sendingtime(chunk.part_msg(n), chunk.length(n), tmp)) {
+				if (!tx_msg.clone_from(chunk.msg_type(n), chunk.length(n), chunk.part_msg(n), &no_ttl))
+					goto out;
+				if (!tx_msg.prepend_field(122, strlen(tmp), (const uint8_t*)tmp)) // OrigSendingTime
+					goto out;
+			} else {
+				if (!tx_msg.clone_from(chunk.msg_type(n), chunk.length(n), chunk.part_msg(n), &no_ttl))
+					goto out;
+				get_sendingtime(tmp);
+				if (!tx_msg.prepend_field(52, strlen(tmp), (const uint8_t*)tmp)) // SendingTime
+					goto out;
+			}
+			if (!tx_msg.prepend_field(43, strlen("Y"), (const uint8_t*)"Y")) // PossDupFlag
+				goto out;
+
+			if (!tx_msg.expose(&ttl, len, &data, &msg_type))
+				goto out;
+			if (push_to_romeo(seqnum, ttl, len, data, msg_type))
+				goto out;
+			++queued;
+			expected = seqnum + 1;
+		}
 
-			tx_msg.append_field(122, strlen(tmp), (const uint8_t*)tmp); // OrigSendingTime
+		// one batch of writev() per chunk
+		if (queued) {
+			queued = 0;
+			if (push_romeo(&romeo_cursor_, &romeo_reg_number_, args_, vdata))
+				goto out;
 		}
+	} while (1);
 
-		tx_msg.expose(&ttl, len, &data, &msg_type);
-		if (push_to_romeo(ttl, len, data, msg_type))
+	// trailing run of expired messages
+	if (gap_begin) {
+		if (push_gap_fill_to_romeo(tx_msg, gap_begin, expected))
 			goto out;
-		if (push_romeo(&romeo_cursor_, &romeo_reg_number_, &seqnum, args_, vdata))
+		queued = 0;
+		if (push_romeo(&romeo_cursor_, &romeo_reg_number_, args_, vdata))
 			goto out;
-
-		++seqnum;
 	}
 	retv = 0;
 out:
+	// romeo must be empty for the next resend
+	if (queued)
+		push_romeo(&romeo_cursor_, &romeo_reg_number_, args_, vdata);
 	free(vdata);
-	delete pmsg_list;
-
-	__atomic_store_n(&msg_seq_number_, orig_seqnum, __ATOMIC_RELEASE);
-	this->start(NULL, NULL, -1);
+	set_flag(&hold_thread_, 0);
 
 	return retv;
 }
@@ -1334,6 +1800,7 @@ FIX_Pusher::start(const char * const local_cache,
                 }
                 snprintf(FIX_start_bytes_, sizeof(FIX_start_bytes_), "8=%s%c9=", FIX_ver, soh_);
                 FIX_start_bytes_length_ = strlen(FIX_start_bytes_);
+                FIX_start_bytes_checksum_ = get_FIX_checksum((const uint8_t*)FIX_start_bytes_, FIX_start_bytes_length_);
 
 		unsigned int n;
 		fix_ver_ = CUSTOM;
@@ -1376,6 +1843,95 @@ out:
         return get_flag(&started_);
 }
 
+int
+FIX_Pusher::set_wait_strategy(const enum wait_strategy_kind_t kind,
+                              const unsigned int spin_count,
+                              const struct timespec * const timeout)
+{
+        if (get_flag(&started_)) {
+                M_ALERT("attempt to change wait strategy while pusher is started");
+                return 0;
+        }
+        if (!alfa_ || !bravo_ || !charlie_ || !romeo_) {
+                M_ALERT("pusher not initialized");
+                return 0;
+        }
+
+        wait_strategy_set(&wait_strategy_, kind, spin_count, timeout);
+        alfa_ring_buffer_set_wait_strategy(alfa_, kind, spin_count, timeout);
+        bravo_ring_buffer_set_wait_strategy(bravo_, kind, spin_count, timeout);
+        charlie_ring_buffer_set_wait_strategy(charlie_, kind, spin_count, timeout);
+        romeo_ring_buffer_set_wait_strategy(romeo_, kind, spin_count, timeout);
+
+        return 1;
+}
+
+int
+FIX_Pusher::set_ring_memory(const int flags)
+{
+        if (alfa_) {
+                M_ALERT("attempt to set ring memory after init()");
+                return 0;
+        }
+        if (flags & ~(RING_MEM_HUGE_PAGES | RING_MEM_PREFAULT | RING_MEM_LOCK)) {
+                M_ALERT("invalid ring memory flags: 0x%x", flags);
+                return 0;
+        }
+        ring_mem_flags_ = flags;
+
+        return 1;
+}
+
+int
+FIX_Pusher::set_thread_placement(const struct thread_placement_t * const placement)
+{
+        int err;
+
+        if (get_flag(&started_)) {
+                M_ALERT("attempt to change thread placement while pusher is started");
+                return 0;
+        }
+        if (!alfa_ || !bravo_ || !charlie_ || !romeo_) {
+                M_ALERT("pusher not initialized");
+                return 0;
+        }
+        if ((0 > placement->cpu_tag) || (0 > placement->fifo_priority) || (99 < placement->fifo_priority)) {
+                M_ALERT("invalid thread placement");
+                return 0;
+        }
+
+        placement_ = *placement;
+        err = bind_memory_to_cpu_node(alfa_, sizeof(alfa_io_t), placement_.cpu_tag);
+        if (!err)
+                err = bind_memory_to_cpu_node(bravo_, sizeof(bravo_io_t), placement_.cpu_tag);
+        if (!err)
+                err = bind_memory_to_cpu_node(charlie_, sizeof(charlie_io_t), placement_.cpu_tag);
+        if (!err)
+                err = bind_memory_to_cpu_node(romeo_, sizeof(romeo_io_t), placement_.cpu_tag);
+        if (err)
+                M_WARNING("could not move pusher queues: %s", strerror(err)); // the placement still holds
+
+        return 1;
+}
+
+int
+FIX_Pusher::set_io_backend(const enum FIXIOBackend backend)
+{
+        if (get_flag(&started_)) {
+                M_ALERT("attempt to change I/O backend while pusher is started");
+                return 0;
+        }
+#ifndef HAVE_LINUX_IO_URING_H
+        if (SYSCALL_IO != backend) {
+                M_ALERT("io_uring is not available");
+                return 0;
+        }
+#endif
+        set_flag(&io_backend_, backend);
+
+        return 1;
+}
+
 void
 FIX_Pusher::stop(void)
 {
@@ -0,0 +1,313 @@
+/*
+ *    Copyright (C) 2013, Jules Colding <jcolding@gmail.com>.
+ *
+ *    All Rights Reserved.
+ */
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     (1) Redistributions of source code must retain the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer.
+ *
+ *     (2) Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *
+ *     (3) Neither the name of the copyright holder nor the names of
+ *     its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written
+ *     permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS
+ * OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifdef HAVE_CONFIG_H
+    #include "ac_config.h"
+#endif
+#include <errno.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/epoll.h>
+
+#include "stdlib/process/threads.h"
+#include "stdlib/log/log.h"
+#include "fixio.h"
+#include "fix_reactor.h"
+
+/*
+ * Most events handled per epoll_wait().
+ */
+#define REACTOR_MAX_EVENTS (64)
+
+/*
+ * How long a reactor thread with backlogged sources waits for events
+ * before it retries the backlog.
+ */
+#define REACTOR_BACKLOG_WAIT_MS (1)
+
+/*
+ * One reactor thread. The lock is held while the thread handles
+ * events, so a source is not touched by the thread once detach() has
+ * taken the lock and removed it.
+ */
+struct reactor_thread_t {
+        int epoll_fd;
+        unsigned int source_count;        // number of attached sources
+        pthread_mutex_t lock;
+        struct reactor_source_t *backlog; // sources to read again
+};
+
+/*
+ * Takes source off the backlog of thread, if it is on it.
+ */
+static void
+unlink_backlogged(struct reactor_thread_t * const thread,
+                  struct reactor_source_t * const source)
+{
+        struct reactor_source_t **pos;
+
+        if (!source->backlogged)
+                return;
+
+        for (pos = &thread->backlog; *pos; pos = &(*pos)->next) {
+                if (*pos == source) {
+                        *pos = source->next;
+                        break;
+                }
+        }
+        source->backlogged = 0;
+        source->next = NULL;
+}
+
+/*
+ * Removes source from thread. Must be called with the lock of thread
+ * held.
+ */
+static void
+remove_source(struct reactor_thread_t * const thread,
+              struct reactor_source_t * const source)
+{
+        if (epoll_ctl(thread->epoll_fd, EPOLL_CTL_DEL, source->fd, NULL))
+                M_WARNING("could not remove socket from reactor: %s", strerror(errno));
+        unlink_backlogged(thread, source);
+        __atomic_store_n(&source->thread, (struct reactor_thread_t*)NULL, __ATOMIC_RELEASE);
+        __atomic_fetch_sub(&thread->source_count, 1, __ATOMIC_RELAXED);
+}
+
+/*
+ * Reads source. It is put on the backlog if it could not be drained
+ * and dropped on errors.
+ */
+static void
+read_source(struct reactor_thread_t * const thread,
+            struct reactor_source_t * const source)
+{
+        switch (source->on_readable(source)) {
+        case 0:
+                break;
+        case EAGAIN:
+                if (!source->backlogged) {
+                        source->backlogged = 1;
+                        source->next = thread->backlog;
+                        thread->backlog = source;
+                }
+                break;
+        default:
+                remove_source(thread, source);
+                break;
+        }
+}
+
+static void*
+reactor_thread_func(void *arg)
+{
+        int n;
+        int count;
+        struct reactor_source_t *source;
+        struct reactor_source_t *backlog;
+        struct epoll_event events[REACTOR_MAX_EVENTS];
+
+        struct reactor_thread_t *thread = (struct reactor_thread_t*)arg;
+        if (!thread) {
+                M_ERROR("reactor thread cannot run (no parameters)");
+                abort();
+        }
+
+        do {
+                count = epoll_wait(thread->epoll_fd, events, REACTOR_MAX_EVENTS, thread->backlog ? REACTOR_BACKLOG_WAIT_MS : -1);
+                if (-1 == count) {
+                        if (EINTR == errno)
+                                continue;
+                        M_ERROR("reactor thread cannot wait for events: %s", strerror(errno));
+                        abort();
+                }
+
+                pthread_mutex_lock(&thread->lock);
+
+                for (n = 0; n < count; ++n) {
+                        source = (struct reactor_source_t*)events[n].data.ptr;
+                        if (thread != source->thread) // detached since epoll_wait() returned
+                                continue;
+                        read_source(thread, source);
+                }
+
+                backlog = thread->backlog;
+                thread->backlog = NULL;
+                while (backlog) {
+                        source = backlog;
+                        backlog = source->next;
+                        source->backlogged = 0;
+                        source->next = NULL;
+                        read_source(thread, source);
+                }
+
+                pthread_mutex_unlock(&thread->lock);
+        } while (1);
+
+        return NULL;
+}
+
+FIX_Reactor::FIX_Reactor(void)
+{
+        threads_ = NULL;
+        thread_count_ = 0;
+}
+
+int
+FIX_Reactor::init(const unsigned int thread_count)
+{
+        unsigned int n;
+        pthread_t thread_id;
+
+        if (threads_) {
+                M_ALERT("reactor is already initialized");
+                return 0;
+        }
+        if (!thread_count) {
+                M_ALERT("reactor needs at least one thread");
+                return 0;
+        }
+
+        threads_ = (struct reactor_thread_t*)calloc(thread_count, sizeof(struct reactor_thread_t));
+        if (!threads_) {
+                M_ALERT("no memory");
+                return 0;
+        }
+
+        for (n = 0; n < thread_count; ++n) {
+                threads_[n].epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+                if (-1 == threads_[n].epoll_fd) {
+                        M_ALERT("could not create epoll instance: %s", strerror(errno));
+                        goto err;
+                }
+                if (pthread_mutex_init(&threads_[n].lock, NULL)) {
+                        M_ALERT("could not create lock");
+                        close(threads_[n].epoll_fd);
+                        goto err;
+                }
+                threads_[n].source_count = 0;
+                threads_[n].backlog = NULL;
+        }
+
+        for (thread_count_ = 0; thread_count_ < thread_count; ++thread_count_) {
+                if (!create_detached_thread(&thread_id, &threads_[thread_count_], reactor_thread_func)) {
+                        M_ALERT("could not create reactor thread");
+                        return 0; // threads_ must outlive the threads already running
+                }
+        }
+
+        return 1;
+err:
+        while (n--) {
+                pthread_mutex_destroy(&threads_[n].lock);
+                close(threads_[n].epoll_fd);
+        }
+        free(threads_);
+        threads_ = NULL;
+
+        return 0;
+}
+
+int
+FIX_Reactor::attach(struct reactor_source_t * const source)
+{
+        unsigned int n;
+        int retv = 0;
+        struct epoll_event event;
+        struct reactor_thread_t *thread;
+
+        if (!thread_count_) {
+                M_ALERT("reactor not initialized");
+                return 0;
+        }
+        if (guard_.enter()) {
+                M_ALERT("could not lock");
+                return 0;
+        }
+
+        thread = &threads_[0];
+        for (n = 1; n < thread_count_; ++n) {
+                if (__atomic_load_n(&threads_[n].source_count, __ATOMIC_RELAXED) < __atomic_load_n(&thread->source_count, __ATOMIC_RELAXED))
+                        thread = &threads_[n];
+        }
+
+        memset(&event, 0, sizeof(event));
+        event.events = EPOLLIN | EPOLLRDHUP | EPOLLET;
+        event.data.ptr = source;
+
+        pthread_mutex_lock(&thread->lock);
+        source->backlogged = 0;
+        source->next = NULL;
+        __atomic_store_n(&source->thread, thread, __ATOMIC_RELEASE);
+        if (epoll_ctl(thread->epoll_fd, EPOLL_CTL_ADD, source->fd, &event)) {
+                M_ALERT("could not add socket to reactor: %s", strerror(errno));
+                __atomic_store_n(&source->thread, (struct reactor_thread_t*)NULL, __ATOMIC_RELEASE);
+        } else {
+                __atomic_fetch_add(&thread->source_count, 1, __ATOMIC_RELAXED);
+                retv = 1;
+        }
+        pthread_mutex_unlock(&thread->lock);
+
+        guard_.leave();
+
+        return retv;
+}
+
+void
+FIX_Reactor::detach(struct reactor_source_t * const source)
+{
+        struct reactor_thread_t *thread;
+
+        if (guard_.enter()) {
+                M_ALERT("could not lock");
+                abort();
+        }
+
+        thread = __atomic_load_n(&source->thread, __ATOMIC_ACQUIRE);
+        if (thread) {
+                pthread_mutex_lock(&thread->lock);
+                if (thread == source->thread) // not dropped meanwhile
+                        remove_source(thread, source);
+                pthread_mutex_unlock(&thread->lock);
+        }
+
+        guard_.leave();
+}
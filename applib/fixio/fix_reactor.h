@@ -0,0 +1,67 @@
+/*
+ *    Copyright (C) 2013, Jules Colding <jcolding@gmail.com>.
+ *
+ *    All Rights Reserved.
+ */
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     (1) Redistributions of source code must retain the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer.
+ *
+ *     (2) Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *
+ *     (3) Neither the name of the copyright holder nor the names of
+ *     its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written
+ *     permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS
+ * OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#pragma once
+
+#ifdef HAVE_CONFIG_H
+    #include "ac_config.h"
+#endif
+
+struct reactor_thread_t;
+
+/*
+ * A socket read by a reactor thread. Please see class FIX_Reactor in
+ * fixio.h.
+ *
+ * on_readable() is called by the reactor thread when fd has become
+ * readable and must read it until recv() would block. It returns 0
+ * (zero) when it has done so, EAGAIN if it could not and must be
+ * called again shortly, e.g. because the queue it reads into is
+ * full, or another errno value if the reactor must drop the socket.
+ */
+struct reactor_source_t {
+        int fd;
+        int (*on_readable)(struct reactor_source_t * const source);
+        void *arg; // for on_readable()
+
+        // owned by the reactor
+        struct reactor_thread_t *thread; // NULL if not attached
+        int backlogged;                  // 1 (one) if on the backlog of thread, 0 (zero) if not
+        struct reactor_source_t *next;   // next source on the backlog
+};
@@ -52,10 +52,50 @@
 #include "stdlib/local_db/sqlite3.h"
 #include "stdlib/locks/region_lock.h"
 #include "stdlib/locks/guard.h"
+#include "stdlib/process/threads.h"
 #include "applib/fixutils/db_utils.h"
 #include "applib/fixutils/stack_utils.h"
 #include "applib/fixmsg/fix_types.h"
 
+/*
+ * How the pusher and popper threads move data to and from the
+ * socket.
+ *
+ * SYSCALL_IO      - writev() and recvfrom(). The default.
+ *
+ * URING_IO        - io_uring. Sent batches are submitted as one
+ *                   sendmsg() each and data is recieved by a
+ *                   multishot recv() into foxtrot entries lent to the
+ *                   kernel as provided buffers.
+ *
+ * URING_SQPOLL_IO - As URING_IO, but a kernel thread polls the
+ *                   submission queues so that submitting needs no
+ *                   system call while the session is busy.
+ *
+ * The io_uring backends are only available if the kernel headers
+ * are. A thread falls back to SYSCALL_IO if the running kernel does
+ * not support io_uring.
+ */
+enum FIXIOBackend {
+        SYSCALL_IO,
+        URING_IO,
+        URING_SQPOLL_IO,
+};
+
+/*
+ * The threads of the popper.
+ *
+ * SUCKER_THREAD   - Reads the source into the recieve queue. Not
+ *                   used if the popper is read by a reactor.
+ *
+ * SPLITTER_THREAD - Splits the recieved data into messages for the
+ *                   threads calling pop() and session_pop().
+ */
+enum FIXPopperThread {
+        SUCKER_THREAD,
+        SPLITTER_THREAD,
+};
+
 struct alfa_io_t;
 struct bravo_io_t;
 struct charlie_io_t;
@@ -63,9 +103,14 @@ struct delta_io_t;
 struct echo_io_t;
 struct foxtrot_io_t;
 struct romeo_io_t;
+struct rx_slab_t;
+struct reactor_source_t;
+struct reactor_sucker_t;
+struct reactor_thread_t;
 struct pusher_thread_args_t;
 struct sucker_thread_args_t;
 struct splitter_thread_args_t;
+class FIXMessageTX;
 
 /*
  * Outstanding issue: Do Popper and Pusher instances live forever? If
@@ -83,6 +128,17 @@ struct splitter_thread_args_t;
 class FIX_PushBase
 {
 public:
+        /*
+         * One message of a batch handed to push_batch(). The fields
+         * are the parameters of push().
+         */
+        struct BatchMessage {
+                const struct timeval *ttl;
+                size_t len;
+                const uint8_t *data;
+                const char *msg_type;
+        };
+
         /*
          * Pushes a FIX messages onto the outgoing stack.
          *
@@ -115,6 +171,21 @@ public:
                          const uint8_t * const data,
                          const char * const msg_type) = 0;
 
+        /*
+         * Pushes count messages as one. The messages are sent in the
+         * given order with contiguous sequence numbers and no other
+         * message in between, e.g. all orders of a basket.
+         *
+         * Please see FIX_PushBase::push() for the data format. Each
+         * message must be small enough for the fast queue of the
+         * implementation and count must not exceed its capacity.
+         *
+         * Returns 0 (zero) if all is well or an errno value if
+         * not. No message is pushed if an error is returned.
+         */
+        virtual int push_batch(const size_t count,
+                               const struct BatchMessage * const msgs) = 0;
+
         /*
          * Please see FIX_PushBase::push() for the data format.
          *
@@ -180,6 +251,14 @@ public:
                  const uint8_t * const data,
                  const char * const msg_type);
 
+        /*
+         * Please see base class documentation. The messages must
+         * each fit in one alfa entry and count must not exceed the
+         * length of alfa.
+         */
+        int push_batch(const size_t count,
+                       const struct BatchMessage * const msgs);
+
         /*
          * Please see base class documentation.
          */
@@ -244,6 +323,83 @@ public:
          */
         void stop(void);
 
+        /*
+         * Sets the durability policy of the local database caching
+         * sent messages. Please see MsgDB::set_durability(). It
+         * takes effect the next time start() is called.
+         *
+         * Returns 1 (one) if all is well, 0 (zero) otherwise.
+         */
+        int set_durability(const enum MsgDBDurability policy,
+                           const uint64_t value)
+                {
+                        return db_.set_durability(policy, value);
+                };
+
+        /*
+         * Selects the backend of the local database caching sent
+         * messages. Please see MsgDB::set_store_type(). Must be
+         * called while stopped.
+         *
+         * Returns 1 (one) if all is well, 0 (zero) otherwise.
+         */
+        int set_store_type(const enum MsgStoreType type)
+                {
+                        return db_.set_store_type(type);
+                };
+
+        /*
+         * Selects how the pusher thread waits for messages to send
+         * and how threads blocking on the queues of the pusher
+         * wait. Please see enum wait_strategy_kind_t in
+         * stdlib/disruptor/disruptor_types.h. timeout may be NULL.
+         *
+         * The pusher thread polls several queues and can therefore
+         * not park. It sleeps for the timeout after spinning if kind
+         * is WAIT_SPIN_PARK.
+         *
+         * By default the pusher thread spins, then yields
+         * (WAIT_SPIN_YIELD). Must be called after init() while
+         * stopped.
+         *
+         * Returns 1 (one) if all is well, 0 (zero) otherwise.
+         */
+        int set_wait_strategy(const enum wait_strategy_kind_t kind,
+                              const unsigned int spin_count,
+                              const struct timespec * const timeout);
+
+        /*
+         * Selects how the pusher thread writes to the sink. Please
+         * see enum FIXIOBackend. Resent messages are always written
+         * with writev(). Must be called while stopped.
+         *
+         * Returns 1 (one) if all is well, 0 (zero) if the backend is
+         * not available.
+         */
+        int set_io_backend(const enum FIXIOBackend backend);
+
+        /*
+         * Places the pusher thread. Please see struct
+         * thread_placement_t in stdlib/process/threads.h. The thread
+         * is placed when it is started and the queues of the pusher
+         * are moved to the NUMA node of the CPU it is pinned to. Must
+         * be called after init() while stopped.
+         *
+         * Returns 1 (one) if all is well, 0 (zero) otherwise.
+         */
+        int set_thread_placement(const struct thread_placement_t * const placement);
+
+        /*
+         * Selects how the memory of the queues of the pusher is
+         * allocated. flags is a bitwise OR of enum ring_mem_flags_t
+         * in stdlib/disruptor/disruptor_types.h. Flags that can not
+         * be honored are logged and ignored. Must be called before
+         * the first call to init().
+         *
+         * Returns 1 (one) if all is well, 0 (zero) otherwise.
+         */
+        int set_ring_memory(const int flags);
+
 private:
         /*
          * Default constructor disallowed
@@ -281,13 +437,25 @@ private:
                 };
 
         /*
-         * Exclusively used for resending
+         * Exclusively used for resending. msg_seq_number is the
+         * sequence number the message will be sent with.
          */
-	int push_to_romeo(const struct timeval * const ttl,
+	int push_to_romeo(const uint64_t msg_seq_number,
+			  const struct timeval * const ttl,
 			  const size_t len,
 			  const uint8_t * const data,
 			  const char * const msg_type);
 
+	/*
+	 * Pushes a SequenceReset-GapFill message with sequence number
+	 * begin and NewSeqNo new_seqnum into romeo.
+	 *
+	 * Returns 0 (zero) if all is well or an errno value if not.
+	 */
+	int push_gap_fill_to_romeo(FIXMessageTX & tx_msg,
+				   const uint64_t begin,
+				   const uint64_t new_seqnum);
+
 	/*
 	 * Returns a suitable formatted value for tag 52
 	 * (SendingTime).
@@ -299,21 +467,32 @@ private:
 	 * resending. It will save a zero terminated copy of the old
 	 * sending time value in orig_sendingtime to be used as value
 	 * for tag 122 (OrigSendingTime).
+	 *
+	 * Returns 1 (one) if the message has a sending time, 0
+	 * (zero) if not.
 	 */
-	void update_sendingtime(PartialMessage * const pmsg,
-				char orig_sendingtime[24]) const;
+	int update_sendingtime(uint8_t * const part_msg,
+			       const size_t length,
+			       char orig_sendingtime[24]) const;
 
         char FIX_start_bytes_[32];          // standard prefilled FIX start characters - "8=FIX.X.Y<SOH>9="
 	FIX_Version fix_ver_;               // FIX protocol version
 	uint64_t msg_seq_number_;           // message sequence number
 	uint64_t push_loop_count_;
         int FIX_start_bytes_length_;        // strlen of FIX version field
+        int FIX_start_bytes_checksum_;      // checksum of FIX_start_bytes_
         int error_;                         // errno from the pusher thread
         int pause_thread_;                  // pause pusher thread
+        int hold_thread_;                   // hold pusher thread while resending
+        int thread_is_held_;                // 1 (one) if the pusher thread is held, 0 (zero) if not
         int db_is_open_;                    // 1 (one) if the database is open, 0 (zero) if not
         int started_;                       // 1 (one) if started, 0 (zero) if not
         struct pusher_thread_args_t *args_; // parameters for the pusher thread
         MsgDB db_;                          // holding sent partial messages
+        struct wait_strategy_t wait_strategy_; // how the pusher thread waits
+        int io_backend_;                    // enum FIXIOBackend
+        struct thread_placement_t placement_; // where the pusher thread runs
+        int ring_mem_flags_;                // enum ring_mem_flags_t
 
         int sink_fd_; // the file descriptor of the socket sink
 
@@ -335,6 +514,73 @@ private:
 };
 
 
+/*
+ * A pool of reactor threads reading the sources of many FIX_Popper
+ * instances. Each reactor thread multiplexes the sockets attached to
+ * it with an edge-triggered epoll instance and reads every readable
+ * socket into the recieve queue of its popper until recv() would
+ * block. A popper handed to a reactor by FIX_Popper::set_reactor()
+ * has no sucker thread of its own.
+ *
+ * The splitter and pusher threads of a session are not affected.
+ */
+class FIX_Reactor
+{
+public:
+        FIX_Reactor(void);
+
+        /*
+         * Starts thread_count reactor threads. Must be called once
+         * before any popper using the reactor is started.
+         *
+         * Returns 1 (one) if all is well, 0 (zero) otherwise.
+         */
+        int init(const unsigned int thread_count);
+
+        /*
+         * Hands source to the reactor thread with the fewest
+         * sources. Used by FIX_Popper::start().
+         *
+         * Returns 1 (one) if all is well, 0 (zero) otherwise.
+         */
+        int attach(struct reactor_source_t * const source);
+
+        /*
+         * Takes source away from its reactor thread. No reactor
+         * thread touches source once detach() returns. Sources
+         * dropped by the reactor thread because of errors are
+         * ignored. Used by FIX_Popper::stop().
+         */
+        void detach(struct reactor_source_t * const source);
+
+private:
+        /*
+         * Copy constructor disallowed
+         */
+        FIX_Reactor(const FIX_Reactor&)
+                {
+                };
+
+        /*
+         * This object must live forever
+         */
+        ~FIX_Reactor()
+                {
+                };
+
+        /*
+         * Assignemnt operator disallowed
+         */
+        FIX_Reactor& operator=(const FIX_Reactor&)
+                {
+                        return *this;
+                };
+
+        struct reactor_thread_t *threads_;
+        unsigned int thread_count_;
+        MutexGuard guard_; // serializes attach() and detach()
+};
+
 /*
 g * Pops complate messages from the recieve stack. Takes, by necessity,
  * care of detecting message gabs and ResendRequest/SequenceReset.
@@ -348,6 +594,20 @@ public:
                 uint8_t *data;           // the FIX message itself
         };
 
+        /*
+         * A recieved message as returned by pop_view(). data points
+         * either into one of the slabs recieved data is read into
+         * (zero-copy mode) or to a malloc'ed copy of the message
+         * (slab is NULL). Either way the view must be handed back
+         * with release_view() when done processing.
+         */
+        struct MessageView {
+                uint32_t len;            // length of message in bytes
+                uint32_t msgtype_offset; // offset in bytes of first character in message type field
+                uint8_t *data;           // the FIX message itself
+                struct rx_slab_t *slab;  // slab holding data, NULL if data is malloc'ed
+        };
+
         /*
          * Call this with SOH or whatever you want as delimiter for
          * testing
@@ -400,6 +660,25 @@ public:
                  struct cursor_t * const cursor,
                  std::queue<struct FIX_Popper::RawMessage> * const messages);
 
+        /*
+         * threadsafe - same as pop() above, but without copying the
+         * message out of the recieve buffers in zero-copy mode. Please
+         * see set_zero_copy().
+         *
+         * The view must be handed back with release_view() as soon
+         * as possible. The sucker thread stops reading from the
+         * source when all slabs are referenced by outstanding views.
+         *
+         * Returns zero if all is well, 1 (one) if not.
+         */
+        int pop_view(struct MessageView * const view);
+
+        /*
+         * Releases a view returned by pop_view(). The view is
+         * cleared.
+         */
+        void release_view(struct MessageView * const view);
+
         /*
          * Register state variables for above method. This method will
          * block until caller may start popping.
@@ -503,6 +782,110 @@ public:
          */
         int stop(void);
 
+        /*
+         * Sets the durability policy of the local database caching
+         * recieved messages. Please see MsgDB::set_durability(). It
+         * takes effect the next time start() is called.
+         *
+         * Returns 1 (one) if all is well, 0 (zero) otherwise.
+         */
+        int set_durability(const enum MsgDBDurability policy,
+                           const uint64_t value)
+                {
+                        return db_.set_durability(policy, value);
+                };
+
+        /*
+         * Selects the backend of the local database caching recieved
+         * messages. Please see MsgDB::set_store_type(). Must be
+         * called while stopped.
+         *
+         * Returns 1 (one) if all is well, 0 (zero) otherwise.
+         */
+        int set_store_type(const enum MsgStoreType type)
+                {
+                        return db_.set_store_type(type);
+                };
+
+        /*
+         * Selects zero-copy mode. In zero-copy mode the source is read
+         * into a ring of large reference counted slabs and recieved
+         * messages are handed to pop_view() as views into these
+         * slabs. Only messages straddling two slabs are copied.
+         *
+         * pop() works in both modes, but copies the message out of
+         * the slab in zero-copy mode.
+         *
+         * Must be called while stopped.
+         *
+         * Returns 1 (one) if all is well, 0 (zero) otherwise.
+         */
+        int set_zero_copy(const int zero_copy);
+
+        /*
+         * Selects how the sucker and splitter threads wait for data
+         * and how threads blocking in pop() and session_pop()
+         * wait. Please see enum wait_strategy_kind_t in
+         * stdlib/disruptor/disruptor_types.h. timeout may be NULL.
+         *
+         * By default the splitter thread spins, then yields
+         * (WAIT_SPIN_YIELD). Must be called after init() while
+         * stopped.
+         *
+         * Returns 1 (one) if all is well, 0 (zero) otherwise.
+         */
+        int set_wait_strategy(const enum wait_strategy_kind_t kind,
+                              const unsigned int spin_count,
+                              const struct timespec * const timeout);
+
+        /*
+         * Selects how the sucker thread reads the source. Please see
+         * enum FIXIOBackend. Zero-copy mode always reads with
+         * recvfrom(). Must be called while stopped.
+         *
+         * Returns 1 (one) if all is well, 0 (zero) if the backend is
+         * not available.
+         */
+        int set_io_backend(const enum FIXIOBackend backend);
+
+        /*
+         * Lets a reactor thread read the source instead of a sucker
+         * thread of the popper. Please see class FIX_Reactor. The
+         * source is read with recv() into the recieve queue, so
+         * zero-copy mode and the io_uring backends are not available.
+         *
+         * Must be called before the first call to init().
+         *
+         * Returns 1 (one) if all is well, 0 (zero) otherwise.
+         */
+        int set_reactor(FIX_Reactor * const reactor);
+
+        /*
+         * Places a thread of the popper. Please see struct
+         * thread_placement_t in stdlib/process/threads.h. The thread
+         * is placed when it is started. The queue read by the
+         * splitter thread is moved to the NUMA node of the CPU the
+         * sucker thread is pinned to and the queues written by the
+         * splitter thread to that of the splitter thread. Threads
+         * calling pop() should run on the same node as the splitter
+         * thread. Must be called after init() while stopped.
+         *
+         * Returns 1 (one) if all is well, 0 (zero) otherwise.
+         */
+        int set_thread_placement(const enum FIXPopperThread thread,
+                                 const struct thread_placement_t * const placement);
+
+        /*
+         * Selects how the memory of the queues of the popper is
+         * allocated. flags is a bitwise OR of enum ring_mem_flags_t
+         * in stdlib/disruptor/disruptor_types.h. Flags that can not
+         * be honored are logged and ignored. Must be called before
+         * the first call to init().
+         *
+         * Returns 1 (one) if all is well, 0 (zero) otherwise.
+         */
+        int set_ring_memory(const int flags);
+
 private:
         /*
          * Default constructor disallowed
@@ -551,6 +934,7 @@ private:
         struct sucker_thread_args_t *sucker_args_;     // parameters for the sucker thread
         struct splitter_thread_args_t *splitter_args_; // parameters for the splitter thread
         MsgDB db_;                                     // holding recieved messages
+        struct wait_strategy_t wait_strategy_;         // how the sucker and splitter threads wait
 
         MutexGuard guard_;
         delta_io_t *delta_;
@@ -567,6 +951,15 @@ private:
         foxtrot_io_t *foxtrot_;
         const size_t foxtrot_max_data_length_;
 
+        int zero_copy_;                                // 1 (one) if reading into slabs_, 0 (zero) if not
+        int io_backend_;                               // enum FIXIOBackend
+        struct rx_slab_t *slabs_;                      // RX_SLAB_COUNT slabs for zero-copy mode
+        FIX_Reactor *reactor_;                         // reads the source if not NULL
+        struct thread_placement_t sucker_placement_;   // where the sucker thread runs
+        struct thread_placement_t splitter_placement_; // where the splitter thread runs
+        int ring_mem_flags_;                           // enum ring_mem_flags_t
+        struct reactor_sucker_t *reactor_sucker_;      // state of the source on the reactor
+
         FIX_PushBase *pusher_;
         const char soh_; // used to overwrite SOH ('\1') for testing
 };
@@ -38,9 +38,11 @@
  */
 
 #include <sys/socket.h>
+#include <sys/wait.h>
 #include <stdio.h>
 #include <check.h>
 #include <fcntl.h>
+#include <poll.h>
 #include <queue>
 #include <new>
 
@@ -52,6 +54,8 @@
 #include "stdlib/disruptor/memsizes.h"
 #include "applib/fixio/fixio.h"
 #include "applib/fixutils/db_utils.h"
+#include "applib/fixutils/mmap_store.h"
+#include "stdlib/local_db/sqlite3.h"
 #include "applib/fixmsg/fix_fields.h"
 
 
@@ -406,6 +410,376 @@ START_TEST(test_message_database)
 }
 END_TEST
 
+/*
+ * Test that all stored messages make it to disk regardless of
+ * durability policy
+ */
+START_TEST(test_message_database_durability)
+{
+        int n;
+        int k;
+        MsgDB db;
+        uint64_t num;
+        PartialMessageList *pmsg_list;
+        const char * const db_path = "23E19F70-616C-4551-BB0E-2EF61EFB9474.db";
+        const enum MsgDBDurability policy[3] = { COMMIT_EVERY_MESSAGE, COMMIT_EVERY_N_MESSAGES, COMMIT_EVERY_T_USEC };
+        const uint64_t value[3] = { 0, 7, 1000000 };
+
+        fail_unless(0 == db.set_durability(COMMIT_EVERY_N_MESSAGES, 0));
+        fail_unless(0 == db.set_durability(COMMIT_EVERY_T_USEC, 0));
+
+        for (k = 0; k < 3; ++k) {
+                remove(db_path);
+                fail_unless(1 == db.set_durability(policy[k], value[k]));
+                fail_unless(1 == db.set_db_path(db_path));
+                fail_unless(1 == db.open());
+
+                for (n = 1; n <= 1000; ++n) {
+                        fail_unless(1 == db.store_sent_msg(n, strlen(partial_messages[n % 16]), UINT32_MAX, 0, (const uint8_t*)partial_messages[n % 16], message_types[n % 16]));
+                        fail_unless(1 == db.store_recv_msg(n, strlen(complete_messages[n % 16]), (const uint8_t*)complete_messages[n % 16]));
+                }
+                fail_unless(1 == db.close());
+
+                fail_unless(1 == db.open());
+                fail_unless(1 == db.get_latest_sent_seqnum(num));
+                fail_unless(1000 == num);
+                fail_unless(1 == db.get_latest_recv_seqnum(num));
+                fail_unless(1000 == num);
+
+                pmsg_list = db.get_sent_msgs(1, 0);
+                fail_unless(NULL != pmsg_list, NULL);
+                fail_unless(1000 == pmsg_list->size(), NULL);
+                for (n = 1; n <= 1000; ++n) {
+                        fail_unless(NULL != pmsg_list->get_at(n - 1));
+                        fail_unless(strlen(partial_messages[n % 16]) == pmsg_list->get_at(n - 1)->length);
+                        fail_unless(0 == memcmp(partial_messages[n % 16], pmsg_list->get_at(n - 1)->part_msg, pmsg_list->get_at(n - 1)->length));
+                        fail_unless(0 == strcmp(message_types[n % 16], pmsg_list->get_at(n - 1)->msg_type));
+                }
+                delete pmsg_list;
+
+                fail_unless(1 == db.close());
+        }
+        remove(db_path);
+}
+END_TEST
+
+/*
+ * Test that an idle journal thread parks instead of spinning and
+ * still picks up new messages
+ */
+START_TEST(test_message_database_idle)
+{
+        int k;
+        MsgDB db;
+        uint64_t num;
+        uint64_t used_nsec;
+        struct timespec before;
+        struct timespec after;
+        const struct timespec idle = { 0, 300*1000*1000 };
+        const char * const db_path = "23E19F70-616C-4551-BB0E-2EF61EFB9474.db";
+
+        remove(db_path);
+        fail_unless(1 == db.set_db_path(db_path));
+        for (k = 0; k < 2; ++k) {
+                fail_unless(1 == db.set_durability(k ? COMMIT_EVERY_T_USEC : COMMIT_EVERY_N_MESSAGES, k ? 500 : 128));
+                fail_unless(1 == db.open());
+
+                fail_unless(0 == clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &before));
+                nanosleep(&idle, NULL);
+                fail_unless(0 == clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &after));
+                used_nsec = (uint64_t)(after.tv_sec - before.tv_sec)*1000000000 + (uint64_t)after.tv_nsec - (uint64_t)before.tv_nsec;
+                fail_unless(100*1000*1000 > used_nsec, NULL);
+
+                fail_unless(1 == db.store_recv_msg(10 + k, strlen(complete_messages[7]), (const uint8_t*)complete_messages[7]));
+                fail_unless(1 == db.get_latest_recv_seqnum(num));
+                fail_unless((uint64_t)(10 + k) == num);
+                fail_unless(1 == db.close());
+        }
+        remove(db_path);
+}
+END_TEST
+
+/*
+ * Test that a failed write is not reported as committed and that the
+ * error sticks until the database is reopened
+ */
+START_TEST(test_message_database_journal_error)
+{
+        MsgDB db;
+        uint64_t num;
+        sqlite3 *lock = NULL;
+        const char * const db_path = "23E19F70-616C-4551-BB0E-2EF61EFB9474.db";
+
+        remove(db_path);
+        fail_unless(1 == db.set_store_type(SQLITE_STORE));
+        fail_unless(1 == db.set_durability(COMMIT_EVERY_MESSAGE, 0));
+        fail_unless(1 == db.set_db_path(db_path));
+        fail_unless(1 == db.open());
+        fail_unless(1 == db.store_recv_msg(1, strlen(complete_messages[7]), (const uint8_t*)complete_messages[7]));
+        fail_unless(1 == db.flush());
+
+        // another connection keeps the journal from writing
+        fail_unless(SQLITE_OK == sqlite3_open(db_path, &lock));
+        fail_unless(SQLITE_OK == sqlite3_exec(lock, "BEGIN EXCLUSIVE", NULL, NULL, NULL));
+        fail_unless(1 == db.store_recv_msg(2, strlen(complete_messages[7]), (const uint8_t*)complete_messages[7]));
+        fail_unless(0 == db.flush());
+        fail_unless(0 == db.get_latest_recv_seqnum(num));
+        fail_unless(0 == db.store_recv_msg(3, strlen(complete_messages[7]), (const uint8_t*)complete_messages[7]));
+        fail_unless(0 == db.store_sent_msg(3, strlen(partial_messages[3]), UINT32_MAX, 0, (const uint8_t*)partial_messages[3], message_types[3]));
+
+        // still failing after the lock is gone
+        fail_unless(SQLITE_OK == sqlite3_exec(lock, "COMMIT", NULL, NULL, NULL));
+        fail_unless(SQLITE_OK == sqlite3_close(lock));
+        fail_unless(0 == db.flush());
+        db.close();
+
+        fail_unless(1 == db.open());
+        fail_unless(1 == db.get_latest_recv_seqnum(num));
+        fail_unless(1 == num);
+        fail_unless(1 == db.store_recv_msg(3, strlen(complete_messages[7]), (const uint8_t*)complete_messages[7]));
+        fail_unless(1 == db.get_latest_recv_seqnum(num));
+        fail_unless(3 == num);
+        fail_unless(1 == db.close());
+        remove(db_path);
+}
+END_TEST
+
+static void*
+store_sent_messages(void *arg)
+{
+        MsgDB * const db = (MsgDB*)arg;
+        int n;
+
+        for (n = 1; n <= 2000; ++n) {
+                if (1 != db->store_sent_msg(n, strlen(partial_messages[n % 16]), UINT32_MAX, 0, (const uint8_t*)partial_messages[n % 16], message_types[n % 16]))
+                        return (void*)1;
+        }
+
+        return NULL;
+}
+
+/*
+ * Test that readers may use the SQLite store while the journal
+ * thread writes to it
+ */
+START_TEST(test_message_database_concurrent_readers)
+{
+        size_t n;
+        MsgDB db;
+        void *rval;
+        uint64_t num;
+        uint64_t prev_num = 0;
+        uint64_t start;
+        pthread_t writer;
+        SentMsgChunk chunk;
+        const char * const db_path = "23E19F70-616C-4551-BB0E-2EF61EFB9474.db";
+
+        remove(db_path);
+        fail_unless(1 == db.set_store_type(SQLITE_STORE));
+        fail_unless(1 == db.set_durability(COMMIT_EVERY_N_MESSAGES, 7));
+        fail_unless(1 == db.set_db_path(db_path));
+        fail_unless(1 == db.open());
+        fail_unless(0 == pthread_create(&writer, NULL, store_sent_messages, &db));
+
+        do {
+                fail_unless(1 == db.get_latest_sent_seqnum(num));
+                fail_unless(prev_num <= num);
+                prev_num = num;
+
+                start = 1;
+                fail_unless(1 == db.get_sent_msgs_chunk(start, 0, 64, chunk));
+                for (n = 0; n < chunk.size(); ++n) {
+                        fail_unless(n + 1 == chunk.seqnum(n));
+                        fail_unless(strlen(partial_messages[(n + 1) % 16]) == chunk.length(n));
+                        fail_unless(0 == memcmp(partial_messages[(n + 1) % 16], chunk.part_msg(n), chunk.length(n)));
+                        fail_unless(0 == strcmp(message_types[(n + 1) % 16], chunk.msg_type(n)));
+                }
+        } while (2000 > num);
+
+        fail_unless(0 == pthread_join(writer, &rval));
+        fail_unless(NULL == rval);
+        fail_unless(1 == db.close());
+        remove(db_path);
+}
+END_TEST
+
+static void
+remove_mmap_store(const char * const prefix)
+{
+        static const char * const suffixes[] = { "sent.idx", "sent.0000", "sent.0001", "recv.idx", "recv.0000", "recv.0001" };
+        char path[256];
+        unsigned int n;
+
+        for (n = 0; n < sizeof(suffixes)/sizeof(suffixes[0]); ++n) {
+                snprintf(path, sizeof(path), "%s.%s", prefix, suffixes[n]);
+                remove(path);
+        }
+}
+
+START_TEST(test_message_store_mmap)
+{
+        int n;
+        MsgDB db;
+        uint64_t num;
+        PartialMessageList *pmsg_list;
+        std::vector<std::vector<uint8_t> > *recv_list;
+        const char * const db_path = "0B5A4C9E-3B8D-4F0A-9C61-7D2E5B1A8F34";
+        const uint64_t big_length = 17*1024*1024; // larger than a segment
+        uint8_t *big_msg = (uint8_t*)malloc(big_length);
+
+        fail_unless(NULL != big_msg);
+        memset(big_msg, 'x', big_length);
+        remove_mmap_store(db_path);
+
+        fail_unless(1 == db.set_store_type(MMAP_STORE));
+        fail_unless(1 == db.set_db_path(db_path));
+        fail_unless(1 == db.open());
+        fail_unless(0 == db.set_store_type(SQLITE_STORE));
+
+        fail_unless(1 == db.get_latest_sent_seqnum(num));
+        fail_unless(0 == num);
+
+        for (n = 1; n <= 1000; ++n) {
+                fail_unless(1 == db.store_sent_msg(n, strlen(partial_messages[n % 16]), (2 == n) ? 1 : UINT32_MAX, 0, (const uint8_t*)partial_messages[n % 16], message_types[n % 16]));
+                fail_unless(1 == db.store_recv_msg(n, strlen(complete_messages[n % 16]), (const uint8_t*)complete_messages[n % 16]));
+        }
+        // replaces the first message number 500
+        fail_unless(1 == db.store_sent_msg(500, strlen(partial_messages[0]), UINT32_MAX, 0, (const uint8_t*)partial_messages[0], message_types[0]));
+        fail_unless(1 == db.store_sent_msg(1001, big_length, UINT32_MAX, 0, big_msg, "D"));
+        fail_unless(1 == db.close());
+
+        fail_unless(1 == db.open());
+        fail_unless(1 == db.get_latest_sent_seqnum(num));
+        fail_unless(1001 == num);
+        fail_unless(1 == db.get_latest_recv_seqnum(num));
+        fail_unless(1000 == num);
+
+        pmsg_list = db.get_sent_msgs(1, 0);
+        fail_unless(NULL != pmsg_list);
+        fail_unless(1001 == pmsg_list->size());
+        for (n = 1; n <= 1000; ++n) {
+                if (2 == n) { // expired
+                        fail_unless(0 == pmsg_list->get_at(n - 1)->length);
+                        continue;
+                }
+                fail_unless(strlen(partial_messages[(500 == n) ? 0 : n % 16]) == pmsg_list->get_at(n - 1)->length);
+                fail_unless(0 == memcmp(partial_messages[(500 == n) ? 0 : n % 16], pmsg_list->get_at(n - 1)->part_msg, pmsg_list->get_at(n - 1)->length));
+                fail_unless(0 == strcmp(message_types[(500 == n) ? 0 : n % 16], pmsg_list->get_at(n - 1)->msg_type));
+        }
+        fail_unless(big_length == pmsg_list->get_at(1000)->length);
+        fail_unless(0 == memcmp(big_msg, pmsg_list->get_at(1000)->part_msg, big_length));
+        delete pmsg_list;
+
+        pmsg_list = db.get_sent_msgs(10, 20);
+        fail_unless(NULL != pmsg_list);
+        fail_unless(11 == pmsg_list->size());
+        fail_unless(0 == memcmp(partial_messages[10], pmsg_list->get_at(0)->part_msg, pmsg_list->get_at(0)->length));
+        delete pmsg_list;
+
+        recv_list = db.get_recv_msgs(990, 2000);
+        fail_unless(NULL != recv_list);
+        fail_unless(11 == recv_list->size());
+        for (n = 990; n <= 1000; ++n) {
+                fail_unless(strlen(complete_messages[n % 16]) == (*recv_list)[n - 990].size());
+                fail_unless(0 == memcmp(complete_messages[n % 16], &(*recv_list)[n - 990][0], (*recv_list)[n - 990].size()));
+        }
+        delete recv_list;
+
+        // streamed in chunks
+        {
+                SentMsgChunk chunk;
+                uint64_t next = 1;
+                uint64_t count = 0;
+                size_t k;
+
+                do {
+                        fail_unless(1 == db.get_sent_msgs_chunk(next, 0, 100, chunk));
+                        fail_unless(100 >= chunk.size());
+                        for (k = 0; k < chunk.size(); ++k) {
+                                ++count;
+                                fail_unless(count == chunk.seqnum(k));
+                                fail_unless((2 == count) == chunk.is_expired(k));
+                        }
+                } while (chunk.size());
+                fail_unless(1001 == count);
+        }
+
+        fail_unless(1 == db.close());
+
+        // anonymous store
+        fail_unless(1 == db.set_db_path(":memory:"));
+        fail_unless(1 == db.open());
+        fail_unless(1 == db.store_sent_msg(7, strlen(partial_messages[7]), UINT32_MAX, 0, (const uint8_t*)partial_messages[7], message_types[7]));
+        pmsg_list = db.get_sent_msgs(1, 0);
+        fail_unless(NULL != pmsg_list);
+        fail_unless(1 == pmsg_list->size());
+        fail_unless(0 == memcmp(partial_messages[7], pmsg_list->get_at(0)->part_msg, pmsg_list->get_at(0)->length));
+        delete pmsg_list;
+        fail_unless(1 == db.close());
+
+        remove_mmap_store(db_path);
+        free(big_msg);
+}
+END_TEST
+
+START_TEST(test_message_store_mmap_crash)
+{
+        int status;
+        pid_t pid;
+        uint64_t num;
+        MmapStore store;
+        PartialMessageList *pmsg_list;
+        const char * const db_path = "6F1D3A52-8C4E-4B7A-A0D9-2E5C7B914F68";
+
+        remove_mmap_store(db_path);
+
+        // dies with sequence number 1 stored again but not committed
+        pid = fork();
+        fail_unless(-1 != pid);
+        if (0 == pid) {
+                MmapStore child;
+
+                if (1 != child.open(db_path)
+                    || 1 != child.begin_transaction()
+                    || 1 != child.write_sent_msg(1, 0, 0, INT32_MAX, 0, strlen(partial_messages[1]), (const uint8_t*)partial_messages[1], message_types[1])
+                    || 1 != child.commit_transaction()
+                    || 1 != child.begin_transaction()
+                    || 1 != child.write_sent_msg(1, 0, 0, INT32_MAX, 0, strlen(partial_messages[2]), (const uint8_t*)partial_messages[2], message_types[2])
+                    || 1 != child.write_sent_msg(2, 0, 0, INT32_MAX, 0, strlen(partial_messages[3]), (const uint8_t*)partial_messages[3], message_types[3])) {
+                        _exit(1);
+                }
+                _exit(0);
+        }
+        fail_unless(pid == waitpid(pid, &status, 0));
+        fail_unless(WIFEXITED(status) && 0 == WEXITSTATUS(status));
+
+        fail_unless(1 == store.open(db_path));
+        fail_unless(1 == store.get_latest_sent_seqnum(num));
+        fail_unless(1 == num);
+        pmsg_list = store.get_sent_msgs(1, 0);
+        fail_unless(NULL != pmsg_list);
+        fail_unless(1 == pmsg_list->size());
+        fail_unless(strlen(partial_messages[1]) == pmsg_list->get_at(0)->length);
+        fail_unless(0 == memcmp(partial_messages[1], pmsg_list->get_at(0)->part_msg, pmsg_list->get_at(0)->length));
+        fail_unless(0 == strcmp(message_types[1], pmsg_list->get_at(0)->msg_type));
+        delete pmsg_list;
+
+        // the uncommitted records are not visible after a commit either
+        fail_unless(1 == store.begin_transaction());
+        fail_unless(1 == store.write_sent_msg(3, 0, 0, INT32_MAX, 0, strlen(partial_messages[4]), (const uint8_t*)partial_messages[4], message_types[4]));
+        fail_unless(1 == store.commit_transaction());
+        pmsg_list = store.get_sent_msgs(1, 0);
+        fail_unless(NULL != pmsg_list);
+        fail_unless(2 == pmsg_list->size());
+        fail_unless(0 == memcmp(partial_messages[1], pmsg_list->get_at(0)->part_msg, pmsg_list->get_at(0)->length));
+        fail_unless(0 == memcmp(partial_messages[4], pmsg_list->get_at(1)->part_msg, pmsg_list->get_at(1)->length));
+        delete pmsg_list;
+        fail_unless(1 == store.close());
+
+        remove_mmap_store(db_path);
+}
+END_TEST
+
 /*
  * Test start and stop. The pusher and they popper must be able to
  * stop and start again without loosing any messages.
@@ -557,6 +931,204 @@ START_TEST(test_FIX_send_and_recv_sequentially)
 }
 END_TEST
 
+/*
+ * Test send of test messages as one batch
+ */
+START_TEST(test_FIX_push_batch)
+{
+        int n;
+        uint32_t len;
+        uint32_t msgtype_offset;
+        uint8_t *msg;
+        uint8_t *big;
+        const struct timeval ttl = { 0, 0 };
+        struct FIX_PushBase::BatchMessage batch[16];
+        FIX_Popper *popper = new (std::nothrow) FIX_Popper(DELIM);
+        FIX_Pusher *pusher = new (std::nothrow) FIX_Pusher(DELIM);
+        int sockets[2] = { -1, -1 };
+
+        fail_unless(0 == socketpair(PF_LOCAL, SOCK_STREAM, 0, sockets), NULL);
+        fail_unless(1 == pusher->init(":memory:"), NULL);
+        fail_unless(1 == popper->init(), NULL);
+        pusher->start(":memory:", "FIX.4.1", sockets[0]);
+        popper->start(":memory:", "FIX.4.1", NULL, sockets[1]);
+
+        for (n = 0; n < 16; ++n) {
+                batch[n].ttl = &ttl;
+                batch[n].len = strlen(partial_messages[n]);
+                batch[n].data = (const uint8_t *)partial_messages[n];
+                batch[n].msg_type = message_types[n];
+        }
+
+        // nothing is pushed if one message is too big for alfa
+        big = (uint8_t*)calloc(1, 1024*8);
+        fail_unless(NULL != big, NULL);
+        batch[15].len = 1024*8;
+        batch[15].data = big;
+        fail_unless(EMSGSIZE == pusher->push_batch(16, batch), NULL);
+        batch[15].len = strlen(partial_messages[15]);
+        batch[15].data = (const uint8_t *)partial_messages[15];
+        free(big);
+
+        fail_unless(0 == pusher->push_batch(0, batch), NULL);
+        fail_unless(0 == pusher->push_batch(16, batch), NULL);
+        for (n = 0; n < 16; ++n) {
+                fail_unless(0 == popper->pop(&len, &msgtype_offset, &msg), NULL);
+                fail_unless(len == strlen(complete_messages[n]), NULL);
+                fail_unless(0 == memcmp(complete_messages[n], msg, len), NULL);
+                free(msg);
+        }
+
+        pusher->stop();
+        popper->stop();
+}
+END_TEST
+
+/*
+ * Writes the message the pusher makes of partial into buf and returns
+ * its length. Returns 0 (zero) if buf is too small.
+ */
+static size_t
+complete_partial_message(char * const buf,
+                         const size_t size,
+                         const char * const msg_type,
+                         const int seqnum,
+                         const char * const partial)
+{
+        int body_len;
+        int len;
+        int n;
+
+        // MsgType up to, and including, the delimiter before CheckSum
+        body_len = snprintf(NULL, 0, "35=%s%c34=%d%.*s", msg_type, DELIM, seqnum, (int)strlen(partial) - 3, partial);
+        len = snprintf(buf, size, "8=FIX.4.1%c9=%d%c35=%s%c34=%d%.*s", DELIM, body_len, DELIM, msg_type, DELIM, seqnum, (int)strlen(partial) - 3, partial);
+        if ((size_t)len >= size)
+                return 0;
+        n = snprintf(buf + len, size - len, "10=%03d%c", get_FIX_checksum((uint8_t*)buf, len), DELIM);
+        if ((size_t)(len + n) >= size)
+                return 0;
+
+        return (size_t)(len + n);
+}
+
+/*
+ * Test the cached header templates and sequence number digits of the
+ * pusher. The sequence numbers roll over from 9 to 10 and from 99 to
+ * 100, and "8" and "Ai" share a header template cache slot.
+ */
+START_TEST(test_FIX_header_templates)
+{
+        int n;
+        uint32_t len;
+        uint32_t msgtype_offset;
+        uint8_t *msg;
+        char expected[512];
+        size_t expected_len;
+        const char *partial;
+        const struct timeval ttl = { 0, 0 };
+        const char *types[3] = { "8", "Ai", "D" };
+        FIX_Popper *popper = new (std::nothrow) FIX_Popper(DELIM);
+        FIX_Pusher *pusher = new (std::nothrow) FIX_Pusher(DELIM);
+        int sockets[2] = { -1, -1 };
+
+        fail_unless(0 == socketpair(PF_LOCAL, SOCK_STREAM, 0, sockets), NULL);
+        fail_unless(1 == pusher->init(":memory:"), NULL);
+        fail_unless(1 == popper->init(), NULL);
+        pusher->start(":memory:", "FIX.4.1", sockets[0]);
+        popper->start(":memory:", "FIX.4.1", NULL, sockets[1]);
+
+        for (n = 1; n <= 1001; ++n) {
+                partial = partial_messages[n % 16];
+                fail_unless(0 == pusher->push(&ttl, strlen(partial), (const uint8_t *)partial, types[n % 3]), NULL);
+                expected_len = complete_partial_message(expected, sizeof(expected), types[n % 3], n, partial);
+                fail_unless(0 != expected_len, NULL);
+
+                fail_unless(0 == popper->pop(&len, &msgtype_offset, &msg), NULL);
+                fail_unless(len == expected_len, NULL);
+                fail_unless(0 == memcmp(expected, msg, len), NULL);
+                free(msg);
+        }
+
+        pusher->stop();
+        popper->stop();
+}
+END_TEST
+
+/*
+ * Test that batches are resumed correctly after short writes. The
+ * sink is non-blocking and has a send buffer smaller than a batch,
+ * so writes end in the middle of messages.
+ */
+#define SHORT_WRITE_PARTIAL_SIZE (1600)
+START_TEST(test_FIX_short_writes)
+{
+        int k;
+        int n;
+        int r;
+        int seqnum;
+        int sndbuf = 4096;
+        uint32_t len;
+        uint32_t msgtype_offset;
+        uint8_t *msg;
+        char *expected;
+        size_t expected_len;
+        char *partials[16];
+        const struct timeval ttl = { 0, 0 };
+        struct FIX_PushBase::BatchMessage batch[16];
+        const enum FIXIOBackend backends[3] = { SYSCALL_IO, URING_IO, URING_SQPOLL_IO };
+
+        expected = (char*)malloc(SHORT_WRITE_PARTIAL_SIZE + 128);
+        fail_unless(NULL != expected, NULL);
+        for (n = 0; n < 16; ++n) {
+                partials[n] = (char*)malloc(SHORT_WRITE_PARTIAL_SIZE);
+                fail_unless(NULL != partials[n], NULL);
+                r = snprintf(partials[n], SHORT_WRITE_PARTIAL_SIZE, "%c49=EXEC%c58=", DELIM, DELIM);
+                memset(partials[n] + r, 'a' + n, 1000 + 37*n);
+                snprintf(partials[n] + r + 1000 + 37*n, SHORT_WRITE_PARTIAL_SIZE - (r + 1000 + 37*n), "%c10=", DELIM);
+
+                batch[n].ttl = &ttl;
+                batch[n].len = strlen(partials[n]);
+                batch[n].data = (const uint8_t *)partials[n];
+                batch[n].msg_type = message_types[n];
+        }
+
+        for (k = 0; k < 3; ++k) {
+                FIX_Popper *popper = new (std::nothrow) FIX_Popper(DELIM);
+                FIX_Pusher *pusher = new (std::nothrow) FIX_Pusher(DELIM);
+                int sockets[2] = { -1, -1 };
+
+                fail_unless(0 == socketpair(PF_LOCAL, SOCK_STREAM, 0, sockets), NULL);
+                fail_unless(0 == setsockopt(sockets[0], SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf)), NULL);
+                fail_unless(0 == fcntl(sockets[0], F_SETFL, fcntl(sockets[0], F_GETFL) | O_NONBLOCK), NULL);
+                fail_unless(1 == pusher->set_io_backend(backends[k]), NULL);
+                fail_unless(1 == pusher->init(":memory:"), NULL);
+                fail_unless(1 == popper->init(), NULL);
+                pusher->start(":memory:", "FIX.4.1", sockets[0]);
+                popper->start(":memory:", "FIX.4.1", NULL, sockets[1]);
+
+                seqnum = 0;
+                for (r = 0; r < 16; ++r) {
+                        fail_unless(0 == pusher->push_batch(16, batch), NULL);
+                        for (n = 0; n < 16; ++n) {
+                                expected_len = complete_partial_message(expected, SHORT_WRITE_PARTIAL_SIZE + 128, message_types[n], ++seqnum, partials[n]);
+                                fail_unless(0 != expected_len, NULL);
+                                fail_unless(0 == popper->pop(&len, &msgtype_offset, &msg), NULL);
+                                fail_unless(len == expected_len, NULL);
+                                fail_unless(0 == memcmp(expected, msg, len), NULL);
+                                free(msg);
+                        }
+                }
+
+                pusher->stop();
+                popper->stop();
+        }
+
+        for (n = 0; n < 16; ++n)
+                free(partials[n]);
+        free(expected);
+}
+END_TEST
+
 /*
  * Test send and recieve of test messages sequentially
  */
@@ -649,6 +1221,110 @@ START_TEST(test_FIX_retrieve_sent)
 }
 END_TEST
 
+/*
+ * Reads from fd until count complete messages have been recieved or
+ * nothing has arrived for a while. Returns the number of messages
+ * read.
+ */
+static int
+read_raw_messages(const int fd,
+                  const int count,
+                  std::string & data)
+{
+        char buf[4096];
+        struct pollfd pfd = { fd, POLLIN, 0 };
+        ssize_t bytes;
+        size_t pos;
+        int n = 0;
+
+        data.clear();
+        while (n < count) {
+                if (1 != poll(&pfd, 1, 5000))
+                        break;
+                bytes = read(fd, buf, sizeof(buf));
+                if (0 >= bytes)
+                        break;
+                data.append(buf, bytes);
+
+                n = 0;
+                for (pos = data.find("|10="); std::string::npos != pos; pos = data.find("|10=", pos + 1))
+                        ++n;
+        }
+
+        return n;
+}
+
+/*
+ * Test resending. Runs of expired messages must be replaced by
+ * GapFill messages.
+ */
+START_TEST(test_FIX_resend)
+{
+        int n;
+        size_t pos;
+        std::string data;
+        std::vector<std::string> msgs;
+        const struct timeval ttl = { 10, 0 };
+        const struct timeval ttl_do_not_resend = { 0, 0 };
+        FIX_Pusher *pusher = new (std::nothrow) FIX_Pusher(DELIM);
+        int sockets[2] = { -1, -1 };
+        const char * const db_path = "7C1E5D2A-94B3-4E8F-A0D6-3F2B8C9E1A47.db";
+
+        remove(db_path);
+
+        fail_unless(0 == socketpair(PF_LOCAL, SOCK_STREAM, 0, sockets), NULL);
+        fail_unless(1 == pusher->init(db_path), NULL);
+        fail_unless(1 == pusher->start(NULL, "FIX.4.1", sockets[0]), NULL);
+
+        // sequence numbers 3, 4, 5 and 20 are expired
+        for (n = 1; n <= 20; ++n) {
+                if ((3 <= n && 5 >= n) || (20 == n)) {
+                        fail_unless(0 == pusher->push(&ttl_do_not_resend, strlen(partial_messages[n % 16]), (const uint8_t *)partial_messages[n % 16], message_types[n % 16]), NULL);
+                } else {
+                        fail_unless(0 == pusher->push(&ttl, strlen(partial_messages[n % 16]), (const uint8_t *)partial_messages[n % 16], message_types[n % 16]), NULL);
+                }
+        }
+        fail_unless(20 == read_raw_messages(sockets[1], 20, data), NULL);
+
+        fail_unless(0 == pusher->resend(2, 0), NULL);
+        fail_unless(17 == read_raw_messages(sockets[1], 17, data), NULL);
+
+        for (pos = 0, n = 0; n < 17; ++n) {
+                size_t end = data.find("|10=", pos) + strlen("|10=XXX|");
+                msgs.push_back(data.substr(pos, end - pos));
+                pos = end;
+        }
+
+        // 2, GapFill 3-5, 6-19, GapFill 20
+        for (n = 2; n <= 19; ++n) {
+                char tmp[32];
+                const int k = (2 == n) ? 0 : n - 4;
+
+                if (3 <= n && 5 >= n)
+                        continue;
+                // PossDupFlag and OrigSendingTime are in the header
+                sprintf(tmp, "|35=%s|34=%d|43=Y|122=", message_types[n % 16], n);
+                fail_unless(std::string::npos != msgs[k].find(tmp), NULL);
+                fail_unless(std::string::npos != msgs[k].find(strchr(strstr(partial_messages[n % 16], "|52=") + 1, '|')), NULL);
+        }
+        fail_unless(std::string::npos != msgs[0].find("|43=Y|122=20121105-23:24:42|49="), NULL);
+        fail_unless(std::string::npos != msgs[1].find("|35=4|34=3|43=Y|52="), NULL);
+        fail_unless(std::string::npos != msgs[1].find("|123=Y|36=6|10="), NULL);
+        fail_unless(std::string::npos != msgs[16].find("|35=4|34=20|43=Y|52="), NULL);
+        fail_unless(std::string::npos != msgs[16].find("|123=Y|36=21|10="), NULL);
+
+        // live traffic continues with the next sequence number
+        fail_unless(0 == pusher->push(&ttl, strlen(partial_messages[0]), (const uint8_t *)partial_messages[0], message_types[0]), NULL);
+        fail_unless(1 == read_raw_messages(sockets[1], 1, data), NULL);
+        fail_unless(std::string::npos != data.find("|34=21|"), NULL);
+
+        pusher->stop();
+        fail_unless(1 == pusher->resend(1, 0), NULL); // not while stopped
+
+        remove(db_path);
+}
+END_TEST
+
 /*
  * Test send and recieve of test messages sequentially
  */
@@ -1025,6 +1701,296 @@ START_TEST(test_FIX_send_and_recv_eratically)
 }
 END_TEST
 
+/*
+ * Test send and recieve with parking and sleeping wait strategies.
+ */
+START_TEST(test_FIX_wait_strategies)
+{
+        int k;
+        int n;
+        uint32_t len;
+        uint32_t msgtype_offset;
+        uint8_t *msg;
+        const struct timeval ttl = { 0, 0 };
+        const struct timespec timeout = { 0, 1000*1000 };
+        const enum wait_strategy_kind_t kinds[2] = { WAIT_SPIN_PARK, WAIT_SLEEP };
+
+        for (k = 0; k < 2; ++k) {
+                FIX_Popper *popper = new (std::nothrow) FIX_Popper(DELIM);
+                FIX_Pusher *pusher = new (std::nothrow) FIX_Pusher(DELIM);
+                int sockets[2] = { -1, -1 };
+
+                fail_unless(0 == pusher->set_wait_strategy(kinds[k], 0, &timeout), NULL); // not initialized
+                fail_unless(0 == socketpair(PF_LOCAL, SOCK_STREAM, 0, sockets), NULL);
+                fail_unless(1 == pusher->init(":memory:"), NULL);
+                fail_unless(1 == popper->init(), NULL);
+                fail_unless(1 == pusher->set_wait_strategy(kinds[k], 0, &timeout), NULL);
+                fail_unless(1 == popper->set_wait_strategy(kinds[k], 0, &timeout), NULL);
+                pusher->start(":memory:", "FIX.4.1", sockets[0]);
+                popper->start(":memory:", "FIX.4.1", NULL, sockets[1]);
+                fail_unless(0 == popper->set_wait_strategy(kinds[k], 0, &timeout), NULL); // started
+
+                for (n = 0; n < 16; ++n) {
+                        fail_unless(0 == pusher->push(&ttl, strlen(partial_messages[n]), (const uint8_t *)partial_messages[n], message_types[n]), NULL);
+                        fail_unless(0 == popper->pop(&len, &msgtype_offset, &msg), NULL);
+                        fail_unless(len == strlen(complete_messages[n]), NULL);
+                        fail_unless(0 == memcmp(complete_messages[n], msg, len), NULL);
+                        free(msg);
+                }
+
+                pusher->stop();
+                popper->stop();
+        }
+}
+END_TEST
+
+/*
+ * Test recieving in zero-copy mode. Every third message is large
+ * enough for some to straddle two slabs.
+ */
+START_TEST(test_FIX_zero_copy_recv)
+{
+        int n;
+        int in_place = 0;
+        uint32_t len;
+        uint32_t msgtype_offset;
+        uint8_t *msg;
+        size_t send_len[24];
+        uint8_t *send_msg[24];
+        struct FIX_Popper::MessageView view;
+        FIX_Popper *popper = new (std::nothrow) FIX_Popper(DELIM);
+        int sockets[2] = { -1, -1 };
+
+        fail_unless(0 == socketpair(PF_LOCAL, SOCK_STREAM, 0, sockets), NULL);
+        fail_unless(1 == popper->init(), NULL);
+        fail_unless(1 == popper->set_zero_copy(1), NULL);
+        popper->start(":memory:", "FIX.4.1", NULL, sockets[1]);
+        fail_unless(0 == popper->set_zero_copy(0), NULL);
+
+        for (n = 0; n < 24; ++n) {
+                send_len[n] = (n % 3) ? 100 : 300*1024;
+                send_msg[n] = make_fix_message("B", "FIX.4.1", n + 1, &send_len[n]);
+                fail_unless(NULL != send_msg[n], NULL);
+                fail_unless(1 == send_all(sockets[0], send_msg[n], send_len[n]), NULL);
+        }
+
+        for (n = 0; n < 20; ++n) {
+                fail_unless(0 == popper->pop_view(&view), NULL);
+                fail_unless(send_len[n] == view.len, NULL);
+                fail_unless(0 == memcmp(send_msg[n], view.data, view.len), NULL);
+                fail_unless('B' == view.data[view.msgtype_offset], NULL);
+                if (view.slab)
+                        ++in_place;
+                popper->release_view(&view);
+                fail_unless(NULL == view.data, NULL);
+                fail_unless(NULL == view.slab, NULL);
+        }
+        fail_unless(0 < in_place, NULL);
+
+        // pop() copies messages out of the slabs
+        for (n = 20; n < 24; ++n) {
+                fail_unless(0 == popper->pop(&len, &msgtype_offset, &msg), NULL);
+                fail_unless(send_len[n] == len, NULL);
+                fail_unless(0 == memcmp(send_msg[n], msg, len), NULL);
+                free(msg);
+        }
+
+        for (n = 0; n < 24; ++n)
+                free(send_msg[n]);
+
+        popper->stop();
+        fail_unless(1 == popper->set_zero_copy(0), NULL);
+}
+END_TEST
+
+/*
+ * Test sending and recieving by io_uring, with and without
+ * SQPOLL. More messages than fit in the foxtrot entries lent to the
+ * kernel are recieved in rounds. Some are larger than an entry.
+ */
+START_TEST(test_FIX_uring_io)
+{
+        int k;
+        int n;
+        int r;
+        uint32_t len;
+        uint32_t msgtype_offset;
+        uint8_t *msg;
+        size_t send_len[64];
+        uint8_t *send_msg[64];
+        const struct timeval ttl = { 0, 0 };
+        const enum FIXIOBackend backends[2] = { URING_IO, URING_SQPOLL_IO };
+
+        for (k = 0; k < 2; ++k) {
+                FIX_Popper *popper = new (std::nothrow) FIX_Popper(DELIM);
+                FIX_Pusher *pusher = new (std::nothrow) FIX_Pusher(DELIM);
+                FIX_Popper *bulk_popper = new (std::nothrow) FIX_Popper(DELIM);
+                int sockets[2] = { -1, -1 };
+                int bulk_sockets[2] = { -1, -1 };
+
+                fail_unless(1 == pusher->set_io_backend(backends[k]), NULL);
+                fail_unless(1 == popper->set_io_backend(backends[k]), NULL);
+                fail_unless(0 == socketpair(PF_LOCAL, SOCK_STREAM, 0, sockets), NULL);
+                fail_unless(1 == pusher->init(":memory:"), NULL);
+                fail_unless(1 == popper->init(), NULL);
+                pusher->start(":memory:", "FIX.4.1", sockets[0]);
+                popper->start(":memory:", "FIX.4.1", NULL, sockets[1]);
+                fail_unless(0 == pusher->set_io_backend(SYSCALL_IO), NULL); // started
+                fail_unless(0 == popper->set_io_backend(SYSCALL_IO), NULL); // started
+
+                for (n = 0; n < 16; ++n) {
+                        fail_unless(0 == pusher->push(&ttl, strlen(partial_messages[n]), (const uint8_t *)partial_messages[n], message_types[n]), NULL);
+                        fail_unless(0 == popper->pop(&len, &msgtype_offset, &msg), NULL);
+                        fail_unless(len == strlen(complete_messages[n]), NULL);
+                        fail_unless(0 == memcmp(complete_messages[n], msg, len), NULL);
+                        free(msg);
+                }
+                pusher->stop();
+                popper->stop();
+
+                fail_unless(1 == bulk_popper->set_io_backend(backends[k]), NULL);
+                fail_unless(0 == socketpair(PF_LOCAL, SOCK_STREAM, 0, bulk_sockets), NULL);
+                fail_unless(1 == bulk_popper->init(), NULL);
+                bulk_popper->start(":memory:", "FIX.4.1", NULL, bulk_sockets[1]);
+                for (r = 0; r < 8; ++r) {
+                        for (n = 0; n < 64; ++n) {
+                                send_len[n] = (n % 7) ? 100 : 10000;
+                                send_msg[n] = make_fix_message("B", "FIX.4.1", 64*r + n + 1, &send_len[n]);
+                                fail_unless(NULL != send_msg[n], NULL);
+                                fail_unless(1 == send_all(bulk_sockets[0], send_msg[n], send_len[n]), NULL);
+                        }
+                        for (n = 0; n < 64; ++n) {
+                                fail_unless(0 == bulk_popper->pop(&len, &msgtype_offset, &msg), NULL);
+                                fail_unless(send_len[n] == len, NULL);
+                                fail_unless(0 == memcmp(send_msg[n], msg, len), NULL);
+                                free(msg);
+                                free(send_msg[n]);
+                        }
+                }
+                bulk_popper->stop();
+        }
+}
+END_TEST
+
+/*
+ * Sessions reading their sources on a shared reactor. There are more
+ * sessions than reactor threads, so each reactor thread has several
+ * sockets to multiplex.
+ */
+#define REACTOR_TEST_SESSIONS (4)
+START_TEST(test_FIX_reactor)
+{
+        int k;
+        int n;
+        int r;
+        uint32_t len;
+        uint32_t msgtype_offset;
+        uint8_t *msg;
+        size_t send_len[64];
+        uint8_t *send_msg[64];
+        const struct timeval ttl = { 0, 0 };
+        FIX_Reactor *reactor = new (std::nothrow) FIX_Reactor();
+        FIX_Popper *poppers[REACTOR_TEST_SESSIONS];
+        FIX_Pusher *pushers[REACTOR_TEST_SESSIONS];
+        int sockets[REACTOR_TEST_SESSIONS][2];
+        int bulk_sockets[2] = { -1, -1 };
+
+        fail_unless(1 == reactor->init(2), NULL);
+        fail_unless(0 == reactor->init(2), NULL); // only once
+
+        for (k = 0; k < REACTOR_TEST_SESSIONS; ++k) {
+                poppers[k] = new (std::nothrow) FIX_Popper(DELIM);
+                pushers[k] = new (std::nothrow) FIX_Pusher(DELIM);
+                fail_unless(1 == poppers[k]->set_reactor(reactor), NULL);
+                fail_unless(0 == poppers[k]->set_zero_copy(1), NULL);
+                fail_unless(0 == socketpair(PF_LOCAL, SOCK_STREAM, 0, sockets[k]), NULL);
+                fail_unless(1 == pushers[k]->init(":memory:"), NULL);
+                fail_unless(1 == poppers[k]->init(), NULL);
+                fail_unless(0 == poppers[k]->set_reactor(NULL), NULL); // after init()
+                fail_unless(1 == pushers[k]->start(":memory:", "FIX.4.1", sockets[k][0]), NULL);
+                fail_unless(1 == poppers[k]->start(":memory:", "FIX.4.1", NULL, sockets[k][1]), NULL);
+        }
+
+        for (n = 0; n < 16; ++n) {
+                for (k = 0; k < REACTOR_TEST_SESSIONS; ++k)
+                        fail_unless(0 == pushers[k]->push(&ttl, strlen(partial_messages[n]), (const uint8_t *)partial_messages[n], message_types[n]), NULL);
+                for (k = 0; k < REACTOR_TEST_SESSIONS; ++k) {
+                        fail_unless(0 == poppers[k]->pop(&len, &msgtype_offset, &msg), NULL);
+                        fail_unless(len == strlen(complete_messages[n]), NULL);
+                        fail_unless(0 == memcmp(complete_messages[n], msg, len), NULL);
+                        free(msg);
+                }
+        }
+
+        // restart a session on a new connection with bursts larger
+        // than one read
+        fail_unless(0 == socketpair(PF_LOCAL, SOCK_STREAM, 0, bulk_sockets), NULL);
+        poppers[1]->stop();
+        fail_unless(1 == poppers[1]->init(), NULL);
+        fail_unless(1 == poppers[1]->start(":memory:", "FIX.4.1", NULL, bulk_sockets[1]), NULL);
+        for (r = 0; r < 8; ++r) {
+                for (n = 0; n < 64; ++n) {
+                        send_len[n] = (n % 7) ? 100 : 10000;
+                        send_msg[n] = make_fix_message("B", "FIX.4.1", 16 + 64*r + n + 1, &send_len[n]); // continues the session
+                        fail_unless(NULL != send_msg[n], NULL);
+                        fail_unless(1 == send_all(bulk_sockets[0], send_msg[n], send_len[n]), NULL);
+                }
+                for (n = 0; n < 64; ++n) {
+                        fail_unless(0 == poppers[1]->pop(&len, &msgtype_offset, &msg), NULL);
+                        fail_unless(send_len[n] == len, NULL);
+                        fail_unless(0 == memcmp(send_msg[n], msg, len), NULL);
+                        free(msg);
+                        free(send_msg[n]);
+                }
+        }
+
+        for (k = 0; k < REACTOR_TEST_SESSIONS; ++k) {
+                pushers[k]->stop();
+                poppers[k]->stop();
+        }
+}
+END_TEST
+
+/*
+ * Queues backed by huge pages, prefaulted and locked. Whatever the
+ * host can not provide falls back to ordinary memory.
+ */
+START_TEST(test_FIX_ring_memory)
+{
+        int n;
+        uint32_t len;
+        uint32_t msgtype_offset;
+        uint8_t *msg;
+        const struct timeval ttl = { 0, 0 };
+        const int flags = RING_MEM_HUGE_PAGES | RING_MEM_PREFAULT | RING_MEM_LOCK;
+        FIX_Popper *popper = new (std::nothrow) FIX_Popper(DELIM);
+        FIX_Pusher *pusher = new (std::nothrow) FIX_Pusher(DELIM);
+        int sockets[2] = { -1, -1 };
+
+        fail_unless(0 == pusher->set_ring_memory(0x80), NULL);
+        fail_unless(0 == popper->set_ring_memory(0x80), NULL);
+        fail_unless(1 == pusher->set_ring_memory(flags), NULL);
+        fail_unless(1 == popper->set_ring_memory(flags), NULL);
+        fail_unless(0 == socketpair(PF_LOCAL, SOCK_STREAM, 0, sockets), NULL);
+        fail_unless(1 == pusher->init(":memory:"), NULL);
+        fail_unless(1 == popper->init(), NULL);
+        fail_unless(0 == pusher->set_ring_memory(0), NULL); // after init()
+        fail_unless(0 == popper->set_ring_memory(0), NULL); // after init()
+        pusher->start(":memory:", "FIX.4.1", sockets[0]);
+        popper->start(":memory:", "FIX.4.1", NULL, sockets[1]);
+
+        for (n = 0; n < 16; ++n) {
+                fail_unless(0 == pusher->push(&ttl, strlen(partial_messages[n]), (const uint8_t *)partial_messages[n], message_types[n]), NULL);
+                fail_unless(0 == popper->pop(&len, &msgtype_offset, &msg), NULL);
+                fail_unless(len == strlen(complete_messages[n]), NULL);
+                fail_unless(0 == memcmp(complete_messages[n], msg, len), NULL);
+                free(msg);
+        }
+        pusher->stop();
+        popper->stop();
+}
+END_TEST
+
 /*
  * This is a test of the popper.
  *
@@ -1157,17 +2123,32 @@ fixio_suite(void)
         tcase_add_test(tc_core, test_FIX_Pusher_create);
         tcase_add_test(tc_core, test_FIX_Popper_create);
         tcase_add_test(tc_core, test_message_database);
+        tcase_add_test(tc_core, test_message_database_durability);
+        tcase_add_test(tc_core, test_message_database_idle);
+        tcase_add_test(tc_core, test_message_database_journal_error);
+        tcase_add_test(tc_core, test_message_database_concurrent_readers);
+        tcase_add_test(tc_core, test_message_store_mmap);
+        tcase_add_test(tc_core, test_message_store_mmap_crash);
         tcase_add_test(tc_core, test_FIX_start_stop);
         tcase_add_test(tc_core, test_FIX_change_version);
         tcase_add_test(tc_core, test_FIX_send_and_recv_sequentially);
+        tcase_add_test(tc_core, test_FIX_push_batch);
+        tcase_add_test(tc_core, test_FIX_header_templates);
+        tcase_add_test(tc_core, test_FIX_short_writes);
         tcase_add_test(tc_core, test_FIX_send_and_recv_session_messages_sequentially);
         tcase_add_test(tc_core, test_FIX_lockfree_sequentially);
         tcase_add_test(tc_core, test_FIX_send_and_recv_session_and_non_session_messages);
         tcase_add_test(tc_core, test_FIX_send_and_recv_session_and_non_session_messages_with_noise);
         tcase_add_test(tc_core, test_FIX_send_and_recv_sequentially_with_noise);
         tcase_add_test(tc_core, test_FIX_retrieve_sent);
+        tcase_add_test(tc_core, test_FIX_resend);
         tcase_add_test(tc_core, test_FIX_send_and_recv_in_bursts);
         tcase_add_test(tc_core, test_FIX_send_and_recv_eratically);
+        tcase_add_test(tc_core, test_FIX_zero_copy_recv);
+        tcase_add_test(tc_core, test_FIX_wait_strategies);
+        tcase_add_test(tc_core, test_FIX_uring_io);
+        tcase_add_test(tc_core, test_FIX_reactor);
+        tcase_add_test(tc_core, test_FIX_ring_memory);
         tcase_add_test(tc_core, test_FIX_challenge_buffer_boundaries_overflow);
         tcase_add_test(tc_core, test_FIX_challenge_buffer_boundaries_with_crap);
         tcase_add_test(tc_core, test_FIX_challenge_buffer_boundaries_and_have_noise);
@@ -40,8 +40,102 @@
 #ifdef HAVE_CONFIG_H
     #include "ac_config.h"
 #endif
+#if defined(__x86_64__) || defined(__i386__)
+    #include <immintrin.h>
+    #define HAVE_X86_KERNELS__
+#endif
 #include "fix_fields.h"
 
+typedef uint64_t (*sum_kernel_t)(const uint8_t *msg, size_t len);
+
+static uint64_t
+sum_scalar(const uint8_t *msg, size_t len)
+{
+        uint64_t sum = 0;
+        size_t n;
+
+        for (n = 0; n < len; ++n) {
+                sum += (uint64_t)msg[n];
+        }
+
+        return sum;
+}
+
+#ifdef HAVE_X86_KERNELS__
+
 /*
- *
+ * psadbw against zero sums 8 bytes at a time into 64 bit lanes. Two
+ * accumulators hide the latency of the adds.
  */
+__attribute__((target("sse2"))) static uint64_t
+sum_sse2(const uint8_t *msg, size_t len)
+{
+        const __m128i zero = _mm_setzero_si128();
+        __m128i acc0 = zero;
+        __m128i acc1 = zero;
+        uint64_t lanes[2];
+        size_t n = 0;
+
+        for (; n + 32 <= len; n += 32) {
+                acc0 = _mm_add_epi64(acc0, _mm_sad_epu8(_mm_loadu_si128((const __m128i*)(msg + n)), zero));
+                acc1 = _mm_add_epi64(acc1, _mm_sad_epu8(_mm_loadu_si128((const __m128i*)(msg + n + 16)), zero));
+        }
+        if (n + 16 <= len) {
+                acc0 = _mm_add_epi64(acc0, _mm_sad_epu8(_mm_loadu_si128((const __m128i*)(msg + n)), zero));
+                n += 16;
+        }
+        _mm_storeu_si128((__m128i*)lanes, _mm_add_epi64(acc0, acc1));
+
+        return lanes[0] + lanes[1] + sum_scalar(msg + n, len - n);
+}
+
+__attribute__((target("avx2"))) static uint64_t
+sum_avx2(const uint8_t *msg, size_t len)
+{
+        const __m256i zero = _mm256_setzero_si256();
+        __m256i acc0 = zero;
+        __m256i acc1 = zero;
+        uint64_t lanes[4];
+        size_t n = 0;
+
+        for (; n + 64 <= len; n += 64) {
+                acc0 = _mm256_add_epi64(acc0, _mm256_sad_epu8(_mm256_loadu_si256((const __m256i*)(msg + n)), zero));
+                acc1 = _mm256_add_epi64(acc1, _mm256_sad_epu8(_mm256_loadu_si256((const __m256i*)(msg + n + 32)), zero));
+        }
+        _mm256_storeu_si256((__m256i*)lanes, _mm256_add_epi64(acc0, acc1));
+
+        return lanes[0] + lanes[1] + lanes[2] + lanes[3] + sum_sse2(msg + n, len - n);
+}
+
+#endif // HAVE_X86_KERNELS__
+
+static sum_kernel_t
+select_sum_kernel(void)
+{
+#ifdef HAVE_X86_KERNELS__
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+                return sum_avx2;
+        if (__builtin_cpu_supports("sse2"))
+                return sum_sse2;
+#endif
+        return sum_scalar;
+}
+
+int
+get_FIX_checksum(const uint8_t *msg, size_t len)
+{
+        static sum_kernel_t sum_kernel = NULL;
+        sum_kernel_t kernel = __atomic_load_n(&sum_kernel, __ATOMIC_RELAXED);
+
+        // not worth a vector kernel
+        if (16 > len)
+                return (sum_scalar(msg, len) % 256);
+
+        if (!kernel) {
+                kernel = select_sum_kernel();
+                __atomic_store_n(&sum_kernel, kernel, __ATOMIC_RELAXED);
+        }
+
+        return (kernel(msg, len) % 256);
+}
@@ -49,16 +49,21 @@
  * msg is a pointer to the first byte in a FIX messsage which is
  * included in the checksum calculation. len is the number of bytes
  * included in the checksum calculation.
+ *
+ * The bytes are summed by the widest kernel the CPU supports (AVX2,
+ * SSE2 or plain C) as detected the first time this is called.
+ */
+int get_FIX_checksum(const uint8_t *msg, size_t len);
+
+/*
+ * Incremental variant of get_FIX_checksum(). checksum is the checksum
+ * of the bytes preceding msg, e.g. a precomputed checksum of a fixed
+ * header prefix. Returns the checksum of all the bytes.
  */
 static inline int
-get_FIX_checksum(const uint8_t *msg, size_t len)
+fold_FIX_checksum(const int checksum,
+                  const uint8_t *msg,
+                  size_t len)
 {
-        uint64_t sum = 0;
-        size_t n;
-
-        for (n = 0; n < len; ++n) {
-                sum += (uint64_t)msg[n];
-        }
-
-        return (sum % 256);
+        return ((checksum + get_FIX_checksum(msg, len)) % 256);
 }
@@ -0,0 +1,90 @@
+/*
+ *    Copyright (C) 2013, Jules Colding <jcolding@gmail.com>.
+ *
+ *    All Rights Reserved.
+ */
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     (1) Redistributions of source code must retain the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer.
+ *
+ *     (2) Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *
+ *     (3) Neither the name of the copyright holder nor the names of
+ *     its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written
+ *     permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS
+ * OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "fix_groups.h"
+
+#ifdef HAVE_CONFIG_H
+    #include "ac_config.h"
+#endif
+
+static const unsigned int party_sub_id_tags[] = { 523, 803, 0 };
+
+const struct FIX_GroupDesc fix44_party_sub_ids = { 802, 523, party_sub_id_tags, NULL };
+
+static const unsigned int party_tags[] = { 448, 447, 452, 0 };
+static const struct FIX_GroupDesc * const party_groups[] = { &fix44_party_sub_ids, NULL };
+
+const struct FIX_GroupDesc fix44_parties = { 453, 448, party_tags, party_groups };
+
+static const unsigned int sec_alt_id_tags[] = { 455, 456, 0 };
+
+const struct FIX_GroupDesc fix44_sec_alt_ids = { 454, 455, sec_alt_id_tags, NULL };
+
+static const unsigned int event_tags[] = { 865, 866, 867, 868, 0 };
+
+const struct FIX_GroupDesc fix44_events = { 864, 865, event_tags, NULL };
+
+static const unsigned int md_full_entry_tags[] = {
+        269, 270, 15, 271, 272, 273, 274, 275, 336, 625, 276, 277, 282, 283,
+        284, 286, 59, 432, 126, 110, 18, 287, 37, 299, 288, 289, 346, 290,
+        546, 811, 58, 354, 355,
+        0
+};
+
+const struct FIX_GroupDesc fix44_md_full_entries = { 268, 269, md_full_entry_tags, NULL };
+
+/*
+ * The Instrument component is included without its underlying and
+ * leg groups.
+ */
+static const unsigned int md_inc_entry_tags[] = {
+        279, 285, 269, 278, 280,
+        // Instrument
+        55, 65, 48, 22, 460, 461, 167, 762, 200, 541, 201, 224, 225, 239,
+        226, 227, 228, 255, 543, 470, 471, 472, 240, 202, 947, 206, 231,
+        223, 207, 106, 348, 349, 107, 350, 351, 691, 667, 875, 876, 873,
+        874,
+        291, 292, 270, 15, 271, 272, 273, 274, 275, 336, 625, 276, 277, 282,
+        283, 284, 286, 59, 432, 126, 110, 18, 287, 37, 299, 288, 289, 346,
+        290, 546, 811, 451, 58, 354, 355, 1023, 83,
+        0
+};
+static const struct FIX_GroupDesc * const md_inc_entry_groups[] = { &fix44_sec_alt_ids, &fix44_events, NULL };
+
+const struct FIX_GroupDesc fix44_md_inc_entries = { 268, 279, md_inc_entry_tags, md_inc_entry_groups };
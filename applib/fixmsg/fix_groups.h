@@ -0,0 +1,92 @@
+/*
+ *    Copyright (C) 2013, Jules Colding <jcolding@gmail.com>.
+ *
+ *    All Rights Reserved.
+ */
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     (1) Redistributions of source code must retain the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer.
+ *
+ *     (2) Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *
+ *     (3) Neither the name of the copyright holder nor the names of
+ *     its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written
+ *     permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS
+ * OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <stdlib.h>
+#include <stdint.h>
+#ifdef HAVE_CONFIG_H
+    #include "ac_config.h"
+#endif
+
+/*
+ * Describes a repeating group. Every entry of the group starts with
+ * delimiter_tag and holds fields of member_tags and nested groups in
+ * any order. The group ends after the number of entries given by
+ * count_tag, the NumInGroup field.
+ *
+ * member_tags is zero terminated and includes delimiter_tag. nested
+ * is NULL terminated and may be NULL if there are no nested groups.
+ *
+ * The tag tables of fix_types.h do not tell which tags belong to
+ * which group, so descriptors are written by hand. Groups not
+ * described below may be described the same way by the user.
+ */
+struct FIX_GroupDesc {
+        unsigned int count_tag;
+        unsigned int delimiter_tag;
+        const unsigned int *member_tags;
+        const struct FIX_GroupDesc * const *nested;
+};
+
+/*
+ * Position in a repeating group of an indexed FIXMessageRX, please
+ * see FIXMessageRX::open_group(). The fields of the current entry are
+ * [entry_begin, entry_end) of FIXMessageRX::get_field().
+ */
+struct FIX_GroupCursor {
+        const struct FIX_GroupDesc *desc;
+        uint64_t count;     // entries in the group as given by the NumInGroup field
+        uint64_t entry;     // entries read so far
+        size_t next;        // the first field of the next entry or, at the end, after the group
+        size_t end;         // the group does not extend to this field
+        size_t entry_begin; // the first field of the current entry
+        size_t entry_end;   // after the last field of the current entry
+};
+
+/*
+ * FIX 4.4 groups. They apply to FIX 5.0 and later as far as the
+ * fields of 4.4 go.
+ */
+extern const struct FIX_GroupDesc fix44_party_sub_ids;   // PtysSubGrp, NoPartySubIDs (802)
+extern const struct FIX_GroupDesc fix44_parties;         // Parties, NoPartyIDs (453)
+extern const struct FIX_GroupDesc fix44_sec_alt_ids;     // SecAltIDGrp, NoSecurityAltID (454)
+extern const struct FIX_GroupDesc fix44_events;          // EvntGrp, NoEvents (864)
+extern const struct FIX_GroupDesc fix44_md_full_entries; // MDFullGrp of MarketDataSnapshotFullRefresh (35=W), NoMDEntries (268)
+extern const struct FIX_GroupDesc fix44_md_inc_entries;  // MDIncGrp of MarketDataIncrementalRefresh (35=X), NoMDEntries (268)
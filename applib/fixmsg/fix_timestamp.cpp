@@ -0,0 +1,171 @@
+/*
+ *    Copyright (C) 2013, Jules Colding <jcolding@gmail.com>.
+ *
+ *    All Rights Reserved.
+ */
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     (1) Redistributions of source code must retain the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer.
+ *
+ *     (2) Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *
+ *     (3) Neither the name of the copyright holder nor the names of
+ *     its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written
+ *     permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS
+ * OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifdef HAVE_CONFIG_H
+    #include "ac_config.h"
+#endif
+#include <errno.h>
+#include <string.h>
+#include "stdlib/log/log.h"
+#include "applib/fixutils/fixmsg_utils.h"
+#include "fix_timestamp.h"
+
+/*
+ * The formatted prefix of the most recently seen second. Every thread
+ * keeps its own so no synchronization is needed.
+ */
+static __thread time_t cached_second = -1;
+static __thread char cached_prefix[FIX_TIMESTAMP_PREFIX_LENGTH];
+
+static inline void
+put_pair(char *pos,
+         const unsigned int value)
+{
+        memcpy(pos, &digit_pairs[2 * value], 2);
+}
+
+/*
+ * Writes the right-most digits digits of value ending just before
+ * end, two digits at a time.
+ */
+static inline void
+put_digits(char *end,
+           uint64_t value,
+           unsigned int digits)
+{
+        while (1 < digits) {
+                end -= 2;
+                put_pair(end, (unsigned int)(value % 100));
+                value /= 100;
+                digits -= 2;
+        }
+        if (digits)
+                *(end - 1) = (char)('0' + value % 10);
+}
+
+/*
+ * Builds "YYYYMMDD-HH:MM:SS" for sec without gmtime(). The date is
+ * derived from the day count by the proleptic Gregorian calendar
+ * algorithm of Howard Hinnant ("civil_from_days").
+ */
+static void
+build_prefix(const time_t sec,
+             char prefix[FIX_TIMESTAMP_PREFIX_LENGTH])
+{
+        int64_t days = sec / 86400;
+        int64_t secs = sec % 86400;
+        int64_t era;
+        unsigned int doe;
+        unsigned int yoe;
+        unsigned int doy;
+        unsigned int mp;
+        unsigned int day;
+        unsigned int month;
+        int64_t year;
+
+        if (0 > secs) {
+                secs += 86400;
+                --days;
+        }
+
+        days += 719468;
+        era = (0 <= days ? days : days - 146096) / 146097;
+        doe = (unsigned int)(days - era * 146097);
+        yoe = (doe - doe/1460 + doe/36524 - doe/146096) / 365;
+        doy = doe - (365*yoe + yoe/4 - yoe/100);
+        mp = (5*doy + 2) / 153;
+        day = doy - (153*mp + 2)/5 + 1;
+        month = (10 > mp ? mp + 3 : mp - 9);
+        year = (int64_t)yoe + era * 400 + (2 >= month ? 1 : 0);
+
+        put_digits(&prefix[4], (uint64_t)year, 4);
+        put_pair(&prefix[4], month);
+        put_pair(&prefix[6], day);
+        prefix[8] = '-';
+        put_pair(&prefix[9], (unsigned int)(secs / 3600));
+        prefix[11] = ':';
+        put_pair(&prefix[12], (unsigned int)(secs / 60 % 60));
+        prefix[14] = ':';
+        put_pair(&prefix[15], (unsigned int)(secs % 60));
+}
+
+size_t
+format_FIX_utc_timestamp(const struct timespec * const ts,
+                         const enum FIX_TimestampPrecision precision,
+                         char *buf)
+{
+        if (ts->tv_sec != cached_second) {
+                build_prefix(ts->tv_sec, cached_prefix);
+                cached_second = ts->tv_sec;
+        }
+        memcpy(buf, cached_prefix, FIX_TIMESTAMP_PREFIX_LENGTH);
+
+        switch (precision) {
+        case FIX_TS_MILLI:
+                buf[FIX_TIMESTAMP_PREFIX_LENGTH] = '.';
+                put_digits(&buf[FIX_TIMESTAMP_PREFIX_LENGTH + 1 + FIX_TS_MILLI], ts->tv_nsec / 1000000, FIX_TS_MILLI);
+                return FIX_TIMESTAMP_PREFIX_LENGTH + 1 + FIX_TS_MILLI;
+        case FIX_TS_MICRO:
+                buf[FIX_TIMESTAMP_PREFIX_LENGTH] = '.';
+                put_digits(&buf[FIX_TIMESTAMP_PREFIX_LENGTH + 1 + FIX_TS_MICRO], ts->tv_nsec / 1000, FIX_TS_MICRO);
+                return FIX_TIMESTAMP_PREFIX_LENGTH + 1 + FIX_TS_MICRO;
+        case FIX_TS_NANO:
+                buf[FIX_TIMESTAMP_PREFIX_LENGTH] = '.';
+                put_digits(&buf[FIX_TIMESTAMP_PREFIX_LENGTH + 1 + FIX_TS_NANO], ts->tv_nsec, FIX_TS_NANO);
+                return FIX_TIMESTAMP_PREFIX_LENGTH + 1 + FIX_TS_NANO;
+        case FIX_TS_SECONDS:
+        default:
+                return FIX_TIMESTAMP_PREFIX_LENGTH;
+        }
+}
+
+size_t
+get_FIX_utc_timestamp(const enum FIX_TimestampPrecision precision,
+                      char *buf)
+{
+        struct timespec now;
+
+        // CLOCK_REALTIME is served by the vDSO on Linux, no syscall
+        if (clock_gettime(CLOCK_REALTIME, &now)) {
+                M_ALERT("clock_gettime() failed: %s", strerror(errno));
+                abort();
+        }
+
+        return format_FIX_utc_timestamp(&now, precision, buf);
+}
@@ -0,0 +1,106 @@
+/*
+ *    Copyright (C) 2013, Jules Colding <jcolding@gmail.com>.
+ *
+ *    All Rights Reserved.
+ */
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     (1) Redistributions of source code must retain the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer.
+ *
+ *     (2) Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *
+ *     (3) Neither the name of the copyright holder nor the names of
+ *     its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written
+ *     permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS
+ * OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#ifdef HAVE_CONFIG_H
+    #include "ac_config.h"
+#endif
+#include "fix_types.h"
+
+/*
+ * Number of fractional second digits in a UTCTimestamp.
+ */
+enum FIX_TimestampPrecision : unsigned int
+{
+        FIX_TS_SECONDS = 0,
+        FIX_TS_MILLI = 3,
+        FIX_TS_MICRO = 6,
+        FIX_TS_NANO = 9
+};
+
+/*
+ * Lengths of "YYYYMMDD-HH:MM:SS" and "YYYYMMDD-HH:MM:SS.sssssssss",
+ * the latter being the longest timestamp formatted below.
+ */
+#define FIX_TIMESTAMP_PREFIX_LENGTH (17)
+#define FIX_TIMESTAMP_MAX_LENGTH (FIX_TIMESTAMP_PREFIX_LENGTH + 1 + FIX_TS_NANO)
+
+/*
+ * Returns the precision of SendingTime (tag 52) for the given
+ * version. FIX 4.0 and 4.1 do not allow fractional seconds.
+ */
+static inline enum FIX_TimestampPrecision
+get_FIX_sending_time_precision(const FIX_Version version)
+{
+        switch (version) {
+        case FIX_4_0:
+        case FIX_4_1:
+                return FIX_TS_SECONDS;
+        default:
+                return FIX_TS_MILLI;
+        }
+}
+
+/*
+ * Formats ts as a UTCTimestamp with the given precision into buf,
+ * which must have room for FIX_TIMESTAMP_MAX_LENGTH bytes. buf is not
+ * zero terminated.
+ *
+ * The "YYYYMMDD-HH:MM:SS" prefix is cached per thread and only
+ * rebuilt when the second changes, so formatting is a copy of the
+ * prefix and a few table lookups for the fraction.
+ *
+ * Returns the number of bytes written.
+ */
+size_t format_FIX_utc_timestamp(const struct timespec * const ts,
+                                const enum FIX_TimestampPrecision precision,
+                                char *buf);
+
+/*
+ * As above, but for the current time as given by
+ * clock_gettime(CLOCK_REALTIME).
+ *
+ * Returns the number of bytes written.
+ */
+size_t get_FIX_utc_timestamp(const enum FIX_TimestampPrecision precision,
+                             char *buf);
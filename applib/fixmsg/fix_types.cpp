@@ -39,16 +39,18 @@
 
 /*
  * Defines helper functions to do very fast "string => index of that
- * string in an array" conversions. With this data set they are
- * actually about 10 times faster than the corresponding strcmp()
- * based algorithms.
+ * string in an array" conversions.
  *
- * It is also faster than the equivalent std::map<string, int> based
- * algorithm by a factor of about 5.
+ * All FIX message types are one or two characters long. One
+ * character types are looked up directly in a 128 entry table. Two
+ * character types share their first character with a few others, so
+ * the first character selects one of a handful of 128 entry rows
+ * which is then indexed by the second character. That is two or
+ * three loads without any comparisons, about 4 times faster than the
+ * std::map based lookup this replaced. See bench_msgtype.cpp.
  *
- * But, there's an upper limit on the length of the strings involved
- * of 4 characters. An eventual terminating zero character is not
- * included in this count.
+ * Session message types are recorded in a bitset indexed by
+ * FIX_MsgType.
  */
 
 #include "fix_types.h"
@@ -57,190 +59,180 @@
     #include "ac_config.h"
 #endif
 #include <string.h>
-#include <map>
+#include <stdlib.h>
 
-static std::map<uint_fast32_t, int> *fix_session_msgtypes_map;
-static std::map<uint_fast32_t, FIX_MsgType> *fix_msgtypes_map;
+#define MSGTYPE_CHARS (128)
+#define MSGTYPE_ROWS (8)    // row 0 (zero) is all fmt_CustomMsg
+#define SESSION_BITS (64)
+
+static_assert(FIX_MSGTYPES_COUNT <= 256, "FIX_MsgType must fit in a byte");
+
+static uint8_t msgtype_single[MSGTYPE_CHARS];             // 1-char types
+static uint8_t msgtype_row[MSGTYPE_CHARS];                // first char => row in msgtype_pair
+static uint8_t msgtype_pair[MSGTYPE_ROWS][MSGTYPE_CHARS]; // 2-char types
+static uint64_t session_msgtypes[(FIX_MSGTYPES_COUNT + SESSION_BITS - 1)/SESSION_BITS];
 
 __attribute__((constructor)) static void
 get_fix_msgtype_ctor(void)
 {
-        uint_fast32_t is;
-        unsigned int len;
+        const unsigned char *str;
+        unsigned int rows = 1;
         unsigned int n;
 
-        // no memory leak here - it is going to live forever...
-        fix_msgtypes_map = new std::map<uint_fast32_t, FIX_MsgType>;
-
         for (n = 0; n < FIX_MSGTYPES_COUNT; ++n) {
-                len = strlen(fix_msgtype_string[n]);
-                switch (len) {
+                str = (const unsigned char*)fix_msgtype_string[n];
+                switch (strlen(fix_msgtype_string[n])) {
                 case 0:
-                        is = 0;
                         break;
                 case 1:
-                        is = (uint_fast32_t)fix_msgtype_string[n][0];
+                        if (MSGTYPE_CHARS <= str[0])
+                                abort();
+                        msgtype_single[str[0]] = (uint8_t)n;
                         break;
                 case 2:
-                        is = (((uint_fast32_t)fix_msgtype_string[n][1] << 8) |
-                              (uint_fast32_t)fix_msgtype_string[n][0]);
-                        break;
-                case 3:
-                        is = (((uint_fast32_t)fix_msgtype_string[n][2] << 16) |
-                              ((uint_fast32_t)fix_msgtype_string[n][1] << 8) |
-                              (uint_fast32_t)fix_msgtype_string[n][0]);
-                        break;
-                case 4:
-                        is = (((uint_fast32_t)fix_msgtype_string[n][3] << 24) |
-                              ((uint_fast32_t)fix_msgtype_string[n][2] << 16) |
-                              ((uint_fast32_t)fix_msgtype_string[n][1] << 8) |
-                              (uint_fast32_t)fix_msgtype_string[n][0]);
+                        if ((MSGTYPE_CHARS <= str[0]) || (MSGTYPE_CHARS <= str[1]))
+                                abort();
+                        if (!msgtype_row[str[0]]) {
+                                if (MSGTYPE_ROWS <= rows)
+                                        abort();
+                                msgtype_row[str[0]] = (uint8_t)rows++;
+                        }
+                        msgtype_pair[msgtype_row[str[0]]][str[1]] = (uint8_t)n;
                         break;
                 default:
                         abort();
                 }
-                (*fix_msgtypes_map)[is] = (FIX_MsgType)n;
         }
-}
-
-__attribute__((constructor)) static void
-is_session_message_ctor(void)
-{
-        uint_fast32_t is;
-        unsigned int len;
-        unsigned int n;
-
-        // no memory leak here - it is going to live forever...
-        fix_session_msgtypes_map = new std::map<uint_fast32_t, int>;
 
-        for (n = 0; n < FIX_SESSION_MSGTYPES_COUNT; ++n) {
-                len = strlen(fix_session_msgtype_string[n]);
-                switch (len) {
-                case 0:
-                        is = 0;
-                        break;
-                case 1:
-                        is = (uint_fast32_t)fix_session_msgtype_string[n][0];
-                        break;
-                case 2:
-                        is = (((uint_fast32_t)fix_session_msgtype_string[n][1] << 8) |
-                              (uint_fast32_t)fix_session_msgtype_string[n][0]);
-                        break;
-                case 3:
-                        is = (((uint_fast32_t)fix_session_msgtype_string[n][2] << 16) |
-                              ((uint_fast32_t)fix_session_msgtype_string[n][1] << 8) |
-                              (uint_fast32_t)fix_session_msgtype_string[n][0]);
-                        break;
-                case 4:
-                        is = (((uint_fast32_t)fix_session_msgtype_string[n][3] << 24) |
-                              ((uint_fast32_t)fix_session_msgtype_string[n][2] << 16) |
-                              ((uint_fast32_t)fix_session_msgtype_string[n][1] << 8) |
-                              (uint_fast32_t)fix_session_msgtype_string[n][0]);
-                        break;
-                default:
-                        abort();
-                }
-                (*fix_session_msgtypes_map)[is] = n;
-        }
+        for (n = 0; fmt_CustomMsg != fix_session_message_types[n]; ++n)
+                session_msgtypes[fix_session_message_types[n] / SESSION_BITS] |= (1ULL << (fix_session_message_types[n] % SESSION_BITS));
 }
 
 FIX_MsgType
 get_fix_msgtype(const char soh,
                 const char * const str)
 {
-        uint_fast32_t is;
-        unsigned int len = 0;
-        std::map<uint_fast32_t, FIX_MsgType>::const_iterator it;
-
-        while (soh != str[len])
-                ++len;
-
-        switch (len) {
-        case 0:
-                is = 0;
-                break;
-        case 1:
-                is = ((uint_fast32_t)(str[0]));
-                break;
-        case 2:
-                is = (((uint_fast32_t)str[1] << 8) |
-                      (uint_fast32_t)str[0]);
-                break;
-        case 3:
-                is = (((uint_fast32_t)str[2] << 16) |
-                      ((uint_fast32_t)str[1] << 8) |
-                      (uint_fast32_t)str[0]);
-                break;
-        case 4:
-                is = (((uint_fast32_t)str[3] << 24) |
-                      ((uint_fast32_t)str[2] << 16) |
-                      ((uint_fast32_t)str[1] << 8) |
-                      (uint_fast32_t)str[0]);
-                break;
-        default:
+        const unsigned char c0 = (unsigned char)str[0];
+        unsigned char c1;
+
+        if ((soh == (char)c0) || (MSGTYPE_CHARS <= c0))
                 return fmt_CustomMsg;
-        }
 
-        it = fix_msgtypes_map->find(is);
-        if (fix_msgtypes_map->end() == it)
+        c1 = (unsigned char)str[1];
+        if (soh == (char)c1)
+                return (FIX_MsgType)msgtype_single[c0];
+
+        if ((soh != str[2]) || (MSGTYPE_CHARS <= c1))
                 return fmt_CustomMsg;
 
-        return it->second;
+        return (FIX_MsgType)msgtype_pair[msgtype_row[c0]][c1];
 }
 
 int
 is_session_message(const FIX_MsgType type)
 {
-	int n = 0;
-
-	while (fmt_CustomMsg != fix_session_message_types[n]){
-		if (fix_session_message_types[n] == type)
-			return 1;
-		++n;
-	}
-	return 0;
+        if (FIX_MSGTYPES_COUNT <= type)
+                return 0;
+
+        return (int)((session_msgtypes[type / SESSION_BITS] >> (type % SESSION_BITS)) & 1);
 }
 
 int
 is_session_message(const char soh,
                    const char * const str)
 {
-        uint_fast32_t is;
-        unsigned int len = 0;
-        std::map<uint_fast32_t, int>::const_iterator it;
-
-        while (soh != str[len])
-                ++len;
-
-        switch (len) {
-        case 0:
-                is = 0;
-                break;
-        case 1:
-                is = ((uint_fast32_t)(str[0]));
-                break;
-        case 2:
-                is = (((uint_fast32_t)str[1] << 8) |
-                      (uint_fast32_t)str[0]);
-                break;
-        case 3:
-                is = (((uint_fast32_t)str[2] << 16) |
-                      ((uint_fast32_t)str[1] << 8) |
-                      (uint_fast32_t)str[0]);
-                break;
-        case 4:
-                is = (((uint_fast32_t)str[3] << 24) |
-                      ((uint_fast32_t)str[2] << 16) |
-                      ((uint_fast32_t)str[1] << 8) |
-                      (uint_fast32_t)str[0]);
-                break;
-        default:
+        return is_session_message(get_fix_msgtype(soh, str));
+}
+
+static struct FIX_TagDict fix_tag_dicts[FIX_VERSION_TYPES_COUNT];
+
+int
+fix_tag_dict_add(struct FIX_TagDict * const dict,
+                 const struct FIX_Tag & tag)
+{
+        unsigned int slot;
+        unsigned int n;
+
+        if (!tag.tag)
                 return 0;
+
+        if (tag.tag < FIX_TAG_DICT_DENSE_SIZE) {
+                dict->dense[tag.tag] = (uint8_t)tag.type;
+                return 1;
         }
 
-        it = fix_session_msgtypes_map->find(is);
-        if (fix_session_msgtypes_map->end() == it)
+        slot = fix_tag_dict_sparse_slot(tag.tag);
+        for (n = 0; n < FIX_TAG_DICT_SPARSE_SIZE; ++n) {
+                if (tag.tag == dict->sparse[slot].tag) {
+                        dict->sparse[slot].type = tag.type;
+                        return 1;
+                }
+                if (!dict->sparse[slot].tag)
+                        break;
+                slot = (slot + 1) & (FIX_TAG_DICT_SPARSE_SIZE - 1);
+        }
+
+        // keep at least one empty slot so that lookups terminate early
+        if (FIX_TAG_DICT_SPARSE_SIZE - 1 <= dict->sparse_count)
                 return 0;
 
+        dict->sparse[slot] = tag;
+        ++dict->sparse_count;
+
         return 1;
 }
+
+__attribute__((constructor)) static void
+fix_tag_dict_ctor(void)
+{
+        const struct FIX_Tag *fix_tags[FIX_VERSION_TYPES_COUNT] = {
+                NULL,
+                fix40_std_tags,
+                fix41_std_tags,
+                fix42_std_tags,
+                fix43_std_tags,
+                fix44_std_tags,
+                fix50_std_tags,
+                fix50sp1_std_tags,
+                fix50sp2_std_tags,
+                fixt11_std_tags,
+        };
+        const struct FIX_Tag *fix_data_tags[FIX_VERSION_TYPES_COUNT] = {
+                NULL,
+                fix40_std_data_tags,
+                fix41_std_data_tags,
+                fix42_std_data_tags,
+                fix43_std_data_tags,
+                fix44_std_data_tags,
+                fix50_std_data_tags,
+                fix50sp1_std_data_tags,
+                fix50sp2_std_data_tags,
+                fixt11_std_data_tags,
+        };
+        unsigned int v;
+        unsigned int n;
+
+        for (v = 0; v < FIX_VERSION_TYPES_COUNT; ++v) {
+                memset(fix_tag_dicts[v].dense, FIX_TAG_UNKNOWN, sizeof(fix_tag_dicts[v].dense));
+                if (!fix_tags[v])
+                        continue;
+
+                for (n = 0; fix_tags[v][n].tag; ++n) {
+                        if (!fix_tag_dict_add(&fix_tag_dicts[v], fix_tags[v][n]))
+                                abort();
+                }
+                for (n = 0; fix_data_tags[v][n].tag; ++n) {
+                        if (!fix_tag_dict_add(&fix_tag_dicts[v], fix_data_tags[v][n]))
+                                abort();
+                }
+        }
+}
+
+const struct FIX_TagDict *
+get_fix_tag_dict(const FIX_Version version)
+{
+        if (FIX_VERSION_TYPES_COUNT <= version)
+                return &fix_tag_dicts[CUSTOM];
+
+        return &fix_tag_dicts[version];
+}
@@ -149,6 +149,71 @@ extern const struct FIX_Tag fix50sp1_std_data_tags[];
 extern const struct FIX_Tag fix50sp2_std_data_tags[];
 extern const struct FIX_Tag fixt11_std_data_tags[];
 
+/*
+ * Flat tag dictionary. Tags below FIX_TAG_DICT_DENSE_SIZE, which
+ * covers all standard tags and the user defined range 5000-9999, are
+ * looked up with a single load from the dense array. Higher tags live
+ * in a small open addressing hash table.
+ *
+ * One dictionary per FIX version is built when the library is
+ * loaded. They are read-only from then on and shared by everybody.
+ */
+#define FIX_TAG_DICT_DENSE_SIZE (10000)
+#define FIX_TAG_DICT_SPARSE_SIZE (64) // must be a power of two
+#define FIX_TAG_UNKNOWN (0xFF)
+
+struct FIX_TagDict {
+        uint8_t dense[FIX_TAG_DICT_DENSE_SIZE];          // FIX_Type or FIX_TAG_UNKNOWN
+        unsigned int sparse_count;
+        struct FIX_Tag sparse[FIX_TAG_DICT_SPARSE_SIZE]; // tag 0 (zero) is an empty slot
+};
+
+/*
+ * Returns the shared standard dictionary of version. The dictionary
+ * of CUSTOM is empty.
+ */
+extern const struct FIX_TagDict *get_fix_tag_dict(const FIX_Version version);
+
+/*
+ * Adds or overwrites tag in dict.
+ *
+ * Returns 1 (one) if all is well, 0 (zero) if the sparse table is
+ * full or the tag is 0 (zero).
+ */
+extern int fix_tag_dict_add(struct FIX_TagDict * const dict,
+                            const struct FIX_Tag & tag);
+
+static inline unsigned int
+fix_tag_dict_sparse_slot(const unsigned int tag)
+{
+        return (tag * 2654435761U) & (FIX_TAG_DICT_SPARSE_SIZE - 1);
+}
+
+/*
+ * Returns the FIX_Type of tag or FIX_TAG_UNKNOWN.
+ */
+static inline unsigned int
+fix_tag_dict_type(const struct FIX_TagDict * const dict,
+                  const unsigned int tag)
+{
+        unsigned int slot;
+        unsigned int n;
+
+        if (__builtin_expect(tag < FIX_TAG_DICT_DENSE_SIZE, 1))
+                return dict->dense[tag];
+
+        slot = fix_tag_dict_sparse_slot(tag);
+        for (n = 0; n < FIX_TAG_DICT_SPARSE_SIZE; ++n) {
+                if (tag == dict->sparse[slot].tag)
+                        return dict->sparse[slot].type;
+                if (!dict->sparse[slot].tag)
+                        break;
+                slot = (slot + 1) & (FIX_TAG_DICT_SPARSE_SIZE - 1);
+        }
+
+        return FIX_TAG_UNKNOWN;
+}
+
 enum FIX_MsgType : uint_fast32_t
 {
         fmt_CustomMsg = 0, // hmm, maybe I really don't need this?
@@ -0,0 +1,434 @@
+/*
+ *    Copyright (C) 2013, Jules Colding <jcolding@gmail.com>.
+ *
+ *    All Rights Reserved.
+ */
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     (1) Redistributions of source code must retain the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer.
+ *
+ *     (2) Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *
+ *     (3) Neither the name of the copyright holder nor the names of
+ *     its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written
+ *     permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS
+ * OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifdef HAVE_CONFIG_H
+    #include "ac_config.h"
+#endif
+#include <string.h>
+#include "applib/fixutils/fixmsg_utils.h"
+#include "fix_values.h"
+
+#define NANOS_PER_SECOND (1000000000LL)
+#define NANOS_PER_DAY (86400LL * NANOS_PER_SECOND)
+
+/*
+ * Loads eight characters into a word with the first character in the
+ * least significant byte.
+ */
+static inline uint64_t
+load_8_chars(const uint8_t * const str)
+{
+        uint64_t retv;
+
+        memcpy(&retv, str, sizeof(retv));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        retv = __builtin_bswap64(retv);
+#endif
+        return retv;
+}
+
+/*
+ * Returns non-zero if all eight characters are in the range [0-9].
+ * The high nibble of every byte must be 3 both before and after
+ * adding 6 to each byte.
+ */
+static inline int
+is_8_digits(const uint64_t chars)
+{
+        return ((((chars & 0xF0F0F0F0F0F0F0F0ULL) | (((chars + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) >> 4))) == 0x3333333333333333ULL);
+}
+
+/*
+ * Converts eight digits in three multiplications, pairing neighbours
+ * into two digit numbers and those into four digit numbers.
+ */
+static inline uint32_t
+convert_8_digits(uint64_t chars)
+{
+        chars -= 0x3030303030303030ULL;
+        chars = (chars * 10) + (chars >> 8);
+        chars = (((chars & 0x000000FF000000FFULL) * (100 + (1000000ULL << 32))) +
+                 (((chars >> 16) & 0x000000FF000000FFULL) * (1 + (10000ULL << 32)))) >> 32;
+
+        return (uint32_t)chars;
+}
+
+static inline int
+convert_2_digits(const uint8_t * const str,
+                 unsigned int * const result)
+{
+        const unsigned int high = str[0] - '0';
+        const unsigned int low = str[1] - '0';
+
+        if ((9 < high) || (9 < low))
+                return 0;
+        *result = 10 * high + low;
+
+        return 1;
+}
+
+/*
+ * Converts the length digits at str. Leading zeros aside, at most 19
+ * digits are accepted, so the result never overflows.
+ */
+static int
+convert_digits(const uint8_t *str,
+               size_t length,
+               uint64_t * const result)
+{
+        uint64_t retv = 0;
+        uint64_t chars;
+        unsigned int digit;
+
+        while ((19 < length) && ('0' == *str)) {
+                ++str;
+                --length;
+        }
+        if (19 < length)
+                return 0;
+
+        while (8 <= length) {
+                chars = load_8_chars(str);
+                if (!is_8_digits(chars))
+                        return 0;
+                retv = 100000000 * retv + convert_8_digits(chars);
+                str += 8;
+                length -= 8;
+        }
+        while (length) {
+                digit = *str - '0';
+                if (9 < digit)
+                        return 0;
+                retv = 10 * retv + digit;
+                ++str;
+                --length;
+        }
+        *result = retv;
+
+        return 1;
+}
+
+/*
+ * Applies the sign to magnitude if it fits in an int64_t.
+ */
+static inline int
+to_signed(const int negative,
+          const uint64_t magnitude,
+          int64_t * const result)
+{
+        if (negative) {
+                if ((uint64_t)INT64_MAX + 1 < magnitude)
+                        return 0;
+                *result = (int64_t)((uint64_t)0 - magnitude);
+        } else {
+                if ((uint64_t)INT64_MAX < magnitude)
+                        return 0;
+                *result = (int64_t)magnitude;
+        }
+
+        return 1;
+}
+
+/*
+ * Days since the epoch of a date in the proleptic Gregorian calendar
+ * by the algorithm of Howard Hinnant ("days_from_civil").
+ */
+static inline int32_t
+days_from_civil(int year,
+                const unsigned int month,
+                const unsigned int day)
+{
+        int era;
+        unsigned int yoe;
+        unsigned int doy;
+        unsigned int doe;
+
+        year -= (2 >= month) ? 1 : 0;
+        era = (0 <= year ? year : year - 399) / 400;
+        yoe = (unsigned int)(year - era * 400);
+        doy = (153 * (2 < month ? month - 3 : month + 9) + 2) / 5 + day - 1;
+        doe = yoe * 365 + yoe/4 - yoe/100 + doy;
+
+        return era * 146097 + (int32_t)doe - 719468;
+}
+
+static inline unsigned int
+days_in_month(const unsigned int year,
+              const unsigned int month)
+{
+        static const unsigned char days[12] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+
+        if ((2 == month) && !(year % 4) && ((year % 100) || !(year % 400)))
+                return 29;
+
+        return days[month - 1];
+}
+
+int
+decode_FIX_uint(const uint8_t * const value,
+                const size_t length,
+                uint64_t * const result)
+{
+        if (!length)
+                return 0;
+
+        return convert_digits(value, length, result);
+}
+
+int
+decode_FIX_int(const uint8_t * const value,
+               const size_t length,
+               int64_t * const result)
+{
+        const int negative = (length && ('-' == *value)) ? 1 : 0;
+        uint64_t magnitude;
+
+        if (!decode_FIX_uint(value + negative, length - negative, &magnitude))
+                return 0;
+
+        return to_signed(negative, magnitude, result);
+}
+
+int
+decode_FIX_decimal(const uint8_t * const value,
+                   const size_t length,
+                   struct FIX_Decimal * const result)
+{
+        const int negative = (length && ('-' == *value)) ? 1 : 0;
+        const uint8_t * const start = value + negative;
+        const uint8_t * const end = value + length;
+        const uint8_t *point;
+        size_t fraction_length = 0;
+        uint64_t integer;
+        uint64_t fraction = 0;
+
+        point = (const uint8_t*)memchr(start, '.', end - start);
+        if (!point)
+                point = end;
+        if (point < end)
+                fraction_length = end - point - 1;
+        if ((start == point) && !fraction_length)
+                return 0;
+        if (MAX_DECIMAL_EXPONENT < fraction_length)
+                return 0;
+
+        if (!convert_digits(start, point - start, &integer))
+                return 0;
+        if (fraction_length && !convert_digits(point + 1, fraction_length, &fraction))
+                return 0;
+
+        if (__builtin_mul_overflow(integer, powers_of_ten[fraction_length], &integer))
+                return 0;
+        if (__builtin_add_overflow(integer, fraction, &integer))
+                return 0;
+        if (!to_signed(negative, integer, &result->mantissa))
+                return 0;
+        result->exponent = -(int)fraction_length;
+
+        return 1;
+}
+
+int
+decode_FIX_char(const uint8_t * const value,
+                const size_t length,
+                char * const result)
+{
+        if (1 != length)
+                return 0;
+        *result = (char)*value;
+
+        return 1;
+}
+
+int
+decode_FIX_boolean(const uint8_t * const value,
+                   const size_t length,
+                   int * const result)
+{
+        if (1 != length)
+                return 0;
+
+        switch (*value) {
+        case 'Y':
+                *result = 1;
+                return 1;
+        case 'N':
+                *result = 0;
+                return 1;
+        default:
+                return 0;
+        }
+}
+
+int
+decode_FIX_date(const uint8_t * const value,
+                const size_t length,
+                int32_t * const result)
+{
+        uint64_t chars;
+        unsigned int date;
+        unsigned int year;
+        unsigned int month;
+        unsigned int day;
+
+        if (8 != length)
+                return 0;
+        chars = load_8_chars(value);
+        if (!is_8_digits(chars))
+                return 0;
+
+        date = convert_8_digits(chars);
+        year = date / 10000;
+        month = date / 100 % 100;
+        day = date % 100;
+        if (!month || (12 < month) || !day || (days_in_month(year, month) < day))
+                return 0;
+        *result = days_from_civil((int)year, month, day);
+
+        return 1;
+}
+
+int
+decode_FIX_utc_time_only(const uint8_t * const value,
+                         const size_t length,
+                         int64_t * const result)
+{
+        unsigned int hours;
+        unsigned int minutes;
+        unsigned int seconds;
+        uint64_t fraction;
+        size_t fraction_length;
+
+        if ((8 > length) || (':' != value[2]) || (':' != value[5]))
+                return 0;
+        if (!convert_2_digits(value, &hours) || (23 < hours))
+                return 0;
+        if (!convert_2_digits(value + 3, &minutes) || (59 < minutes))
+                return 0;
+        if (!convert_2_digits(value + 6, &seconds) || (60 < seconds)) // leap second
+                return 0;
+        *result = (((int64_t)hours * 60 + minutes) * 60 + seconds) * NANOS_PER_SECOND;
+
+        if (8 == length)
+                return 1;
+
+        fraction_length = length - 9;
+        if (('.' != value[8]) || !fraction_length || (9 < fraction_length))
+                return 0;
+        if (!convert_digits(value + 9, fraction_length, &fraction))
+                return 0;
+        *result += (int64_t)(fraction * powers_of_ten[9 - fraction_length]);
+
+        return 1;
+}
+
+int
+decode_FIX_utc_timestamp(const uint8_t * const value,
+                         const size_t length,
+                         int64_t * const result)
+{
+        int32_t days;
+        int64_t nanoseconds;
+
+        if ((17 > length) || ('-' != value[8]))
+                return 0;
+        if (!decode_FIX_date(value, 8, &days))
+                return 0;
+        if (!decode_FIX_utc_time_only(value + 9, length - 9, &nanoseconds))
+                return 0;
+
+        // int64_t nanoseconds cover the years 1678 through 2261
+        if (__builtin_mul_overflow((int64_t)days, NANOS_PER_DAY, result))
+                return 0;
+        if (__builtin_add_overflow(*result, nanoseconds, result))
+                return 0;
+
+        return 1;
+}
+
+int
+decode_FIX_value(const unsigned int type,
+                 const uint8_t * const value,
+                 const size_t length,
+                 struct FIX_Value * const result)
+{
+        int retv;
+
+        switch (type) {
+        case ft_int:
+        case ft_DayOfMonth:
+                retv = decode_FIX_int(value, length, &result->u.integer);
+                break;
+        case ft_Length:
+        case ft_TagNum:
+        case ft_SeqNum:
+        case ft_NumInGroup:
+                retv = decode_FIX_uint(value, length, &result->u.uinteger);
+                break;
+        case ft_float:
+        case ft_Qty:
+        case ft_Price:
+        case ft_PriceOffset:
+        case ft_Amt:
+        case ft_Percentage:
+                retv = decode_FIX_decimal(value, length, &result->u.decimal);
+                break;
+        case ft_char:
+                retv = decode_FIX_char(value, length, &result->u.character);
+                break;
+        case ft_Boolean:
+                retv = decode_FIX_boolean(value, length, &result->u.boolean);
+                break;
+        case ft_UTCTimestamp:
+                retv = decode_FIX_utc_timestamp(value, length, &result->u.nanoseconds);
+                break;
+        case ft_UTCTimeOnly:
+                retv = decode_FIX_utc_time_only(value, length, &result->u.nanoseconds);
+                break;
+        case ft_UTCDateOnly:
+        case ft_LocalMktDate:
+                retv = decode_FIX_date(value, length, &result->u.days);
+                break;
+        default:
+                return 0;
+        }
+        result->type = type;
+
+        return retv;
+}
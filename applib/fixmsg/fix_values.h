@@ -0,0 +1,160 @@
+/*
+ *    Copyright (C) 2013, Jules Colding <jcolding@gmail.com>.
+ *
+ *    All Rights Reserved.
+ */
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     (1) Redistributions of source code must retain the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer.
+ *
+ *     (2) Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *
+ *     (3) Neither the name of the copyright holder nor the names of
+ *     its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written
+ *     permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS
+ * OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <stdlib.h>
+#include <stdint.h>
+#ifdef HAVE_CONFIG_H
+    #include "ac_config.h"
+#endif
+#include "fix_types.h"
+
+#define MAX_DECIMAL_EXPONENT (18) // largest exponent, or number of fraction digits, of a decimal
+
+/*
+ * Decoders of the field values returned by
+ * FIXMessageRX::next_field(). They take the value as a pointer and a
+ * length, never read outside of it, do not depend on the locale and
+ * do not allocate. Digits are converted eight at a time within a
+ * 64 bit word.
+ *
+ * All of them return 1 (one) if the value is well formed, 0 (zero)
+ * if not, in which case *result is undefined.
+ */
+
+/*
+ * A fixed-point decimal, mantissa * 10^exponent. Decoded values keep
+ * the digits as sent, so "15.00" is { 1500, -2 }. It is the
+ * representation taken by FIXMessageTX::append_decimal().
+ */
+struct FIX_Decimal {
+        int64_t mantissa;
+        int exponent;
+};
+
+/*
+ * An optional '-' followed by at most 19 significant digits that fit
+ * in an int64_t. For int, DayOfMonth and the like.
+ */
+int decode_FIX_int(const uint8_t * const value,
+                   const size_t length,
+                   int64_t * const result);
+
+/*
+ * As above, but without a sign. For Length, TagNum, SeqNum,
+ * NumInGroup and the like.
+ */
+int decode_FIX_uint(const uint8_t * const value,
+                    const size_t length,
+                    uint64_t * const result);
+
+/*
+ * An optional '-', digits and optionally '.' and at most
+ * MAX_DECIMAL_EXPONENT fraction digits. The digits must fit in an
+ * int64_t mantissa. For float, Qty, Price, PriceOffset, Amt and
+ * Percentage.
+ */
+int decode_FIX_decimal(const uint8_t * const value,
+                       const size_t length,
+                       struct FIX_Decimal * const result);
+
+/*
+ * A single character.
+ */
+int decode_FIX_char(const uint8_t * const value,
+                    const size_t length,
+                    char * const result);
+
+/*
+ * 'Y' as 1 (one) and 'N' as 0 (zero).
+ */
+int decode_FIX_boolean(const uint8_t * const value,
+                       const size_t length,
+                       int * const result);
+
+/*
+ * "YYYYMMDD-HH:MM:SS" with an optional fraction of 1 to 9 digits, as
+ * nanoseconds since the epoch. For UTCTimestamp.
+ */
+int decode_FIX_utc_timestamp(const uint8_t * const value,
+                             const size_t length,
+                             int64_t * const result);
+
+/*
+ * "HH:MM:SS" with an optional fraction of 1 to 9 digits, as
+ * nanoseconds since midnight. For UTCTimeOnly.
+ */
+int decode_FIX_utc_time_only(const uint8_t * const value,
+                             const size_t length,
+                             int64_t * const result);
+
+/*
+ * "YYYYMMDD" as days since the epoch. For UTCDateOnly and
+ * LocalMktDate.
+ */
+int decode_FIX_date(const uint8_t * const value,
+                    const size_t length,
+                    int32_t * const result);
+
+/*
+ * A decoded value of the type given by the tag dictionary.
+ */
+struct FIX_Value {
+        unsigned int type; // enum FIX_Type
+        union {
+                int64_t integer;            // int, DayOfMonth
+                uint64_t uinteger;          // Length, TagNum, SeqNum, NumInGroup
+                struct FIX_Decimal decimal; // float, Qty, Price, PriceOffset, Amt, Percentage
+                char character;             // char
+                int boolean;                // Boolean
+                int64_t nanoseconds;        // UTCTimestamp since the epoch, UTCTimeOnly since midnight
+                int32_t days;               // UTCDateOnly and LocalMktDate since the epoch
+        } u;
+};
+
+/*
+ * Decodes value by the decoder of type, an enum FIX_Type such as
+ * returned by FIXMessageRX::field_type(). Returns 0 (zero) for types
+ * without a decoder, e.g. String and data, which are used as is.
+ */
+int decode_FIX_value(const unsigned int type,
+                     const uint8_t * const value,
+                     const size_t length,
+                     struct FIX_Value * const result);
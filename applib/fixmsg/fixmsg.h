@@ -42,17 +42,31 @@
 #ifdef HAVE_CONFIG_H
     #include "ac_config.h"
 #endif
-#include <set>
-#include <map>
 #include <string.h>
 #include <stddef.h>
 #include <stdlib.h>
 #include "stdlib/disruptor/memsizes.h"
+#include "stdlib/process/cpu.h"
 #include "applib/fixmsg/fix_types.h"
+#include "applib/fixmsg/fix_timestamp.h"
+#include "applib/fixmsg/fix_values.h"
+#include "applib/fixmsg/fix_groups.h"
 #include "applib/fixutils/db_utils.h"
 
 #define INITIAL_TX_BUFFER_SIZE (2048)
 #define MAX_MSGTYPE_LENGTH (CACHE_LINE_SIZE)
+#define INITIAL_RX_INDEX_SIZE (64)  // fields room is first made for by FIXMessageRX::index()
+#define RX_INDEX_HOT_TAGS (1024)    // tags below this are looked up in constant time by FIXMessageRX::get()
+
+/*
+ * A field of an indexed FIXMessageRX. offset is counted from the
+ * start of the message.
+ */
+struct FIX_FieldRef {
+        uint32_t tag;
+        uint32_t offset;
+        uint32_t length;
+};
 
 /*
  * FIXMessageTX will prepare a message for sending by the FIXIO
@@ -106,6 +120,31 @@ public:
                         return (buf_ ? 1 : 0);
                 };
 
+        /*
+         * Readies the instance for a new message like init(), but
+         * keeps the buffer it already has. Used by FIXMessagePool,
+         * please see fixmsg_pool.h.
+         *
+         * Returns 1 (one) if all is well, 0 (zero) if not.
+         */
+        int reset(void)
+                {
+                        if (!buf_)
+                                return init();
+
+                        pos_ = buf_;
+                        *pos_ = soh_;
+                        length_ = 1;
+                        ++pos_;
+                        msg_type_[0] = '\0';
+			sending_time_appended_ = 0;
+
+			ttl_.tv_sec = 0;
+			ttl_.tv_usec = 0;
+
+                        return 1;
+                };
+
         /*
          * Appends a FIX field, in order, into the
          * message. insert_value() does not take ownership of the
@@ -123,6 +162,80 @@ public:
 				 const size_t length,
 				 const uint8_t *value);
 
+	/*
+	 * Inserts a FIX field in front of all fields of the
+	 * message. The pusher writes tags 8, 9, 35 and 34 in front of
+	 * the partial message, so a prepended field always belongs to
+	 * the standard header. Used for the header fields added when
+	 * a stored message is resent.
+	 *
+	 * Returns 1 (one) if all is well, 0 (zero) if not.
+	 */
+	int prepend_field(const unsigned int tag,
+			  const size_t length,
+			  const uint8_t *value);
+
+	/*
+	 * Appends tag 52 (SendingTime) with the current UTC time at
+	 * the given precision, see fix_timestamp.h. The precision
+	 * must be FIX_TS_SECONDS for FIX 4.0 and 4.1.
+	 *
+	 * Returns 1 (one) if all is well, 0 (zero) if not.
+	 */
+	int append_sending_time(const enum FIX_TimestampPrecision precision = FIX_TS_MILLI)
+		{
+			return append_utc_timestamp(52, precision);
+		};
+
+	/*
+	 * Appends a UTCTimestamp typed field with the current UTC
+	 * time at the given precision.
+	 *
+	 * Returns 1 (one) if all is well, 0 (zero) if not.
+	 */
+	int append_utc_timestamp(const unsigned int tag,
+				 const enum FIX_TimestampPrecision precision);
+
+	/*
+	 * Typed appenders. The value is formatted straight into the
+	 * message, otherwise they are as append_field(). Only
+	 * append_char() may append tag 35 (MsgType).
+	 *
+	 * append_decimal() appends mantissa * 10^exponent, so a price
+	 * of 123.45 is append_decimal(tag, 12345, -2). Trailing zeros
+	 * of the mantissa are kept. exponent must be in the range
+	 * [-MAX_DECIMAL_EXPONENT, MAX_DECIMAL_EXPONENT].
+	 *
+	 * append_bool() appends 'Y' if value is non-zero, 'N' if not.
+	 *
+	 * append_timestamp() appends ts as an UTCTimestamp at the
+	 * given precision, see fix_timestamp.h.
+	 *
+	 * Returns 1 (one) if all is well, 0 (zero) if not.
+	 */
+	int append_uint(const unsigned int tag,
+			const uint64_t value);
+
+	int append_int(const unsigned int tag,
+		       const int64_t value);
+
+	int append_decimal(const unsigned int tag,
+			   const int64_t mantissa,
+			   const int exponent);
+
+	int append_char(const unsigned int tag,
+			const char value);
+
+	int append_bool(const unsigned int tag,
+			const int value)
+		{
+			return append_char(tag, value ? 'Y' : 'N');
+		};
+
+	int append_timestamp(const unsigned int tag,
+			     const struct timespec * const ts,
+			     const enum FIX_TimestampPrecision precision);
+
 	/*
 	 * Determines the time to live (ttl) for this particular
 	 * message. The ttl will remain valid for this instance until
@@ -175,7 +288,43 @@ public:
 	 */
 	int clone_from(const PartialMessage * const pmsg);
 
+	/*
+	 * As above, but the partial message is given by its
+	 * parts. msg_type is zero terminated and length is the number
+	 * of bytes in part_msg.
+	 *
+	 * Returns 1 (one) if all is well, 0 (zero) if not.
+	 */
+	int clone_from(const char * const msg_type,
+		       const size_t length,
+		       const uint8_t * const part_msg,
+		       const struct timeval * const ttl);
+
 private:
+	/*
+	 * Makes room for tag and a value of at most max_length bytes
+	 * and writes "tag=". The value is then written at pos_ and
+	 * terminated by end_field(). Fails for tag 35 (MsgType).
+	 *
+	 * Returns 1 (one) if all is well, 0 (zero) if not.
+	 */
+	int begin_field(const unsigned int tag,
+			const size_t max_length);
+
+	void end_field(void)
+		{
+			*pos_ = soh_;
+			++pos_;
+			length_ = pos_ - buf_;
+		};
+
+	/*
+	 * Grows the buffer to at least size bytes.
+	 *
+	 * Returns 1 (one) if all is well, 0 (zero) if not.
+	 */
+	int grow(const size_t size);
+
         const char soh_;
 	struct timeval ttl_;
         char msg_type_[MAX_MSGTYPE_LENGTH];
@@ -210,17 +359,22 @@ public:
 
         static FIXMessageRX *make_fix_message_with_provided_mem_on_heap(const FIX_Version version,
                                                                         const char soh);
+        FIXMessageRX(const FIXMessageRX & other);
+
         virtual ~FIXMessageRX()
                 {
                         if (owns_memory_)
                                 free(msg_);
+                        free(custom_dict_);
+                        free(fields_);
+                        free(hot_slots_);
                 };
 
 
         /*
          * Must be invoked before an instance of this class is set to
-         * work. This is a heavy operation so objects of this class
-         * must be pooled. They are not cheap to create.
+         * work. It merely points the instance at the shared tag
+         * dictionary of its FIX version and drops any custom tags.
          *
          * Returns 1 (one) if all is well, 0 (zero) if not.
          */
@@ -233,8 +387,11 @@ public:
          * These custom tags can never be removed and they will
          * overwrite the standard tags in case of a tag collision.
          *
-         * Again, this is a heavy operation and should only be invoked
-         * once in the objects lifetime.
+         * The first custom tag gives the instance a private copy of
+         * the tag dictionary, so this is a heavy operation and should
+         * only be invoked when the instance is set up. At most
+         * FIX_TAG_DICT_SPARSE_SIZE - 1 tags above
+         * FIX_TAG_DICT_DENSE_SIZE - 1 can be added.
          *
          * Returns 1 (one) if all is well, 0 (zero) if not.
          */
@@ -250,9 +407,12 @@ public:
                 {
                         if (owns_memory_)
                                 free(msg_);
+                        if (field_count_)
+                                clear_index();
                         msg_ = msg;
                         prev_value_ = NULL;
                         pos_ = msg_ + msgtype_offset - 3; // reverse over "35=" to point at '3'
+                        start_ = pos_;
                 };
 
         /*
@@ -262,8 +422,11 @@ public:
                 {
                         if (owns_memory_)
                                 free(msg_);
+                        if (field_count_)
+                                clear_index();
                         msg_ = NULL;
                         pos_ = NULL;
+                        start_ = NULL;
                         prev_value_ = NULL;
                 };
 
@@ -314,6 +477,159 @@ public:
          */
         int next_field(size_t & length, uint8_t **value);
 
+        /*
+         * Returns the enum FIX_Type of tag, custom tags included, or
+         * FIX_TAG_UNKNOWN. Field values are decoded by
+         * decode_FIX_value() or the decoder of the type, please see
+         * fix_values.h.
+         */
+        unsigned int field_type(const unsigned int tag) const
+                {
+                        return fix_tag_dict_type(dict_, tag);
+                };
+
+        /*
+         * Tokenizes the whole message in one pass into an index of
+         * its fields, for get(), get_field() and missing_field(). The
+         * fields are as returned by next_field(), whose traversal is
+         * not affected. The index storage is kept and reused by the
+         * next message, so once warm this does not allocate.
+         *
+         * The index is dropped by imprint() and done().
+         *
+         * Returns the number of fields, 0 (zero) if no message is
+         * imprinted or -1 (minus one) if the message can not be
+         * parsed, see next_field(), or indexed for lack of memory.
+         */
+        int index(void);
+
+        /*
+         * Returns the number of indexed fields.
+         */
+        size_t field_count(void) const
+                {
+                        return field_count_;
+                };
+
+        /*
+         * Finds the first field of tag in the index. Tags below
+         * RX_INDEX_HOT_TAGS are found in constant time, others by
+         * searching the index.
+         *
+         * Returns 1 (one) and sets length and *value as next_field()
+         * if found, 0 (zero) if not.
+         */
+        int get(const unsigned int tag,
+                size_t & length,
+                uint8_t **value) const
+                {
+                        const struct FIX_FieldRef *field;
+                        size_t n;
+
+                        if (LIKELY__(RX_INDEX_HOT_TAGS > tag)) {
+                                if (!hot_slots_ || !hot_slots_[tag])
+                                        return 0;
+                                field = &fields_[hot_slots_[tag] - 1];
+                        } else {
+                                for (n = 0; n < field_count_; ++n) {
+                                        if (tag == fields_[n].tag)
+                                                break;
+                                }
+                                if (n == field_count_)
+                                        return 0;
+                                field = &fields_[n];
+                        }
+                        length = field->length;
+                        *value = msg_ + field->offset;
+
+                        return 1;
+                };
+
+        /*
+         * Gets the n'th field of the index, counting from 0 (zero)
+         * in message order.
+         *
+         * Returns the tag and sets length and *value as next_field(),
+         * or 0 (zero) if there are no more fields.
+         */
+        int get_field(const size_t n,
+                      size_t & length,
+                      uint8_t **value) const
+                {
+                        if (n >= field_count_)
+                                return 0;
+                        length = fields_[n].length;
+                        *value = msg_ + fields_[n].offset;
+
+                        return (int)fields_[n].tag;
+                };
+
+        /*
+         * Checks the index for count required tags.
+         *
+         * Returns the first of them which is missing, or 0 (zero) if
+         * all are present.
+         */
+        unsigned int missing_field(const unsigned int * const tags,
+                                   const size_t count) const;
+
+        /*
+         * Opens the repeating group of desc in the index. Entries are
+         * then read by next_entry() and their fields found by
+         * get_entry_field() or get_field() over [entry_begin,
+         * entry_end) of the cursor. Nothing is copied, values point
+         * into the message.
+         *
+         * Returns 1 (one) if the NumInGroup field is present, 0 (zero)
+         * if not or -1 (minus one) if its value is not a number.
+         */
+        int open_group(const struct FIX_GroupDesc & desc,
+                       struct FIX_GroupCursor & cursor) const;
+
+        /*
+         * As open_group() but opens a group nested in the current
+         * entry of parent.
+         */
+        int open_nested_group(const struct FIX_GroupCursor & parent,
+                              const struct FIX_GroupDesc & desc,
+                              struct FIX_GroupCursor & cursor) const;
+
+        /*
+         * Moves the cursor to the next entry of the group. The fields
+         * of nested groups are part of the entry. Once all entries
+         * are read, cursor.next is the first field after the group.
+         *
+         * Returns 1 (one) if there is an entry, 0 (zero) if all have
+         * been read or -1 (minus one) if the entry does not start
+         * with the delimiter tag, has fields of a malformed nested
+         * group or if the delimiter tag follows the last entry.
+         */
+        int next_entry(struct FIX_GroupCursor & cursor) const;
+
+        /*
+         * Finds the first field of tag in the current entry of cursor.
+         *
+         * Returns 1 (one) and sets length and *value as next_field()
+         * if found, 0 (zero) if not.
+         */
+        int get_entry_field(const struct FIX_GroupCursor & cursor,
+                            const unsigned int tag,
+                            size_t & length,
+                            uint8_t **value) const
+                {
+                        size_t n;
+
+                        for (n = cursor.entry_begin; n < cursor.entry_end; ++n) {
+                                if (tag == fields_[n].tag) {
+                                        length = fields_[n].length;
+                                        *value = msg_ + fields_[n].offset;
+                                        return 1;
+                                }
+                        }
+
+                        return 0;
+                };
+
 protected:
         FIXMessageRX(const FIX_Version version,
                      const int owns_memory,
@@ -321,9 +637,16 @@ protected:
                 : version_(version),
                   owns_memory_(owns_memory),
                   soh_(soh),
+                  dict_(get_fix_tag_dict(version)),
+                  custom_dict_(NULL),
                   msg_(NULL),
                   pos_(NULL),
-                  prev_value_(NULL)
+                  prev_value_(NULL),
+                  start_(NULL),
+                  fields_(NULL),
+                  field_count_(0),
+                  field_capacity_(0),
+                  hot_slots_(NULL)
                 {
                 };
 
@@ -332,16 +655,47 @@ private:
          * Returns 1 (one) if the tag is of type ft_data, 0 (zero)
          * otherwise.
          */
-        int field_contains_data(unsigned int tag);
+        int field_contains_data(unsigned int tag)
+                {
+                        return (ft_data == fix_tag_dict_type(dict_, tag));
+                };
 
         const FIX_Version version_;
         const int owns_memory_;
         const char soh_;
-        std::set<unsigned int> data_tags_;
-        std::map<unsigned int, FIX_Type> tags_;
+        const struct FIX_TagDict *dict_;  // shared or custom_dict_
+        struct FIX_TagDict *custom_dict_; // private copy once custom tags are added
         uint8_t *msg_;
+        /*
+         * Reads the field at pos as next_field() does and advances
+         * pos and prev_value past it.
+         */
+        int read_field(uint8_t *& pos,
+                       uint8_t *& prev_value,
+                       size_t & length,
+                       uint8_t **value);
+
+        /*
+         * Empties the index.
+         */
+        void clear_index(void);
+
+        /*
+         * Sets up cursor for the group of desc whose NumInGroup field
+         * is the n'th of the index. The group ends before field end.
+         */
+        int start_group(const struct FIX_GroupDesc & desc,
+                        const size_t n,
+                        const size_t end,
+                        struct FIX_GroupCursor & cursor) const;
+
         uint8_t *pos_;
         uint8_t *prev_value_;
+        uint8_t *start_;              // the first field of the imprinted message
+        struct FIX_FieldRef *fields_; // the index, field_capacity_ entries
+        size_t field_count_;          // number of indexed fields
+        size_t field_capacity_;
+        uint32_t *hot_slots_;         // RX_INDEX_HOT_TAGS slots, 1 (one) + the first field of the tag or 0 (zero)
 };
 
 inline FIXMessageRX
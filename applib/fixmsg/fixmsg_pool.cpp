@@ -0,0 +1,202 @@
+/*
+ *    Copyright (C) 2013, Jules Colding <jcolding@gmail.com>.
+ *
+ *    All Rights Reserved.
+ */
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     (1) Redistributions of source code must retain the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer.
+ *
+ *     (2) Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *
+ *     (3) Neither the name of the copyright holder nor the names of
+ *     its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written
+ *     permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS
+ * OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "fixmsg_pool.h"
+
+#ifdef HAVE_CONFIG_H
+    #include "ac_config.h"
+#endif
+#include <new>
+
+FIXMessageTX*
+FIXMessagePool::make_tx(void)
+{
+        FIXMessageTX *retv = new (std::nothrow) FIXMessageTX(soh_);
+
+        if (retv && !retv->init()) {
+                delete retv;
+                retv = NULL;
+        }
+
+        return retv;
+}
+
+FIXMessageRX*
+FIXMessagePool::make_rx(void)
+{
+        FIXMessageRX *retv;
+
+        try {
+                if (rx_owns_memory_)
+                        retv = FIXMessageRX::make_fix_message_mem_owner_on_heap(version_, soh_);
+                else
+                        retv = FIXMessageRX::make_fix_message_with_provided_mem_on_heap(version_, soh_);
+        }
+        catch (std::bad_alloc & e) {
+                return NULL;
+        }
+        if (!retv->init()) {
+                delete retv;
+                retv = NULL;
+        }
+
+        return retv;
+}
+
+int
+FIXMessagePool::prewarm(const size_t tx_count,
+                        const size_t rx_count)
+{
+        size_t n;
+        FIXMessageTX *tx_msg;
+        FIXMessageRX *rx_msg;
+
+        try {
+                tx_.reserve(tx_count);
+                rx_.reserve(rx_count);
+        }
+        catch (std::bad_alloc & e) {
+                return 0;
+        }
+
+        for (n = tx_.size(); n < tx_count; ++n) {
+                tx_msg = make_tx();
+                if (!tx_msg)
+                        return 0;
+                tx_.give(&tx_msg, 1);
+        }
+        for (n = rx_.size(); n < rx_count; ++n) {
+                rx_msg = make_rx();
+                if (!rx_msg)
+                        return 0;
+                rx_.give(&rx_msg, 1);
+        }
+
+        return 1;
+}
+
+size_t
+FIXMessagePool::take_tx(FIXMessageTX **msgs,
+                        const size_t count)
+{
+        size_t retv = tx_.take(msgs, count);
+
+        if (!retv) {
+                msgs[0] = make_tx();
+                if (msgs[0])
+                        retv = 1;
+        }
+
+        return retv;
+}
+
+size_t
+FIXMessagePool::take_rx(FIXMessageRX **msgs,
+                        const size_t count)
+{
+        size_t retv = rx_.take(msgs, count);
+
+        if (!retv) {
+                msgs[0] = make_rx();
+                if (msgs[0])
+                        retv = 1;
+        }
+
+        return retv;
+}
+
+FIXMessageTX*
+FIXMessagePool::get_tx(void)
+{
+        FIXMessageTX *retv;
+
+        return (take_tx(&retv, 1) ? retv : NULL);
+}
+
+FIXMessageRX*
+FIXMessagePool::get_rx(void)
+{
+        FIXMessageRX *retv;
+
+        return (take_rx(&retv, 1) ? retv : NULL);
+}
+
+void
+FIXMessagePool::put_tx(FIXMessageTX * const msg)
+{
+        if (!msg->reset()) {
+                delete msg;
+                return;
+        }
+        tx_.give(&msg, 1);
+}
+
+void
+FIXMessagePool::put_rx(FIXMessageRX * const msg)
+{
+        msg->done();
+        msg->init();
+        rx_.give(&msg, 1);
+}
+
+void
+FIXMessagePoolCache::put_tx(FIXMessageTX * const msg)
+{
+        if (!msg->reset()) {
+                delete msg;
+                return;
+        }
+        if (FIXMSG_POOL_CACHE_SIZE == tx_count_) {
+                tx_count_ -= FIXMSG_POOL_CACHE_BATCH;
+                pool_.tx_.give(tx_ + tx_count_, FIXMSG_POOL_CACHE_BATCH);
+        }
+        tx_[tx_count_++] = msg;
+}
+
+void
+FIXMessagePoolCache::put_rx(FIXMessageRX * const msg)
+{
+        msg->done();
+        msg->init();
+        if (FIXMSG_POOL_CACHE_SIZE == rx_count_) {
+                rx_count_ -= FIXMSG_POOL_CACHE_BATCH;
+                pool_.rx_.give(rx_ + rx_count_, FIXMSG_POOL_CACHE_BATCH);
+        }
+        rx_[rx_count_++] = msg;
+}
@@ -0,0 +1,287 @@
+/*
+ *    Copyright (C) 2013, Jules Colding <jcolding@gmail.com>.
+ *
+ *    All Rights Reserved.
+ */
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     (1) Redistributions of source code must retain the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer.
+ *
+ *     (2) Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *
+ *     (3) Neither the name of the copyright holder nor the names of
+ *     its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written
+ *     permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS
+ * OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#pragma once
+
+#ifdef HAVE_CONFIG_H
+    #include "ac_config.h"
+#endif
+#include <stddef.h>
+#include <vector>
+#include "stdlib/locks/guard.h"
+#include "applib/fixmsg/fixmsg.h"
+
+/*
+ * Number of messages of each kind a FIXMessagePoolCache holds on
+ * to. Half of it is moved to or from the pool at a time.
+ */
+#define FIXMSG_POOL_CACHE_SIZE (32)
+#define FIXMSG_POOL_CACHE_BATCH (FIXMSG_POOL_CACHE_SIZE / 2)
+
+/*
+ * Mutex protected list of free messages.
+ */
+template <typename Msg>
+class FIXMessageFreeList
+{
+public:
+        FIXMessageFreeList()
+                {
+                };
+
+        ~FIXMessageFreeList()
+                {
+                        size_t n;
+
+                        for (n = 0; n < free_.size(); ++n)
+                                delete free_[n];
+                };
+
+        /*
+         * Moves up to count messages into msgs. Returns the number of
+         * messages moved.
+         */
+        size_t take(Msg **msgs,
+                    const size_t count)
+                {
+                        size_t n = 0;
+
+                        guard_.enter();
+                        while ((n < count) && !free_.empty()) {
+                                msgs[n] = free_.back();
+                                free_.pop_back();
+                                ++n;
+                        }
+                        guard_.leave();
+
+                        return n;
+                };
+
+        /*
+         * Moves count messages from msgs into the list.
+         */
+        void give(Msg * const *msgs,
+                  const size_t count)
+                {
+                        size_t n;
+
+                        guard_.enter();
+                        for (n = 0; n < count; ++n)
+                                free_.push_back(msgs[n]);
+                        guard_.leave();
+                };
+
+        size_t size(void)
+                {
+                        size_t retv;
+
+                        guard_.enter();
+                        retv = free_.size();
+                        guard_.leave();
+
+                        return retv;
+                };
+
+        void reserve(const size_t count)
+                {
+                        guard_.enter();
+                        free_.reserve(count);
+                        guard_.leave();
+                };
+
+private:
+        MutexGuard guard_;
+        std::vector<Msg*> free_;
+};
+
+/*
+ * A pool of FIXMessageTX and FIXMessageRX instances of one FIX version
+ * and SOH. Messages keep their buffers while in the pool, so a
+ * message taken from a warm pool is ready for use without any
+ * allocation.
+ *
+ * The pool itself is thread safe, but every call takes a mutex. Busy
+ * threads should get and put messages through a FIXMessagePoolCache
+ * of their own. A message may be returned by any thread, to the pool
+ * or to any cache of the pool, regardless of where it was taken.
+ *
+ * The pool must outlive its caches. Messages not returned when the
+ * pool is destroyed are not deleted by it.
+ */
+class FIXMessagePool
+{
+public:
+        /*
+         * RX messages are made by
+         * make_fix_message_mem_owner_on_heap() if rx_owns_memory is
+         * non-zero and by make_fix_message_with_provided_mem_on_heap()
+         * otherwise.
+         */
+        FIXMessagePool(const FIX_Version version,
+                       const char soh,
+                       const int rx_owns_memory)
+                : version_(version),
+                  soh_(soh),
+                  rx_owns_memory_(rx_owns_memory)
+                {
+                };
+
+        ~FIXMessagePool()
+                {
+                };
+
+        /*
+         * Creates messages until at least tx_count TX and rx_count RX
+         * messages are free in the pool. Room is reserved for all of
+         * them, so returning them later does not allocate.
+         *
+         * Returns 1 (one) if all is well, 0 (zero) if not.
+         */
+        int prewarm(const size_t tx_count,
+                    const size_t rx_count);
+
+        /*
+         * Returns an initialized message or NULL if out of
+         * memory. A new message is created if the pool is empty.
+         */
+        FIXMessageTX *get_tx(void);
+        FIXMessageRX *get_rx(void);
+
+        /*
+         * Returns a message to the pool. TX messages are reset() and
+         * RX messages done() and init(), so RX messages lose any
+         * custom tags.
+         */
+        void put_tx(FIXMessageTX * const msg);
+        void put_rx(FIXMessageRX * const msg);
+
+        size_t free_tx(void)
+                {
+                        return tx_.size();
+                };
+
+        size_t free_rx(void)
+                {
+                        return rx_.size();
+                };
+
+private:
+        friend class FIXMessagePoolCache;
+
+        FIXMessageTX *make_tx(void);
+        FIXMessageRX *make_rx(void);
+
+        /*
+         * Moves up to count messages into msgs, creating a single
+         * message if the pool is empty. Returns the number of messages
+         * moved, 0 (zero) if out of memory.
+         */
+        size_t take_tx(FIXMessageTX **msgs,
+                       const size_t count);
+        size_t take_rx(FIXMessageRX **msgs,
+                       const size_t count);
+
+        const FIX_Version version_;
+        const char soh_;
+        const int rx_owns_memory_;
+        FIXMessageFreeList<FIXMessageTX> tx_;
+        FIXMessageFreeList<FIXMessageRX> rx_;
+};
+
+/*
+ * A per-thread cache in front of a FIXMessagePool. Once warm, the
+ * messages a thread gets and puts stay in the cache without locking
+ * or allocating. The pool is only visited when the cache runs empty
+ * or full.
+ *
+ * An instance must only be used by one thread at a time. Cached
+ * messages are returned to the pool by the destructor.
+ */
+class FIXMessagePoolCache
+{
+public:
+        FIXMessagePoolCache(FIXMessagePool & pool)
+                : pool_(pool),
+                  tx_count_(0),
+                  rx_count_(0)
+                {
+                };
+
+        ~FIXMessagePoolCache()
+                {
+                        pool_.tx_.give(tx_, tx_count_);
+                        pool_.rx_.give(rx_, rx_count_);
+                };
+
+        /*
+         * Returns an initialized message or NULL if out of memory.
+         */
+        FIXMessageTX *get_tx(void)
+                {
+                        if (!tx_count_)
+                                tx_count_ = pool_.take_tx(tx_, FIXMSG_POOL_CACHE_BATCH);
+
+                        return (tx_count_ ? tx_[--tx_count_] : NULL);
+                };
+
+        FIXMessageRX *get_rx(void)
+                {
+                        if (!rx_count_)
+                                rx_count_ = pool_.take_rx(rx_, FIXMSG_POOL_CACHE_BATCH);
+
+                        return (rx_count_ ? rx_[--rx_count_] : NULL);
+                };
+
+        /*
+         * Returns a message to the cache. Please see
+         * FIXMessagePool::put_tx() and FIXMessagePool::put_rx().
+         */
+        void put_tx(FIXMessageTX * const msg);
+        void put_rx(FIXMessageRX * const msg);
+
+private:
+        FIXMessagePoolCache(const FIXMessagePoolCache&);
+        FIXMessagePoolCache& operator=(const FIXMessagePoolCache&);
+
+        FIXMessagePool & pool_;
+        size_t tx_count_;
+        size_t rx_count_;
+        FIXMessageTX *tx_[FIXMSG_POOL_CACHE_SIZE];
+        FIXMessageRX *rx_[FIXMSG_POOL_CACHE_SIZE];
+};
@@ -43,89 +43,44 @@
     #include "ac_config.h"
 #endif
 #include <stdio.h>
+#include <new>
 #include "applib/fixutils/fixmsg_utils.h"
 
-int
-FIXMessageRX::field_contains_data(unsigned int tag)
+FIXMessageRX::FIXMessageRX(const FIXMessageRX & other)
+        : version_(other.version_),
+          owns_memory_(other.owns_memory_),
+          soh_(other.soh_),
+          dict_(other.dict_),
+          custom_dict_(NULL),
+          msg_(other.msg_),
+          pos_(other.pos_),
+          prev_value_(other.prev_value_),
+          start_(other.start_),
+          fields_(NULL),
+          field_count_(0),
+          field_capacity_(0),
+          hot_slots_(NULL)
 {
-        std::set<unsigned int>::const_iterator it;
-
-        it = data_tags_.find(tag);
-        if (data_tags_.end() == it)
-                return 0;
+        if (!other.custom_dict_)
+                return;
 
-        return 1;
+        custom_dict_ = (struct FIX_TagDict*)malloc(sizeof(struct FIX_TagDict));
+        if (!custom_dict_)
+                throw std::bad_alloc();
+        memcpy(custom_dict_, other.custom_dict_, sizeof(struct FIX_TagDict));
+        dict_ = custom_dict_;
 }
 
 int
 FIXMessageRX::init(void)
 {
-        const struct FIX_Tag *fix_tags;
-        const struct FIX_Tag *fix_data_tags;
-
-	tags_.clear();
-	data_tags_.clear();
-
-        switch (version_) {
-        case FIX_4_0:
-                fix_tags = fix40_std_tags;
-                fix_data_tags = fix40_std_data_tags;
-                break;
-        case FIX_4_1:
-                fix_tags = fix41_std_tags;
-                fix_data_tags = fix41_std_data_tags;
-                break;
-        case FIX_4_2:
-                fix_tags = fix42_std_tags;
-                fix_data_tags = fix42_std_data_tags;
-                break;
-        case FIX_4_3:
-                fix_tags = fix43_std_tags;
-                fix_data_tags = fix43_std_data_tags;
-                break;
-        case FIX_4_4:
-                fix_tags = fix44_std_tags;
-                fix_data_tags = fix44_std_data_tags;
-                break;
-        case FIX_5_0:
-                fix_tags = fix50_std_tags;
-                fix_data_tags = fix50_std_data_tags;
-                break;
-        case FIX_5_0_SP1:
-                fix_tags = fix50sp1_std_tags;
-                fix_data_tags = fix50sp1_std_data_tags;
-                break;
-        case FIX_5_0_SP2:
-                fix_tags = fix50sp2_std_tags;
-                fix_data_tags = fix50sp2_std_data_tags;
-                break;
-        case FIXT_1_1:
-                fix_tags = fixt11_std_tags;
-                fix_data_tags = fixt11_std_data_tags;
-                break;
-        default:
-		/*
-		 * Custom versions must add their own set of tags.
-		 */
-                return 1;
-        }
-
-        int n = 0;
-        try {
-                while (fix_tags[n].tag) {
-                        tags_[fix_tags[n].tag] = fix_tags[n].type;
-                        ++n;
-                }
+        free(custom_dict_);
+        custom_dict_ = NULL;
 
-                n = 0;
-                while (fix_data_tags[n].tag) {
-                        data_tags_.insert(fix_data_tags[n].tag);
-                        ++n;
-                }
-        }
-        catch (...) {
-                return 0;
-        }
+        /*
+         * Custom versions must add their own set of tags.
+         */
+        dict_ = get_fix_tag_dict(version_);
 
         return 1;
 }
@@ -133,24 +88,24 @@ FIXMessageRX::init(void)
 int
 FIXMessageRX::add_custom_tag(const struct FIX_Tag & custom_tag)
 {
-        try {
-                tags_[custom_tag.tag] = custom_tag.type;
-
-                if (ft_data == custom_tag.type) {
-                        data_tags_.insert(custom_tag.tag);
-                }
-        }
-        catch (...) {
-                return 0;
+        if (!custom_dict_) {
+                custom_dict_ = (struct FIX_TagDict*)malloc(sizeof(struct FIX_TagDict));
+                if (!custom_dict_)
+                        return 0;
+                memcpy(custom_dict_, dict_, sizeof(struct FIX_TagDict));
+                dict_ = custom_dict_;
         }
 
-        return 1;
+        return fix_tag_dict_add(custom_dict_, custom_tag);
 }
 
 int
-FIXMessageRX::next_field(size_t & length, uint8_t **value)
+FIXMessageRX::read_field(uint8_t *& pos,
+                         uint8_t *& prev_value,
+                         size_t & length,
+                         uint8_t **value)
 {
-        uint8_t *msg_pos = pos_;
+        uint8_t *msg_pos = pos;
         int prev_val = 0;
         int retv;
 
@@ -165,21 +120,231 @@ FIXMessageRX::next_field(size_t & length, uint8_t **value)
         *value = msg_pos;
 
         if (UNLIKELY__(field_contains_data(retv))) {
-                prev_val = get_fix_length_value(soh_, (const char*)prev_value_);
-                prev_value_ = msg_pos;
+                prev_val = get_fix_length_value(soh_, (const char*)prev_value);
+                prev_value = msg_pos;
                 if (0 > prev_val)
                         return -1;
 
                 length = prev_val;
-                pos_ = msg_pos + length + 1; // now points at first character after SOH
+                pos = msg_pos + length + 1; // now points at first character after SOH
                 return retv;
         }
-        prev_value_ = msg_pos;
+        prev_value = msg_pos;
 
         while (soh_ != *msg_pos)
                 ++msg_pos;
-        length = msg_pos - prev_value_;
-        pos_ = msg_pos + 1; // now points at first character after SOH
+        length = msg_pos - prev_value;
+        pos = msg_pos + 1; // now points at first character after SOH
 
         return retv;
 }
+
+int
+FIXMessageRX::next_field(size_t & length, uint8_t **value)
+{
+        return read_field(pos_, prev_value_, length, value);
+}
+
+void
+FIXMessageRX::clear_index(void)
+{
+        size_t n;
+
+        for (n = 0; n < field_count_; ++n) {
+                if (RX_INDEX_HOT_TAGS > fields_[n].tag)
+                        hot_slots_[fields_[n].tag] = 0;
+        }
+        field_count_ = 0;
+}
+
+int
+FIXMessageRX::index(void)
+{
+        uint8_t *pos = start_;
+        uint8_t *prev_value = NULL;
+        uint8_t *value;
+        size_t length;
+        struct FIX_FieldRef *tmp;
+        int tag;
+
+        clear_index();
+        if (!pos)
+                return 0;
+
+        if (UNLIKELY__(!hot_slots_)) {
+                hot_slots_ = (uint32_t*)calloc(RX_INDEX_HOT_TAGS, sizeof(uint32_t));
+                if (!hot_slots_)
+                        return -1;
+        }
+
+        while (0 < (tag = read_field(pos, prev_value, length, &value))) {
+                if (UNLIKELY__(field_count_ == field_capacity_)) {
+                        tmp = (struct FIX_FieldRef*)realloc(fields_, (field_capacity_ ? 2 * field_capacity_ : INITIAL_RX_INDEX_SIZE) * sizeof(struct FIX_FieldRef));
+                        if (!tmp)
+                                goto err;
+                        fields_ = tmp;
+                        field_capacity_ = field_capacity_ ? 2 * field_capacity_ : INITIAL_RX_INDEX_SIZE;
+                }
+                fields_[field_count_].tag = (uint32_t)tag;
+                fields_[field_count_].offset = (uint32_t)(value - msg_);
+                fields_[field_count_].length = (uint32_t)length;
+                if ((RX_INDEX_HOT_TAGS > (unsigned int)tag) && !hot_slots_[tag])
+                        hot_slots_[tag] = (uint32_t)field_count_ + 1;
+                ++field_count_;
+        }
+        if (0 > tag)
+                goto err;
+
+        return (int)field_count_;
+err:
+        clear_index();
+
+        return -1;
+}
+
+unsigned int
+FIXMessageRX::missing_field(const unsigned int * const tags,
+                            const size_t count) const
+{
+        size_t length;
+        uint8_t *value;
+        size_t n;
+
+        for (n = 0; n < count; ++n) {
+                if (!get(tags[n], length, &value))
+                        return tags[n];
+        }
+
+        return 0;
+}
+
+int
+FIXMessageRX::start_group(const struct FIX_GroupDesc & desc,
+                          const size_t n,
+                          const size_t end,
+                          struct FIX_GroupCursor & cursor) const
+{
+        if (!decode_FIX_uint(msg_ + fields_[n].offset, fields_[n].length, &cursor.count))
+                return -1;
+        cursor.desc = &desc;
+        cursor.entry = 0;
+        cursor.next = n + 1;
+        cursor.end = end;
+        cursor.entry_begin = n + 1;
+        cursor.entry_end = n + 1;
+
+        return 1;
+}
+
+int
+FIXMessageRX::open_group(const struct FIX_GroupDesc & desc,
+                         struct FIX_GroupCursor & cursor) const
+{
+        size_t n;
+
+        if (LIKELY__(RX_INDEX_HOT_TAGS > desc.count_tag)) {
+                if (!hot_slots_ || !hot_slots_[desc.count_tag])
+                        return 0;
+                n = hot_slots_[desc.count_tag] - 1;
+        } else {
+                for (n = 0; n < field_count_; ++n) {
+                        if (desc.count_tag == fields_[n].tag)
+                                break;
+                }
+                if (n == field_count_)
+                        return 0;
+        }
+
+        return start_group(desc, n, field_count_, cursor);
+}
+
+int
+FIXMessageRX::open_nested_group(const struct FIX_GroupCursor & parent,
+                                const struct FIX_GroupDesc & desc,
+                                struct FIX_GroupCursor & cursor) const
+{
+        size_t n;
+
+        for (n = parent.entry_begin; n < parent.entry_end; ++n) {
+                if (desc.count_tag == fields_[n].tag)
+                        return start_group(desc, n, parent.entry_end, cursor);
+        }
+
+        return 0;
+}
+
+static inline int
+is_group_member(const struct FIX_GroupDesc * const desc,
+                const unsigned int tag)
+{
+        const unsigned int *member;
+
+        for (member = desc->member_tags; *member; ++member) {
+                if (tag == *member)
+                        return 1;
+        }
+
+        return 0;
+}
+
+static inline const struct FIX_GroupDesc*
+nested_group(const struct FIX_GroupDesc * const desc,
+             const unsigned int tag)
+{
+        const struct FIX_GroupDesc * const *nested;
+
+        if (!desc->nested)
+                return NULL;
+        for (nested = desc->nested; *nested; ++nested) {
+                if (tag == (*nested)->count_tag)
+                        return *nested;
+        }
+
+        return NULL;
+}
+
+int
+FIXMessageRX::next_entry(struct FIX_GroupCursor & cursor) const
+{
+        const struct FIX_GroupDesc *nested;
+        struct FIX_GroupCursor inner;
+        unsigned int tag;
+        size_t n = cursor.next;
+        int rval;
+
+        if (cursor.entry == cursor.count) {
+                // another entry than NumInGroup says
+                if ((n < cursor.end) && (cursor.desc->delimiter_tag == fields_[n].tag))
+                        return -1;
+                return 0;
+        }
+        if ((n >= cursor.end) || (cursor.desc->delimiter_tag != fields_[n].tag))
+                return -1;
+
+        cursor.entry_begin = n++;
+        while (n < cursor.end) {
+                tag = fields_[n].tag;
+                if (cursor.desc->delimiter_tag == tag)
+                        break;
+                nested = nested_group(cursor.desc, tag);
+                if (nested) {
+                        // skip the nested group, it belongs to this entry
+                        if (1 != start_group(*nested, n, cursor.end, inner))
+                                return -1;
+                        while (0 < (rval = next_entry(inner)))
+                                ;
+                        if (rval)
+                                return -1;
+                        n = inner.next;
+                        continue;
+                }
+                if (!is_group_member(cursor.desc, tag))
+                        break;
+                ++n;
+        }
+        cursor.entry_end = n;
+        cursor.next = n;
+        ++cursor.entry;
+
+        return 1;
+}
@@ -66,64 +66,216 @@ next_power_of_two(size_t k)
 }
 
 int
-FIXMessageTX::append_field(const unsigned int tag,
-                           const size_t length,
-                           const uint8_t *value)
+FIXMessageTX::grow(const size_t size)
+{
+        const size_t new_size = next_power_of_two(size);
+        uint8_t *tmp = (uint8_t*)realloc(buf_, new_size);
+
+        if (!tmp)
+                return 0;
+        buf_ = tmp;
+        buf_size_ = new_size;
+        pos_ = buf_ + length_;
+
+        return 1;
+}
+
+int
+FIXMessageTX::begin_field(const unsigned int tag,
+                          const size_t max_length)
 {
-        const uint8_t *start = pos_;
+        size_t needed;
+
+        // MsgType is not part of the partial message
+        if (UNLIKELY__(35 == tag))
+                return 0;
+        if (UNLIKELY__(!buf_) && !init())
+                return 0;
+
+        // "tag=", the value and <SOH>, plus the "10=" tacked on by
+        // expose()
+        needed = length_ + uint_str_length(tag) + 1 + max_length + 1 + 3;
+        if (UNLIKELY__(needed > buf_size_) && !grow(needed))
+                return 0;
 
 	if (52 == tag)
 		sending_time_appended_ = 1;
 
-        if (35 != tag) {
-                // we'll need to decide whether to extend buffer or
-                // not and we need to do it with a minimum of
-                // effort. So... I'm making a best effort guess here.
-                //
-                // I'll assume (rather safely I think) that "tag=" is
-                // never more than 21 characters long. Then I'm adding
-                // that to "length + 4" (4 bytes is needed to make
-                // room for "<SOH>10=").
-		//
-		// If that would make the buffer overflow, I'll
-		// reallocate.
-
-        again:
-                if (25 + length <= buf_size_) {
-                        uint_to_str('=', tag, (char**)&pos_);
-                        ++pos_;
-
-                        memcpy(pos_, value, length);
-                        pos_ += length;
-                        *pos_ = soh_;
-                        ++pos_;
-                        length_ += pos_ - start;
-                } else {
-                        uint8_t *tmp = buf_;
-
-			if (buf_size_) {
-				tmp = (uint8_t*)realloc(buf_, 2 * buf_size_);
-				if (tmp) {
-					buf_ = tmp;
-					buf_size_ *= 2;
-				} else {
-					return 0;
-				}
-			} else {
-				if (!init())
-					return 0;
-			}
-			goto again;
+        uint_to_str('=', tag, (char**)&pos_);
+        ++pos_;
+
+        return 1;
+}
+
+int
+FIXMessageTX::prepend_field(const unsigned int tag,
+                            const size_t length,
+                            const uint8_t *value)
+{
+        const size_t field_length = uint_str_length(tag) + 1 + length + 1;
+        uint8_t *field;
+
+        if (UNLIKELY__(35 == tag))
+                return 0;
+        if (UNLIKELY__(!buf_) && !init())
+                return 0;
+        if (UNLIKELY__(length_ + field_length + 3 > buf_size_) && !grow(length_ + field_length + 3))
+                return 0;
+
+        // make room behind the leading <SOH>
+        memmove(buf_ + 1 + field_length, buf_ + 1, length_ - 1);
+        field = buf_ + 1;
+        uint_to_str('=', tag, (char**)&field);
+        ++field;
+        memcpy(field, value, length);
+        field[length] = soh_;
+        pos_ += field_length;
+        length_ += field_length;
+
+	if (52 == tag)
+		sending_time_appended_ = 1;
+
+        return 1;
+}
+
+int
+FIXMessageTX::append_utc_timestamp(const unsigned int tag,
+                                   const enum FIX_TimestampPrecision precision)
+{
+        if (!begin_field(tag, FIX_TIMESTAMP_MAX_LENGTH))
+                return 0;
+        pos_ += get_FIX_utc_timestamp(precision, (char*)pos_);
+        end_field();
+
+        return 1;
+}
+
+int
+FIXMessageTX::append_timestamp(const unsigned int tag,
+                               const struct timespec * const ts,
+                               const enum FIX_TimestampPrecision precision)
+{
+        if (!begin_field(tag, FIX_TIMESTAMP_MAX_LENGTH))
+                return 0;
+        pos_ += format_FIX_utc_timestamp(ts, precision, (char*)pos_);
+        end_field();
+
+        return 1;
+}
+
+int
+FIXMessageTX::append_uint(const unsigned int tag,
+                          const uint64_t value)
+{
+        if (!begin_field(tag, uint_str_length(value)))
+                return 0;
+        uint_to_str(soh_, value, (char**)&pos_);
+        end_field();
+
+        return 1;
+}
+
+int
+FIXMessageTX::append_int(const unsigned int tag,
+                         const int64_t value)
+{
+        // negated as unsigned to get INT64_MIN right
+        const uint64_t magnitude = (0 > value) ? (uint64_t)0 - (uint64_t)value : (uint64_t)value;
+
+        if (!begin_field(tag, 1 + uint_str_length(magnitude)))
+                return 0;
+        if (0 > value) {
+                *pos_ = '-';
+                ++pos_;
+        }
+        uint_to_str(soh_, magnitude, (char**)&pos_);
+        end_field();
+
+        return 1;
+}
+
+int
+FIXMessageTX::append_decimal(const unsigned int tag,
+                             const int64_t mantissa,
+                             const int exponent)
+{
+        const uint64_t magnitude = (0 > mantissa) ? (uint64_t)0 - (uint64_t)mantissa : (uint64_t)mantissa;
+        const size_t digits = uint_str_length(magnitude);
+        size_t fraction;
+
+        if ((MAX_DECIMAL_EXPONENT < exponent) || (-MAX_DECIMAL_EXPONENT > exponent))
+                return 0;
+
+        // sign, "0." and the digits padded by zeros to the exponent
+        if (!begin_field(tag, 1 + 2 + digits + MAX_DECIMAL_EXPONENT))
+                return 0;
+        if (0 > mantissa) {
+                *pos_ = '-';
+                ++pos_;
+        }
+
+        if (0 <= exponent) {
+                uint_to_str(soh_, magnitude, (char**)&pos_);
+                if (magnitude) {
+                        memset(pos_, '0', exponent);
+                        pos_ += exponent;
                 }
+        } else if ((fraction = -exponent) < digits) {
+                // write the digits, then move the fraction one to the
+                // right to make room for the point
+                uint_to_str(soh_, magnitude, (char**)&pos_);
+                memmove(pos_ - fraction + 1, pos_ - fraction, fraction);
+                *(pos_ - fraction) = '.';
+                ++pos_;
         } else {
+                *pos_ = '0';
+                *(pos_ + 1) = '.';
+                pos_ += 2;
+                memset(pos_, '0', fraction - digits);
+                pos_ += fraction - digits;
+                uint_to_str(soh_, magnitude, (char**)&pos_);
+        }
+        end_field();
+
+        return 1;
+}
+
+int
+FIXMessageTX::append_char(const unsigned int tag,
+                          const char value)
+{
+        if (35 == tag)
+                return append_field(tag, 1, (const uint8_t*)&value);
+        if (!begin_field(tag, 1))
+                return 0;
+        *pos_ = value;
+        ++pos_;
+        end_field();
+
+        return 1;
+}
+
+int
+FIXMessageTX::append_field(const unsigned int tag,
+                           const size_t length,
+                           const uint8_t *value)
+{
+        if (35 == tag) {
                 if (MAX_MSGTYPE_LENGTH > length) {
                         memcpy(msg_type_, value, length);
                         msg_type_[length] = '\0';
                 } else {
                         return 0;
                 }
+                return 1;
         }
 
+        if (!begin_field(tag, length))
+                return 0;
+        memcpy(pos_, value, length);
+        pos_ += length;
+        end_field();
+
         return 1;
 }
 
@@ -164,40 +316,53 @@ FIXMessageTX::clone_from(const PartialMessage * const pmsg)
 {
 	if (!pmsg || !pmsg->length) {
 		init();
-	} else {
-		if (pmsg->length > buf_size_) {
-			uint8_t *tmp = buf_;
-
-			buf_size_ = next_power_of_two(pmsg->length);
-			tmp = (uint8_t*)realloc(buf_, buf_size_);
-			if (tmp) {
-				buf_ = tmp;
-			} else {
-				init();
-				return 0;
-			}
-		}
+		ttl_.tv_sec = pmsg ? pmsg->ttl.tv_sec : 0;
+		ttl_.tv_usec = pmsg ? pmsg->ttl.tv_usec : 0;
 
-		// we do not copy the terminating "10="
-		memcpy(buf_, pmsg->part_msg, pmsg->length - 3);
-		pos_ = buf_ + pmsg->length - 3;
-		length_ = pmsg->length - 3;
+		return 1;
+	}
+
+	return clone_from(pmsg->msg_type, pmsg->length, pmsg->part_msg, &pmsg->ttl);
+}
+
+int 
+FIXMessageTX::clone_from(const char * const msg_type,
+			 const size_t length,
+			 const uint8_t * const part_msg,
+			 const struct timeval * const ttl)
+{
+	if (length > buf_size_) {
+		uint8_t *tmp = buf_;
 
-		if (MAX_MSGTYPE_LENGTH > strlen(pmsg->msg_type)) {
-			memcpy(msg_type_, pmsg->msg_type, strlen(pmsg->msg_type));
-			msg_type_[strlen(pmsg->msg_type)] = '\0';
+		buf_size_ = next_power_of_two(length);
+		tmp = (uint8_t*)realloc(buf_, buf_size_);
+		if (tmp) {
+			buf_ = tmp;
 		} else {
 			init();
 			return 0;
 		}
+	}
 
-		char st[5]; // "<SOH>52="
-		sprintf(st, "%c52=", soh_);
-		sending_time_appended_ = strnstr((const char*)pmsg->part_msg, st, length_) ? 1 : 0;
-	} 
-	ttl_.tv_sec = pmsg ? pmsg->ttl.tv_sec : 0;
-	ttl_.tv_usec = pmsg ? pmsg->ttl.tv_usec : 0;
+	// we do not copy the terminating "10="
+	memcpy(buf_, part_msg, length - 3);
+	pos_ = buf_ + length - 3;
+	length_ = length - 3;
+
+	if (MAX_MSGTYPE_LENGTH > strlen(msg_type)) {
+		memcpy(msg_type_, msg_type, strlen(msg_type));
+		msg_type_[strlen(msg_type)] = '\0';
+	} else {
+		init();
+		return 0;
+	}
+
+	char st[5]; // "<SOH>52="
+	sprintf(st, "%c52=", soh_);
+	sending_time_appended_ = strnstr((const char*)part_msg, st, length_) ? 1 : 0;
+
+	ttl_.tv_sec = ttl->tv_sec;
+	ttl_.tv_usec = ttl->tv_usec;
 
 	return 1;
 }
-
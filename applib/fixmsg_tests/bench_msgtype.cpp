@@ -0,0 +1,167 @@
+/*
+ *    Copyright (C) 2013, Jules Colding <jcolding@gmail.com>.
+ *
+ *    All Rights Reserved.
+ */
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     (1) Redistributions of source code must retain the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer.
+ *
+ *     (2) Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *
+ *     (3) Neither the name of the copyright holder nor the names of
+ *     its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written
+ *     permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS
+ * OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+
+/*
+ * Microbenchmark of get_fix_msgtype() and is_session_message()
+ * against the std::map lookup and linear session type scan they
+ * replaced. Not run by "make check":
+ *
+ *    ./bench_msgtype [iterations]
+ */
+
+#ifdef HAVE_CONFIG_H
+    #include "ac_config.h"
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <map>
+#include "applib/fixmsg/fix_types.h"
+
+#define SOH '|'
+#define DEFAULT_ITERATIONS (10000000)
+
+static std::map<uint_fast32_t, FIX_MsgType> msgtypes_map;
+
+static uint_fast32_t
+pack_msgtype(const char soh,
+             const char * const str)
+{
+        uint_fast32_t is = 0;
+        unsigned int len = 0;
+
+        while (soh != str[len]) {
+                if (4 == len)
+                        return 0;
+                is |= ((uint_fast32_t)str[len] << (8*len));
+                ++len;
+        }
+
+        return is;
+}
+
+static FIX_MsgType
+map_get_fix_msgtype(const char soh,
+                    const char * const str)
+{
+        std::map<uint_fast32_t, FIX_MsgType>::const_iterator it;
+
+        it = msgtypes_map.find(pack_msgtype(soh, str));
+        if (msgtypes_map.end() == it)
+                return fmt_CustomMsg;
+
+        return it->second;
+}
+
+static int
+scan_is_session_message(const FIX_MsgType type)
+{
+        int n = 0;
+
+        while (fmt_CustomMsg != fix_session_message_types[n]) {
+                if (fix_session_message_types[n] == type)
+                        return 1;
+                ++n;
+        }
+        return 0;
+}
+
+static double
+now(void)
+{
+        struct timespec ts;
+
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+
+        return (double)ts.tv_sec + (double)ts.tv_nsec/1e9;
+}
+
+int
+main(int argc, char **argv)
+{
+        char msgtypes[FIX_MSGTYPES_COUNT][sizeof(uint_fast32_t) + 2];
+        unsigned long iterations = DEFAULT_ITERATIONS;
+        volatile unsigned long sink = 0;
+        unsigned long n;
+        unsigned int k;
+        double start;
+        double map_time;
+        double table_time;
+
+        if (1 < argc)
+                iterations = strtoul(argv[1], NULL, 10);
+
+        for (k = 0; k < FIX_MSGTYPES_COUNT; ++k) {
+                snprintf(msgtypes[k], sizeof(msgtypes[k]), "%s%c", fix_msgtype_string[k], SOH);
+                msgtypes_map[pack_msgtype(SOH, msgtypes[k])] = (FIX_MsgType)k;
+        }
+
+        for (k = 0; k < FIX_MSGTYPES_COUNT; ++k) {
+                if (map_get_fix_msgtype(SOH, msgtypes[k]) != get_fix_msgtype(SOH, msgtypes[k])) {
+                        fprintf(stderr, "mismatch for MsgType \"%s\"\n", fix_msgtype_string[k]);
+                        return EXIT_FAILURE;
+                }
+                if (scan_is_session_message((FIX_MsgType)k) != is_session_message((FIX_MsgType)k)) {
+                        fprintf(stderr, "session mismatch for MsgType \"%s\"\n", fix_msgtype_string[k]);
+                        return EXIT_FAILURE;
+                }
+        }
+
+        start = now();
+        for (n = 0; n < iterations; ++n) {
+                k = (unsigned int)((n * 7) % FIX_MSGTYPES_COUNT);
+                sink += scan_is_session_message(map_get_fix_msgtype(SOH, msgtypes[k]));
+        }
+        map_time = now() - start;
+
+        start = now();
+        for (n = 0; n < iterations; ++n) {
+                k = (unsigned int)((n * 7) % FIX_MSGTYPES_COUNT);
+                sink += is_session_message(get_fix_msgtype(SOH, msgtypes[k]));
+        }
+        table_time = now() - start;
+
+        printf("std::map + scan: %6.2f ns/msg\n", 1e9*map_time/(double)iterations);
+        printf("direct tables:   %6.2f ns/msg\n", 1e9*table_time/(double)iterations);
+        printf("speedup:         %6.2fx\n", map_time/table_time);
+
+        return EXIT_SUCCESS;
+}
@@ -46,10 +46,13 @@
 #include <check.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <pthread.h>
 #include <sys/socket.h>
 #include "stdlib/log/log.h"
 #include "applib/fixio/fixio.h"
 #include "applib/fixmsg/fixmsg.h"
+#include "applib/fixmsg/fixmsg_pool.h"
+#include "applib/fixmsg/fix_fields.h"
 
 #define DELIM '|'
 
@@ -287,6 +290,690 @@ START_TEST(test_FIXMessageTX_composition)
         fail_unless(1 == tx_msg.expose(&ttl, len, &data, &msg_type), NULL);
         fail_unless(0 == memcmp(data, partial_messages_tx[0], len), NULL);
         fail_unless(0 == strcmp("8", msg_type), NULL);
+
+        //
+        // prepend header fields to a cloned message
+        //
+        fail_unless(1 == tx_msg.clone_from("D", strlen("|58=FOO|10="), (const uint8_t*)"|58=FOO|10=", ttl), NULL);
+        fail_unless(0 == tx_msg.prepend_field(35, strlen("D"), (const uint8_t*)"D"), NULL);
+        fail_unless(1 == tx_msg.prepend_field(52, strlen("20130101-00:00:00"), (const uint8_t*)"20130101-00:00:00"), NULL);
+        fail_unless(1 == tx_msg.prepend_field(43, strlen("Y"), (const uint8_t*)"Y"), NULL);
+        fail_unless(1 == tx_msg.expose(&ttl, len, &data, &msg_type), NULL);
+        fail_unless(strlen("|43=Y|52=20130101-00:00:00|58=FOO|10=") == len, NULL);
+        fail_unless(0 == memcmp(data, "|43=Y|52=20130101-00:00:00|58=FOO|10=", len), NULL);
+
+        // grows the buffer
+        fail_unless(1 == tx_msg.append_field(58, strlen("FOO"), (const uint8_t*)"FOO"), NULL);
+        for (n = 0; n < INITIAL_TX_BUFFER_SIZE; ++n)
+                fail_unless(1 == tx_msg.prepend_field(52, strlen("X"), (const uint8_t*)"X"), NULL);
+        fail_unless(1 == tx_msg.expose(&ttl, len, &data, &msg_type), NULL);
+        fail_unless(INITIAL_TX_BUFFER_SIZE * strlen("52=X|") + strlen("|58=FOO|10=") == len, NULL);
+        fail_unless(0 == memcmp(data, "|52=X|52=X|", strlen("|52=X|52=X|")), NULL);
+        fail_unless(0 == memcmp(data + len - strlen("|52=X|58=FOO|10="), "|52=X|58=FOO|10=", strlen("|52=X|58=FOO|10=")), NULL);
+}
+END_TEST
+
+/*
+ * Test the checksum kernels against a plain byte sum for all
+ * alignments and a range of lengths.
+ */
+START_TEST(test_FIX_checksum)
+{
+        uint8_t buf[1100 + 64];
+        size_t offset;
+        size_t len;
+        size_t n;
+        uint64_t sum;
+        int prefix;
+
+        srandom(42);
+        for (n = 0; n < sizeof(buf); ++n)
+                buf[n] = (uint8_t)random();
+
+        for (offset = 0; offset < 64; ++offset) {
+                for (len = 0; len <= 1100; len += (len < 200) ? 1 : 37) {
+                        sum = 0;
+                        for (n = 0; n < len; ++n)
+                                sum += buf[offset + n];
+                        fail_unless((int)(sum % 256) == get_FIX_checksum(buf + offset, len), NULL);
+
+                        prefix = get_FIX_checksum(buf, offset);
+                        sum = 0;
+                        for (n = 0; n < offset + len; ++n)
+                                sum += buf[n];
+                        fail_unless((int)(sum % 256) == fold_FIX_checksum(prefix, buf + offset, len), NULL);
+                }
+        }
+
+        // all 0xFF must not overflow any lane
+        memset(buf, 0xFF, sizeof(buf));
+        fail_unless((int)((0xFF * sizeof(buf)) % 256) == get_FIX_checksum(buf, sizeof(buf)), NULL);
+}
+END_TEST
+
+/*
+ * Test the flat tag dictionaries.
+ */
+START_TEST(test_FIX_tag_dict)
+{
+        struct FIX_TagDict dict;
+        struct FIX_Tag tag;
+        unsigned int n;
+
+        fail_unless(ft_data == fix_tag_dict_type(get_fix_tag_dict(FIX_4_4), 96), NULL);
+        fail_unless(ft_Length == fix_tag_dict_type(get_fix_tag_dict(FIX_4_4), 95), NULL);
+        fail_unless(ft_String == fix_tag_dict_type(get_fix_tag_dict(FIX_4_4), 49), NULL);
+        fail_unless(FIX_TAG_UNKNOWN == fix_tag_dict_type(get_fix_tag_dict(FIX_4_4), 5001), NULL);
+        fail_unless(FIX_TAG_UNKNOWN == fix_tag_dict_type(get_fix_tag_dict(CUSTOM), 96), NULL);
+        fail_unless(FIX_TAG_UNKNOWN == fix_tag_dict_type(get_fix_tag_dict(FIX_4_4), 20000), NULL);
+
+        memcpy(&dict, get_fix_tag_dict(FIX_4_4), sizeof(dict));
+        tag.type = ft_data;
+        for (n = 0; n < FIX_TAG_DICT_SPARSE_SIZE - 1; ++n) {
+                tag.tag = FIX_TAG_DICT_DENSE_SIZE + n * FIX_TAG_DICT_SPARSE_SIZE;
+                fail_unless(1 == fix_tag_dict_add(&dict, tag), NULL);
+        }
+        tag.tag = 1000000;
+        fail_unless(0 == fix_tag_dict_add(&dict, tag), NULL);
+        for (n = 0; n < FIX_TAG_DICT_SPARSE_SIZE - 1; ++n)
+                fail_unless(ft_data == fix_tag_dict_type(&dict, FIX_TAG_DICT_DENSE_SIZE + n * FIX_TAG_DICT_SPARSE_SIZE), NULL);
+        fail_unless(FIX_TAG_UNKNOWN == fix_tag_dict_type(&dict, 1000000), NULL);
+
+        // overwriting an existing tag needs no new slot
+        tag.tag = FIX_TAG_DICT_DENSE_SIZE;
+        tag.type = ft_int;
+        fail_unless(1 == fix_tag_dict_add(&dict, tag), NULL);
+        fail_unless(ft_int == fix_tag_dict_type(&dict, FIX_TAG_DICT_DENSE_SIZE), NULL);
+
+        // the shared dictionary is untouched
+        fail_unless(FIX_TAG_UNKNOWN == fix_tag_dict_type(get_fix_tag_dict(FIX_4_4), FIX_TAG_DICT_DENSE_SIZE), NULL);
+}
+END_TEST
+
+/*
+ * Test MsgType classification.
+ */
+START_TEST(test_FIX_msgtype)
+{
+        char str[sizeof(uint_fast32_t) + 2];
+        unsigned int n;
+        unsigned int k;
+        int session;
+
+        for (n = 0; n < FIX_MSGTYPES_COUNT; ++n) {
+                snprintf(str, sizeof(str), "%.*s%c", (int)sizeof(fix_msgtype_string[n]) - 1, fix_msgtype_string[n], DELIM);
+                fail_unless((FIX_MsgType)n == get_fix_msgtype(DELIM, str), NULL);
+
+                session = 0;
+                for (k = 0; fmt_CustomMsg != fix_session_message_types[k]; ++k)
+                        session |= ((FIX_MsgType)n == fix_session_message_types[k]);
+                fail_unless(session == is_session_message((FIX_MsgType)n), NULL);
+                fail_unless(session == is_session_message(DELIM, str), NULL);
+        }
+
+        fail_unless(fmt_CustomMsg == get_fix_msgtype(DELIM, "I|"), NULL);
+        fail_unless(fmt_CustomMsg == get_fix_msgtype(DELIM, "AAA|"), NULL);
+        fail_unless(fmt_CustomMsg == get_fix_msgtype(DELIM, "DA|"), NULL);
+        fail_unless(fmt_CustomMsg == get_fix_msgtype(DELIM, "FOOBAR|"), NULL);
+        fail_unless(fmt_CustomMsg == get_fix_msgtype(DELIM, "\xC3\xA6|"), NULL);
+        fail_unless(0 == is_session_message(DELIM, "|"), NULL);
+        fail_unless(0 == is_session_message(FIX_MSGTYPES_COUNT), NULL);
+}
+END_TEST
+
+/*
+ * Imprints the zero terminated msg on rx_msg.
+ */
+static void
+imprint_test_message(FIXMessageRX & rx_msg,
+                     const char * const msg)
+{
+        rx_msg.imprint((uint32_t)(strstr(msg, "|35=") + 4 - msg), (uint8_t*)msg);
+}
+
+/*
+ * Test index(), get(), get_field() and missing_field().
+ */
+START_TEST(test_FIXMessageRX_index)
+{
+        int n;
+        int tag;
+        size_t length;
+        size_t next_length;
+        uint8_t *value;
+        uint8_t *next_value;
+        char exec_report[] = "8=FIX.4.4|9=88|35=8|49=A|56=B|34=2|11=ORD1|37=X1|39=2|150=F|95=5|96=ab|cd|5000=Z|11=ORD2|10=123|";
+        char cancel[] = "8=FIX.4.4|9=32|35=F|49=A|56=B|34=3|11=ORD3|10=123|";
+        char broken[] = "8=FIX.4.4|9=32|35=F|49=A|x6=B|10=123|";
+        const unsigned int required[] = { 11, 37, 39, 150 };
+        FIXMessageRX rx_msg = FIXMessageRX::make_fix_message_with_provided_mem_on_stack(FIX_4_4, DELIM);
+
+        fail_unless(1 == rx_msg.init(), NULL);
+        fail_unless(0 == rx_msg.index(), NULL); // nothing imprinted
+        fail_unless(0 == rx_msg.get(35, length, &value), NULL);
+
+        imprint_test_message(rx_msg, exec_report);
+        fail_unless(12 == rx_msg.index(), NULL);
+        fail_unless(12 == rx_msg.field_count(), NULL);
+
+        // out of order
+        fail_unless(1 == rx_msg.get(150, length, &value), NULL);
+        fail_unless((1 == length) && ('F' == *value), NULL);
+        fail_unless(1 == rx_msg.get(37, length, &value), NULL);
+        fail_unless((2 == length) && !memcmp("X1", value, 2), NULL);
+        fail_unless(1 == rx_msg.get(11, length, &value), NULL); // the first one
+        fail_unless((4 == length) && !memcmp("ORD1", value, 4), NULL);
+        fail_unless(1 == rx_msg.get(96, length, &value), NULL); // data with a SOH
+        fail_unless((5 == length) && !memcmp("ab|cd", value, 5), NULL);
+        fail_unless(1 == rx_msg.get(5000, length, &value), NULL); // not hot
+        fail_unless((1 == length) && ('Z' == *value), NULL);
+        fail_unless(0 == rx_msg.get(44, length, &value), NULL);
+        fail_unless(0 == rx_msg.get(6000, length, &value), NULL);
+        fail_unless(0 == rx_msg.missing_field(required, 4), NULL);
+
+        // iteration matches next_field(), which index() did not disturb
+        n = 0;
+        while (0 < (tag = rx_msg.next_field(next_length, &next_value))) {
+                fail_unless(tag == rx_msg.get_field(n, length, &value), NULL);
+                fail_unless((next_length == length) && (next_value == value), NULL);
+                ++n;
+        }
+        fail_unless(0 == tag, NULL);
+        fail_unless(12 == n, NULL);
+        fail_unless(0 == rx_msg.get_field(n, length, &value), NULL);
+
+        // the index is reused and holds nothing of the previous message
+        imprint_test_message(rx_msg, cancel);
+        fail_unless(0 == rx_msg.field_count(), NULL);
+        fail_unless(0 == rx_msg.get(11, length, &value), NULL);
+        fail_unless(5 == rx_msg.index(), NULL);
+        fail_unless(1 == rx_msg.get(11, length, &value), NULL);
+        fail_unless((4 == length) && !memcmp("ORD3", value, 4), NULL);
+        fail_unless(0 == rx_msg.get(150, length, &value), NULL);
+        fail_unless(37 == rx_msg.missing_field(required, 4), NULL);
+
+        imprint_test_message(rx_msg, broken);
+        fail_unless(-1 == rx_msg.index(), NULL);
+        fail_unless(0 == rx_msg.field_count(), NULL);
+        fail_unless(0 == rx_msg.get(35, length, &value), NULL);
+        rx_msg.done();
+        fail_unless(0 == rx_msg.index(), NULL);
+}
+END_TEST
+
+/*
+ * Test open_group(), open_nested_group(), next_entry() and
+ * get_entry_field().
+ */
+START_TEST(test_FIXMessageRX_groups)
+{
+        int n;
+        int tag;
+        char buf[8192];
+        char alt_id[16];
+        char *pos;
+        size_t length;
+        uint8_t *value;
+        uint64_t size;
+        struct FIX_Decimal price;
+        struct FIX_GroupCursor entries;
+        struct FIX_GroupCursor alt_ids;
+        struct FIX_GroupCursor parties;
+        struct FIX_GroupCursor sub_ids;
+        char order[] = "8=FIX.4.4|9=99|35=D|11=ORD1|453=2|448=P1|447=D|452=1|802=2|523=S1|803=2|523=S2|803=3|448=P2|447=D|452=3|54=1|10=123|";
+        char short_count[] = "8=FIX.4.4|9=99|35=D|11=ORD1|453=3|448=P1|452=1|448=P2|452=3|54=1|10=123|";
+        char long_count[] = "8=FIX.4.4|9=99|35=D|11=ORD1|453=1|448=P1|452=1|448=P2|452=3|54=1|10=123|";
+        char no_delimiter[] = "8=FIX.4.4|9=99|35=D|11=ORD1|453=1|447=D|448=P1|54=1|10=123|";
+        char bad_count[] = "8=FIX.4.4|9=99|35=D|11=ORD1|453=x|448=P1|54=1|10=123|";
+        FIXMessageRX rx_msg = FIXMessageRX::make_fix_message_with_provided_mem_on_stack(FIX_4_4, DELIM);
+
+        fail_unless(1 == rx_msg.init(), NULL);
+
+        // a 100 entry book update, every 10th entry with alternative IDs
+        pos = buf + sprintf(buf, "8=FIX.4.4|9=9999|35=X|49=A|56=B|34=2|262=R1|268=100|");
+        for (n = 0; n < 100; ++n) {
+                pos += sprintf(pos, "279=0|269=%d|55=SYM|270=100.%02d|271=%d|", n % 2, n, n + 1);
+                if (!(n % 10))
+                        pos += sprintf(pos, "454=2|455=A%d|456=1|455=B%d|456=2|", n, n);
+                pos += sprintf(pos, "346=%d|", n);
+        }
+        sprintf(pos, "10=123|");
+
+        imprint_test_message(rx_msg, buf);
+        fail_unless(0 < rx_msg.index(), NULL);
+        fail_unless(0 == rx_msg.open_group(fix44_parties, entries), NULL);
+        fail_unless(1 == rx_msg.open_group(fix44_md_inc_entries, entries), NULL);
+        fail_unless(100 == entries.count, NULL);
+        n = 0;
+        while (0 < (tag = rx_msg.next_entry(entries))) {
+                fail_unless(1 == rx_msg.get_entry_field(entries, 270, length, &value), NULL);
+                fail_unless(1 == decode_FIX_decimal(value, length, &price), NULL);
+                fail_unless((10000 + n == price.mantissa) && (-2 == price.exponent), NULL);
+                fail_unless(1 == rx_msg.get_entry_field(entries, 271, length, &value), NULL);
+                fail_unless(1 == decode_FIX_uint(value, length, &size), NULL);
+                fail_unless((uint64_t)n + 1 == size, NULL);
+                fail_unless(1 == rx_msg.get_entry_field(entries, 346, length, &value), NULL); // after the nested group
+                fail_unless(0 == rx_msg.get_entry_field(entries, 262, length, &value), NULL);
+                if (n % 10) {
+                        fail_unless(0 == rx_msg.open_nested_group(entries, fix44_sec_alt_ids, alt_ids), NULL);
+                } else {
+                        fail_unless(1 == rx_msg.open_nested_group(entries, fix44_sec_alt_ids, alt_ids), NULL);
+                        fail_unless(1 == rx_msg.next_entry(alt_ids), NULL);
+                        fail_unless(1 == rx_msg.get_entry_field(alt_ids, 455, length, &value), NULL);
+                        snprintf(alt_id, sizeof(alt_id), "A%d", n);
+                        fail_unless((strlen(alt_id) == length) && !memcmp(alt_id, value, length), NULL);
+                        fail_unless(1 == rx_msg.next_entry(alt_ids), NULL);
+                        fail_unless(1 == rx_msg.get_entry_field(alt_ids, 456, length, &value), NULL);
+                        fail_unless((1 == length) && ('2' == *value), NULL);
+                        fail_unless(0 == rx_msg.get_entry_field(alt_ids, 346, length, &value), NULL);
+                        fail_unless(0 == rx_msg.next_entry(alt_ids), NULL);
+                }
+                ++n;
+        }
+        fail_unless(0 == tag, NULL);
+        fail_unless(100 == n, NULL);
+        fail_unless(rx_msg.field_count() == entries.next, NULL);
+
+        // nested parties and the field after the group
+        imprint_test_message(rx_msg, order);
+        fail_unless(0 < rx_msg.index(), NULL);
+        fail_unless(1 == rx_msg.open_group(fix44_parties, parties), NULL);
+        fail_unless(1 == rx_msg.next_entry(parties), NULL);
+        fail_unless(1 == rx_msg.get_entry_field(parties, 448, length, &value), NULL);
+        fail_unless((2 == length) && !memcmp("P1", value, 2), NULL);
+        fail_unless(1 == rx_msg.open_nested_group(parties, fix44_party_sub_ids, sub_ids), NULL);
+        fail_unless(2 == sub_ids.count, NULL);
+        fail_unless(1 == rx_msg.next_entry(sub_ids), NULL);
+        fail_unless(1 == rx_msg.next_entry(sub_ids), NULL);
+        fail_unless(1 == rx_msg.get_entry_field(sub_ids, 523, length, &value), NULL);
+        fail_unless((2 == length) && !memcmp("S2", value, 2), NULL);
+        fail_unless(0 == rx_msg.next_entry(sub_ids), NULL);
+        fail_unless(1 == rx_msg.next_entry(parties), NULL);
+        fail_unless(1 == rx_msg.get_entry_field(parties, 452, length, &value), NULL);
+        fail_unless((1 == length) && ('3' == *value), NULL);
+        fail_unless(0 == rx_msg.get_entry_field(parties, 523, length, &value), NULL);
+        fail_unless(0 == rx_msg.open_nested_group(parties, fix44_party_sub_ids, sub_ids), NULL);
+        fail_unless(0 == rx_msg.get_entry_field(parties, 54, length, &value), NULL);
+        fail_unless(0 == rx_msg.next_entry(parties), NULL);
+        fail_unless(54 == rx_msg.get_field(parties.next, length, &value), NULL);
+
+        // malformed groups
+        imprint_test_message(rx_msg, short_count);
+        fail_unless(0 < rx_msg.index(), NULL);
+        fail_unless(1 == rx_msg.open_group(fix44_parties, parties), NULL);
+        fail_unless(1 == rx_msg.next_entry(parties), NULL);
+        fail_unless(1 == rx_msg.next_entry(parties), NULL);
+        fail_unless(-1 == rx_msg.next_entry(parties), NULL);
+
+        imprint_test_message(rx_msg, long_count);
+        fail_unless(0 < rx_msg.index(), NULL);
+        fail_unless(1 == rx_msg.open_group(fix44_parties, parties), NULL);
+        fail_unless(1 == rx_msg.next_entry(parties), NULL);
+        fail_unless(-1 == rx_msg.next_entry(parties), NULL);
+
+        imprint_test_message(rx_msg, no_delimiter);
+        fail_unless(0 < rx_msg.index(), NULL);
+        fail_unless(1 == rx_msg.open_group(fix44_parties, parties), NULL);
+        fail_unless(-1 == rx_msg.next_entry(parties), NULL);
+
+        imprint_test_message(rx_msg, bad_count);
+        fail_unless(0 < rx_msg.index(), NULL);
+        fail_unless(-1 == rx_msg.open_group(fix44_parties, parties), NULL);
+        rx_msg.done();
+}
+END_TEST
+
+/*
+ * Test the typed appenders of FIXMessageTX.
+ */
+START_TEST(test_FIXMessageTX_typed_appenders)
+{
+        int n;
+        size_t len;
+        const uint8_t *data;
+        const char *msg_type;
+	const struct timeval *ttl;
+        struct timespec ts;
+        FIXMessageTX tx_msg(DELIM);
+        const char *expected = "|52=20130101-00:00:00|34=0|38=18446744073709551615|99=-17|99=-9223372036854775808|99=9223372036854775807|54=1|43=Y|97=N|60=20000229-00:00:00.007|10=";
+        const struct {
+                int64_t mantissa;
+                int exponent;
+                const char *expected;
+        } decimals[] = {
+                { 12345, -2, "|44=123.45|" },
+                { -12345, -2, "|44=-123.45|" },
+                { 12345, -5, "|44=0.12345|" },
+                { 5, -3, "|44=0.005|" },
+                { -5, -3, "|44=-0.005|" },
+                { 1500, -2, "|44=15.00|" },
+                { 0, -2, "|44=0.00|" },
+                { 0, 3, "|44=0|" },
+                { 42, 0, "|44=42|" },
+                { 42, 3, "|44=42000|" },
+                { INT64_MIN, -18, "|44=-9.223372036854775808|" },
+                { 0, 0, NULL },
+        };
+
+        fail_unless(1 == tx_msg.init(), NULL);
+
+        fail_unless(1 == tx_msg.append_char(35, 'D'), NULL);
+        fail_unless(1 == tx_msg.append_field(52, strlen("20130101-00:00:00"), (const uint8_t*)"20130101-00:00:00"), NULL);
+        fail_unless(1 == tx_msg.append_uint(34, 0), NULL);
+        fail_unless(1 == tx_msg.append_uint(38, UINT64_MAX), NULL);
+        fail_unless(1 == tx_msg.append_int(99, -17), NULL);
+        fail_unless(1 == tx_msg.append_int(99, INT64_MIN), NULL);
+        fail_unless(1 == tx_msg.append_int(99, INT64_MAX), NULL);
+        fail_unless(1 == tx_msg.append_char(54, '1'), NULL);
+        fail_unless(1 == tx_msg.append_bool(43, 1), NULL);
+        fail_unless(1 == tx_msg.append_bool(97, 0), NULL);
+        ts.tv_sec = 951782400; // 2000-02-29
+        ts.tv_nsec = 7008009;
+        fail_unless(1 == tx_msg.append_timestamp(60, &ts, FIX_TS_MILLI), NULL);
+        fail_unless(1 == tx_msg.expose(&ttl, len, &data, &msg_type), NULL);
+        fail_unless(0 == strcmp("D", msg_type), NULL);
+        fail_unless(strlen(expected) == len, NULL);
+        fail_unless(0 == memcmp(expected, data, len), NULL);
+
+        for (n = 0; decimals[n].expected; ++n) {
+                fail_unless(1 == tx_msg.append_field(52, strlen("X"), (const uint8_t*)"X"), NULL);
+                fail_unless(1 == tx_msg.append_decimal(44, decimals[n].mantissa, decimals[n].exponent), NULL);
+                fail_unless(1 == tx_msg.expose(&ttl, len, &data, &msg_type), NULL);
+                fail_unless(strlen("|52=X") + strlen(decimals[n].expected) + strlen("10=") == len, NULL);
+                fail_unless(0 == memcmp(decimals[n].expected, data + strlen("|52=X"), strlen(decimals[n].expected)), NULL);
+        }
+        fail_unless(0 == tx_msg.append_decimal(44, 1, MAX_DECIMAL_EXPONENT + 1), NULL);
+        fail_unless(0 == tx_msg.append_decimal(44, 1, -MAX_DECIMAL_EXPONENT - 1), NULL);
+        fail_unless(0 == tx_msg.append_uint(35, 1), NULL);
+
+        // grow the buffer many times over with exact reservations
+        fail_unless(1 == tx_msg.append_field(52, strlen("X"), (const uint8_t*)"X"), NULL);
+        for (n = 0; n < 4 * INITIAL_TX_BUFFER_SIZE; ++n)
+                fail_unless(1 == tx_msg.append_int(58, n), NULL);
+        fail_unless(1 == tx_msg.expose(&ttl, len, &data, &msg_type), NULL);
+        fail_unless(0 == memcmp("|52=X|58=0|58=1|58=2|", data, strlen("|52=X|58=0|58=1|58=2|")), NULL);
+        fail_unless(0 == memcmp("|58=8191|10=", data + len - strlen("|58=8191|10="), strlen("|58=8191|10=")), NULL);
+}
+END_TEST
+
+#define DECODE(decoder__, str__, result__) decoder__((const uint8_t*)(str__), strlen(str__), (result__))
+
+/*
+ * Test the field value decoders.
+ */
+START_TEST(test_FIX_value_decoders)
+{
+        int64_t integer;
+        uint64_t uinteger;
+        struct FIX_Decimal decimal;
+        char character;
+        int boolean;
+        int32_t days;
+        int64_t nanoseconds;
+        struct FIX_Value value;
+        struct timespec ts;
+        char buf[FIX_TIMESTAMP_MAX_LENGTH];
+        size_t len;
+        time_t sec;
+        unsigned int n;
+        FIXMessageRX rx_msg = FIXMessageRX::make_fix_message_with_provided_mem_on_stack(FIX_4_4, DELIM);
+        const struct {
+                const char *str;
+                int64_t mantissa;
+                int exponent;
+        } decimals[] = {
+                { "123.45", 12345, -2 },
+                { "-123.45", -12345, -2 },
+                { "0.005", 5, -3 },
+                { "15.00", 1500, -2 },
+                { "42", 42, 0 },
+                { "42.", 42, 0 },
+                { ".5", 5, -1 },
+                { "-0.0", 0, -1 },
+                { "12345678.12345678", 1234567812345678, -8 },
+                { "-9.223372036854775808", INT64_MIN, -18 },
+                { NULL, 0, 0 },
+        };
+        const char *bad_decimals[] = { "", "-", ".", "1.2.3", "1,5", "+1", "0.0000000000000000001", "9.223372036854775808", NULL };
+
+        fail_unless(1 == DECODE(decode_FIX_int, "0", &integer) && (0 == integer), NULL);
+        fail_unless(1 == DECODE(decode_FIX_int, "-17", &integer) && (-17 == integer), NULL);
+        fail_unless(1 == DECODE(decode_FIX_int, "123456789012", &integer) && (123456789012LL == integer), NULL);
+        fail_unless(1 == DECODE(decode_FIX_int, "9223372036854775807", &integer) && (INT64_MAX == integer), NULL);
+        fail_unless(1 == DECODE(decode_FIX_int, "-9223372036854775808", &integer) && (INT64_MIN == integer), NULL);
+        fail_unless(1 == DECODE(decode_FIX_int, "000000000000000000000042", &integer) && (42 == integer), NULL);
+        fail_unless(0 == DECODE(decode_FIX_int, "9223372036854775808", &integer), NULL);
+        fail_unless(0 == DECODE(decode_FIX_int, "", &integer), NULL);
+        fail_unless(0 == DECODE(decode_FIX_int, "-", &integer), NULL);
+        fail_unless(0 == DECODE(decode_FIX_int, "+1", &integer), NULL);
+        fail_unless(0 == DECODE(decode_FIX_int, "1234567a", &integer), NULL);
+        fail_unless(0 == DECODE(decode_FIX_int, "1234567/", &integer), NULL);
+        fail_unless(0 == DECODE(decode_FIX_int, "12345678:", &integer), NULL);
+        fail_unless(1 == DECODE(decode_FIX_uint, "1234567890123456789", &uinteger) && (1234567890123456789ULL == uinteger), NULL);
+        fail_unless(0 == DECODE(decode_FIX_uint, "-1", &uinteger), NULL);
+        fail_unless(0 == DECODE(decode_FIX_uint, "12345678901234567890", &uinteger), NULL);
+
+        for (n = 0; decimals[n].str; ++n) {
+                fail_unless(1 == DECODE(decode_FIX_decimal, decimals[n].str, &decimal), NULL);
+                fail_unless(decimals[n].mantissa == decimal.mantissa, NULL);
+                fail_unless(decimals[n].exponent == decimal.exponent, NULL);
+        }
+        for (n = 0; bad_decimals[n]; ++n)
+                fail_unless(0 == DECODE(decode_FIX_decimal, bad_decimals[n], &decimal), NULL);
+
+        fail_unless(1 == DECODE(decode_FIX_char, "2", &character) && ('2' == character), NULL);
+        fail_unless(0 == DECODE(decode_FIX_char, "22", &character), NULL);
+        fail_unless(1 == DECODE(decode_FIX_boolean, "Y", &boolean) && (1 == boolean), NULL);
+        fail_unless(1 == DECODE(decode_FIX_boolean, "N", &boolean) && (0 == boolean), NULL);
+        fail_unless(0 == DECODE(decode_FIX_boolean, "y", &boolean), NULL);
+
+        fail_unless(1 == DECODE(decode_FIX_date, "19700101", &days) && (0 == days), NULL);
+        fail_unless(1 == DECODE(decode_FIX_date, "20000229", &days) && (11016 == days), NULL);
+        fail_unless(1 == DECODE(decode_FIX_date, "19691231", &days) && (-1 == days), NULL);
+        fail_unless(0 == DECODE(decode_FIX_date, "20010229", &days), NULL);
+        fail_unless(0 == DECODE(decode_FIX_date, "21000229", &days), NULL);
+        fail_unless(0 == DECODE(decode_FIX_date, "20001301", &days), NULL);
+        fail_unless(0 == DECODE(decode_FIX_date, "20000100", &days), NULL);
+        fail_unless(0 == DECODE(decode_FIX_date, "2000011", &days), NULL);
+
+        fail_unless(1 == DECODE(decode_FIX_utc_time_only, "00:00:00", &nanoseconds) && (0 == nanoseconds), NULL);
+        fail_unless(1 == DECODE(decode_FIX_utc_time_only, "23:59:60.5", &nanoseconds) && (86400500000000LL == nanoseconds), NULL);
+        fail_unless(1 == DECODE(decode_FIX_utc_time_only, "01:02:03.000000004", &nanoseconds) && (3723000000004LL == nanoseconds), NULL);
+        fail_unless(0 == DECODE(decode_FIX_utc_time_only, "24:00:00", &nanoseconds), NULL);
+        fail_unless(0 == DECODE(decode_FIX_utc_time_only, "12:00:00.", &nanoseconds), NULL);
+        fail_unless(0 == DECODE(decode_FIX_utc_time_only, "12:00:00.0000000001", &nanoseconds), NULL);
+        fail_unless(0 == DECODE(decode_FIX_utc_time_only, "12-00:00", &nanoseconds), NULL);
+
+        // from before the epoch until after 2100, leap days included
+        for (n = 0, sec = -86400LL * 400; n < 6000; ++n, sec += 86400LL * 13 + 3607) {
+                ts.tv_sec = sec;
+                ts.tv_nsec = 123456789;
+                len = format_FIX_utc_timestamp(&ts, FIX_TS_NANO, buf);
+                fail_unless(1 == decode_FIX_utc_timestamp((const uint8_t*)buf, len, &nanoseconds), NULL);
+                fail_unless((int64_t)sec * 1000000000 + 123456789 == nanoseconds, NULL);
+                len = format_FIX_utc_timestamp(&ts, FIX_TS_MILLI, buf);
+                fail_unless(1 == decode_FIX_utc_timestamp((const uint8_t*)buf, len, &nanoseconds), NULL);
+                fail_unless((int64_t)sec * 1000000000 + 123000000 == nanoseconds, NULL);
+                len = format_FIX_utc_timestamp(&ts, FIX_TS_SECONDS, buf);
+                fail_unless(1 == decode_FIX_utc_timestamp((const uint8_t*)buf, len, &nanoseconds), NULL);
+                fail_unless((int64_t)sec * 1000000000 == nanoseconds, NULL);
+        }
+        fail_unless(0 == DECODE(decode_FIX_utc_timestamp, "20000229 00:00:00", &nanoseconds), NULL);
+        fail_unless(0 == DECODE(decode_FIX_utc_timestamp, "25000101-00:00:00", &nanoseconds), NULL); // out of range
+
+        // by the types of the tag dictionary
+        fail_unless(ft_Price == rx_msg.field_type(44), NULL);
+        fail_unless(1 == decode_FIX_value(rx_msg.field_type(44), (const uint8_t*)"99.5", 4, &value), NULL);
+        fail_unless((ft_Price == value.type) && (995 == value.u.decimal.mantissa) && (-1 == value.u.decimal.exponent), NULL);
+        fail_unless(1 == decode_FIX_value(rx_msg.field_type(34), (const uint8_t*)"77", 2, &value), NULL);
+        fail_unless(77 == value.u.uinteger, NULL);
+        fail_unless(1 == decode_FIX_value(rx_msg.field_type(43), (const uint8_t*)"Y", 1, &value), NULL);
+        fail_unless(1 == value.u.boolean, NULL);
+        fail_unless(1 == decode_FIX_value(rx_msg.field_type(52), (const uint8_t*)"19700101-00:00:01", 17, &value), NULL);
+        fail_unless(1000000000 == value.u.nanoseconds, NULL);
+        fail_unless(0 == decode_FIX_value(rx_msg.field_type(49), (const uint8_t*)"SENDER", 6, &value), NULL); // String
+}
+END_TEST
+
+/*
+ * Test UTCTimestamp formatting against strftime().
+ */
+START_TEST(test_FIX_timestamp)
+{
+        FIXMessageTX tx_msg('|');
+        const struct timeval *ttl;
+        const uint8_t *data;
+        const char *msg_type;
+        char buf[FIX_TIMESTAMP_MAX_LENGTH + 1];
+        char expected[64];
+        struct timespec ts;
+        time_t sec;
+        size_t len;
+        unsigned int n;
+
+        // from before the epoch until well after 2100, leap days included
+        for (n = 0, sec = -86400LL * 400; n < 20000; ++n, sec += 86400LL * 13 + 3607) {
+                ts.tv_sec = sec;
+                ts.tv_nsec = 123456789;
+                strftime(expected, sizeof(expected), "%Y%m%d-%H:%M:%S", gmtime(&sec));
+
+                len = format_FIX_utc_timestamp(&ts, FIX_TS_SECONDS, buf);
+                fail_unless(FIX_TIMESTAMP_PREFIX_LENGTH == len, NULL);
+                fail_unless(!memcmp(expected, buf, len), NULL);
+
+                len = format_FIX_utc_timestamp(&ts, FIX_TS_NANO, buf);
+                fail_unless(FIX_TIMESTAMP_MAX_LENGTH == len, NULL);
+                fail_unless(!memcmp(expected, buf, FIX_TIMESTAMP_PREFIX_LENGTH), NULL);
+                fail_unless(!memcmp(".123456789", &buf[FIX_TIMESTAMP_PREFIX_LENGTH], 10), NULL);
+        }
+        ts.tv_sec = 951782400; // 2000-02-29
+        ts.tv_nsec = 7008009;
+        buf[format_FIX_utc_timestamp(&ts, FIX_TS_MILLI, buf)] = '\0';
+        fail_unless(!strcmp("20000229-00:00:00.007", buf), NULL);
+        buf[format_FIX_utc_timestamp(&ts, FIX_TS_MICRO, buf)] = '\0';
+        fail_unless(!strcmp("20000229-00:00:00.007008", buf), NULL);
+        ts.tv_sec = 951868799;
+        ts.tv_nsec = 999999999;
+        buf[format_FIX_utc_timestamp(&ts, FIX_TS_MILLI, buf)] = '\0';
+        fail_unless(!strcmp("20000229-23:59:59.999", buf), NULL);
+
+        fail_unless(FIX_TS_SECONDS == get_FIX_sending_time_precision(FIX_4_1), NULL);
+        fail_unless(FIX_TS_MILLI == get_FIX_sending_time_precision(FIX_4_4), NULL);
+        fail_unless(FIX_TIMESTAMP_PREFIX_LENGTH + 4 == get_FIX_utc_timestamp(FIX_TS_MILLI, buf), NULL);
+
+        // expose() needs tag 52
+        fail_unless(1 == tx_msg.init(), NULL);
+        fail_unless(1 == tx_msg.append_field(35, strlen("0"), (const uint8_t*)"0"), NULL);
+        fail_unless(0 == tx_msg.expose(&ttl, len, &data, &msg_type), NULL);
+        fail_unless(1 == tx_msg.append_sending_time(FIX_TS_MICRO), NULL);
+        fail_unless(1 == tx_msg.append_utc_timestamp(60, FIX_TS_SECONDS), NULL);
+        fail_unless(1 == tx_msg.expose(&ttl, len, &data, &msg_type), NULL);
+        fail_unless(strlen("|52=YYYYMMDD-HH:MM:SS.uuuuuu|60=YYYYMMDD-HH:MM:SS|10=") == len, NULL);
+        fail_unless(!memcmp("|52=", data, 4), NULL);
+        fail_unless('.' == data[4 + FIX_TIMESTAMP_PREFIX_LENGTH], NULL);
+        fail_unless(!memcmp("|60=", &data[4 + FIX_TIMESTAMP_PREFIX_LENGTH + 7], 4), NULL);
+}
+END_TEST
+
+/*
+ * Returns every message in args through a cache of the calling
+ * thread.
+ */
+#define POOL_TEST_MESSAGES (3*FIXMSG_POOL_CACHE_SIZE)
+struct pool_test_args_t {
+        FIXMessagePool *pool;
+        FIXMessageTX *tx_msgs[POOL_TEST_MESSAGES];
+};
+
+static void*
+pool_test_put_thread(void *args)
+{
+        int n;
+        struct pool_test_args_t *pool_args = (struct pool_test_args_t*)args;
+        FIXMessagePoolCache cache(*pool_args->pool);
+
+        for (n = 0; n < POOL_TEST_MESSAGES; ++n)
+                cache.put_tx(pool_args->tx_msgs[n]);
+
+        return NULL;
+}
+
+/*
+ * Test FIXMessagePool and FIXMessagePoolCache.
+ */
+START_TEST(test_FIXMessagePool)
+{
+        int n;
+        size_t len;
+        const uint8_t *data;
+        const uint8_t *first_data;
+        const char *msg_type;
+        const struct timeval *ttl;
+        pthread_t thread;
+        FIXMessageTX *tx_msg;
+        struct pool_test_args_t pool_args;
+        FIXMessageRX *rx_msg;
+        FIXMessagePool pool(FIX_4_1, DELIM, 1);
+
+        fail_unless(1 == pool.prewarm(8, 4), NULL);
+        fail_unless(8 == pool.free_tx(), NULL);
+        fail_unless(4 == pool.free_rx(), NULL);
+        fail_unless(1 == pool.prewarm(2, 2), NULL); // already warm
+        fail_unless(8 == pool.free_tx(), NULL);
+
+        {
+                FIXMessagePoolCache cache(pool);
+
+                // a returned message comes back reset with its buffer
+                tx_msg = cache.get_tx();
+                fail_unless(NULL != tx_msg, NULL);
+                fail_unless(0 == pool.free_tx(), NULL); // the cache took them all
+                fail_unless(1 == tx_msg->append_field(35, strlen("D"), (const uint8_t*)"D"), NULL);
+                fail_unless(1 == tx_msg->append_field(52, strlen("20130101-00:00:00"), (const uint8_t*)"20130101-00:00:00"), NULL);
+                fail_unless(1 == tx_msg->append_field(58, strlen("FOO"), (const uint8_t*)"FOO"), NULL);
+                fail_unless(1 == tx_msg->expose(&ttl, len, &data, &msg_type), NULL);
+                first_data = data;
+                fail_unless(1 == tx_msg->append_field(58, strlen("FOO"), (const uint8_t*)"FOO"), NULL);
+                cache.put_tx(tx_msg);
+                fail_unless(tx_msg == cache.get_tx(), NULL);
+                fail_unless(0 == tx_msg->expose(&ttl, len, &data, &msg_type), NULL); // blank
+                fail_unless(1 == tx_msg->append_field(35, strlen("B"), (const uint8_t*)"B"), NULL);
+                fail_unless(1 == tx_msg->append_field(52, strlen("20130101-00:00:00"), (const uint8_t*)"20130101-00:00:00"), NULL);
+                fail_unless(1 == tx_msg->expose(&ttl, len, &data, &msg_type), NULL);
+                fail_unless(first_data == data, NULL);
+                fail_unless(0 == memcmp("|52=20130101-00:00:00|10=", data, len), NULL);
+                fail_unless(0 == strcmp("B", msg_type), NULL);
+                cache.put_tx(tx_msg);
+
+                rx_msg = cache.get_rx();
+                fail_unless(NULL != rx_msg, NULL);
+                cache.put_rx(rx_msg);
+                fail_unless(rx_msg == cache.get_rx(), NULL);
+                cache.put_rx(rx_msg);
+        }
+        fail_unless(8 == pool.free_tx(), NULL); // returned by the cache
+        fail_unless(4 == pool.free_rx(), NULL);
+
+        // take more than a cache holds and return them from another thread
+        {
+                FIXMessagePoolCache cache(pool);
+
+                for (n = 0; n < POOL_TEST_MESSAGES; ++n) {
+                        pool_args.tx_msgs[n] = cache.get_tx();
+                        fail_unless(NULL != pool_args.tx_msgs[n], NULL);
+                }
+        }
+        pool_args.pool = &pool;
+        fail_unless(0 == pool.free_tx(), NULL);
+        fail_unless(0 == pthread_create(&thread, NULL, pool_test_put_thread, &pool_args), NULL);
+        fail_unless(0 == pthread_join(thread, NULL), NULL);
+        fail_unless(POOL_TEST_MESSAGES == pool.free_tx(), NULL);
+
+        tx_msg = pool.get_tx();
+        fail_unless(NULL != tx_msg, NULL);
+        fail_unless(POOL_TEST_MESSAGES - 1 == pool.free_tx(), NULL);
+        pool.put_tx(tx_msg);
+        fail_unless(POOL_TEST_MESSAGES == pool.free_tx(), NULL);
 }
 END_TEST
 
@@ -300,7 +987,16 @@ fixmsg_suite(void)
 
         tcase_add_test(tc_core, test_FIXMessageRX_resource_management);
         tcase_add_test(tc_core, test_FIXMessageRX_next_field);
+        tcase_add_test(tc_core, test_FIXMessageRX_index);
+        tcase_add_test(tc_core, test_FIXMessageRX_groups);
         tcase_add_test(tc_core, test_FIXMessageTX_composition);
+        tcase_add_test(tc_core, test_FIXMessageTX_typed_appenders);
+        tcase_add_test(tc_core, test_FIX_value_decoders);
+        tcase_add_test(tc_core, test_FIX_checksum);
+        tcase_add_test(tc_core, test_FIX_tag_dict);
+        tcase_add_test(tc_core, test_FIX_msgtype);
+        tcase_add_test(tc_core, test_FIX_timestamp);
+        tcase_add_test(tc_core, test_FIXMessagePool);
         suite_add_tcase(s, tc_core);
 
         return s;
@@ -186,6 +186,41 @@ START_TEST(test_uint_to_str)
 }
 END_TEST
 
+/*
+ * Tests uint_to_str() and uint_str_length() around every power of
+ * ten up to the largest 64 bit value.
+ */
+START_TEST(test_uint_to_str_wide)
+{
+        char buf[24];
+        char std[24];
+        char *str;
+        uint64_t power = 1;
+        uint64_t values[3];
+        unsigned int n;
+        unsigned int k;
+
+        for (n = 0; n < 20; ++n) {
+                values[0] = power - 1;
+                values[1] = power;
+                values[2] = power + 7;
+                for (k = 0; k < 3; ++k) {
+                        str = buf;
+                        snprintf(std, sizeof(std), "%llu", (unsigned long long)values[k]);
+                        uint_to_str('\0', values[k], &str);
+                        fail_unless(strlen(std) == uint_str_length(values[k]), NULL);
+                        fail_unless(!strcmp(std, buf), NULL);
+                        fail_unless(buf + strlen(std) == str, NULL);
+                }
+                power *= 10;
+        }
+        str = buf;
+        uint_to_str('|', UINT64_MAX, &str);
+        fail_unless(!memcmp("18446744073709551615|", buf, 21), NULL);
+        fail_unless(20 == uint_str_length(UINT64_MAX), NULL);
+}
+END_TEST
+
 /*
  * Test uint_to_str_zero_padded().
  */
@@ -226,6 +261,7 @@ fixio_suite(void)
 	tcase_add_test(tc_core, test_get_fix_tag);
 	tcase_add_test(tc_core, test_get_fix_length_value);
         tcase_add_test(tc_core, test_uint_to_str);
+        tcase_add_test(tc_core, test_uint_to_str_wide);
         tcase_add_test(tc_core, test_uint_to_str_zero_padded);
         suite_add_tcase(s, tc_core);
 
@@ -40,147 +40,196 @@
 #include <inttypes.h>
 #include <stdlib.h>
 #include <unistd.h>
+#include <sched.h>
 #include <sys/time.h>
+#include <new>
 
 #ifdef HAVE_CONFIG_H
     #include "ac_config.h"
 #endif
+#include "stdlib/disruptor/disruptor.h"
+#include "stdlib/process/threads.h"
 #include "stdlib/log/log.h"
+#include "stack_utils.h"
+#include "sqlite_store.h"
+#include "mmap_store.h"
 #include "db_utils.h"
 
-#define CREATE_RECV_MSG_TABLE "CREATE TABLE IF NOT EXISTS RECV_MESSAGES (seqnum INTEGER PRIMARY KEY, timestamp_seconds INTEGER, timestamp_microseconds INTEGER, msg BLOB)"
-#define CREATE_SENT_MSG_TABLE "CREATE TABLE IF NOT EXISTS SENT_MESSAGES (seqnum INTEGER PRIMARY KEY, timestamp_seconds INTEGER, timestamp_microseconds INTEGER, ttl_seconds INTEGER, ttl_useconds INTEGER, msg_type TEXT, partial_msg_length INTEGER, partial_msg BLOB)"
-
-#define INSERT_RECV_MESSAGE "INSERT OR REPLACE INTO RECV_MESSAGES(seqnum, timestamp_seconds, timestamp_microseconds, msg) VALUES(?1, ?2, ?3, ?4)"
-#define INSERT_SENT_MESSAGE "INSERT OR REPLACE INTO SENT_MESSAGES(seqnum, timestamp_seconds, timestamp_microseconds, ttl_seconds, ttl_useconds, msg_type, partial_msg_length, partial_msg) VALUES(?1, ?2, ?3, ?4, ?5, ?6, ?7, ?8)"
-
-#define SELECT_MAX_RECV_SEQNUM "SELECT MAX(seqnum) FROM RECV_MESSAGES"
-#define SELECT_MAX_SENT_SEQNUM "SELECT MAX(seqnum) FROM SENT_MESSAGES"
+/*
+ * Journal) Many publishers, one entry processor (the journal
+ * thread), 1024 entries.
+ *
+ * Each entry owns a heap buffer which is reused from message to
+ * message and only grown when a larger message comes along. It holds
+ * the zero terminated message type (sent messages only) followed by
+ * the message itself.
+ */
+#define JOURNAL_QUEUE_LENGTH (1024) // MUST be a power of two
+#define JOURNAL_ENTRY_PROCESSORS (1)
 
 /*
- * result = x - y. Subtract the `struct timeval' values X and Y,
- * storing the result in result.
+ * The journal thread spins JOURNAL_SPIN_COUNT polls after the journal
+ * runs dry and then parks until new entries are committed, or at most
+ * JOURNAL_PARK_USEC, or the commit interval if that is shorter, so
+ * that flush requests and open transactions are seen to in time.
  */
-static int
-timeval_subtract(struct timeval * const result, 
-		 struct timeval * const x, 
-		 struct timeval * const y)
-{
-	int nsec;
-
-	// Perform the carry for the later subtraction by updating y
-	if (x->tv_usec < y->tv_usec) {
-		nsec = (y->tv_usec - x->tv_usec) / 1000000 + 1;
-		y->tv_usec -= 1000000 * nsec;
-		y->tv_sec += nsec;
-	}
-	if (x->tv_usec - y->tv_usec > 1000000) {
-		nsec = (x->tv_usec - y->tv_usec) / 1000000;
-		y->tv_usec += 1000000 * nsec;
-		y->tv_sec -= nsec;
-	}
-     
-	// Compute the time remaining to wait. tv_usec is certainly
-	// positive
-	result->tv_sec = x->tv_sec - y->tv_sec;
-	result->tv_usec = x->tv_usec - y->tv_usec;
-
-	// Return 1 if result is negative
-	return (x->tv_sec < y->tv_sec);
-}
+#define JOURNAL_SPIN_COUNT (100)
+#define JOURNAL_PARK_USEC (1000)
+
+enum JournalEntryKind {
+        JOURNAL_NOOP,     // nothing to write, e.g. after a failed allocation
+        JOURNAL_SENT_MSG, // goes into SENT_MESSAGES
+        JOURNAL_RECV_MSG, // goes into RECV_MESSAGES
+};
+
+struct journal_t {
+        uint32_t kind;            // enum JournalEntryKind
+        uint32_t msg_type_length; // bytes in msg type including the terminating zero
+        uint64_t seqnum;
+        uint64_t tv_sec;          // time of storing
+        uint64_t tv_usec;
+        uint64_t ttl_tv_sec;
+        uint64_t ttl_tv_usec;
+        uint64_t length;          // bytes in message
+        size_t allocated_size;
+        uint8_t *data;
+};
+
+DEFINE_ENTRY_TYPE(struct journal_t, journal_entry_t);
+DEFINE_RING_BUFFER_TYPE(JOURNAL_ENTRY_PROCESSORS, JOURNAL_QUEUE_LENGTH, journal_entry_t, journal_io_t);
+DEFINE_RING_BUFFER_MALLOC(journal_io_t, journal_);
+DEFINE_RING_BUFFER_INIT(JOURNAL_QUEUE_LENGTH, journal_io_t, journal_);
+DEFINE_RING_BUFFER_SET_WAIT_STRATEGY_FUNCTION(journal_io_t, journal_);
+DEFINE_RING_BUFFER_SHOW_ENTRY_FUNCTION(journal_entry_t, journal_io_t, journal_);
+DEFINE_RING_BUFFER_ACQUIRE_ENTRY_FUNCTION(journal_entry_t, journal_io_t, journal_);
+DEFINE_ENTRY_PROCESSOR_BARRIER_REGISTER_FUNCTION(journal_io_t, journal_);
+DEFINE_ENTRY_PROCESSOR_BARRIER_WAITFOR_NONBLOCKING_FUNCTION(journal_io_t, journal_);
+DEFINE_ENTRY_PROCESSOR_BARRIER_RELEASEENTRY_FUNCTION(journal_io_t, journal_);
+DEFINE_ENTRY_PUBLISHER_NEXTENTRY_BLOCKING_FUNCTION(journal_io_t, journal_);
+DEFINE_ENTRY_PUBLISHER_COMMITENTRY_BLOCKING_FUNCTION(journal_io_t, journal_);
 
 /*
- * Returns 1 (one) if now os greater than ttl, 0 (zero) otherwise.
+ * Ensures that the entry buffer can hold size bytes.
+ *
+ * Returns 1 (one) if all is well, 0 (zero) if not.
  */
 static inline int
-is_ttl_expired(const time_t ttl_tv_sec,
-               const suseconds_t ttl_tv_usec,
-	       struct timeval & remaining_ttl)
+reserve_journal_data(struct journal_t * const entry,
+                     const size_t size)
 {
-        struct timeval ttl = { ttl_tv_sec, ttl_tv_usec };
-        struct timeval now;
+        if (entry->allocated_size >= size)
+                return 1;
 
-        gettimeofday(&now, NULL);
-	if (timeval_subtract(&remaining_ttl, &ttl, &now)) {
-		remaining_ttl.tv_sec = 0;
-		remaining_ttl.tv_usec = 0;
-	}
+        free(entry->data);
+        entry->data = (uint8_t*)malloc(size);
+        if (!entry->data) {
+                entry->allocated_size = 0;
+                return 0;
+        }
+        entry->allocated_size = size;
 
-	return (!remaining_ttl.tv_sec && !remaining_ttl.tv_usec);
+        return 1;
+}
+
+static inline uint64_t
+get_usec(void)
+{
+        struct timeval tval;
+
+        // ignore errors
+        gettimeofday(&tval, NULL);
+
+        return ((uint64_t)tval.tv_sec * 1000000) + (uint64_t)tval.tv_usec;
 }
 
 
+MsgDB::~MsgDB()
+{
+        unsigned int n;
+
+        this->close();
+        delete store_;
+        free(db_path_);
+
+        if (journal_) {
+                for (n = 0; n < JOURNAL_QUEUE_LENGTH; ++n)
+                        free(journal_->buffer[n].content.data);
+                free(journal_);
+        }
+}
+
 int
 MsgDB::open(void)
 {
-        int ret;
-        char *err_msg = NULL;
+        struct timespec park_timeout;
+        uint64_t park_usec;
 
-        if (db_)
+        if (is_open_)
                 return 1;
 
         if (!db_path_)
                 return 0;
 
-        ret = sqlite3_open(db_path_, &db_);
-        if (SQLITE_OK != ret) {
-                M_ALERT("could not open local database");
-                goto err;
-        }
-        sqlite3_exec(db_, "PRAGMA journal_mode=WAL", NULL, NULL, &err_msg);
-        if (SQLITE_OK != ret) {
-                M_ALERT("could not enable WAL");
-                /* continuing in default mode */
-        }
-
-        ret = sqlite3_exec(db_, CREATE_RECV_MSG_TABLE, NULL, NULL, &err_msg);
-        if (SQLITE_OK != ret) {
-                M_ALERT("could not create recv_msg table");
-                goto err;
-        }
-
-        ret = sqlite3_exec(db_, CREATE_SENT_MSG_TABLE, NULL, NULL, &err_msg);
-        if (SQLITE_OK != ret) {
-                M_ALERT("could not create sent_msg table");
-                goto err;
+        if (!store_) {
+                switch (store_type_) {
+                case MMAP_STORE:
+                        store_ = new (std::nothrow) MmapStore;
+                        break;
+                case SQLITE_STORE:
+                default:
+                        store_ = new (std::nothrow) SQLiteStore;
+                        break;
+                }
+                if (!store_) {
+                        M_ALERT("no memory");
+                        return 0;
+                }
         }
-
-        ret = sqlite3_prepare_v2(db_, INSERT_RECV_MESSAGE, -1,  &insert_recv_msg_statement_, NULL);
-        if (SQLITE_OK != ret) {
-                M_ALERT("could not prepare insert recv msg statement");
-                goto err;
+        if (!store_->open(db_path_)) {
+                M_ALERT("could not open local database");
+                return 0;
         }
 
-        ret = sqlite3_prepare_v2(db_, INSERT_SENT_MESSAGE, -1,  &insert_sent_msg_statement_, NULL);
-        if (SQLITE_OK != ret) {
-                M_ALERT("could not prepare insert recv msg statement");
-                goto err;
+        // The journal is allocated once and lives as long as this
+        // instance. So does the registration of the journal thread
+        // as its entry processor.
+        if (!journal_) {
+                journal_ = journal_ring_buffer_malloc();
+                if (!journal_) {
+                        M_ALERT("no memory");
+                        goto err;
+                }
+                journal_ring_buffer_init(journal_);
+                journal_cursor_.sequence = journal_entry_processor_barrier_register(journal_, &journal_reg_number_);
         }
 
-        ret = sqlite3_prepare_v2(db_, SELECT_MAX_RECV_SEQNUM, -1,  &max_recv_seqnum_statement_, NULL);
-        if (SQLITE_OK != ret) {
-                M_ALERT("could not prepare max recv seqnum statement");
-                goto err;
+        park_usec = JOURNAL_PARK_USEC;
+        if ((COMMIT_EVERY_T_USEC == __atomic_load_n(&durability_, __ATOMIC_RELAXED))
+            && (__atomic_load_n(&durability_value_, __ATOMIC_RELAXED) < park_usec))
+                park_usec = __atomic_load_n(&durability_value_, __ATOMIC_RELAXED);
+        park_timeout.tv_sec = 0;
+        park_timeout.tv_nsec = (long)park_usec * 1000;
+        journal_ring_buffer_set_wait_strategy(journal_, WAIT_SPIN_PARK, JOURNAL_SPIN_COUNT, &park_timeout);
+
+        // the entries which failed before close() are lost, so
+        // flush() must not wait for them
+        if (get_flag(&journal_error_)) {
+                __atomic_store_n(&journal_committed_, journal_cursor_.sequence - 1, __ATOMIC_RELEASE);
+                set_flag(&journal_error_, 0);
         }
 
-        ret = sqlite3_prepare_v2(db_, SELECT_MAX_SENT_SEQNUM, -1,  &max_sent_seqnum_statement_, NULL);
-        if (SQLITE_OK != ret) {
-                M_ALERT("could not prepare max sent seqnum statement");
+        set_flag(&stop_journal_, 0);
+        if (!create_joinable_thread(&journal_thread_id_, this, journal_thread_func)) {
+                M_ALERT("could not create journal thread");
                 goto err;
         }
+        set_flag(&journal_is_running_, 1);
+        is_open_ = 1;
 
         return 1;
 
 err:
-        if (SQLITE_OK != ret) {
-                if (err_msg) {
-                        M_ALERT("local database operation failed: %s", err_msg);
-                } else {
-                        M_ALERT("local database operation failed: %s", sqlite3_errstr(ret));
-                }
-        }
-        sqlite3_free(err_msg);
-        if (!this->close()) {
+        if (!store_->close()) {
                 M_ALERT("could not close local database - aborting");
                 abort();
         }
@@ -191,42 +240,83 @@ err:
 int
 MsgDB::close(void)
 {
-        int cnt = 0;
-        int ret;
-
-        if (!db_)
+        if (!is_open_)
                 return 1;
 
-        sqlite3_finalize(insert_recv_msg_statement_);
-        sqlite3_finalize(insert_sent_msg_statement_);
-        sqlite3_finalize(max_recv_seqnum_statement_);
-        sqlite3_finalize(max_sent_seqnum_statement_);
-        insert_recv_msg_statement_ = NULL;
-        insert_sent_msg_statement_ = NULL;
-        max_recv_seqnum_statement_ = NULL;
-        max_sent_seqnum_statement_ = NULL;
-
-close_db:
-        ret = sqlite3_close(db_);
-        switch (ret) {
-        case SQLITE_OK:
+        // drains and commits the journal
+        if (get_flag(&journal_is_running_)) {
+                set_flag(&stop_journal_, 1);
+                wait_strategy_signal(&journal_->wait_strategy);
+                pthread_join(journal_thread_id_, NULL);
+                set_flag(&journal_is_running_, 0);
+        }
+
+        if (!store_->close())
+                return 0;
+        is_open_ = 0;
+
+        return 1;
+}
+
+int
+MsgDB::set_store_type(const enum MsgStoreType type)
+{
+        if (is_open_)
+                return 0;
+
+        switch (type) {
+        case SQLITE_STORE:
+        case MMAP_STORE:
                 break;
-        case SQLITE_BUSY:
-                ++cnt;
-                if (5 == cnt) {
-                        M_ALERT("SQLITE_BUSY for too long - aborting");
-                        return 0;
-                }
-                sleep(1);
-                goto close_db;
-        case SQLITE_MISUSE:
-                M_ALERT("could not close local cache: SQLITE_MISUSE");
+        default:
                 return 0;
+        }
+        if (type != store_type_) {
+                delete store_;
+                store_ = NULL;
+                store_type_ = type;
+        }
+
+        return 1;
+}
+
+int
+MsgDB::set_durability(const enum MsgDBDurability policy,
+                      const uint64_t value)
+{
+        switch (policy) {
+        case COMMIT_EVERY_MESSAGE:
+                break;
+        case COMMIT_EVERY_N_MESSAGES:
+        case COMMIT_EVERY_T_USEC:
+                if (!value)
+                        return 0;
+                break;
         default:
-                M_ALERT("trouble closing local cache: %s", sqlite3_errstr(ret));
                 return 0;
         }
-        db_ = NULL;
+        __atomic_store_n(&durability_, (int)policy, __ATOMIC_RELAXED);
+        __atomic_store_n(&durability_value_, value, __ATOMIC_RELAXED);
+
+        return 1;
+}
+
+int
+MsgDB::flush(void) const
+{
+        uint64_t last_stored;
+
+        if (!is_open_ || !__atomic_load_n(&journal_is_running_, __ATOMIC_ACQUIRE))
+                return 0;
+
+        last_stored = __atomic_load_n(&journal_->write_cursor.sequence, __ATOMIC_ACQUIRE);
+        while (__atomic_load_n(&journal_committed_, __ATOMIC_ACQUIRE) < last_stored) {
+                if (__atomic_load_n(&journal_error_, __ATOMIC_ACQUIRE))
+                        return 0;
+                set_flag(&flush_journal_, 1);
+                wait_strategy_signal(&journal_->wait_strategy);
+                sched_yield();
+        }
 
         return 1;
 }
@@ -239,74 +329,40 @@ MsgDB::store_sent_msg(const uint64_t seqnum,
                       const uint8_t * const msg,
                       const char * const msg_type)
 {
-        int ret;
         struct timeval tval;
+        struct cursor_t cursor;
+        struct journal_entry_t *entry;
+        const size_t msg_type_length = strlen(msg_type) + 1;
 
-        if (!db_)
+        if (!is_open_ || get_flag(&journal_error_))
                 return 0;
 
         // ignore errors
         gettimeofday(&tval, NULL);
 
-        ret = sqlite3_bind_int64(insert_sent_msg_statement_, 1, seqnum);
-        if (SQLITE_OK != ret) {
-                M_ALERT("could not bind into sent msg statement: %s", sqlite3_errstr(ret));
-                goto out;
-        }
+        journal_publisher_next_entry_blocking(journal_, &cursor);
+        entry = journal_ring_buffer_acquire_entry(journal_, &cursor);
 
-        ret = sqlite3_bind_int64(insert_sent_msg_statement_, 2, (uint64_t)tval.tv_sec);
-        if (SQLITE_OK != ret) {
-                M_ALERT("could not bind into sent msg statement: %s", sqlite3_errstr(ret));
-                goto out;
-        }
-
-        ret = sqlite3_bind_int64(insert_sent_msg_statement_, 3, (uint64_t)tval.tv_usec);
-        if (SQLITE_OK != ret) {
-                M_ALERT("could not bind into sent msg statement: %s", sqlite3_errstr(ret));
-                goto out;
-        }
-
-        ret = sqlite3_bind_int64(insert_sent_msg_statement_, 4, ttl_tv_sec);
-        if (SQLITE_OK != ret) {
-                M_ALERT("could not bind into sent msg statement: %s", sqlite3_errstr(ret));
-                goto out;
-        }
-
-        ret = sqlite3_bind_int64(insert_sent_msg_statement_, 5, ttl_tv_usec);
-        if (SQLITE_OK != ret) {
-                M_ALERT("could not bind into sent msg statement: %s", sqlite3_errstr(ret));
-                goto out;
-        }
-
-        ret = sqlite3_bind_text(insert_sent_msg_statement_, 6, msg_type, -1, SQLITE_TRANSIENT);
-        if (SQLITE_OK != ret) {
-                M_ALERT("could not bind into sent msg statement: %s", sqlite3_errstr(ret));
-                goto out;
-        }
-
-        ret = sqlite3_bind_int64(insert_sent_msg_statement_, 7, len);
-        if (SQLITE_OK != ret) {
-                M_ALERT("could not bind into sent msg statement: %s", sqlite3_errstr(ret));
-                goto out;
-        }
-
-        ret = sqlite3_bind_blob(insert_sent_msg_statement_, 8, msg, len, SQLITE_TRANSIENT);
-        if (SQLITE_OK != ret) {
-                M_ALERT("could not bind into sent msg statement: %s", sqlite3_errstr(ret));
-                goto out;
-        }
-
-        ret = sqlite3_step(insert_sent_msg_statement_);
-        if (SQLITE_DONE != ret) {
-                M_ALERT("could not step sent msg statement: (%d) %s - %s", ret, sqlite3_errstr(ret), sqlite3_errmsg(db_));
-                goto out;
+        if (!reserve_journal_data(&entry->content, msg_type_length + len)) {
+                entry->content.kind = JOURNAL_NOOP;
+                journal_publisher_commit_entry_blocking(journal_, &cursor);
+                M_ALERT("no memory");
+                return 0;
         }
+        entry->content.kind = JOURNAL_SENT_MSG;
+        entry->content.msg_type_length = msg_type_length;
+        entry->content.seqnum = seqnum;
+        entry->content.tv_sec = (uint64_t)tval.tv_sec;
+        entry->content.tv_usec = (uint64_t)tval.tv_usec;
+        entry->content.ttl_tv_sec = ttl_tv_sec;
+        entry->content.ttl_tv_usec = ttl_tv_usec;
+        entry->content.length = len;
+        memcpy(entry->content.data, msg_type, msg_type_length);
+        memcpy(entry->content.data + msg_type_length, msg, len);
+
+        journal_publisher_commit_entry_blocking(journal_, &cursor);
 
-out:
-        sqlite3_clear_bindings(insert_sent_msg_statement_);
-        sqlite3_reset(insert_sent_msg_statement_);
-
-        return ((SQLITE_DONE == ret) ? 1 : 0);
+        return 1;
 }
 
 int
@@ -314,201 +370,200 @@ MsgDB::store_recv_msg(const uint64_t seqnum,
                       const uint64_t len,
                       const uint8_t * const msg)
 {
-        int ret;
         struct timeval tval;
+        struct cursor_t cursor;
+        struct journal_entry_t *entry;
 
-        if (!db_)
+        if (!is_open_ || get_flag(&journal_error_))
                 return 0;
 
         // ignore errors
         gettimeofday(&tval, NULL);
 
-        ret = sqlite3_bind_int64(insert_recv_msg_statement_, 1, seqnum);
-        if (SQLITE_OK != ret) {
-                M_ALERT("could not bind into recv msg statement: %s", sqlite3_errstr(ret));
-                goto out;
-        }
+        journal_publisher_next_entry_blocking(journal_, &cursor);
+        entry = journal_ring_buffer_acquire_entry(journal_, &cursor);
 
-        ret = sqlite3_bind_int64(insert_sent_msg_statement_, 2, tval.tv_sec);
-        if (SQLITE_OK != ret) {
-                M_ALERT("could not bind into recv msg statement: %s", sqlite3_errstr(ret));
-                goto out;
+        if (!reserve_journal_data(&entry->content, len)) {
+                entry->content.kind = JOURNAL_NOOP;
+                journal_publisher_commit_entry_blocking(journal_, &cursor);
+                M_ALERT("no memory");
+                return 0;
         }
+        entry->content.kind = JOURNAL_RECV_MSG;
+        entry->content.msg_type_length = 0;
+        entry->content.seqnum = seqnum;
+        entry->content.tv_sec = (uint64_t)tval.tv_sec;
+        entry->content.tv_usec = (uint64_t)tval.tv_usec;
+        entry->content.length = len;
+        memcpy(entry->content.data, msg, len);
 
-        ret = sqlite3_bind_int64(insert_sent_msg_statement_, 3, tval.tv_usec);
-        if (SQLITE_OK != ret) {
-                M_ALERT("could not bind into recv msg statement: %s", sqlite3_errstr(ret));
-                goto out;
-        }
+        journal_publisher_commit_entry_blocking(journal_, &cursor);
 
-        ret = sqlite3_bind_blob(insert_recv_msg_statement_, 4, msg, len, SQLITE_TRANSIENT);
-        if (SQLITE_OK != ret) {
-                M_ALERT("could not bind into recv msg statement: %s", sqlite3_errstr(ret));
-                goto out;
-        }
+        return 1;
+}
 
-        ret = sqlite3_step(insert_recv_msg_statement_);
-        if (SQLITE_DONE != ret) {
-                M_ALERT("could not step recv msg statement: %s", sqlite3_errstr(ret));
-                goto out;
-        }
+void*
+MsgDB::journal_thread_func(void *arg)
+{
+        MsgDB * const db = (MsgDB*)arg;
+        const int durability = __atomic_load_n(&db->durability_, __ATOMIC_RELAXED);
+        const uint64_t durability_value = __atomic_load_n(&db->durability_value_, __ATOMIC_RELAXED);
+        const struct journal_entry_t *entry;
+        struct cursor_t n;
+        struct cursor_t cursor_upper_limit;
+        uint64_t pending = 0; // messages in the open transaction
+        uint64_t begun = 0;   // when the open transaction was begun
+        int failed = 0;       // 1 (one) if the open transaction could not be begun or written
+        unsigned int polls = 0;
+        int stopping;
+
+        do {
+                // must be read before looking for entries so that
+                // nothing stored before close() is left behind
+                stopping = get_flag(&db->stop_journal_);
+
+                cursor_upper_limit.sequence = db->journal_cursor_.sequence;
+                if (journal_entry_processor_barrier_wait_for_nonblocking(db->journal_, &cursor_upper_limit)) {
+                        for (n.sequence = db->journal_cursor_.sequence; n.sequence <= cursor_upper_limit.sequence; ++n.sequence) { // batching
+                                entry = journal_ring_buffer_show_entry(db->journal_, &n);
+
+                                if (!pending) {
+                                        failed = !db->store_->begin_transaction();
+                                        if (failed)
+                                                M_ALERT("journal could not begin transaction");
+                                        begun = get_usec();
+                                }
+                                switch (entry->content.kind) {
+                                case JOURNAL_SENT_MSG:
+                                        if (!db->store_->write_sent_msg(entry->content.seqnum,
+                                                                        entry->content.tv_sec,
+                                                                        entry->content.tv_usec,
+                                                                        entry->content.ttl_tv_sec,
+                                                                        entry->content.ttl_tv_usec,
+                                                                        entry->content.length,
+                                                                        entry->content.data + entry->content.msg_type_length,
+                                                                        (const char*)entry->content.data)) {
+                                                M_ALERT("journal could not write sent message %llu", (unsigned long long)entry->content.seqnum);
+                                                failed = 1;
+                                        }
+                                        break;
+                                case JOURNAL_RECV_MSG:
+                                        if (!db->store_->write_recv_msg(entry->content.seqnum,
+                                                                        entry->content.tv_sec,
+                                                                        entry->content.tv_usec,
+                                                                        entry->content.length,
+                                                                        entry->content.data)) {
+                                                M_ALERT("journal could not write received message %llu", (unsigned long long)entry->content.seqnum);
+                                                failed = 1;
+                                        }
+                                        break;
+                                default:
+                                        break;
+                                }
+                                ++pending;
+                                journal_entry_processor_barrier_release_entry(db->journal_, &db->journal_reg_number_, &n);
+
+                                if ((COMMIT_EVERY_MESSAGE == durability)
+                                    || ((COMMIT_EVERY_N_MESSAGES == durability) && (durability_value <= pending))
+                                    || ((COMMIT_EVERY_T_USEC == durability) && (durability_value <= get_usec() - begun))) {
+                                        db->commit_journal(failed, n.sequence);
+                                        pending = 0;
+                                }
+                        }
+                        db->journal_cursor_.sequence = ++cursor_upper_limit.sequence;
+                        polls = 0;
+                        continue;
+                }
+
+                // the journal has run dry
+                if (pending) {
+                        if ((COMMIT_EVERY_T_USEC != durability)
+                            || stopping
+                            || get_flag_weak(&db->flush_journal_)
+                            || (durability_value <= get_usec() - begun)) {
+                                db->commit_journal(failed, db->journal_cursor_.sequence - 1);
+                                pending = 0;
+                        }
+                }
+                if (!pending)
+                        set_flag_weak(&db->flush_journal_, 0);
+
+                if (stopping)
+                        break;
+
+                // parks until more is committed to the journal
+                wait_strategy_wait(&db->journal_->wait_strategy, &polls, &db->journal_->max_read_cursor.sequence, db->journal_cursor_.sequence);
+        } while (1);
 
-out:
-        sqlite3_clear_bindings(insert_recv_msg_statement_);
-        sqlite3_reset(insert_recv_msg_statement_);
+        return NULL;
+}
+
+void
+MsgDB::commit_journal(const int failed,
+                      const uint64_t sequence)
+{
+        if (!store_->commit_transaction()) {
+                M_ALERT("journal could not commit transaction");
+                set_flag(&journal_error_, 1);
+                return;
+        }
+        if (failed) {
+                set_flag(&journal_error_, 1);
+                return;
+        }
 
-        return ((SQLITE_DONE == ret) ? 1 : 0);
+        // nothing is committed past a failed entry
+        if (!get_flag(&journal_error_))
+                __atomic_store_n(&journal_committed_, sequence, __ATOMIC_RELEASE);
 }
 
 int
 MsgDB::get_latest_recv_seqnum(uint64_t & seqnum) const
 {
-        int ret;
-
-        if (!db_)
+        if (!flush())
                 return 0;
 
-        ret = sqlite3_step(max_recv_seqnum_statement_);
-        switch (ret) {
-        case SQLITE_ROW:
-                break;
-        case SQLITE_DONE:
-                seqnum = 0;
-                goto out;
-        default:
-                M_ALERT("error getting latest recv seqnum");
-                goto err;
-        }
-        seqnum = sqlite3_column_int64(max_recv_seqnum_statement_, 0);
-out:
-        sqlite3_reset(max_recv_seqnum_statement_);
-        return 1;
-
-err:
-        sqlite3_reset(max_recv_seqnum_statement_);
-        M_ALERT("could not get latest recv seqnum: %s", sqlite3_errstr(ret));
-        return 0;
+        return store_->get_latest_recv_seqnum(seqnum);
 }
 
 int
 MsgDB::get_latest_sent_seqnum(uint64_t & seqnum) const
 {
-        int ret;
-
-        ret = sqlite3_step(max_sent_seqnum_statement_);
-        switch (ret) {
-        case SQLITE_ROW:
-                break;
-        case SQLITE_DONE:
-                seqnum = 0;
-                goto out;
-        default:
-                M_ALERT("error getting latest sent seqnum");
-                goto err;
-        }
-        seqnum = sqlite3_column_int64(max_sent_seqnum_statement_, 0);
-out:
-        sqlite3_reset(max_sent_seqnum_statement_);
-        return 1;
+        if (!flush())
+                return 0;
 
-err:
-        sqlite3_reset(max_sent_seqnum_statement_);
-        M_ALERT("could not get latest sent seqnum: %s", sqlite3_errstr(ret));
-        return 0;
+        return store_->get_latest_sent_seqnum(seqnum);
 }
 
 PartialMessageList*
 MsgDB::get_sent_msgs(uint64_t start,
                      uint64_t end) const
 {
-        static const char *select_fmt_no_end = "SELECT ttl_seconds, ttl_useconds, msg_type, partial_msg_length, partial_msg FROM SENT_MESSAGES WHERE seqnum >= %llu";
-        static const char *select_fmt = "SELECT ttl_seconds, ttl_useconds, msg_type, partial_msg_length, partial_msg FROM SENT_MESSAGES WHERE seqnum >= %llu AND seqnum <= %llu";
-        PartialMessageList *retv = NULL;
-        PartialMessage *pmsg = NULL;
-        sqlite3_stmt *select_statement = NULL;
-        char select_str[256];
-        time_t ttl_sec;
-        suseconds_t ttl_usec;
-        int ret;
-        const void *part_msg = NULL;
-
-        if (!db_)
+        if (!flush())
                 return NULL;
 
-	if (!end) {
-		sprintf(select_str, select_fmt_no_end, start);
-	} else {
-		sprintf(select_str, select_fmt, start, end);
-	}
-        ret = sqlite3_prepare_v2(db_, select_str, -1,  &select_statement, NULL);
-        if (SQLITE_OK != ret) {
-                M_ALERT("could not prepare select sent messages statement: ret = %d", ret);
-                goto out;
-        }
-        retv = new (std::nothrow) PartialMessageList;
-        if (!retv)
-                goto out;
-
-        do {
-                ret = sqlite3_step(select_statement);
-                switch (ret) {
-                case SQLITE_ROW:
-                        break;
-                case SQLITE_BUSY:
-                        continue;
-                case SQLITE_DONE:
-                        goto out;
-                default:
-                        M_ALERT("error selecting sent messages: ret = %d", ret);
-                        goto out;
-                }
-
-                pmsg = new (std::nothrow) PartialMessage;
-                if (!pmsg) {
-                        delete retv;
-			M_ALERT("no memory");
-                        retv = NULL;
-                        goto out;
-                }
-
-                ttl_sec = (time_t)sqlite3_column_int64(select_statement, 0);
-                ttl_usec = (suseconds_t)sqlite3_column_int64(select_statement, 1);
-                if (is_ttl_expired(ttl_sec, ttl_usec, pmsg->ttl)) {
-			retv->push_back(pmsg); 
-                        continue;
-		}
-
-                pmsg->msg_type = strdup((const char*)sqlite3_column_text(select_statement, 2));
-                pmsg->length = sqlite3_column_int64(select_statement, 3);
-                pmsg->part_msg = (uint8_t*)malloc(pmsg->length + 5); // "+ 5" is to avoid realloc when inserting "43=Y<SOH>"
-		if (!pmsg->part_msg) {
-			delete pmsg;
-                        delete retv;
-			M_ALERT("no memory");
-                        retv = NULL;
-                        goto out;
-		}
-                part_msg = sqlite3_column_blob(select_statement, 4);
-                memcpy((void*)pmsg->part_msg, (const uint8_t*)part_msg, pmsg->length);
-
-                retv->push_back(pmsg);
-                pmsg = NULL;
-        } while (1);
+        return store_->get_sent_msgs(start, end);
+}
 
-out:
-        sqlite3_finalize(select_statement);
+int
+MsgDB::get_sent_msgs_chunk(uint64_t & start,
+                           const uint64_t end,
+                           const size_t max_count,
+                           SentMsgChunk & chunk) const
+{
+        chunk.clear();
+        if (!flush())
+                return 0;
 
-        return retv;
+        return store_->get_sent_msgs_chunk(start, end, max_count, chunk);
 }
 
 std::vector<std::vector<uint8_t> >*
-MsgDB::get_recv_msgs(uint64_t /*start*/,
-                     uint64_t /*end*/) const
+MsgDB::get_recv_msgs(uint64_t start,
+                     uint64_t end) const
 {
-        std::vector<std::vector<uint8_t> > *retv = NULL;
-
-        if (!db_)
+        if (!flush())
                 return NULL;
 
-        return retv;
+        return store_->get_recv_msgs(start, end);
 }
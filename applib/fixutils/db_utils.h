@@ -41,92 +41,74 @@
 
 #include <inttypes.h>
 #include <string.h>
-//#include <pthread.h>
+#include <pthread.h>
 #include <vector>
 #include <string>
 
 #ifdef HAVE_CONFIG_H
     #include "ac_config.h"
 #endif
-#include "stdlib/local_db/sqlite3.h"
+#include "stdlib/disruptor/disruptor_types.h"
+#include "msg_store.h"
 
-class PartialMessage {
-public:
-	PartialMessage() 
-		: length(0), 
-		  msg_type(NULL),
-		  part_msg(NULL),
-		  ttl{0,0}
-		{
-		};
-
-	~PartialMessage()
-		{
-			free(msg_type);
-			free(part_msg);
-		};
-
-	uint32_t length;
-	char *msg_type;
-	uint8_t *part_msg;
-	struct timeval ttl;
-};
+struct journal_io_t;
 
-class PartialMessageList {
-public:
-	~PartialMessageList()
-		{
-			unsigned int n;
-
-			for (n = 0; n < list_.size(); ++n)
-				delete list_[n];
-		};
-
-	size_t size(void) const
-		{
-			return list_.size();
-		};
-
-	void push_back(PartialMessage *pmsg)
-		{
-			list_.push_back(pmsg);
-		};
-
-	/*
-	 * Returns message number n. If the message in question has
-	 * exceeded its time to live, then a NULL will be
-	 * returned. NULL will also be returned if n >= size().
-	 */ 
-	PartialMessage *get_at(const unsigned int n)
-		{
-			if (n > (list_.size() - 1))
-				return NULL;
-
-			return list_[n];
-		};
+/*
+ * Durability policies of the message journal. Messages handed to
+ * MsgDB::store_sent_msg() and MsgDB::store_recv_msg() are queued in
+ * the journal and written to the database by a dedicated journal
+ * thread. The policy decides when the open transaction is committed
+ * and thereby when a message is on disk:
+ *
+ * COMMIT_EVERY_MESSAGE    - One transaction per message.
+ *
+ * COMMIT_EVERY_N_MESSAGES - At most N messages per transaction. A
+ *                           partial batch is committed as soon as the
+ *                           journal runs dry.
+ *
+ * COMMIT_EVERY_T_USEC     - A transaction is committed T microseconds
+ *                           after it was begun regardless of how many
+ *                           messages it holds.
+ */
+enum MsgDBDurability {
+        COMMIT_EVERY_MESSAGE,
+        COMMIT_EVERY_N_MESSAGES,
+        COMMIT_EVERY_T_USEC,
+};
 
-private:
-	std::vector<PartialMessage*> list_;
+/*
+ * Message store backends. See msg_store.h.
+ *
+ * SQLITE_STORE - The default. One SQLite database file.
+ *
+ * MMAP_STORE   - Append-only memory mapped segment files with a dense
+ *                sequence number index. See mmap_store.h.
+ */
+enum MsgStoreType {
+        SQLITE_STORE,
+        MMAP_STORE,
 };
 
 class MsgDB {
 public:
 
         MsgDB(void)
-		: db_(NULL),
+		: store_(NULL),
+		  store_type_(SQLITE_STORE),
+		  is_open_(0),
 		  db_path_(NULL),
-		  insert_recv_msg_statement_(NULL),
-		  insert_sent_msg_statement_(NULL),
-		  max_recv_seqnum_statement_(NULL),
-		  max_sent_seqnum_statement_(NULL)
+		  journal_(NULL),
+		  journal_is_running_(0),
+		  stop_journal_(0),
+		  flush_journal_(0),
+		  journal_committed_(0),
+		  journal_error_(0),
+		  durability_(COMMIT_EVERY_N_MESSAGES),
+		  durability_value_(128)
                 {
                 };
 
-        ~MsgDB()
-                {
-                        this->close();
-                        free(db_path_);
-                };
+        ~MsgDB();
 
         /*
          * Does whatever needs doing to get the database initialized
@@ -149,15 +131,58 @@ public:
 
         /*
          * Returns when the underlying store is closed. Blocks
-         * potentially for a long(-ish) time.
+         * potentially for a long(-ish) time as every message in the
+         * journal is written and committed before the database is
+         * closed.
          *
          * Returns 1 (one) if all is well, 0 (zero) if not.
          */
         int close(void);
 
+        /*
+         * Selects the message store backend. Must be called before
+         * open() or after close(). The same path is used by all
+         * backends, so SQLITE_STORE and MMAP_STORE data do not mix.
+         *
+         * Returns 1 (one) if all is well, 0 (zero) if the database is
+         * open or the type is unknown.
+         */
+        int set_store_type(const enum MsgStoreType type);
+
+        /*
+         * Sets the durability policy of the journal. value is N for
+         * COMMIT_EVERY_N_MESSAGES and T for COMMIT_EVERY_T_USEC. It
+         * is ignored for COMMIT_EVERY_MESSAGE.
+         *
+         * The policy takes effect the next time the database is
+         * opened.
+         *
+         * Returns 1 (one) if all is well, 0 (zero) if value is
+         * invalid for the policy.
+         */
+        int set_durability(const enum MsgDBDurability policy,
+                           const uint64_t value);
+
+        /*
+         * Blocks until all messages stored so far have been
+         * committed to the database. All methods reading messages or
+         * sequence numbers will flush before reading.
+         *
+         * Returns 1 (one) if all is well, 0 (zero) if the database
+         * is not open or if the journal thread has failed to write
+         * or commit a message since the database was opened.
+         */
+        int flush(void) const;
+
         /*
          * Stores outgoing partial messages.
          *
+         * The message is copied into the journal and written to the
+         * database by the journal thread. This method only blocks if
+         * the journal is full. Errors writing the message are logged
+         * by the journal thread and make this method, and flush(),
+         * fail until the database is reopened.
+         *
          * seqnum: Sequence number
          * msg: The partial message
          * len: Number of bytes in msg
@@ -172,7 +197,8 @@ public:
                            const char * const msg_type);
 
         /*
-         * Stores incoming complete messages.
+         * Stores incoming complete messages. Asynchronous like
+         * store_sent_msg().
          *
          * seqnum: Sequence number
          * msg: The complete message
@@ -221,6 +247,25 @@ public:
          */
         PartialMessageList *get_sent_msgs(uint64_t start, uint64_t end) const;
 
+        /*
+         * Streaming variant of get_sent_msgs(). Reads at most
+         * max_count previously sent partial messages, starting with
+         * sequence number "start" and ending with sequence number
+         * "end", both included, into chunk. "end" is interpreted as
+         * by get_sent_msgs().
+         *
+         * On return "start" is the sequence number to continue
+         * from. The range is exhausted when an empty chunk is
+         * returned. Sequence numbers not in the database are
+         * skipped.
+         *
+         * Returns 1 (one) if all is well, 0 (zero) if not.
+         */
+        int get_sent_msgs_chunk(uint64_t & start,
+                                const uint64_t end,
+                                const size_t max_count,
+                                SentMsgChunk & chunk) const;
+
         /*
          * Returns a vector of previously recieved complete messages
          * starting with sequence number "start" and ending with
@@ -235,10 +280,35 @@ public:
         std::vector<std::vector<uint8_t> > *get_recv_msgs(uint64_t start, uint64_t end) const;
 
 private:
-        sqlite3 *db_;
+        /*
+         * The journal thread. arg is the MsgDB instance.
+         */
+        static void *journal_thread_func(void *arg);
+
+        /*
+         * Commits the open transaction of the journal thread. The
+         * entries up to and including sequence are marked as
+         * committed if, and only if, neither this commit nor any
+         * write of the transaction failed. Otherwise the journal
+         * error is set and journal_committed_ is left as it is.
+         */
+        void commit_journal(const int failed,
+                            const uint64_t sequence);
+
+        MsgStore *store_;                   // created by open() according to store_type_
+        int store_type_;                    // enum MsgStoreType
+        int is_open_;
         char *db_path_;
-        sqlite3_stmt *insert_recv_msg_statement_;
-        sqlite3_stmt *insert_sent_msg_statement_;
-        sqlite3_stmt *max_recv_seqnum_statement_;
-        sqlite3_stmt *max_sent_seqnum_statement_;
+
+        journal_io_t *journal_;             // messages waiting to be written
+        struct cursor_t journal_cursor_;    // next entry to be read by the journal thread
+        struct count_t journal_reg_number_; // entry processor registration of the journal thread
+        pthread_t journal_thread_id_;
+        int journal_is_running_;            // 1 (one) if the journal thread is running, 0 (zero) if not
+        int stop_journal_;                  // tells the journal thread to drain the journal and exit
+        mutable int flush_journal_;         // tells the journal thread to commit now
+        uint64_t journal_committed_;        // journal sequence number of last committed entry
+        int journal_error_;                 // 1 (one) once the journal thread failed to write or commit, 0 (zero) if not
+        int durability_;                    // enum MsgDBDurability
+        uint64_t durability_value_;         // N or T, depending on durability_
 };
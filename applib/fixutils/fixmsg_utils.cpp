@@ -46,6 +46,41 @@
 #define MAX_TAG__ ((int)((INT_MAX - 9) / 10))
 #define MAX_LENGTH__ ((long long)((LLONG_MAX - 9) / 10))
 
+const char digit_pairs[201] =
+        "00010203040506070809"
+        "10111213141516171819"
+        "20212223242526272829"
+        "30313233343536373839"
+        "40414243444546474849"
+        "50515253545556575859"
+        "60616263646566676869"
+        "70717273747576777879"
+        "80818283848586878889"
+        "90919293949596979899";
+
+const uint64_t powers_of_ten[20] = {
+        1ULL,
+        10ULL,
+        100ULL,
+        1000ULL,
+        10000ULL,
+        100000ULL,
+        1000000ULL,
+        10000000ULL,
+        100000000ULL,
+        1000000000ULL,
+        10000000000ULL,
+        100000000000ULL,
+        1000000000000ULL,
+        10000000000000ULL,
+        100000000000000ULL,
+        1000000000000000ULL,
+        10000000000000000ULL,
+        100000000000000000ULL,
+        1000000000000000000ULL,
+        10000000000000000000ULL,
+};
+
 int
 get_fix_tag(const char **str)
 {
@@ -106,64 +141,44 @@ get_fix_length_value(const char soh,
         return num;
 }
 
+size_t
+uint_str_length(const uint64_t value)
+{
+        size_t guess;
+
+        if (10 > value)
+                return 1;
+
+        // 1233/4096 is a bit more than log10(2), so the number of
+        // bits gives the number of digits give or take one
+        guess = ((64 - __builtin_clzll(value)) * 1233) >> 12;
+
+        return guess + ((value < powers_of_ten[guess]) ? 0 : 1);
+}
+
 void
 uint_to_str(const char terminator,
             uint64_t value,
             char **str)
 {
-        char *pos = *str;
-        int size = 0;
-
-        if (value >= 10000) {
-                if (value >= 10000000) {
-                        if (value >= 1000000000) {
-                                size = 10;
-                                if (value >= 10000000000) {
-                                        sprintf(*str, "%llu", value);
-                                        while ('\0' != **str)
-                                                ++(*str);
-                                        **str = terminator;
-                                        return;
-                                }
-                        } else if (value >= 100000000) {
-                                size = 9;
-                        } else {
-                                size = 8;
-                        }
-                } else {
-                        if (value >= 1000000) {
-                                size = 7;
-                        } else if (value >= 100000) {
-                                size = 6;
-                        } else {
-                                size = 5;
-                        }
-                }
-        } else {
-                if (value >= 100) {
-                        if (value >= 1000) {
-                                size = 4;
-                        } else {
-                                size = 3;
-                        }
-                } else {
-                        if (value >= 10) {
-                                size = 2;
-                        } else {
-                                size = 1;
-                        }
-                }
-        }
+        char *pos;
+        unsigned int pair;
 
-        *str += size;
+        *str += uint_str_length(value);
         pos = *str;
         *pos = terminator;
 
-        do {
-                *(--pos) = (char)('0' + (value % 10));
-        } while (value /= 10);
-
-        return;
+        while (100 <= value) {
+                pair = 2 * (unsigned int)(value % 100);
+                value /= 100;
+                pos -= 2;
+                memcpy(pos, &digit_pairs[pair], 2);
+        }
+        if (10 <= value) {
+                memcpy(pos - 2, &digit_pairs[2 * value], 2);
+        } else {
+                *(pos - 1) = (char)('0' + value);
+        }
 }
 
 int
@@ -108,7 +108,26 @@ get_fix_length_value(const char soh,
 
 
 /*
- * Optimized for integers less than 10.000.000.000.
+ * The two digits of the decimal numbers 0 to 99. The digits of n
+ * start at digit_pairs[2 * n].
+ */
+extern const char digit_pairs[201];
+
+/*
+ * powers_of_ten[n] is 10 to the power of n.
+ */
+extern const uint64_t powers_of_ten[20];
+
+/*
+ * Returns the number of decimal digits in value, which is 1 (one) for
+ * 0 (zero).
+ */
+extern size_t
+uint_str_length(const uint64_t value);
+
+/*
+ * Writes value in decimal followed by terminator. Room for
+ * uint_str_length(value) + 1 bytes is needed.
  *
  * Upon entry: *str points to the start of the memory which will be
  * written to.
@@ -117,7 +136,8 @@ get_fix_length_value(const char soh,
  *
  * Performance notes:
  *
- * This function is more han 6 times faster than the equivalent one
+ * The digits are written two at a time from a table, so this
+ * function is more than 6 times faster than the equivalent one
  * based on sprintf().
  */
 extern void
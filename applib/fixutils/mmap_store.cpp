@@ -0,0 +1,817 @@
+/*
+ *    Copyright (C) 2013, Jules Colding <jcolding@gmail.com>.
+ *
+ *    All Rights Reserved.
+ */
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     (1) Redistributions of source code must retain the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer.
+ *
+ *     (2) Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *
+ *     (3) Neither the name of the copyright holder nor the names of
+ *     its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written
+ *     permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS
+ * OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <inttypes.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <new>
+
+#ifdef HAVE_CONFIG_H
+    #include "ac_config.h"
+#endif
+#include "stdlib/log/log.h"
+#include "mmap_store.h"
+
+#ifndef MAP_ANONYMOUS
+    #define MAP_ANONYMOUS MAP_ANON
+#endif
+
+/*
+ * On-disk layout
+ * --------------
+ *
+ * Segment files are SEGMENT_SIZE bytes (larger if a single record
+ * does not fit) and hold 8 byte aligned records back to back:
+ *
+ *     struct mmap_record_t
+ *     msg_type including the terminating zero (sent messages only)
+ *     msg
+ *     padding
+ *
+ * The index file is an array of uint64_t. The first
+ * INDEX_HEADER_SLOTS slots hold the committed state of the log. Slot
+ * INDEX_HEADER_SLOTS + seqnum holds the location of the record with
+ * that sequence number as ((segment + 1) << 32) | (offset >> 3), or
+ * 0 (zero) if there is no such record. Slots are never trusted
+ * without checking that the record they point to is committed and
+ * carries the right sequence number.
+ *
+ * A commit syncs the new records, then the committed state and only
+ * then the index slots pointing to the new records. A slot therefore
+ * never points past the committed state on disk, and a sequence
+ * number stored again keeps its committed record until the new one
+ * is committed as well.
+ */
+#define SEGMENT_SIZE (16*1024*1024)
+#define INDEX_INITIAL_SIZE (64*1024) // bytes
+#define INDEX_HEADER_SLOTS (8)
+#define INDEX_MAGIC (0x58444958464d4d4dULL) // "MMMFXIDX"
+#define INDEX_VERSION (1)
+
+enum IndexHeaderSlot {
+        INDEX_MAGIC_SLOT,
+        INDEX_VERSION_SLOT,
+        INDEX_MAX_SEQNUM_SLOT,
+        INDEX_SEGMENT_COUNT_SLOT,
+        INDEX_WRITE_OFFSET_SLOT,
+};
+
+struct mmap_record_t {
+        uint32_t length;          // bytes in record including padding, 0 (zero) if none
+        uint32_t msg_type_length; // bytes in msg type including the terminating zero
+        uint64_t seqnum;
+        uint64_t tv_sec;          // time of storing
+        uint64_t tv_usec;
+        uint64_t ttl_tv_sec;
+        uint64_t ttl_tv_usec;
+        uint64_t msg_length;      // bytes in message
+};
+
+#define ALIGN8(x) (((x) + 7) & ~((uint64_t)7))
+
+static inline uint64_t
+page_size(void)
+{
+        static uint64_t size = 0;
+
+        if (!size)
+                size = (uint64_t)sysconf(_SC_PAGESIZE);
+
+        return size;
+}
+
+/*
+ * msync() the range [addr, addr + len). The start is rounded down to
+ * a page boundary as msync() requires.
+ */
+static int
+sync_range(void * const addr,
+           const uint64_t len)
+{
+        const uintptr_t start = (uintptr_t)addr & ~(uintptr_t)(page_size() - 1);
+
+        if (!len)
+                return 1;
+
+        if (msync((void*)start, (size_t)((uintptr_t)addr + len - start), MS_SYNC)) {
+                M_ALERT("msync failed: %s", strerror(errno));
+                return 0;
+        }
+
+        return 1;
+}
+
+/*
+ * Makes sure that fd refers to a file of at least size bytes with the
+ * blocks allocated, if possible.
+ */
+static int
+reserve_file(const int fd,
+             const uint64_t size)
+{
+#ifdef HAVE_POSIX_FALLOCATE
+        int ret = posix_fallocate(fd, 0, (off_t)size);
+
+        if (!ret)
+                return 1;
+        if (EINVAL != ret) {
+                M_ALERT("posix_fallocate failed: %s", strerror(ret));
+                return 0;
+        }
+        // not supported by the file system
+#endif
+        if (ftruncate(fd, (off_t)size)) {
+                M_ALERT("ftruncate failed: %s", strerror(errno));
+                return 0;
+        }
+
+        return 1;
+}
+
+static uint8_t*
+map_region(const int fd,
+           const uint64_t size)
+{
+        void *p;
+
+        if (-1 == fd)
+                p = mmap(NULL, (size_t)size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        else
+                p = mmap(NULL, (size_t)size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (MAP_FAILED == p) {
+                M_ALERT("mmap failed: %s", strerror(errno));
+                return NULL;
+        }
+
+        return (uint8_t*)p;
+}
+
+/*
+ * Maps segment number n of log, creating it with size bytes if it does
+ * not exist. size is ignored for existing segments.
+ */
+static int
+map_segment(struct mmap_log_t * const mlog,
+            const uint32_t n,
+            uint64_t size)
+{
+        struct mmap_segment_t *segments;
+        struct stat sbuf;
+        char *path = NULL;
+        int fd = -1;
+        int retv = 0;
+
+        segments = (struct mmap_segment_t*)realloc(mlog->segments, (n + 1) * sizeof(struct mmap_segment_t));
+        if (!segments) {
+                M_ALERT("no memory");
+                return 0;
+        }
+        mlog->segments = segments;
+
+        if (mlog->path) {
+                if (-1 == asprintf(&path, "%s.%04u", mlog->path, n)) {
+                        M_ALERT("no memory");
+                        path = NULL;
+                        goto out;
+                }
+                fd = ::open(path, O_RDWR | O_CREAT, 0644);
+                if (-1 == fd) {
+                        M_ALERT("could not open %s: %s", path, strerror(errno));
+                        goto out;
+                }
+                if (fstat(fd, &sbuf)) {
+                        M_ALERT("could not stat %s: %s", path, strerror(errno));
+                        goto out;
+                }
+                if ((uint64_t)sbuf.st_size)
+                        size = (uint64_t)sbuf.st_size;
+                else if (!reserve_file(fd, size))
+                        goto out;
+        }
+        mlog->segments[n].base = map_region(fd, size);
+        if (!mlog->segments[n].base)
+                goto out;
+        mlog->segments[n].size = size;
+
+        retv = 1;
+out:
+        if (-1 != fd)
+                ::close(fd);
+        free(path);
+
+        return retv;
+}
+
+/*
+ * Grows the index to hold at least slots slots.
+ */
+static int
+grow_index(struct mmap_log_t * const mlog,
+           const uint64_t slots)
+{
+        uint64_t size = mlog->index_size;
+        uint8_t *index;
+
+        while (size < slots * sizeof(uint64_t)) {
+                if (size > (UINT64_MAX >> 1)) {
+                        M_ALERT("index too large");
+                        return 0;
+                }
+                size <<= 1;
+        }
+
+        if (-1 != mlog->index_fd) {
+                if (!sync_range(mlog->index, mlog->index_size))
+                        return 0;
+                if (ftruncate(mlog->index_fd, (off_t)size)) {
+                        M_ALERT("ftruncate failed: %s", strerror(errno));
+                        return 0;
+                }
+        }
+        index = map_region(mlog->index_fd, size);
+        if (!index)
+                return 0;
+        if (-1 == mlog->index_fd)
+                memcpy(index, mlog->index, mlog->index_size);
+        munmap(mlog->index, mlog->index_size);
+        mlog->index = (uint64_t*)index;
+        mlog->index_size = size;
+
+        return 1;
+}
+
+static void
+close_log(struct mmap_log_t * const mlog)
+{
+        uint32_t n;
+
+        for (n = 0; n < mlog->segment_count; ++n)
+                munmap(mlog->segments[n].base, mlog->segments[n].size);
+        free(mlog->segments);
+        free(mlog->slot_updates);
+        if (mlog->index)
+                munmap(mlog->index, mlog->index_size);
+        if (-1 != mlog->index_fd)
+                ::close(mlog->index_fd);
+        free(mlog->path);
+        memset(mlog, 0, sizeof(struct mmap_log_t));
+        mlog->index_fd = -1;
+}
+
+/*
+ * path is NULL for an anonymous log.
+ */
+static int
+open_log(struct mmap_log_t * const mlog,
+         const char * const path,
+         const char * const direction)
+{
+        struct stat sbuf;
+        char *index_path = NULL;
+        uint32_t segment_count;
+        uint32_t n;
+        int retv = 0;
+
+        memset(mlog, 0, sizeof(struct mmap_log_t));
+        mlog->index_fd = -1;
+
+        if (path) {
+                if ((-1 == asprintf(&mlog->path, "%s.%s", path, direction))
+                    || (-1 == asprintf(&index_path, "%s.idx", mlog->path))) {
+                        M_ALERT("no memory");
+                        mlog->path = NULL;
+                        index_path = NULL;
+                        goto out;
+                }
+                mlog->index_fd = ::open(index_path, O_RDWR | O_CREAT, 0644);
+                if (-1 == mlog->index_fd) {
+                        M_ALERT("could not open %s: %s", index_path, strerror(errno));
+                        goto out;
+                }
+                if (fstat(mlog->index_fd, &sbuf)) {
+                        M_ALERT("could not stat %s: %s", index_path, strerror(errno));
+                        goto out;
+                }
+                mlog->index_size = (uint64_t)sbuf.st_size;
+                if (!mlog->index_size) {
+                        mlog->index_size = INDEX_INITIAL_SIZE;
+                        if (ftruncate(mlog->index_fd, (off_t)mlog->index_size)) {
+                                M_ALERT("ftruncate failed: %s", strerror(errno));
+                                goto out;
+                        }
+                } else if (mlog->index_size < INDEX_HEADER_SLOTS * sizeof(uint64_t)) {
+                        M_ALERT("%s is not a message index", index_path);
+                        goto out;
+                }
+        } else {
+                mlog->index_size = INDEX_INITIAL_SIZE;
+        }
+        mlog->index = (uint64_t*)map_region(mlog->index_fd, mlog->index_size);
+        if (!mlog->index)
+                goto out;
+
+        if (!mlog->index[INDEX_MAGIC_SLOT]) {
+                mlog->index[INDEX_MAGIC_SLOT] = INDEX_MAGIC;
+                mlog->index[INDEX_VERSION_SLOT] = INDEX_VERSION;
+        } else if ((INDEX_MAGIC != mlog->index[INDEX_MAGIC_SLOT]) || (INDEX_VERSION != mlog->index[INDEX_VERSION_SLOT])) {
+                M_ALERT("%s is not a message index", index_path);
+                goto out;
+        }
+
+        // recover the committed state, anything beyond is lost
+        segment_count = (uint32_t)mlog->index[INDEX_SEGMENT_COUNT_SLOT];
+        for (n = 0; n < segment_count; ++n) {
+                if (!map_segment(mlog, n, SEGMENT_SIZE))
+                        goto out;
+                ++mlog->segment_count;
+        }
+        mlog->write_offset = mlog->index[INDEX_WRITE_OFFSET_SLOT];
+        mlog->max_seqnum = mlog->index[INDEX_MAX_SEQNUM_SLOT];
+        if (segment_count && (mlog->write_offset > mlog->segments[segment_count - 1].size)) {
+                M_ALERT("%s is corrupt", index_path);
+                goto out;
+        }
+        mlog->sync_segment = segment_count ? segment_count - 1 : 0;
+        mlog->sync_offset = mlog->write_offset;
+
+        retv = 1;
+out:
+        free(index_path);
+        if (!retv)
+                close_log(mlog);
+
+        return retv;
+}
+
+/*
+ * Writes everything appended since the last sync to disk followed by
+ * the new committed state and then the index slots of the appended
+ * records, please see the on-disk layout above.
+ */
+static int
+sync_log(struct mmap_log_t * const mlog)
+{
+        uint64_t lo = UINT64_MAX;
+        uint64_t hi = 0;
+        uint64_t slot;
+        uint64_t k;
+        uint32_t n;
+        uint64_t start;
+        uint64_t end;
+
+        if (-1 == mlog->index_fd)
+                goto commit;
+
+        for (n = mlog->sync_segment; n < mlog->segment_count; ++n) {
+                start = (n == mlog->sync_segment) ? mlog->sync_offset : 0;
+                end = (n == mlog->segment_count - 1) ? mlog->write_offset : mlog->segments[n].size;
+                if ((end > start) && !sync_range(mlog->segments[n].base + start, end - start))
+                        return 0;
+        }
+
+commit:
+        mlog->index[INDEX_MAX_SEQNUM_SLOT] = mlog->max_seqnum;
+        mlog->index[INDEX_SEGMENT_COUNT_SLOT] = mlog->segment_count;
+        mlog->index[INDEX_WRITE_OFFSET_SLOT] = mlog->write_offset;
+        if ((-1 != mlog->index_fd) && !sync_range(mlog->index, INDEX_HEADER_SLOTS * sizeof(uint64_t)))
+                return 0;
+        mlog->sync_segment = mlog->segment_count ? mlog->segment_count - 1 : 0;
+        mlog->sync_offset = mlog->write_offset;
+
+        // in the order written, so the latest record of a sequence
+        // number wins
+        for (k = 0; k < mlog->slot_update_count; ++k) {
+                slot = mlog->slot_updates[k].slot;
+                mlog->index[slot] = mlog->slot_updates[k].location;
+                if (slot < lo)
+                        lo = slot;
+                if (slot > hi)
+                        hi = slot;
+        }
+        mlog->slot_update_count = 0;
+        if ((-1 != mlog->index_fd) && (lo <= hi)) {
+                if (!sync_range(&mlog->index[lo], (hi - lo + 1) * sizeof(uint64_t)))
+                        return 0;
+        }
+
+        return 1;
+}
+
+static int
+append_record(struct mmap_log_t * const mlog,
+              const uint64_t seqnum,
+              const uint64_t tv_sec,
+              const uint64_t tv_usec,
+              const uint64_t ttl_tv_sec,
+              const uint64_t ttl_tv_usec,
+              const uint64_t len,
+              const uint8_t * const msg,
+              const char * const msg_type)
+{
+        const uint64_t msg_type_length = msg_type ? strlen(msg_type) + 1 : 0;
+        const uint64_t length = ALIGN8(sizeof(struct mmap_record_t) + msg_type_length + len);
+        const uint64_t slot = INDEX_HEADER_SLOTS + seqnum;
+        struct mmap_slot_update_t *slot_updates;
+        struct mmap_record_t *rec;
+        uint8_t *p;
+        uint64_t size;
+
+        if ((length > UINT32_MAX) || (seqnum >= (UINT64_MAX / sizeof(uint64_t)) - INDEX_HEADER_SLOTS)) {
+                M_ALERT("message %" PRIu64 " is too large to be stored", seqnum);
+                return 0;
+        }
+
+        if (!mlog->segment_count || (mlog->write_offset + length > mlog->segments[mlog->segment_count - 1].size)) {
+                size = SEGMENT_SIZE;
+                if (size < length)
+                        size = (length + page_size() - 1) & ~(page_size() - 1);
+                if (!map_segment(mlog, mlog->segment_count, size))
+                        return 0;
+                ++mlog->segment_count;
+                mlog->write_offset = 0;
+        }
+        if ((slot + 1) * sizeof(uint64_t) > mlog->index_size) {
+                if (!grow_index(mlog, slot + 1))
+                        return 0;
+        }
+        if (mlog->slot_update_count == mlog->slot_update_size) {
+                size = mlog->slot_update_size ? 2 * mlog->slot_update_size : 64;
+                slot_updates = (struct mmap_slot_update_t*)realloc(mlog->slot_updates, size * sizeof(struct mmap_slot_update_t));
+                if (!slot_updates) {
+                        M_ALERT("no memory");
+                        return 0;
+                }
+                mlog->slot_updates = slot_updates;
+                mlog->slot_update_size = size;
+        }
+
+        p = mlog->segments[mlog->segment_count - 1].base + mlog->write_offset;
+        rec = (struct mmap_record_t*)p;
+        rec->msg_type_length = (uint32_t)msg_type_length;
+        rec->seqnum = seqnum;
+        rec->tv_sec = tv_sec;
+        rec->tv_usec = tv_usec;
+        rec->ttl_tv_sec = ttl_tv_sec;
+        rec->ttl_tv_usec = ttl_tv_usec;
+        rec->msg_length = len;
+        p += sizeof(struct mmap_record_t);
+        memcpy(p, msg_type, msg_type_length);
+        memcpy(p + msg_type_length, msg, len);
+        rec->length = (uint32_t)length;
+
+        // the slot is updated by sync_log()
+        mlog->slot_updates[mlog->slot_update_count].slot = slot;
+        mlog->slot_updates[mlog->slot_update_count].location = ((uint64_t)mlog->segment_count << 32) | (mlog->write_offset >> 3);
+        ++mlog->slot_update_count;
+        mlog->write_offset += length;
+        if (seqnum > mlog->max_seqnum)
+                mlog->max_seqnum = seqnum;
+
+        return 1;
+}
+
+/*
+ * Returns the record with sequence number seqnum or NULL if there is
+ * no such record.
+ */
+static const struct mmap_record_t*
+find_record(const struct mmap_log_t * const mlog,
+            const uint64_t seqnum)
+{
+        const uint64_t slot = INDEX_HEADER_SLOTS + seqnum;
+        const struct mmap_record_t *rec;
+        uint64_t location;
+        uint64_t segment;
+        uint64_t offset;
+
+        if ((slot + 1) * sizeof(uint64_t) > mlog->index_size)
+                return NULL;
+        location = mlog->index[slot];
+        if (!location)
+                return NULL;
+
+        segment = (location >> 32) - 1;
+        offset = (location & 0xffffffff) << 3;
+        if (segment >= mlog->segment_count)
+                return NULL;
+        if ((segment == mlog->segment_count - 1) && (offset >= mlog->write_offset))
+                return NULL;
+        if (offset + sizeof(struct mmap_record_t) > mlog->segments[segment].size)
+                return NULL;
+
+        rec = (const struct mmap_record_t*)(mlog->segments[segment].base + offset);
+        if ((rec->seqnum != seqnum)
+            || (offset + rec->length > mlog->segments[segment].size)
+            || (sizeof(struct mmap_record_t) + rec->msg_type_length + rec->msg_length > rec->length))
+                return NULL;
+
+        return rec;
+}
+
+int
+MmapStore::open(const char * const path)
+{
+        const int anonymous = (!path || !*path || !strcmp(path, ":memory:"));
+
+        if (is_open_)
+                return 1;
+
+        if (!open_log(&sent_, anonymous ? NULL : path, "sent"))
+                return 0;
+        if (!open_log(&recv_, anonymous ? NULL : path, "recv")) {
+                close_log(&sent_);
+                return 0;
+        }
+        is_open_ = 1;
+
+        return 1;
+}
+
+int
+MmapStore::close(void)
+{
+        int retv = 1;
+
+        if (!is_open_)
+                return 1;
+
+        if (!commit_transaction())
+                retv = 0;
+        close_log(&sent_);
+        close_log(&recv_);
+        is_open_ = 0;
+
+        return retv;
+}
+
+int
+MmapStore::begin_transaction(void)
+{
+        // records are invisible after a restart until committed
+        return is_open_;
+}
+
+int
+MmapStore::commit_transaction(void)
+{
+        int retv;
+
+        if (!is_open_)
+                return 0;
+
+        guard_.enter();
+        retv = sync_log(&sent_) && sync_log(&recv_);
+        guard_.leave();
+
+        return retv;
+}
+
+int
+MmapStore::write_sent_msg(const uint64_t seqnum,
+                          const uint64_t tv_sec,
+                          const uint64_t tv_usec,
+                          const uint64_t ttl_tv_sec,
+                          const uint64_t ttl_tv_usec,
+                          const uint64_t len,
+                          const uint8_t * const msg,
+                          const char * const msg_type)
+{
+        int retv;
+
+        if (!is_open_)
+                return 0;
+
+        guard_.enter();
+        retv = append_record(&sent_, seqnum, tv_sec, tv_usec, ttl_tv_sec, ttl_tv_usec, len, msg, msg_type);
+        guard_.leave();
+
+        return retv;
+}
+
+int
+MmapStore::write_recv_msg(const uint64_t seqnum,
+                          const uint64_t tv_sec,
+                          const uint64_t tv_usec,
+                          const uint64_t len,
+                          const uint8_t * const msg)
+{
+        int retv;
+
+        if (!is_open_)
+                return 0;
+
+        guard_.enter();
+        retv = append_record(&recv_, seqnum, tv_sec, tv_usec, 0, 0, len, msg, NULL);
+        guard_.leave();
+
+        return retv;
+}
+
+int
+MmapStore::get_latest_recv_seqnum(uint64_t & seqnum)
+{
+        if (!is_open_)
+                return 0;
+
+        guard_.enter();
+        seqnum = recv_.max_seqnum;
+        guard_.leave();
+
+        return 1;
+}
+
+int
+MmapStore::get_latest_sent_seqnum(uint64_t & seqnum)
+{
+        if (!is_open_)
+                return 0;
+
+        guard_.enter();
+        seqnum = sent_.max_seqnum;
+        guard_.leave();
+
+        return 1;
+}
+
+PartialMessageList*
+MmapStore::get_sent_msgs(uint64_t start,
+                         uint64_t end)
+{
+        PartialMessageList *retv = NULL;
+        PartialMessage *pmsg = NULL;
+        const struct mmap_record_t *rec;
+        const uint8_t *data;
+        uint64_t n;
+
+        if (!is_open_)
+                return NULL;
+
+        retv = new (std::nothrow) PartialMessageList;
+        if (!retv) {
+                M_ALERT("no memory");
+                return NULL;
+        }
+
+        guard_.enter();
+        if (!end || (end > sent_.max_seqnum))
+                end = sent_.max_seqnum;
+        for (n = start; n <= end; ++n) {
+                rec = find_record(&sent_, n);
+                if (!rec)
+                        continue;
+
+                pmsg = new (std::nothrow) PartialMessage;
+                if (!pmsg)
+                        goto err;
+
+                if (is_ttl_expired((time_t)rec->ttl_tv_sec, (suseconds_t)rec->ttl_tv_usec, pmsg->ttl)) {
+                        retv->push_back(pmsg);
+                        continue;
+                }
+
+                data = (const uint8_t*)rec + sizeof(struct mmap_record_t);
+                pmsg->msg_type = strndup((const char*)data, rec->msg_type_length);
+                pmsg->length = (uint32_t)rec->msg_length;
+                pmsg->part_msg = (uint8_t*)malloc(pmsg->length + 5); // "+ 5" is to avoid realloc when inserting "43=Y<SOH>"
+                if (!pmsg->msg_type || !pmsg->part_msg) {
+                        delete pmsg;
+                        goto err;
+                }
+                memcpy(pmsg->part_msg, data + rec->msg_type_length, pmsg->length);
+
+                retv->push_back(pmsg);
+                pmsg = NULL;
+        }
+        guard_.leave();
+
+        return retv;
+
+err:
+        guard_.leave();
+        M_ALERT("no memory");
+        delete retv;
+
+        return NULL;
+}
+
+int
+MmapStore::get_sent_msgs_chunk(uint64_t & start,
+                               const uint64_t end,
+                               const size_t max_count,
+                               SentMsgChunk & chunk)
+{
+        struct timeval remaining_ttl;
+        const struct mmap_record_t *rec;
+        const uint8_t *data;
+        uint64_t last;
+        int retv = 1;
+
+        chunk.clear();
+        if (!is_open_)
+                return 0;
+
+        guard_.enter();
+        last = (!end || (end > sent_.max_seqnum)) ? sent_.max_seqnum : end;
+        for (; (start <= last) && (chunk.size() < max_count); ++start) {
+                rec = find_record(&sent_, start);
+                if (!rec)
+                        continue;
+
+                if (is_ttl_expired((time_t)rec->ttl_tv_sec, (suseconds_t)rec->ttl_tv_usec, remaining_ttl)) {
+                        retv = chunk.append_expired(start);
+                } else {
+                        data = (const uint8_t*)rec + sizeof(struct mmap_record_t);
+                        retv = chunk.append(start, (const char*)data, rec->msg_length, data + rec->msg_type_length);
+                }
+                if (!retv) {
+                        M_ALERT("no memory");
+                        break;
+                }
+        }
+        guard_.leave();
+
+        return retv;
+}
+
+std::vector<std::vector<uint8_t> >*
+MmapStore::get_recv_msgs(uint64_t start,
+                         uint64_t end)
+{
+        std::vector<std::vector<uint8_t> > *retv = NULL;
+        const struct mmap_record_t *rec;
+        const uint8_t *data;
+        uint64_t n;
+
+        if (!is_open_)
+                return NULL;
+
+        retv = new (std::nothrow) std::vector<std::vector<uint8_t> >;
+        if (!retv) {
+                M_ALERT("no memory");
+                return NULL;
+        }
+
+        guard_.enter();
+        if (!end || (end > recv_.max_seqnum))
+                end = recv_.max_seqnum;
+        try {
+                for (n = start; n <= end; ++n) {
+                        rec = find_record(&recv_, n);
+                        if (!rec)
+                                continue;
+                        data = (const uint8_t*)rec + sizeof(struct mmap_record_t) + rec->msg_type_length;
+                        retv->push_back(std::vector<uint8_t>(data, data + rec->msg_length));
+                }
+        }
+        catch (...) {
+                M_ALERT("no memory");
+                delete retv;
+                retv = NULL;
+        }
+        guard_.leave();
+
+        return retv;
+}
@@ -0,0 +1,165 @@
+/*
+ *    Copyright (C) 2013, Jules Colding <jcolding@gmail.com>.
+ *
+ *    All Rights Reserved.
+ */
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     (1) Redistributions of source code must retain the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer.
+ *
+ *     (2) Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *
+ *     (3) Neither the name of the copyright holder nor the names of
+ *     its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written
+ *     permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS
+ * OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <inttypes.h>
+#include <vector>
+
+#ifdef HAVE_CONFIG_H
+    #include "ac_config.h"
+#endif
+#include "stdlib/locks/guard.h"
+#include "msg_store.h"
+
+/*
+ * One append-only message log. Records are appended to a sequence of
+ * pre-allocated, memory mapped segment files named
+ * "<path>.<direction>.NNNN". A dense index file,
+ * "<path>.<direction>.idx", maps sequence numbers to the location of
+ * the latest record with that sequence number. The first slots of the
+ * index hold the committed state of the log.
+ *
+ * Please see mmap_store.cpp for the on-disk layout.
+ */
+struct mmap_segment_t {
+        uint8_t *base;
+        uint64_t size;
+};
+
+struct mmap_slot_update_t {
+        uint64_t slot;
+        uint64_t location;
+};
+
+struct mmap_log_t {
+        char *path;                       // "<path>.<direction>" or NULL if anonymous
+        int index_fd;                     // -1 if anonymous
+        uint64_t *index;                  // the mapped index
+        uint64_t index_size;              // bytes mapped
+        struct mmap_segment_t *segments;
+        uint32_t segment_count;           // the last segment is the one being appended to
+        uint64_t write_offset;            // first free byte in the last segment
+        uint64_t max_seqnum;
+        uint32_t sync_segment;            // first segment holding unsynced records
+        uint64_t sync_offset;             // first unsynced byte in sync_segment
+        struct mmap_slot_update_t *slot_updates; // index updates waiting for the next commit
+        uint64_t slot_update_count;
+        uint64_t slot_update_size;        // entries allocated
+};
+
+/*
+ * Stores messages in two append-only, memory mapped logs; one for
+ * sent messages and one for recieved messages. Writing a message is a
+ * memcpy() into the mapping plus an index update. Locating a sequence
+ * number is a single index lookup.
+ *
+ * commit_transaction() msync()'s everything written since the last
+ * commit and then the committed state. Records written after the last
+ * commit are discarded if the process dies. Index slots are only
+ * updated by commit_transaction(), so a record is not found before it
+ * is committed and a committed record is never replaced by one which
+ * is not.
+ *
+ * The path given to open() is the prefix of the log files. The
+ * special paths ":memory:" and "" (empty string) give an anonymous
+ * store which is lost when closed.
+ */
+class MmapStore : public MsgStore
+{
+public:
+        MmapStore(void)
+		: is_open_(0)
+                {
+                        memset(&sent_, 0, sizeof(sent_));
+                        memset(&recv_, 0, sizeof(recv_));
+                };
+
+        ~MmapStore()
+                {
+                        this->close();
+                };
+
+        int open(const char * const path);
+
+        int close(void);
+
+        int begin_transaction(void);
+
+        int commit_transaction(void);
+
+        int write_sent_msg(const uint64_t seqnum,
+                           const uint64_t tv_sec,
+                           const uint64_t tv_usec,
+                           const uint64_t ttl_tv_sec,
+                           const uint64_t ttl_tv_usec,
+                           const uint64_t len,
+                           const uint8_t * const msg,
+                           const char * const msg_type);
+
+        int write_recv_msg(const uint64_t seqnum,
+                           const uint64_t tv_sec,
+                           const uint64_t tv_usec,
+                           const uint64_t len,
+                           const uint8_t * const msg);
+
+        int get_latest_recv_seqnum(uint64_t & seqnum);
+
+        int get_latest_sent_seqnum(uint64_t & seqnum);
+
+        /*
+         * Sequence numbers not in the store are skipped.
+         */
+        PartialMessageList *get_sent_msgs(uint64_t start, uint64_t end);
+
+        int get_sent_msgs_chunk(uint64_t & start,
+                                const uint64_t end,
+                                const size_t max_count,
+                                SentMsgChunk & chunk);
+
+        std::vector<std::vector<uint8_t> > *get_recv_msgs(uint64_t start, uint64_t end);
+
+private:
+        int is_open_;
+        struct mmap_log_t sent_;
+        struct mmap_log_t recv_;
+
+        // guards growth of the mappings against readers
+        MutexGuard guard_;
+};
@@ -0,0 +1,384 @@
+/*
+ *    Copyright (C) 2013, Jules Colding <jcolding@gmail.com>.
+ *
+ *    All Rights Reserved.
+ */
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     (1) Redistributions of source code must retain the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer.
+ *
+ *     (2) Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *
+ *     (3) Neither the name of the copyright holder nor the names of
+ *     its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written
+ *     permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS
+ * OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <vector>
+
+#ifdef HAVE_CONFIG_H
+    #include "ac_config.h"
+#endif
+
+class PartialMessage {
+public:
+	PartialMessage() 
+		: length(0), 
+		  msg_type(NULL),
+		  part_msg(NULL),
+		  ttl{0,0}
+		{
+		};
+
+	~PartialMessage()
+		{
+			free(msg_type);
+			free(part_msg);
+		};
+
+	uint32_t length;
+	char *msg_type;
+	uint8_t *part_msg;
+	struct timeval ttl;
+};
+
+class PartialMessageList {
+public:
+	~PartialMessageList()
+		{
+			unsigned int n;
+
+			for (n = 0; n < list_.size(); ++n)
+				delete list_[n];
+		};
+
+	size_t size(void) const
+		{
+			return list_.size();
+		};
+
+	void push_back(PartialMessage *pmsg)
+		{
+			list_.push_back(pmsg);
+		};
+
+	/*
+	 * Returns message number n. If the message in question has
+	 * exceeded its time to live, then a NULL will be
+	 * returned. NULL will also be returned if n >= size().
+	 */ 
+	PartialMessage *get_at(const unsigned int n)
+		{
+			if (n > (list_.size() - 1))
+				return NULL;
+
+			return list_[n];
+		};
+
+private:
+	std::vector<PartialMessage*> list_;
+};
+
+/*
+ * A chunk of sent messages in ascending sequence number order as read
+ * by MsgDB::get_sent_msgs_chunk(). The memory of the chunk is reused
+ * from chunk to chunk, so streaming through a range of any size only
+ * costs the memory of the largest chunk.
+ *
+ * Messages which have exceeded their time to live are included as
+ * expired (is_expired() is 1 (one)) but without content.
+ */
+class SentMsgChunk {
+public:
+	SentMsgChunk()
+		: data_(NULL),
+		  allocated_size_(0),
+		  used_(0)
+		{
+		};
+
+	~SentMsgChunk()
+		{
+			free(data_);
+		};
+
+	void clear(void)
+		{
+			used_ = 0;
+			entries_.clear();
+		};
+
+	size_t size(void) const
+		{
+			return entries_.size();
+		};
+
+	/*
+	 * Appends a copy of the message. msg_type is zero terminated.
+	 *
+	 * Returns 1 (one) if all is well, 0 (zero) if not.
+	 */
+	int append(const uint64_t seqnum,
+		   const char * const msg_type,
+		   const uint64_t length,
+		   const uint8_t * const part_msg)
+		{
+			struct entry_t entry;
+			const size_t msg_type_length = strlen(msg_type) + 1;
+
+			if (!reserve(msg_type_length + length))
+				return 0;
+			entry.seqnum = seqnum;
+			entry.length = length;
+			entry.offset = used_;
+			memcpy(data_ + used_, msg_type, msg_type_length);
+			memcpy(data_ + used_ + msg_type_length, part_msg, length);
+			used_ += msg_type_length + length;
+			try {
+				entries_.push_back(entry);
+			}
+			catch (...) {
+				return 0;
+			}
+
+			return 1;
+		};
+
+	int append_expired(const uint64_t seqnum)
+		{
+			struct entry_t entry = { seqnum, 0, EXPIRED };
+
+			try {
+				entries_.push_back(entry);
+			}
+			catch (...) {
+				return 0;
+			}
+
+			return 1;
+		};
+
+	uint64_t seqnum(const size_t n) const
+		{
+			return entries_[n].seqnum;
+		};
+
+	int is_expired(const size_t n) const
+		{
+			return (EXPIRED == entries_[n].offset);
+		};
+
+	const char *msg_type(const size_t n) const
+		{
+			return (const char*)data_ + entries_[n].offset;
+		};
+
+	uint64_t length(const size_t n) const
+		{
+			return entries_[n].length;
+		};
+
+	/*
+	 * The partial message may be modified in-situ.
+	 */
+	uint8_t *part_msg(const size_t n)
+		{
+			return data_ + entries_[n].offset + strlen(msg_type(n)) + 1;
+		};
+
+private:
+	static const size_t EXPIRED = SIZE_MAX;
+
+	struct entry_t {
+		uint64_t seqnum;
+		uint64_t length;
+		size_t offset; // of msg type in data_, EXPIRED if expired
+	};
+
+	int reserve(const size_t bytes)
+		{
+			uint8_t *tmp;
+			size_t size = allocated_size_ ? allocated_size_ : 4096;
+
+			if (used_ + bytes <= allocated_size_)
+				return 1;
+			while (size < used_ + bytes)
+				size *= 2;
+			tmp = (uint8_t*)realloc(data_, size);
+			if (!tmp)
+				return 0;
+			data_ = tmp;
+			allocated_size_ = size;
+
+			return 1;
+		};
+
+	uint8_t *data_;
+	size_t allocated_size_;
+	size_t used_;
+	std::vector<struct entry_t> entries_;
+};
+
+/*
+ * result = x - y. Subtract the `struct timeval' values X and Y,
+ * storing the result in result.
+ */
+static inline int
+timeval_subtract(struct timeval * const result, 
+		 struct timeval * const x, 
+		 struct timeval * const y)
+{
+	int nsec;
+
+	// Perform the carry for the later subtraction by updating y
+	if (x->tv_usec < y->tv_usec) {
+		nsec = (y->tv_usec - x->tv_usec) / 1000000 + 1;
+		y->tv_usec -= 1000000 * nsec;
+		y->tv_sec += nsec;
+	}
+	if (x->tv_usec - y->tv_usec > 1000000) {
+		nsec = (x->tv_usec - y->tv_usec) / 1000000;
+		y->tv_usec += 1000000 * nsec;
+		y->tv_sec -= nsec;
+	}
+     
+	// Compute the time remaining to wait. tv_usec is certainly
+	// positive
+	result->tv_sec = x->tv_sec - y->tv_sec;
+	result->tv_usec = x->tv_usec - y->tv_usec;
+
+	// Return 1 if result is negative
+	return (x->tv_sec < y->tv_sec);
+}
+
+/*
+ * Returns 1 (one) if now os greater than ttl, 0 (zero) otherwise.
+ */
+static inline int
+is_ttl_expired(const time_t ttl_tv_sec,
+               const suseconds_t ttl_tv_usec,
+	       struct timeval & remaining_ttl)
+{
+        struct timeval ttl = { ttl_tv_sec, ttl_tv_usec };
+        struct timeval now;
+
+        gettimeofday(&now, NULL);
+	if (timeval_subtract(&remaining_ttl, &ttl, &now)) {
+		remaining_ttl.tv_sec = 0;
+		remaining_ttl.tv_usec = 0;
+	}
+
+	return (!remaining_ttl.tv_sec && !remaining_ttl.tv_usec);
+}
+
+/*
+ * Service contract for the storage backends of MsgDB.
+ *
+ * All methods are called with the database open except open()
+ * itself. The write and transaction methods are only called by the
+ * journal thread of MsgDB. The read methods may be called from any
+ * thread, but never concurrently with each other.
+ *
+ * Please see MsgDB for the semantics of the individual methods.
+ */
+class MsgStore
+{
+public:
+        virtual ~MsgStore()
+                {
+                };
+
+        /*
+         * path is the location of the store. Its interpretation is
+         * up to the backend.
+         *
+         * Returns 1 (one) if all is well, 0 (zero) if not.
+         */
+        virtual int open(const char * const path) = 0;
+
+        /*
+         * Returns 1 (one) if all is well, 0 (zero) if not.
+         */
+        virtual int close(void) = 0;
+
+        /*
+         * Everything written between begin_transaction() and
+         * commit_transaction() must be durable once
+         * commit_transaction() returns.
+         *
+         * Returns 1 (one) if all is well, 0 (zero) if not.
+         */
+        virtual int begin_transaction(void) = 0;
+        virtual int commit_transaction(void) = 0;
+
+        /*
+         * A message written with a sequence number already in the
+         * store replaces the previous one.
+         *
+         * Returns 1 (one) if all is well, 0 (zero) if not.
+         */
+        virtual int write_sent_msg(const uint64_t seqnum,
+                                   const uint64_t tv_sec,
+                                   const uint64_t tv_usec,
+                                   const uint64_t ttl_tv_sec,
+                                   const uint64_t ttl_tv_usec,
+                                   const uint64_t len,
+                                   const uint8_t * const msg,
+                                   const char * const msg_type) = 0;
+
+        virtual int write_recv_msg(const uint64_t seqnum,
+                                   const uint64_t tv_sec,
+                                   const uint64_t tv_usec,
+                                   const uint64_t len,
+                                   const uint8_t * const msg) = 0;
+
+        /*
+         * Returns 1 (one) if all is well, 0 (zero) if not.
+         */
+        virtual int get_latest_recv_seqnum(uint64_t & seqnum) = 0;
+        virtual int get_latest_sent_seqnum(uint64_t & seqnum) = 0;
+
+        /*
+         * Returns NULL on error.
+         */
+        virtual PartialMessageList *get_sent_msgs(uint64_t start, uint64_t end) = 0;
+
+        /*
+         * Returns 1 (one) if all is well, 0 (zero) if not.
+         */
+        virtual int get_sent_msgs_chunk(uint64_t & start,
+                                        const uint64_t end,
+                                        const size_t max_count,
+                                        SentMsgChunk & chunk) = 0;
+        virtual std::vector<std::vector<uint8_t> > *get_recv_msgs(uint64_t start, uint64_t end) = 0;
+};
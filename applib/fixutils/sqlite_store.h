@@ -0,0 +1,135 @@
+/*
+ *    Copyright (C) 2013, Jules Colding <jcolding@gmail.com>.
+ *
+ *    All Rights Reserved.
+ */
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     (1) Redistributions of source code must retain the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer.
+ *
+ *     (2) Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *
+ *     (3) Neither the name of the copyright holder nor the names of
+ *     its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written
+ *     permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS
+ * OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <inttypes.h>
+#include <vector>
+
+#ifdef HAVE_CONFIG_H
+    #include "ac_config.h"
+#endif
+#include "stdlib/locks/guard.h"
+#include "stdlib/local_db/sqlite3.h"
+#include "msg_store.h"
+
+/*
+ * Stores messages in the SQLite tables SENT_MESSAGES and
+ * RECV_MESSAGES. The path given to open() is the path of the
+ * database file. Please see FIX_Pusher::start() for the special
+ * paths recognized by SQLite.
+ */
+class SQLiteStore : public MsgStore
+{
+public:
+        SQLiteStore(void)
+		: db_(NULL),
+		  insert_recv_msg_statement_(NULL),
+		  insert_sent_msg_statement_(NULL),
+		  max_recv_seqnum_statement_(NULL),
+		  max_sent_seqnum_statement_(NULL),
+		  select_sent_msgs_statement_(NULL),
+		  begin_statement_(NULL),
+		  commit_statement_(NULL)
+                {
+                };
+
+        ~SQLiteStore()
+                {
+                        this->close();
+                };
+
+        int open(const char * const path);
+
+        int close(void);
+
+        int begin_transaction(void);
+
+        int commit_transaction(void);
+
+        int write_sent_msg(const uint64_t seqnum,
+                           const uint64_t tv_sec,
+                           const uint64_t tv_usec,
+                           const uint64_t ttl_tv_sec,
+                           const uint64_t ttl_tv_usec,
+                           const uint64_t len,
+                           const uint8_t * const msg,
+                           const char * const msg_type);
+
+        int write_recv_msg(const uint64_t seqnum,
+                           const uint64_t tv_sec,
+                           const uint64_t tv_usec,
+                           const uint64_t len,
+                           const uint8_t * const msg);
+
+        int get_latest_recv_seqnum(uint64_t & seqnum);
+
+        int get_latest_sent_seqnum(uint64_t & seqnum);
+
+        /*
+         * This method is not performance critical (re-sending is a
+         * fairly rare occurrence) and the implementation reflects
+         * that.
+         */
+        PartialMessageList *get_sent_msgs(uint64_t start, uint64_t end);
+
+        int get_sent_msgs_chunk(uint64_t & start,
+                                const uint64_t end,
+                                const size_t max_count,
+                                SentMsgChunk & chunk);
+
+        /*
+         * Not implemented yet. Always returns NULL.
+         */
+        std::vector<std::vector<uint8_t> > *get_recv_msgs(uint64_t start, uint64_t end);
+
+private:
+        sqlite3 *db_;
+        sqlite3_stmt *insert_recv_msg_statement_;
+        sqlite3_stmt *insert_sent_msg_statement_;
+        sqlite3_stmt *max_recv_seqnum_statement_;
+        sqlite3_stmt *max_sent_seqnum_statement_;
+        sqlite3_stmt *select_sent_msgs_statement_;
+        sqlite3_stmt *begin_statement_;
+        sqlite3_stmt *commit_statement_;
+
+        // serializes the journal thread and readers on the connection
+        // and its prepared statements
+        MutexGuard guard_;
+};
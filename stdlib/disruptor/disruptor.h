@@ -43,9 +43,16 @@
 #include "disruptor_types.h"
 
 #include <limits.h>
+#include <sched.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
+#include <sys/mman.h>
+#ifdef __linux__
+    #include <linux/futex.h>
+    #include <sys/syscall.h>
+#endif
 #ifdef HAVE_CONFIG_H
     #include "ac_config.h"
 #endif
@@ -65,14 +72,110 @@
 #define UNLIKELY__(expr__) (__builtin_expect(((expr__) ? 1 : 0), 0))
 
 /*
- * Cacheline padded timeout value.
- * Not intended for use elsewhere.
+ * Sets the strategy. The default timeout of the kind is used if
+ * timeout is NULL.
+ */
+static inline void
+wait_strategy_set(struct wait_strategy_t * const strategy,
+                  const enum wait_strategy_kind_t kind,
+                  const unsigned int spin_count,
+                  const struct timespec * const timeout)
+{
+        strategy->spin_count = spin_count;
+        if (timeout) {
+                strategy->timeout = *timeout;
+        } else {
+                strategy->timeout.tv_sec = 0;
+                strategy->timeout.tv_nsec = (WAIT_SPIN_PARK == kind) ? WAIT_DEFAULT_PARK_NSEC : WAIT_DEFAULT_SLEEP_NSEC;
+        }
+        __atomic_store_n(&strategy->kind, (int)kind, __ATOMIC_RELEASE);
+}
+
+static inline void
+wait_strategy_init(struct wait_strategy_t * const strategy,
+                   const enum wait_strategy_kind_t kind)
+{
+        memset((void*)strategy, 0, sizeof(struct wait_strategy_t));
+        wait_strategy_set(strategy, kind, WAIT_DEFAULT_SPIN_COUNT, NULL);
+}
+
+static inline void
+cpu_relax__(void)
+{
+#if defined(__i386__) || defined(__x86_64__)
+        __builtin_ia32_pause();
+#elif defined(__aarch64__)
+        __asm__ __volatile__("yield" ::: "memory");
+#else
+        __asm__ __volatile__("" ::: "memory");
+#endif
+}
+
+/*
+ * Waits once according to strategy. *polls counts the polls done so
+ * far and must be zero when starting to wait for something new.
+ *
+ * If sequence is not NULL the calling thread may park until *sequence
+ * is at least wanted. Strategies other than WAIT_SPIN_PARK ignore
+ * sequence and wanted.
+ */
+static inline void
+wait_strategy_wait(struct wait_strategy_t * const strategy,
+                   unsigned int * const polls,
+                   const uint_fast64_t * const sequence,
+                   const uint_fast64_t wanted)
+{
+        const int kind = __atomic_load_n(&strategy->kind, __ATOMIC_RELAXED);
+#ifdef __linux__
+        uint32_t epoch;
+#endif
+
+        if (WAIT_SLEEP == kind) {
+                nanosleep(&strategy->timeout, NULL);
+                return;
+        }
+        if ((WAIT_BUSY_SPIN == kind) || (*polls < strategy->spin_count)) {
+                ++*polls;
+                cpu_relax__();
+                return;
+        }
+        if (WAIT_SPIN_YIELD == kind) {
+                sched_yield();
+                return;
+        }
+#ifdef __linux__
+        if (sequence) {
+                epoch = __atomic_load_n(&strategy->epoch, __ATOMIC_ACQUIRE);
+                __atomic_fetch_add(&strategy->waiters, 1, __ATOMIC_SEQ_CST);
+                if (__atomic_load_n(sequence, __ATOMIC_SEQ_CST) < wanted)
+                        syscall(SYS_futex, &strategy->epoch, FUTEX_WAIT_PRIVATE, epoch, &strategy->timeout, NULL, 0);
+                __atomic_fetch_sub(&strategy->waiters, 1, __ATOMIC_RELEASE);
+                return;
+        }
+#endif
+        nanosleep(&strategy->timeout, NULL);
+}
+
+/*
+ * Wakes threads parked by wait_strategy_wait(). Must be called by
+ * publishers after committing.
  */
-struct yield_t__ {
-        struct timespec timeout;
-        uint8_t padding[(CACHE_LINE_SIZE > sizeof(struct timespec)) ? (CACHE_LINE_SIZE - sizeof(struct timespec)) : (sizeof(struct timespec) % CACHE_LINE_SIZE)];
-} __attribute__((aligned(CACHE_LINE_SIZE)));
-static const struct yield_t__ timeout__ = { {0, 1}, { 0 } };
+static inline void
+wait_strategy_signal(struct wait_strategy_t * const strategy)
+{
+#ifdef __linux__
+        if (LIKELY__(WAIT_SPIN_PARK != __atomic_load_n(&strategy->kind, __ATOMIC_RELAXED)))
+                return;
+
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        if (!__atomic_load_n(&strategy->waiters, __ATOMIC_RELAXED))
+                return;
+        __atomic_fetch_add(&strategy->epoch, 1, __ATOMIC_RELEASE);
+        syscall(SYS_futex, &strategy->epoch, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+#else
+        (void)strategy;
+#endif
+}
 
 /*
  * An entry processor cursor spot that has this value is not used and
@@ -105,6 +208,7 @@ static const struct yield_t__ timeout__ = { {0, 1}, { 0 } };
             struct cursor_t max_read_cursor;                                                                              \
             struct cursor_t write_cursor;                                                                                 \
             struct cursor_t entry_processor_cursors[entry_processor_capacity__];                                          \
+            struct wait_strategy_t wait_strategy;                                                                         \
             struct entry_type_name__ buffer[entry_capacity__];                                                            \
     } __attribute__((aligned(PAGE_SIZE)))
 
@@ -120,6 +224,116 @@ ring_buffer_prefix__ ## ring_buffer_malloc(void)
         return (posix_memalign((void**)&retv, PAGE_SIZE, sizeof(struct ring_buffer_type_name__)) ? NULL : retv); \
 }
 
+/*
+ * Returns the number of bytes mapped for a ring buffer of size bytes
+ * allocated with flags.
+ */
+static inline size_t
+ring_mem_length(const size_t size,
+                const int flags)
+{
+        const size_t page = (flags & RING_MEM_HUGE_PAGES) ? RING_MEM_HUGE_PAGE_SIZE : PAGE_SIZE;
+
+        return (size + page - 1) & ~(page - 1);
+}
+
+/*
+ * Maps size bytes of ring buffer memory according to flags, please
+ * see enum ring_mem_flags_t. The flags that could be honored are
+ * returned in *granted. Returns NULL if out of memory.
+ *
+ * The memory must be released by ring_mem_unmap() with the same size
+ * and flags.
+ */
+static inline void*
+ring_mem_map(const size_t size,
+             const int flags,
+             int * const granted)
+{
+        const size_t length = ring_mem_length(size, flags);
+        uint8_t *retv = (uint8_t*)MAP_FAILED;
+        uint8_t *aligned;
+        size_t head;
+        size_t off;
+
+        *granted = 0;
+#ifdef MAP_HUGETLB
+        if (flags & RING_MEM_HUGE_PAGES) {
+                int huge_flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB;
+#ifdef MAP_HUGE_2MB
+                huge_flags |= MAP_HUGE_2MB;
+#endif
+                retv = (uint8_t*)mmap(NULL, length, PROT_READ | PROT_WRITE, huge_flags, -1, 0);
+                if (MAP_FAILED != retv)
+                        *granted |= RING_MEM_HUGE_PAGES;
+        }
+#endif
+        if (MAP_FAILED == retv) {
+                if (flags & RING_MEM_HUGE_PAGES) {
+                        // transparent huge pages need huge page aligned memory
+                        retv = (uint8_t*)mmap(NULL, length + RING_MEM_HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+                        if (MAP_FAILED == retv)
+                                return NULL;
+                        aligned = (uint8_t*)(((uintptr_t)retv + RING_MEM_HUGE_PAGE_SIZE - 1) & ~((uintptr_t)RING_MEM_HUGE_PAGE_SIZE - 1));
+                        head = aligned - retv;
+                        if (head)
+                                munmap(retv, head);
+                        munmap(aligned + length, RING_MEM_HUGE_PAGE_SIZE - head);
+                        retv = aligned;
+#ifdef MADV_HUGEPAGE
+                        if (!madvise(retv, length, MADV_HUGEPAGE))
+                                *granted |= RING_MEM_HUGE_PAGES;
+#endif
+                } else {
+                        retv = (uint8_t*)mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+                        if (MAP_FAILED == retv)
+                                return NULL;
+                }
+        }
+
+        if (flags & RING_MEM_PREFAULT) {
+                for (off = 0; off < length; off += PAGE_SIZE)
+                        ((volatile uint8_t*)retv)[off] = 0;
+                *granted |= RING_MEM_PREFAULT;
+        }
+        if ((flags & RING_MEM_LOCK) && !mlock(retv, length))
+                *granted |= RING_MEM_LOCK;
+
+        return retv;
+}
+
+static inline void
+ring_mem_unmap(void * const mem,
+               const size_t size,
+               const int flags)
+{
+        if (mem)
+                munmap(mem, ring_mem_length(size, flags));
+}
+
+/*
+ * These functions map and unmap a ring buffer by ring_mem_map() and
+ * ring_mem_unmap() as an alternative to
+ * <prefix>ring_buffer_malloc(). The ring buffer must be unmapped
+ * with the flags it was mapped with.
+ */
+#define DEFINE_RING_BUFFER_MAP(ring_buffer_type_name__, ring_buffer_prefix__...)                  \
+static struct ring_buffer_type_name__ *                                                           \
+ring_buffer_prefix__ ## ring_buffer_map(const int flags,                                          \
+                                        int * const granted)                                      \
+{                                                                                                 \
+        return (struct ring_buffer_type_name__*)ring_mem_map(sizeof(struct ring_buffer_type_name__), \
+                                                             flags,                               \
+                                                             granted);                            \
+}                                                                                                 \
+                                                                                                  \
+static inline void                                                                                \
+ring_buffer_prefix__ ## ring_buffer_unmap(struct ring_buffer_type_name__ * const ring_buffer,     \
+                                          const int flags)                                        \
+{                                                                                                 \
+        ring_mem_unmap(ring_buffer, sizeof(struct ring_buffer_type_name__), flags);               \
+}
+
 /*
  * This function must always be invoked on a ring buffer before it is
  * put into use.
@@ -133,9 +347,25 @@ ring_buffer_prefix__ ## ring_buffer_init(struct ring_buffer_type_name__ * const
         memset((void*)ring_buffer, 0, sizeof(struct ring_buffer_type_name__));                      \
         for (n = 0; n < sizeof(ring_buffer->entry_processor_cursors)/sizeof(struct cursor_t); ++n)  \
                 ring_buffer->entry_processor_cursors[n].sequence = VACANT__;                        \
+        wait_strategy_init(&ring_buffer->wait_strategy, DISRUPTOR_DEFAULT_WAIT_STRATEGY);          \
         __atomic_store_n(&ring_buffer->reduced_size.count, entry_capacity__ - 1, __ATOMIC_SEQ_CST); \
 }
 
+/*
+ * Selects the wait strategy of the ring buffer. Please see
+ * wait_strategy_set(). Should not be called while the ring buffer
+ * is in use.
+ */
+#define DEFINE_RING_BUFFER_SET_WAIT_STRATEGY_FUNCTION(ring_buffer_type_name__, ring_buffer_prefix__...)       \
+static inline void                                                                                            \
+ring_buffer_prefix__ ## ring_buffer_set_wait_strategy(struct ring_buffer_type_name__ * const ring_buffer,     \
+                                                      const enum wait_strategy_kind_t kind,                   \
+                                                      const unsigned int spin_count,                          \
+                                                      const struct timespec * const timeout)                  \
+{                                                                                                             \
+        wait_strategy_set(&ring_buffer->wait_strategy, kind, spin_count, timeout);                            \
+}
+
 /*
  * This function returns a const pointer to an entry in the ring
  * buffer.
@@ -231,10 +461,12 @@ static inline void
 ring_buffer_prefix__ ## entry_processor_barrier_wait_for_blocking(const struct ring_buffer_type_name__ * const ring_buffer,   \
                                                                   struct cursor_t * __restrict__ const cursor)                \
 {                                                                                                                             \
+        unsigned int polls = 0;                                                                                               \
         const struct cursor_t incur = { cursor->sequence, { 0 } };                                                            \
                                                                                                                               \
         while (incur.sequence > __atomic_load_n(&ring_buffer->max_read_cursor.sequence, __ATOMIC_RELAXED))                    \
-                nanosleep(&timeout__.timeout, NULL);                                                                          \
+                wait_strategy_wait((struct wait_strategy_t*)&ring_buffer->wait_strategy, &polls,                              \
+                                   &ring_buffer->max_read_cursor.sequence, incur.sequence);                                   \
                                                                                                                               \
         cursor->sequence = __atomic_load_n(&ring_buffer->max_read_cursor.sequence, __ATOMIC_ACQUIRE);                         \
 }
@@ -287,6 +519,7 @@ ring_buffer_prefix__ ## publisher_next_entry_blocking(struct ring_buffer_type_na
                                                            struct cursor_t * __restrict__ const cursor)                            \
 {                                                                                                                                  \
         unsigned int n;                                                                                                            \
+        unsigned int polls = 0;                                                                                                    \
         struct cursor_t seq;                                                                                                       \
         struct cursor_t slowest_reader;                                                                                            \
         const struct cursor_t incur = { 1 + __atomic_fetch_add(&ring_buffer->write_cursor.sequence, 1, __ATOMIC_RELAXED), { 0 } }; \
@@ -304,7 +537,7 @@ ring_buffer_prefix__ ## publisher_next_entry_blocking(struct ring_buffer_type_na
                 __atomic_store_n(&ring_buffer->slowest_entry_processor.sequence, slowest_reader.sequence, __ATOMIC_RELAXED);       \
                 if (LIKELY__((incur.sequence - slowest_reader.sequence) <= ring_buffer->reduced_size.count))                       \
                         return;                                                                                                    \
-                nanosleep(&timeout__.timeout, NULL);                                                                               \
+                wait_strategy_wait(&ring_buffer->wait_strategy, &polls, NULL, 0);                                                  \
         } while (1);                                                                                                               \
 }
 
@@ -340,6 +573,82 @@ ring_buffer_prefix__ ## publisher_next_entry_nonblocking(struct ring_buffer_type
         return 0;                                                                                                                                           \
 }
 
+/*
+ * Batch version of the blocking next entry function. Claims count
+ * consecutive entries, first to last both included, in one go. count
+ * must be at least one and no larger than the capacity of the ring
+ * buffer.
+ *
+ * The entries must be committed as one by
+ * publisher_commit_entries_blocking() or
+ * publisher_commit_entries_nonblocking().
+ */
+#define DEFINE_ENTRY_PUBLISHER_NEXTENTRIES_BLOCKING_FUNCTION(ring_buffer_type_name__, ring_buffer_prefix__...)                               \
+static inline void                                                                                                                           \
+ring_buffer_prefix__ ## publisher_next_entries_blocking(struct ring_buffer_type_name__ * const ring_buffer,                                  \
+                                                        const uint_fast64_t count,                                                           \
+                                                        struct cursor_t * __restrict__ const first,                                          \
+                                                        struct cursor_t * __restrict__ const last)                                           \
+{                                                                                                                                            \
+        unsigned int n;                                                                                                                      \
+        unsigned int polls = 0;                                                                                                              \
+        struct cursor_t seq;                                                                                                                 \
+        struct cursor_t slowest_reader;                                                                                                      \
+        const struct cursor_t incur = { count + __atomic_fetch_add(&ring_buffer->write_cursor.sequence, count, __ATOMIC_RELAXED), { 0 } }; \
+                                                                                                                                             \
+        first->sequence = incur.sequence - count + 1;                                                                                        \
+        last->sequence = incur.sequence;                                                                                                     \
+        do {                                                                                                                                 \
+                slowest_reader.sequence = VACANT__;                                                                                          \
+                for (n = 0; n < sizeof(ring_buffer->entry_processor_cursors)/sizeof(struct cursor_t); ++n) {                                 \
+                        seq.sequence = __atomic_load_n(&ring_buffer->entry_processor_cursors[n].sequence, __ATOMIC_RELAXED);                 \
+                        if (seq.sequence < slowest_reader.sequence)                                                                          \
+                                slowest_reader.sequence = seq.sequence;                                                                      \
+                }                                                                                                                            \
+                if (UNLIKELY__(VACANT__ == slowest_reader.sequence))                                                                         \
+                        slowest_reader.sequence = incur.sequence - (ring_buffer->reduced_size.count & incur.sequence);                       \
+                __atomic_store_n(&ring_buffer->slowest_entry_processor.sequence, slowest_reader.sequence, __ATOMIC_RELAXED);                 \
+                if (LIKELY__((incur.sequence - slowest_reader.sequence) <= ring_buffer->reduced_size.count))                                 \
+                        return;                                                                                                              \
+                wait_strategy_wait(&ring_buffer->wait_strategy, &polls, NULL, 0);                                                            \
+        } while (1);                                                                                                                         \
+}
+
+/*
+ * Like the blocking version. Returns 1 (one) if count new entries
+ * were claimed, 0 (zero) otherwise.
+ */
+#define DEFINE_ENTRY_PUBLISHER_NEXTENTRIES_NONBLOCKING_FUNCTION(ring_buffer_type_name__, ring_buffer_prefix__...)                                          \
+static inline int                                                                                                                                          \
+ring_buffer_prefix__ ## publisher_next_entries_nonblocking(struct ring_buffer_type_name__ * const ring_buffer,                                             \
+                                                           const uint_fast64_t count,                                                                      \
+                                                           struct cursor_t * __restrict__ const first,                                                     \
+                                                           struct cursor_t * __restrict__ const last)                                                      \
+{                                                                                                                                                          \
+        unsigned int n;                                                                                                                                    \
+        struct cursor_t seq;                                                                                                                               \
+        struct cursor_t slowest_reader;                                                                                                                    \
+        const struct cursor_t incur = { count + __atomic_load_n(&ring_buffer->write_cursor.sequence, __ATOMIC_RELAXED), { 0 } };                           \
+                                                                                                                                                           \
+        first->sequence = incur.sequence - count + 1;                                                                                                      \
+        last->sequence = incur.sequence;                                                                                                                   \
+        slowest_reader.sequence = VACANT__;                                                                                                                \
+        for (n = 0; n < sizeof(ring_buffer->entry_processor_cursors)/sizeof(struct cursor_t); ++n) {                                                       \
+                seq.sequence = __atomic_load_n(&ring_buffer->entry_processor_cursors[n].sequence, __ATOMIC_RELAXED);                                       \
+                if (seq.sequence < slowest_reader.sequence)                                                                                                \
+                        slowest_reader.sequence = seq.sequence;                                                                                            \
+        }                                                                                                                                                  \
+        if (UNLIKELY__(VACANT__ == slowest_reader.sequence))                                                                                               \
+                slowest_reader.sequence = incur.sequence - (ring_buffer->reduced_size.count & incur.sequence);                                             \
+        __atomic_store_n(&ring_buffer->slowest_entry_processor.sequence, slowest_reader.sequence, __ATOMIC_RELAXED);                                       \
+        if (LIKELY__((incur.sequence - slowest_reader.sequence) <= ring_buffer->reduced_size.count)) {                                                     \
+                seq.sequence = first->sequence - 1;                                                                                                        \
+                if (__atomic_compare_exchange_n(&ring_buffer->write_cursor.sequence, &seq.sequence, incur.sequence, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) \
+                        return 1;                                                                                                                          \
+        }                                                                                                                                                  \
+        return 0;                                                                                                                                          \
+}
+
 /*
  * Entry Publishers must call this function to commit the entry to the
  * entry processors. Blocks until the entry has been committed.
@@ -349,12 +658,14 @@ static inline __attribute__((always_inline)) void
 ring_buffer_prefix__ ## publisher_commit_entry_blocking(struct ring_buffer_type_name__ * const ring_buffer,         \
                                                              const struct cursor_t * __restrict__ const cursor)     \
 {                                                                                                                   \
+        unsigned int polls = 0;                                                                                     \
         const uint_fast64_t required_read_sequence = cursor->sequence - 1;                                          \
                                                                                                                     \
         while (__atomic_load_n(&ring_buffer->max_read_cursor.sequence, __ATOMIC_RELAXED) != required_read_sequence) \
-                nanosleep(&timeout__.timeout, NULL);                                                                \
+                wait_strategy_wait(&ring_buffer->wait_strategy, &polls, NULL, 0);                                   \
                                                                                                                     \
         __atomic_fetch_add(&ring_buffer->max_read_cursor.sequence, 1, __ATOMIC_RELEASE);                            \
+        wait_strategy_signal(&ring_buffer->wait_strategy);                                                          \
 }
 
 /*
@@ -373,6 +684,49 @@ ring_buffer_prefix__ ## publisher_commit_entry_nonblocking(struct ring_buffer_ty
                 return 0;                                                                                             \
                                                                                                                       \
         __atomic_fetch_add(&ring_buffer->max_read_cursor.sequence, 1, __ATOMIC_RELEASE);                              \
+        wait_strategy_signal(&ring_buffer->wait_strategy);                                                            \
+                                                                                                                      \
+        return 1;                                                                                                     \
+}
+
+/*
+ * Commits the entries first to last, both included, to the entry
+ * processors in one go. Entry processors see either none or all of
+ * them. Blocks until the entries have been committed.
+ */
+#define DEFINE_ENTRY_PUBLISHER_COMMITENTRIES_BLOCKING_FUNCTION(ring_buffer_type_name__, ring_buffer_prefix__...)    \
+static inline void                                                                                                  \
+ring_buffer_prefix__ ## publisher_commit_entries_blocking(struct ring_buffer_type_name__ * const ring_buffer,       \
+                                                          const struct cursor_t * __restrict__ const first,         \
+                                                          const struct cursor_t * __restrict__ const last)          \
+{                                                                                                                   \
+        unsigned int polls = 0;                                                                                     \
+        const uint_fast64_t required_read_sequence = first->sequence - 1;                                           \
+                                                                                                                    \
+        while (__atomic_load_n(&ring_buffer->max_read_cursor.sequence, __ATOMIC_RELAXED) != required_read_sequence) \
+                wait_strategy_wait(&ring_buffer->wait_strategy, &polls, NULL, 0);                                   \
+                                                                                                                    \
+        __atomic_store_n(&ring_buffer->max_read_cursor.sequence, last->sequence, __ATOMIC_RELEASE);                 \
+        wait_strategy_signal(&ring_buffer->wait_strategy);                                                          \
+}
+
+/*
+ * Like the blocking version. Returns 1 (one) if the entries have
+ * been commited, 0 (zero) otherwise.
+ */
+#define DEFINE_ENTRY_PUBLISHER_COMMITENTRIES_NONBLOCKING_FUNCTION(ring_buffer_type_name__, ring_buffer_prefix__...)   \
+static inline int                                                                                                     \
+ring_buffer_prefix__ ## publisher_commit_entries_nonblocking(struct ring_buffer_type_name__ * const ring_buffer,     \
+                                                             const struct cursor_t * __restrict__ const first,        \
+                                                             const struct cursor_t * __restrict__ const last)         \
+{                                                                                                                     \
+        const uint_fast64_t required_read_sequence = first->sequence - 1;                                             \
+                                                                                                                      \
+        if (__atomic_load_n(&ring_buffer->max_read_cursor.sequence, __ATOMIC_RELAXED) != required_read_sequence)      \
+                return 0;                                                                                             \
+                                                                                                                      \
+        __atomic_store_n(&ring_buffer->max_read_cursor.sequence, last->sequence, __ATOMIC_RELEASE);                   \
+        wait_strategy_signal(&ring_buffer->wait_strategy);                                                            \
                                                                                                                       \
         return 1;                                                                                                     \
 }
@@ -41,6 +41,7 @@
 #define DISRUPTORC_TYPES_H
 
 #include <inttypes.h>
+#include <time.h>
 
 #ifdef HAVE_CONFIG_H
     #include "ac_config.h"
@@ -63,4 +64,83 @@ struct cursor_t {
         uint8_t padding[(CACHE_LINE_SIZE > sizeof(uint_fast64_t)) ? (CACHE_LINE_SIZE - sizeof(uint_fast64_t)) : (sizeof(uint_fast64_t) % CACHE_LINE_SIZE)];
 } __attribute__((aligned(CACHE_LINE_SIZE)));
 
+/*
+ * Wait strategies. They decide what a thread does between polls when
+ * waiting for a ring buffer:
+ *
+ * WAIT_SLEEP      - nanosleep() for the strategy timeout between
+ *                   polls. The default with a timeout of 1 ns, which
+ *                   really is however short the kernel will sleep.
+ *
+ * WAIT_BUSY_SPIN  - Spin with a pause instruction. Lowest latency, but
+ *                   burns a core. Only for threads on dedicated cores.
+ *
+ * WAIT_SPIN_YIELD - Spin spin_count polls, then sched_yield() between
+ *                   polls.
+ *
+ * WAIT_SPIN_PARK  - Spin spin_count polls, then park on a futex until
+ *                   woken by a publisher committing an entry or the
+ *                   strategy timeout expires. Publishers only pay for
+ *                   the wakeup when somebody is parked. Waits that
+ *                   can not be woken, i.e. publishers waiting for
+ *                   entry processors, sleep for the timeout instead of
+ *                   parking. Linux only, WAIT_SLEEP elsewhere.
+ *
+ * DISRUPTOR_DEFAULT_WAIT_STRATEGY may be defined to select the
+ * strategy ring buffers are initialized with. Each ring buffer may
+ * furthermore be given its own strategy by
+ * <prefix>ring_buffer_set_wait_strategy().
+ */
+enum wait_strategy_kind_t {
+        WAIT_SLEEP,
+        WAIT_BUSY_SPIN,
+        WAIT_SPIN_YIELD,
+        WAIT_SPIN_PARK,
+};
+
+#ifndef DISRUPTOR_DEFAULT_WAIT_STRATEGY
+#define DISRUPTOR_DEFAULT_WAIT_STRATEGY (WAIT_SLEEP)
+#endif
+
+#define WAIT_DEFAULT_SPIN_COUNT (10000)       // polls before yielding or parking
+#define WAIT_DEFAULT_SLEEP_NSEC (1)           // WAIT_SLEEP timeout
+#define WAIT_DEFAULT_PARK_NSEC (100*1000)     // WAIT_SPIN_PARK timeout
+
+/*
+ * Ring buffer memory flags for <prefix>ring_buffer_map():
+ *
+ * RING_MEM_HUGE_PAGES - Back the ring buffer by huge pages. Explicit
+ *                       huge pages (MAP_HUGETLB) are tried first, then
+ *                       transparent huge pages. Ordinary pages are used
+ *                       if neither is available.
+ *
+ * RING_MEM_PREFAULT   - Touch every page of the ring buffer when it is
+ *                       mapped so that it is not faulted in by the
+ *                       first burst of traffic.
+ *
+ * RING_MEM_LOCK       - mlock() the ring buffer. Left unlocked if
+ *                       RLIMIT_MEMLOCK does not allow it.
+ */
+enum ring_mem_flags_t {
+        RING_MEM_HUGE_PAGES = 0x1,
+        RING_MEM_PREFAULT   = 0x2,
+        RING_MEM_LOCK       = 0x4,
+};
+
+#define RING_MEM_HUGE_PAGE_SIZE (2*1024*1024) // the huge page size tried
+
+/*
+ * Cacheline padded wait strategy. epoch and waiters are only written
+ * when parking so the cacheline is read-only for all other
+ * strategies.
+ */
+struct wait_strategy_t {
+        int kind;                // enum wait_strategy_kind_t
+        unsigned int spin_count; // polls before yielding or parking
+        struct timespec timeout; // sleep or maximum park time
+        uint32_t epoch;          // futex word, bumped by publishers waking parked threads
+        uint32_t waiters;        // number of parked threads
+        uint8_t padding[(CACHE_LINE_SIZE > 2*sizeof(int) + sizeof(struct timespec) + 2*sizeof(uint32_t)) ? (CACHE_LINE_SIZE - (2*sizeof(int) + sizeof(struct timespec) + 2*sizeof(uint32_t))) : 0];
+} __attribute__((aligned(CACHE_LINE_SIZE)));
+
 #endif //  DISRUPTORC_TYPES_H
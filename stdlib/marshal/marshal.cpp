@@ -93,27 +93,27 @@ vmarshal_size(const char *format,
                         break;
                 case 'b':
                         ub = (uint8_t)va_arg(ap, int);
-                        retv += 8;
+                        retv += sizeof(uint8_t);
                         break;
                 case 'w':
                         uw = (uint16_t)va_arg(ap, int);
-                        retv += 16;
+                        retv += sizeof(uint16_t);
                         break;
                 case 'l':
                         ul = va_arg(ap, uint32_t);
-                        retv += 32;
+                        retv += sizeof(uint32_t);
                         break;
                 case 'L':
                         ull = va_arg(ap, uint64_t);
-                        retv += 64;
+                        retv += sizeof(uint64_t);
                         break;
                 case 'f':
                         f = va_arg(ap, double);
-                        retv += 32;
+                        retv += sizeof(uint32_t);
                         break;
                 case 'F':
                         f = va_arg(ap, double);
-                        retv += 64;
+                        retv += sizeof(uint64_t);
                         break;
                 default:
                         goto exit;
@@ -192,7 +192,7 @@ vmarshal(uint8_t * const buf,
                         memcpy((void*)pos, (const void*)s, inc);
                         break;
                 case 'b':
-                        inc = 8;
+                        inc = sizeof(uint8_t);
                         if (len < *count + inc) {
                                 M_DEBUG("Error marshalling");
                                 return false;
@@ -206,7 +206,7 @@ vmarshal(uint8_t * const buf,
                         }
                         break;
                 case 'w':
-                        inc = 16;
+                        inc = sizeof(uint16_t);
                         if (len < *count + inc) {
                                 M_DEBUG("Error marshalling");
                                 return false;
@@ -220,7 +220,7 @@ vmarshal(uint8_t * const buf,
                         }
                         break;
                 case 'l':
-                        inc = 32;
+                        inc = sizeof(uint32_t);
                         if (len < *count + inc) {
                                 M_DEBUG("Error marshalling");
                                 return false;
@@ -234,7 +234,7 @@ vmarshal(uint8_t * const buf,
                         }
                         break;
                 case 'L':
-                        inc = 64;
+                        inc = sizeof(uint64_t);
                         if (len < *count + inc) {
                                 M_DEBUG("Error marshalling");
                                 return false;
@@ -248,7 +248,7 @@ vmarshal(uint8_t * const buf,
                         }
                         break;
                 case 'f':
-                        inc = 32;
+                        inc = sizeof(uint32_t);
                         if (len < *count + inc) {
                                 M_DEBUG("Error marshalling");
                                 return false;
@@ -258,7 +258,7 @@ vmarshal(uint8_t * const buf,
                         setu32(pos, ul);
                         break;
                 case 'F':
-                        inc = 64;
+                        inc = sizeof(uint64_t);
                         if (len < *count + inc) {
                                 M_DEBUG("Error marshalling");
                                 return false;
@@ -349,7 +349,7 @@ vunmarshal(const uint8_t * const buf,
                         retv++;
                         break;
                 case 'b':
-                        cnt += 8;
+                        cnt += sizeof(uint8_t);
                         if (un_signed) {
                                 ub = (uint8_t*)va_arg(ap, uint8_t*);
                                 *ub = *pos;
@@ -360,7 +360,7 @@ vunmarshal(const uint8_t * const buf,
                         retv++;
                         break;
                 case 'w':
-                        cnt += 16;
+                        cnt += sizeof(uint16_t);
                         if (un_signed) {
                                 uw = (uint16_t*)va_arg(ap, uint16_t*);
                                 *uw = getu16(pos);
@@ -371,7 +371,7 @@ vunmarshal(const uint8_t * const buf,
                         retv++;
                         break;
                 case 'l':
-                        cnt += 32;
+                        cnt += sizeof(uint32_t);
                         if (un_signed) {
                                 ul = va_arg(ap, uint32_t*);
                                 *ul = getu32(pos);
@@ -382,7 +382,7 @@ vunmarshal(const uint8_t * const buf,
                         retv++;
                         break;
                 case 'L':
-                        cnt += 64;
+                        cnt += sizeof(uint64_t);
                         if (un_signed) {
                                 ull = va_arg(ap, uint64_t*);
                                 *ull = getu64(pos);
@@ -393,14 +393,14 @@ vunmarshal(const uint8_t * const buf,
                         retv++;
                         break;
                 case 'f':
-                        cnt += 32;
+                        cnt += sizeof(uint32_t);
                         f = va_arg(ap, double*);
                         n32 = getu32(pos);
                         *f = unpack754_32(n32);
                         retv++;
                         break;
                 case 'F':
-                        cnt += 64;
+                        cnt += sizeof(uint64_t);
                         f = va_arg(ap, double*);
                         n64 = getu64(pos);
                         *f = unpack754_64(n64);
@@ -0,0 +1,241 @@
+/*
+ *    Copyright (C) 2013, Jules Colding <jcolding@gmail.com>.
+ *
+ *    All Rights Reserved.
+ */
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 
+ *     (1) Redistributions of source code must retain the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer.
+ * 
+ *     (2) Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *     
+ *     (3) Neither the name of the copyright holder nor the names of
+ *     its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written
+ *     permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS
+ * OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifdef HAVE_CONFIG_H
+    #include "ac_config.h"
+#endif
+
+#ifdef HAVE_LINUX_IO_URING_H
+
+#include <errno.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include "stdlib/log/log.h"
+#include "uring.h"
+
+/*
+ * How long an SQPOLL kernel thread keeps polling an idle submission
+ * queue before it goes to sleep.
+ */
+#define URING_SQ_THREAD_IDLE_MS (1000)
+
+static inline int
+sys_io_uring_setup(const unsigned int entries,
+                   struct io_uring_params * const params)
+{
+        return (int)syscall(__NR_io_uring_setup, entries, params);
+}
+
+static inline int
+sys_io_uring_enter(const int fd,
+                   const unsigned int to_submit,
+                   const unsigned int min_complete,
+                   const unsigned int flags,
+                   const void * const arg,
+                   const size_t argsz)
+{
+        return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, arg, argsz);
+}
+
+int
+uring_init(struct uring_t * const ring,
+           const unsigned int entries,
+           const int sqpoll)
+{
+        int err;
+        unsigned int n;
+        unsigned int *sq_array;
+        struct io_uring_params params;
+
+        memset(ring, 0, sizeof(*ring));
+        memset(&params, 0, sizeof(params));
+        if (sqpoll) {
+                params.flags = IORING_SETUP_SQPOLL;
+                params.sq_thread_idle = URING_SQ_THREAD_IDLE_MS;
+        }
+
+        ring->fd = sys_io_uring_setup(entries, &params);
+        if (0 > ring->fd) {
+                err = errno;
+                M_WARNING("io_uring_setup() failed: %s", strerror(err));
+                return err;
+        }
+        ring->sqpoll = sqpoll;
+
+        // completion waits with a timeout need IORING_ENTER_EXT_ARG
+        if (!(params.features & IORING_FEAT_EXT_ARG)) {
+                M_WARNING("io_uring lacks IORING_FEAT_EXT_ARG");
+                err = ENOSYS;
+                goto err;
+        }
+
+        ring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+        ring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+        if (params.features & IORING_FEAT_SINGLE_MMAP) {
+                if (ring->cq_ring_size > ring->sq_ring_size)
+                        ring->sq_ring_size = ring->cq_ring_size;
+                ring->cq_ring_size = ring->sq_ring_size;
+        }
+
+        ring->sq_ring = mmap(NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+        if (MAP_FAILED == ring->sq_ring) {
+                err = errno;
+                ring->sq_ring = NULL;
+                M_ERROR("could not map submission queue: %s", strerror(err));
+                goto err;
+        }
+        if (params.features & IORING_FEAT_SINGLE_MMAP) {
+                ring->cq_ring = ring->sq_ring;
+        } else {
+                ring->cq_ring = mmap(NULL, ring->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+                if (MAP_FAILED == ring->cq_ring) {
+                        err = errno;
+                        ring->cq_ring = NULL;
+                        M_ERROR("could not map completion queue: %s", strerror(err));
+                        goto err;
+                }
+        }
+        ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+        ring->sqes = (struct io_uring_sqe*)mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+        if (MAP_FAILED == ring->sqes) {
+                err = errno;
+                ring->sqes = NULL;
+                M_ERROR("could not map submission queue entries: %s", strerror(err));
+                goto err;
+        }
+
+        ring->sq_head = (unsigned int*)((uint8_t*)ring->sq_ring + params.sq_off.head);
+        ring->sq_tail = (unsigned int*)((uint8_t*)ring->sq_ring + params.sq_off.tail);
+        ring->sq_flags = (unsigned int*)((uint8_t*)ring->sq_ring + params.sq_off.flags);
+        ring->sq_mask = *(unsigned int*)((uint8_t*)ring->sq_ring + params.sq_off.ring_mask);
+        ring->sq_entries = params.sq_entries;
+        ring->cq_head = (unsigned int*)((uint8_t*)ring->cq_ring + params.cq_off.head);
+        ring->cq_tail = (unsigned int*)((uint8_t*)ring->cq_ring + params.cq_off.tail);
+        ring->cq_mask = *(unsigned int*)((uint8_t*)ring->cq_ring + params.cq_off.ring_mask);
+        ring->cqes = (struct io_uring_cqe*)((uint8_t*)ring->cq_ring + params.cq_off.cqes);
+
+        // submission queue entries are used in ring order
+        sq_array = (unsigned int*)((uint8_t*)ring->sq_ring + params.sq_off.array);
+        for (n = 0; n < ring->sq_entries; ++n)
+                sq_array[n] = n;
+
+        return 0;
+err:
+        uring_destroy(ring);
+
+        return err;
+}
+
+void
+uring_destroy(struct uring_t * const ring)
+{
+        if (ring->sqes)
+                munmap(ring->sqes, ring->sqes_size);
+        if (ring->cq_ring && (ring->cq_ring != ring->sq_ring))
+                munmap(ring->cq_ring, ring->cq_ring_size);
+        if (ring->sq_ring)
+                munmap(ring->sq_ring, ring->sq_ring_size);
+        if (0 <= ring->fd)
+                close(ring->fd);
+
+        memset(ring, 0, sizeof(*ring));
+        ring->fd = -1;
+}
+
+int
+uring_submit(struct uring_t * const ring,
+             const int wait,
+             const struct timespec * const timeout)
+{
+        int rval;
+        unsigned int flags = 0;
+        unsigned int to_submit;
+        struct io_uring_getevents_arg arg;
+        struct __kernel_timespec ts;
+
+        if (ring->sqe_tail != ring->sqe_head) {
+                __atomic_store_n(ring->sq_tail, ring->sqe_tail, __ATOMIC_RELEASE);
+                ring->sqe_head = ring->sqe_tail;
+        }
+
+        // everything the kernel has not consumed, including entries
+        // left over by an earlier EBUSY or EAGAIN
+        to_submit = ring->sqe_tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+
+        if (ring->sqpoll) {
+                // the kernel thread submits, it only needs waking up
+                // if it has gone idle
+                to_submit = 0;
+                __atomic_thread_fence(__ATOMIC_SEQ_CST);
+                if (__atomic_load_n(ring->sq_flags, __ATOMIC_RELAXED) & IORING_SQ_NEED_WAKEUP)
+                        flags |= IORING_ENTER_SQ_WAKEUP;
+        }
+        if (wait) {
+                if (uring_peek_cqe(ring) && !to_submit && !flags)
+                        return 0;
+                flags |= IORING_ENTER_GETEVENTS;
+        }
+        if (!to_submit && !flags)
+                return 0;
+
+        memset(&arg, 0, sizeof(arg));
+        if (timeout) {
+                ts.tv_sec = timeout->tv_sec;
+                ts.tv_nsec = timeout->tv_nsec;
+                arg.ts = (uint64_t)(uintptr_t)&ts;
+        }
+        arg.sigmask_sz = _NSIG / 8;
+
+        // EBUSY and EAGAIN are left to the caller, retrying here
+        // would never end if the completion queue is full
+        rval = sys_io_uring_enter(ring->fd, to_submit, wait ? 1 : 0, flags | IORING_ENTER_EXT_ARG, &arg, sizeof(arg));
+        if (0 > rval)
+                return errno;
+
+        // EINTR and ETIME are returned above
+        if (wait && !uring_peek_cqe(ring))
+                return ETIME;
+
+        return 0;
+}
+
+#endif // HAVE_LINUX_IO_URING_H
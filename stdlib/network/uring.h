@@ -0,0 +1,172 @@
+/*
+ *    Copyright (C) 2013, Jules Colding <jcolding@gmail.com>.
+ *
+ *    All Rights Reserved.
+ */
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 
+ *     (1) Redistributions of source code must retain the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer.
+ * 
+ *     (2) Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *     
+ *     (3) Neither the name of the copyright holder nor the names of
+ *     its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written
+ *     permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS
+ * OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#pragma once
+
+#ifdef HAVE_CONFIG_H
+    #include "ac_config.h"
+#endif
+
+#ifdef HAVE_LINUX_IO_URING_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <time.h>
+#include <linux/io_uring.h>
+
+/*
+ * A minimal io_uring instance driven by the raw system calls. Only
+ * one thread at a time may use an instance.
+ *
+ * Submission queue entries are obtained with uring_get_sqe(), filled
+ * in by the caller and handed to the kernel by uring_submit().
+ * Completions are read with uring_peek_cqe() and released with
+ * uring_cqe_seen().
+ *
+ * In SQPOLL mode a kernel thread polls the submission queue, so
+ * submitting needs no system call unless the kernel thread has gone
+ * idle.
+ */
+struct uring_t {
+        int fd;
+        int sqpoll;
+
+        // submission queue
+        unsigned int *sq_head;
+        unsigned int *sq_tail;
+        unsigned int *sq_flags;
+        unsigned int sq_mask;
+        unsigned int sq_entries;
+        unsigned int sqe_tail;  // entries handed out by uring_get_sqe()
+        unsigned int sqe_head;  // entries made visible to the kernel
+        struct io_uring_sqe *sqes;
+
+        // completion queue
+        unsigned int *cq_head;
+        unsigned int *cq_tail;
+        unsigned int cq_mask;
+        struct io_uring_cqe *cqes;
+
+        void *sq_ring;
+        size_t sq_ring_size;
+        void *cq_ring;
+        size_t cq_ring_size;
+        size_t sqes_size;
+};
+
+/*
+ * Creates a ring with room for entries submissions. entries must be
+ * a power of two. sqpoll is 1 (one) for SQPOLL mode, 0 (zero)
+ * otherwise.
+ *
+ * Returns 0 (zero) if all is well or an errno value if not. ENOSYS
+ * is returned if the kernel lacks io_uring or the features needed.
+ */
+int uring_init(struct uring_t * const ring,
+               const unsigned int entries,
+               const int sqpoll);
+
+/*
+ * Closes the ring. Outstanding operations are cancelled by the
+ * kernel, so the caller must make sure none remains that refers to
+ * memory about to be freed.
+ */
+void uring_destroy(struct uring_t * const ring);
+
+/*
+ * Returns a zeroed submission queue entry or NULL if the submission
+ * queue is full.
+ */
+static inline struct io_uring_sqe*
+uring_get_sqe(struct uring_t * const ring)
+{
+        struct io_uring_sqe *sqe;
+
+        if (ring->sqe_tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE) >= ring->sq_entries)
+                return NULL;
+
+        sqe = &ring->sqes[ring->sqe_tail & ring->sq_mask];
+        ++ring->sqe_tail;
+        memset(sqe, 0, sizeof(*sqe));
+
+        return sqe;
+}
+
+/*
+ * Submits all entries obtained by uring_get_sqe() and, if wait is
+ * non-zero, waits until at least one completion is available or
+ * timeout, which may be NULL, has passed.
+ *
+ * Returns 0 (zero) if all is well or an errno value if not. ETIME is
+ * returned if timeout passed without a completion and EINTR if a
+ * signal interrupted the wait. EBUSY is returned if the completion
+ * queue is full and EAGAIN if the kernel is short of resources. The
+ * caller must then reap completions before calling again. Entries
+ * not taken by the kernel are submitted by the next call.
+ */
+int uring_submit(struct uring_t * const ring,
+                 const int wait,
+                 const struct timespec * const timeout);
+
+/*
+ * Returns the oldest unseen completion or NULL if there is none.
+ */
+static inline struct io_uring_cqe*
+uring_peek_cqe(struct uring_t * const ring)
+{
+        const unsigned int head = *ring->cq_head;
+
+        if (head == __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE))
+                return NULL;
+
+        return &ring->cqes[head & ring->cq_mask];
+}
+
+/*
+ * Hands the completion returned by uring_peek_cqe() back to the
+ * kernel.
+ */
+static inline void
+uring_cqe_seen(struct uring_t * const ring)
+{
+        __atomic_store_n(ring->cq_head, *ring->cq_head + 1, __ATOMIC_RELEASE);
+}
+
+#endif // HAVE_LINUX_IO_URING_H
@@ -0,0 +1,143 @@
+/*
+ *    Copyright (C) 2013, Jules Colding <jcolding@gmail.com>.
+ *
+ *    All Rights Reserved.
+ */
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     (1) Redistributions of source code must retain the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer.
+ *
+ *     (2) Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *
+ *     (3) Neither the name of the copyright holder nor the names of
+ *     its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written
+ *     permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS
+ * OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <check.h>
+
+#ifdef HAVE_CONFIG_H
+    #include "ac_config.h"
+#endif
+#include <sched.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include "stdlib/log/log.h"
+#include "threads.h"
+
+START_TEST(test_place_thread)
+{
+        cpu_set_t mask;
+        struct thread_placement_t placement;
+
+        // unpinned, default policy
+        placement.cpu_tag = 0;
+        placement.fifo_priority = 0;
+        fail_unless(0 == place_thread(&placement), NULL);
+
+        // the first CPU
+        placement.cpu_tag = 1;
+        fail_unless(0 == place_thread(&placement), NULL);
+
+        CPU_ZERO(&mask);
+        fail_unless(0 == sched_getaffinity(0, sizeof(mask), &mask), NULL);
+        fail_unless(1 == CPU_COUNT(&mask), NULL);
+        fail_unless(CPU_ISSET(0, &mask), NULL);
+
+        // an unpinned placement leaves the affinity as it is
+        placement.cpu_tag = 0;
+        fail_unless(0 == place_thread(&placement), NULL);
+        CPU_ZERO(&mask);
+        fail_unless(0 == sched_getaffinity(0, sizeof(mask), &mask), NULL);
+        fail_unless(1 == CPU_COUNT(&mask), NULL);
+        fail_unless(CPU_ISSET(0, &mask), NULL);
+
+}
+END_TEST
+
+START_TEST(test_bind_memory_to_cpu_node)
+{
+        void *mem;
+        const size_t len = 4 * sysconf(_SC_PAGESIZE);
+
+        mem = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        fail_unless(MAP_FAILED != mem, NULL);
+        memset(mem, 0xAB, len);
+
+        // unpinned threads have no node
+        fail_unless(0 == bind_memory_to_cpu_node(mem, len, 0), NULL);
+
+        // bound to the node of the first CPU, if known
+        fail_unless(-1 <= get_numa_node_of_cpu(1), NULL);
+        fail_unless(0 == bind_memory_to_cpu_node(mem, len, 1), NULL);
+        fail_unless(0xAB == ((uint8_t*)mem)[len - 1], NULL);
+
+        fail_unless(EINVAL == bind_memory_to_numa_node(mem, len, -1), NULL);
+
+        munmap(mem, len);
+}
+END_TEST
+
+Suite*
+threads_suite(void)
+{
+        Suite *s = suite_create("Threads");
+
+        /* Core test case */
+        TCase *tc_core = tcase_create("Core");
+
+        tcase_set_timeout(tc_core, 20);
+
+        tcase_add_test(tc_core, test_place_thread);
+        tcase_add_test(tc_core, test_bind_memory_to_cpu_node);
+        suite_add_tcase(s, tc_core);
+
+        return s;
+}
+
+int
+main(int /* argc */, char ** /* argv */)
+{
+        int number_failed;
+        Suite *s = threads_suite();
+        SRunner *sr = srunner_create(s);
+
+        // initiate logging
+        if (!init_logging(false, "check_threads")) {
+                fprintf(stderr, "could not initiate logging\n");
+                return EXIT_FAILURE;
+        }
+
+        // run the tests
+        srunner_run_all(sr, CK_VERBOSE);
+        number_failed = srunner_ntests_failed(sr);
+        srunner_free(sr);
+
+        return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
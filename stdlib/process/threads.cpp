@@ -45,10 +45,15 @@
     #include <mach/thread_policy.h>
 #elif defined __linux__
     #include <unistd.h>
+    #include <stdio.h>
+    #include <dirent.h>
     #include <sys/syscall.h>
     #include <sys/types.h>
     #include <sched.h>
+    #include <linux/mempolicy.h>
 #endif
+#include <errno.h>
+#include <string.h>
 #include "threads.h"
 
 
@@ -78,6 +83,104 @@ pin_thread(const int cpu_tag)
 }
 #endif
 
+int
+place_thread(const struct thread_placement_t * const placement)
+{
+        int err;
+        struct sched_param param;
+
+        if (placement->cpu_tag && pin_thread(placement->cpu_tag))
+                return (errno ? errno : EINVAL);
+
+        memset(&param, 0, sizeof(param));
+        param.sched_priority = placement->fifo_priority;
+        err = pthread_setschedparam(pthread_self(), (placement->fifo_priority ? SCHED_FIFO : SCHED_OTHER), &param);
+
+        return err;
+}
+
+#ifdef __APPLE__
+int
+get_numa_node_of_cpu(const int cpu_tag)
+{
+        (void)cpu_tag;
+
+        return -1;
+}
+
+int
+bind_memory_to_numa_node(void * const addr,
+                         const size_t len,
+                         const int node)
+{
+        (void)addr;
+        (void)len;
+        (void)node;
+
+        return ENOSYS;
+}
+#elif defined __linux__
+int
+get_numa_node_of_cpu(const int cpu_tag)
+{
+        int node = -1;
+        DIR *dir;
+        struct dirent *entry;
+        char path[64];
+
+        if (0 >= cpu_tag)
+                return -1;
+
+        // the CPU directory holds a "nodeN" link to its node
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d", cpu_tag - 1);
+        dir = opendir(path);
+        if (!dir)
+                return -1;
+        while ((entry = readdir(dir))) {
+                if (1 == sscanf(entry->d_name, "node%d", &node))
+                        break;
+                node = -1;
+        }
+        closedir(dir);
+
+        return node;
+}
+
+int
+bind_memory_to_numa_node(void * const addr,
+                         const size_t len,
+                         const int node)
+{
+        unsigned long nodemask[16];
+
+        if ((0 > node) || ((int)(8 * sizeof(nodemask)) <= node))
+                return EINVAL;
+
+        memset(nodemask, 0, sizeof(nodemask));
+        nodemask[node / (8 * sizeof(unsigned long))] = 1UL << (node % (8 * sizeof(unsigned long)));
+        if (syscall(__NR_mbind, addr, len, MPOL_BIND, nodemask, 8 * sizeof(nodemask), MPOL_MF_MOVE))
+                return errno;
+
+        return 0;
+}
+#endif
+
+int
+bind_memory_to_cpu_node(void * const addr,
+                        const size_t len,
+                        const int cpu_tag)
+{
+        int node;
+
+        if (!cpu_tag)
+                return 0;
+        node = get_numa_node_of_cpu(cpu_tag);
+        if (0 > node)
+                return 0;
+
+        return bind_memory_to_numa_node(addr, len, node);
+}
+
 static inline bool
 create_thread(const bool detached,
               pthread_t * const thread_id,
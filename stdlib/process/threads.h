@@ -43,6 +43,22 @@
     #include "ac_config.h"
 #endif
 #include <pthread.h>
+#include <stddef.h>
+
+/*
+ * Where and how a thread runs.
+ *
+ * cpu_tag: The CPU the thread is pinned to as by pin_thread(). The
+ *          thread is not pinned if it is 0 (zero).
+ *
+ * fifo_priority: SCHED_FIFO priority of the thread, 1 through 99. The
+ *                thread runs with the default policy if it is 0
+ *                (zero).
+ */
+struct thread_placement_t {
+        int cpu_tag;
+        int fifo_priority;
+};
 
 /*
  * Makes the scheduler put the thread on a specific CPU if possible.
@@ -50,6 +66,34 @@
 extern int
 pin_thread(const int cpu_tag);
 
+/*
+ * Places the calling thread as described by placement. An unpinned
+ * placement leaves the CPU affinity of the thread as it is.
+ *
+ * Returns 0 (zero) if all is well or an errno value if not. EPERM
+ * means that the process may not use SCHED_FIFO.
+ */
+extern int
+place_thread(const struct thread_placement_t * const placement);
+
+/*
+ * Returns the NUMA node of the CPU identified by cpu_tag as used by
+ * pin_thread() or -1 if it is not known.
+ */
+extern int
+get_numa_node_of_cpu(const int cpu_tag);
+
+/*
+ * Binds the pages of the len bytes at addr to NUMA node node. Pages
+ * already touched are moved to the node. addr must be page aligned.
+ *
+ * Returns 0 (zero) if all is well or an errno value if not.
+ */
+extern int
+bind_memory_to_numa_node(void * const addr,
+                         const size_t len,
+                         const int node);
+
 /*
  * Creates a thread.
  */
@@ -65,3 +109,15 @@ extern bool
 create_detached_thread(pthread_t * const thread_id,
 		       void *thread_arg,
 		       void *(*thread_func)(void *));
+
+/*
+ * As bind_memory_to_numa_node(), but binds to the NUMA node of the
+ * CPU identified by cpu_tag. Nothing is done if cpu_tag is 0 (zero)
+ * or the node of the CPU is not known.
+ *
+ * Returns 0 (zero) if all is well or an errno value if not.
+ */
+extern int
+bind_memory_to_cpu_node(void * const addr,
+                        const size_t len,
+                        const int cpu_tag);
@@ -0,0 +1,936 @@
+/*
+ *    Copyright (C) 2013, Jules Colding <jcolding@gmail.com>.
+ *
+ *    All Rights Reserved.
+ */
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     (1) Redistributions of source code must retain the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer.
+ *
+ *     (2) Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *
+ *     (3) Neither the name of the copyright holder nor the names of
+ *     its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written
+ *     permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS
+ * OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <check.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <string>
+
+#ifdef HAVE_CONFIG_H
+    #include "ac_config.h"
+#endif
+#include "rule_domain.h"
+
+#define TAG(type__, id__) ((((uint32_t)(type__)) << 24) | (uint32_t)(id__))
+
+// integer tags of the random tests
+#define RANDOM_TAGS (4)
+#define RANDOM_CRITERIA (12)
+
+/*
+ * Reference evaluation of an expression. Operators have equal
+ * precedence and are evaluated left to right, as the interpreter the
+ * compiler replaced did, but every operand is evaluated.
+ */
+static bool
+reference_criteria(const char **expression,
+		   const Event * const incident,
+		   const CriteriaCache * const criteria_cache)
+{
+	const unsigned long criteria_id = strtoul(*expression, (char**)expression, 16);
+	const struct TagInstance *instance;
+	uint32_t lval;
+	uint32_t rval;
+
+	CriteriaCache::const_iterator cit = criteria_cache->find(criteria_id);
+	fail_unless(criteria_cache->end() != cit, NULL);
+
+	instance = incident->find(cit->second.tag);
+	if (!instance)
+		return false;
+	lval = (uint32_t)instance->int_value;
+	rval = (uint32_t)cit->second.int_value;
+
+	switch (cit->second.cond) {
+	case eEqual:
+		return (lval == rval);
+	case eGreaterThan:
+		return (lval > rval);
+	case eGreaterThanOrEqual:
+		return (lval >= rval);
+	case eLessThan:
+		return (lval < rval);
+	case eLessThanOrEqual:
+		return (lval <= rval);
+	case eNotEqual:
+		return (lval != rval);
+	case eTrue:
+		return true;
+	case eFalse:
+		return false;
+	default:
+		fail_unless(false, NULL);
+	}
+
+	return false;
+}
+
+static bool
+reference_group(const char **expression,
+		const Event * const incident,
+		const CriteriaCache * const criteria_cache);
+
+static bool
+reference_operand(const char **expression,
+		  const Event * const incident,
+		  const CriteriaCache * const criteria_cache)
+{
+	bool retv;
+
+	if (PAR_START != **expression)
+		return reference_criteria(expression, incident, criteria_cache);
+
+	++(*expression);
+	retv = reference_group(expression, incident, criteria_cache);
+	fail_unless(PAR_END == **expression, NULL);
+	++(*expression);
+
+	return retv;
+}
+
+static bool
+reference_group(const char **expression,
+		const Event * const incident,
+		const CriteriaCache * const criteria_cache)
+{
+	bool retv = reference_operand(expression, incident, criteria_cache);
+	bool operand;
+	char op;
+
+	while ((AND == **expression) || (OR == **expression)) {
+		op = *(*expression)++;
+		operand = reference_operand(expression, incident, criteria_cache);
+		retv = (AND == op) ? (retv && operand) : (retv || operand);
+	}
+
+	return retv;
+}
+
+static const char*
+reference_evaluate(const Event * const incident,
+		   const RuleSet * const rules,
+		   const CriteriaCache * const criteria_cache)
+{
+	const char *expr;
+	bool retv;
+
+	for (RuleSet::size_type n = 0; n < rules->size(); ++n) {
+		expr = (*rules)[n].expression;
+		retv = *expr ? reference_group(&expr, incident, criteria_cache) : false;
+		if ((*rules)[n].negate ? !retv : retv)
+			return (*rules)[n].id;
+	}
+
+	return NULL;
+}
+
+/*
+ * Appends a random expression of at most depth nesting levels.
+ */
+static void
+random_expression(unsigned int * const seed,
+		  const int depth,
+		  std::string & expression)
+{
+	const int operands = 1 + rand_r(seed) % 4;
+	char id[8];
+
+	for (int n = 0; n < operands; ++n) {
+		if (n)
+			expression += (rand_r(seed) % 2) ? AND : OR;
+		if (depth && !(rand_r(seed) % 3)) {
+			expression += PAR_START;
+			random_expression(seed, depth - 1, expression);
+			expression += PAR_END;
+		} else {
+			snprintf(id, sizeof(id), "%x", 1 + rand_r(seed) % RANDOM_CRITERIA);
+			expression += id;
+		}
+	}
+}
+
+static void
+random_criteria(unsigned int * const seed,
+		CriteriaCache & criteria_cache)
+{
+	static const enum Evaluation conditions[] = { eEqual, eGreaterThan, eGreaterThanOrEqual, eLessThan, eLessThanOrEqual, eNotEqual, eTrue, eFalse };
+	struct Criteria criteria;
+
+	criteria_cache.clear();
+	for (unsigned int n = 1; n <= RANDOM_CRITERIA; ++n) {
+		criteria.cond = conditions[rand_r(seed) % (sizeof(conditions)/sizeof(conditions[0]))];
+		criteria.tag = TAG(vt_uint32, 1 + rand_r(seed) % RANDOM_TAGS);
+		criteria.int_value = rand_r(seed) % 4;
+		criteria.ptr_value = NULL;
+		criteria_cache[n] = criteria;
+	}
+}
+
+/*
+ * Fills incident with random values. Some tags are left out.
+ */
+static void
+random_event(unsigned int * const seed,
+	     Event & incident)
+{
+	incident.clear();
+	for (unsigned int tag = 1; tag <= RANDOM_TAGS; ++tag) {
+		if (rand_r(seed) % 5)
+			fail_unless(1 == incident.set(TAG(vt_uint32, tag), (uint64_t)(rand_r(seed) % 4)), NULL);
+	}
+}
+
+/*
+ * Fills rules with up to 5 random rules. The expressions are kept in
+ * expressions, which must not be modified while rules is in use.
+ */
+static void
+random_rule_set(unsigned int * const seed,
+		std::vector<std::string> & expressions,
+		RuleSet & rules)
+{
+	static const char *ids[] = { "R0", "R1", "R2", "R3", "R4" };
+	const size_t count = 1 + rand_r(seed) % 5;
+	struct Rule rule;
+
+	expressions.assign(count, std::string());
+	rules.clear();
+	for (size_t n = 0; n < count; ++n) {
+		random_expression(seed, 3, expressions[n]);
+		rule.negate = !(rand_r(seed) % 4);
+		rule.priority = 0;
+		rule.action = 0;
+		rule.expression = (char*)expressions[n].c_str();
+		rule.id = (char*)ids[n];
+		rules.push_back(rule);
+	}
+}
+
+static void
+add_criteria(CriteriaCache & criteria_cache,
+	     const unsigned int criteria_id,
+	     const uint32_t tag,
+	     const enum Evaluation cond,
+	     const uint64_t int_value)
+{
+	struct Criteria criteria = { cond, tag, int_value, NULL };
+
+	criteria_cache[criteria_id] = criteria;
+}
+
+static void
+add_rule(RuleSet & rules,
+	 const char * const id,
+	 const int negate,
+	 const char * const expression)
+{
+	struct Rule rule = { negate, 0, 0, (char*)expression, (char*)id };
+
+	rules.push_back(rule);
+}
+
+/*
+ * Returns 1 (one) if the criteria in slot has been evaluated, 0 (zero)
+ * if not.
+ */
+static int
+is_known(const RuleEvaluation & evaluation,
+	 const uint32_t slot)
+{
+	return (0 != (evaluation.known[slot / 64] & (1ULL << (slot % 64))));
+}
+
+/*
+ * Test the code generated for operators, parentheses and the
+ * patching of short-circuit jumps.
+ */
+START_TEST(test_rule_compiler)
+{
+	CriteriaCache criteria_cache;
+	RuleSet rules;
+	CompiledRuleSet compiled;
+	RuleEvaluation evaluation;
+	Event incident;
+
+	// 1 and 2 are false, 3 and 4 true
+	add_criteria(criteria_cache, 1, TAG(vt_uint32, 1), eGreaterThan, 5);
+	add_criteria(criteria_cache, 2, TAG(vt_uint32, 1), eNotEqual, 1);
+	add_criteria(criteria_cache, 3, TAG(vt_uint32, 1), eLessThan, 5);
+	add_criteria(criteria_cache, 4, TAG(vt_uint32, 2), eTrue, 0);
+	fail_unless(1 == incident.set(TAG(vt_uint32, 1), (uint64_t)1), NULL);
+	fail_unless(1 == incident.set(TAG(vt_uint32, 2), (uint64_t)1), NULL);
+
+	// a false AND goes to the next OR, a true OR to the end
+	add_rule(rules, "R", 0, "1+2|3");
+	fail_unless(1 == compile_rule_set(&rules, &criteria_cache, &compiled), NULL);
+	fail_unless(6 == compiled.code.size(), NULL);
+	fail_unless(op_test == compiled.code[0].op, NULL);
+	fail_unless(op_jump_if_false == compiled.code[1].op, NULL);
+	fail_unless(3 == compiled.code[1].target, NULL);
+	fail_unless(op_test == compiled.code[2].op, NULL);
+	fail_unless(op_jump_if_true == compiled.code[3].op, NULL);
+	fail_unless(5 == compiled.code[3].target, NULL);
+	fail_unless(op_test == compiled.code[4].op, NULL);
+	fail_unless(op_end == compiled.code[5].op, NULL);
+	fail_unless(3 == compiled.criteria_count, NULL);
+	fail_unless(!strcmp("R", evaluate_incident_with_compiled_rules(&incident, &compiled, &evaluation)), NULL);
+	fail_unless(is_known(evaluation, 0) && !is_known(evaluation, 1) && is_known(evaluation, 2), NULL);
+
+	// all pending ANDs go to the OR
+	rules[0].expression = (char*)"1+2+3|4";
+	fail_unless(1 == compile_rule_set(&rules, &criteria_cache, &compiled), NULL);
+	fail_unless(8 == compiled.code.size(), NULL);
+	fail_unless((op_jump_if_false == compiled.code[1].op) && (5 == compiled.code[1].target), NULL);
+	fail_unless((op_jump_if_false == compiled.code[3].op) && (5 == compiled.code[3].target), NULL);
+	fail_unless((op_jump_if_true == compiled.code[5].op) && (7 == compiled.code[5].target), NULL);
+	fail_unless(!strcmp("R", evaluate_incident_with_compiled_rules(&incident, &compiled, &evaluation)), NULL);
+	fail_unless(is_known(evaluation, 0) && !is_known(evaluation, 1) && !is_known(evaluation, 2) && is_known(evaluation, 3), NULL);
+
+	// a true OR skips the rest of its parenthesis only
+	rules[0].expression = (char*)"(3|1)+2";
+	fail_unless(1 == compile_rule_set(&rules, &criteria_cache, &compiled), NULL);
+	fail_unless(6 == compiled.code.size(), NULL);
+	fail_unless((op_jump_if_true == compiled.code[1].op) && (3 == compiled.code[1].target), NULL);
+	fail_unless((op_jump_if_false == compiled.code[3].op) && (5 == compiled.code[3].target), NULL);
+	fail_unless(NULL == evaluate_incident_with_compiled_rules(&incident, &compiled, &evaluation), NULL);
+	fail_unless(is_known(evaluation, 0) && !is_known(evaluation, 1) && is_known(evaluation, 2), NULL);
+
+	// a false AND skips out of nested parentheses to the next OR
+	rules[0].expression = (char*)"(1+(3|4))|4";
+	fail_unless(1 == compile_rule_set(&rules, &criteria_cache, &compiled), NULL);
+	fail_unless(!strcmp("R", evaluate_incident_with_compiled_rules(&incident, &compiled, &evaluation)), NULL);
+	fail_unless(is_known(evaluation, 0) && !is_known(evaluation, 1) && is_known(evaluation, 2), NULL);
+
+	// negated rules
+	rules[0].negate = 1;
+	fail_unless(1 == compile_rule_set(&rules, &criteria_cache, &compiled), NULL);
+	fail_unless(NULL == evaluate_incident_with_compiled_rules(&incident, &compiled, &evaluation), NULL);
+	rules[0].expression = (char*)"1|2";
+	fail_unless(1 == compile_rule_set(&rules, &criteria_cache, &compiled), NULL);
+	fail_unless(!strcmp("R", evaluate_incident_with_compiled_rules(&incident, &compiled, &evaluation)), NULL);
+
+	// an empty expression is false
+	rules[0].negate = 0;
+	rules[0].expression = (char*)" ";
+	fail_unless(1 == compile_rule_set(&rules, &criteria_cache, &compiled), NULL);
+	fail_unless(NULL == evaluate_incident_with_compiled_rules(&incident, &compiled, &evaluation), NULL);
+
+	// malformed
+	rules[0].expression = (char*)"(1+2";
+	fail_unless(0 == compile_rule_set(&rules, &criteria_cache, &compiled), NULL);
+	fail_unless(compiled.code.empty() && compiled.rules.empty(), NULL);
+	rules[0].expression = (char*)"1+2)";
+	fail_unless(0 == compile_rule_set(&rules, &criteria_cache, &compiled), NULL);
+	rules[0].expression = (char*)"1+";
+	fail_unless(0 == compile_rule_set(&rules, &criteria_cache, &compiled), NULL);
+	rules[0].expression = (char*)"1+9";
+	fail_unless(0 == compile_rule_set(&rules, &criteria_cache, &compiled), NULL);
+
+	// conditions and value types without an evaluator
+	add_criteria(criteria_cache, 5, TAG(vt_uint32, 1), (enum Evaluation)0x7F, 1);
+	add_criteria(criteria_cache, 6, TAG(vt_ieee754, 1), eEqual, 1);
+	rules[0].expression = (char*)"3|5";
+	fail_unless(0 == compile_rule_set(&rules, &criteria_cache, &compiled), NULL);
+	rules[0].expression = (char*)"3|6";
+	fail_unless(0 == compile_rule_set(&rules, &criteria_cache, &compiled), NULL);
+	fail_unless(compiled.code.empty() && compiled.rules.empty(), NULL);
+}
+END_TEST
+
+/*
+ * Test that compiled rules give the same results as the reference
+ * evaluation on random rules and events.
+ */
+START_TEST(test_rule_compiler_random)
+{
+	unsigned int seed = 4711;
+	CriteriaCache criteria_cache;
+	std::vector<std::string> expressions;
+	RuleSet rules;
+	CompiledRuleSet compiled;
+	RuleEvaluation evaluation;
+	Event incident;
+	const char *expected;
+	const char *id;
+
+	for (int n = 0; n < 2000; ++n) {
+		random_criteria(&seed, criteria_cache);
+		random_rule_set(&seed, expressions, rules);
+		fail_unless(1 == compile_rule_set(&rules, &criteria_cache, &compiled), NULL);
+
+		for (int k = 0; k < 50; ++k) {
+			random_event(&seed, incident);
+			expected = reference_evaluate(&incident, &rules, &criteria_cache);
+			id = evaluate_incident_with_compiled_rules(&incident, &compiled, &evaluation);
+			fail_unless(expected == id, NULL);
+			if (!k)
+				fail_unless(expected == evaluate_incident_with_rules(&incident, &rules, &criteria_cache), NULL);
+		}
+	}
+}
+END_TEST
+
+/*
+ * Test which rules are indexed and that only the candidates found in
+ * the index, and the unindexed rules, are evaluated.
+ */
+START_TEST(test_rule_index)
+{
+	const uint32_t tag_a = TAG(vt_uint32, 1);
+	const uint32_t tag_b = TAG(vt_uint8, 2);
+	const uint32_t tag_c = TAG(vt_uint32, 3);
+	CriteriaCache criteria_cache;
+	RuleSet rules;
+	CompiledRuleSet compiled;
+	RuleEvaluation evaluation;
+	Event incident;
+	struct RuleIndexKey key;
+
+	add_criteria(criteria_cache, 1, tag_a, eEqual, 1);
+	add_criteria(criteria_cache, 2, tag_a, eEqual, 2);
+	add_criteria(criteria_cache, 3, tag_c, eGreaterThan, 0);
+	add_criteria(criteria_cache, 4, tag_b, eEqual, 0x101);
+	add_criteria(criteria_cache, 5, tag_c, eNotEqual, 7);
+
+	add_rule(rules, "R0", 0, "1+3"); // indexed under tag_a == 1
+	add_rule(rules, "R1", 0, "2+3"); // indexed under tag_a == 2
+	add_rule(rules, "R2", 0, "3|1"); // nothing required
+	add_rule(rules, "R3", 0, "4+5"); // indexed under tag_b == 1
+	add_rule(rules, "R4", 1, "1");   // negated
+	add_rule(rules, "R5", 0, "3+5"); // no equality criteria
+	fail_unless(1 == compile_rule_set(&rules, &criteria_cache, &compiled), NULL);
+
+	// slots are assigned in the order the criteria are first seen
+	fail_unless(5 == compiled.criteria_count, NULL);
+
+	fail_unless(3 == compiled.index.size(), NULL);
+	fail_unless(2 == compiled.index_tags.size(), NULL);
+	fail_unless((tag_a == compiled.index_tags[0]) && (tag_b == compiled.index_tags[1]), NULL);
+	key.tag = tag_a;
+	key.value = 1;
+	fail_unless((1 == compiled.index[key].size()) && (0 == compiled.index[key][0]), NULL);
+	key.value = 2;
+	fail_unless((1 == compiled.index[key].size()) && (1 == compiled.index[key][0]), NULL);
+	key.tag = tag_b;
+	key.value = 1; // 0x101 normalized to uint8
+	fail_unless((1 == compiled.index[key].size()) && (3 == compiled.index[key][0]), NULL);
+	fail_unless(3 == compiled.unindexed.size(), NULL);
+	fail_unless((2 == compiled.unindexed[0]) && (4 == compiled.unindexed[1]) && (5 == compiled.unindexed[2]), NULL);
+
+	// R0 is pruned, so criteria 1 in slot 0 is never evaluated
+	fail_unless(1 == incident.set(tag_a, (uint64_t)2), NULL);
+	fail_unless(1 == incident.set(tag_b, (uint64_t)1), NULL);
+	fail_unless(1 == incident.set(tag_c, (uint64_t)1), NULL);
+	fail_unless(!strcmp("R1", evaluate_incident_with_compiled_rules(&incident, &compiled, &evaluation)), NULL);
+	fail_unless(!is_known(evaluation, 0) && is_known(evaluation, 1) && is_known(evaluation, 2), NULL);
+	fail_unless(5 == evaluation.candidates.size(), NULL);
+
+	// the unindexed R2 is evaluated after R0 failed
+	incident.clear();
+	fail_unless(1 == incident.set(tag_a, (uint64_t)1), NULL);
+	fail_unless(1 == incident.set(tag_c, (uint64_t)0), NULL);
+	fail_unless(!strcmp("R2", evaluate_incident_with_compiled_rules(&incident, &compiled, &evaluation)), NULL);
+	fail_unless(is_known(evaluation, 0) && is_known(evaluation, 1) && !is_known(evaluation, 2), NULL);
+	fail_unless(4 == evaluation.candidates.size(), NULL);
+
+	// the Event value is normalized as well
+	incident.clear();
+	fail_unless(1 == incident.set(tag_a, (uint64_t)3), NULL);
+	fail_unless(1 == incident.set(tag_b, (uint64_t)0x101), NULL);
+	fail_unless(1 == incident.set(tag_c, (uint64_t)0), NULL);
+	fail_unless(!strcmp("R3", evaluate_incident_with_compiled_rules(&incident, &compiled, &evaluation)), NULL);
+
+	// only the unindexed rules are candidates
+	incident.clear();
+	fail_unless(1 == incident.set(tag_a, (uint64_t)5), NULL);
+	fail_unless(1 == incident.set(tag_c, (uint64_t)0), NULL);
+	fail_unless(!strcmp("R4", evaluate_incident_with_compiled_rules(&incident, &compiled, &evaluation)), NULL);
+	fail_unless(3 == evaluation.candidates.size(), NULL);
+	incident.clear();
+	fail_unless(1 == incident.set(tag_c, (uint64_t)3), NULL);
+	fail_unless(!strcmp("R2", evaluate_incident_with_compiled_rules(&incident, &compiled, &evaluation)), NULL);
+	fail_unless(3 == evaluation.candidates.size(), NULL);
+}
+END_TEST
+
+/*
+ * Test that the memoized criteria of one Event do not leak into the
+ * evaluation of the next.
+ */
+START_TEST(test_rule_evaluation_memo)
+{
+	const uint32_t tag_a = TAG(vt_uint32, 1);
+	const uint32_t tag_c = TAG(vt_uint32, 3);
+	CriteriaCache criteria_cache;
+	std::string expression;
+	RuleSet rules;
+	CompiledRuleSet compiled;
+	RuleEvaluation evaluation;
+	Event incident;
+	char id[8];
+
+	// criteria 1 is shared and true for tag_a == 1
+	add_criteria(criteria_cache, 1, tag_a, eEqual, 1);
+	add_criteria(criteria_cache, 2, tag_c, eGreaterThan, 0);
+	add_rule(rules, "R0", 0, "2+1");
+	add_rule(rules, "R1", 1, "1");
+	fail_unless(1 == compile_rule_set(&rules, &criteria_cache, &compiled), NULL);
+
+	fail_unless(1 == incident.set(tag_a, (uint64_t)1), NULL);
+	fail_unless(1 == incident.set(tag_c, (uint64_t)1), NULL);
+	fail_unless(!strcmp("R0", evaluate_incident_with_compiled_rules(&incident, &compiled, &evaluation)), NULL);
+	fail_unless(1 == evaluation.touched.size(), NULL);
+	fail_unless((3 == evaluation.known[0]) && (3 == evaluation.value[0]), NULL);
+
+	// a stale value of criteria 1 would make R1 fail, R0 is pruned
+	fail_unless(1 == incident.set(tag_a, (uint64_t)2), NULL);
+	fail_unless(!strcmp("R1", evaluate_incident_with_compiled_rules(&incident, &compiled, &evaluation)), NULL);
+	fail_unless((2 == evaluation.known[0]) && (0 == evaluation.value[0]), NULL);
+
+	// a stale known bit of criteria 2 would keep R0 from matching
+	fail_unless(1 == incident.set(tag_a, (uint64_t)1), NULL);
+	fail_unless(1 == incident.set(tag_c, (uint64_t)0), NULL);
+	fail_unless(NULL == evaluate_incident_with_compiled_rules(&incident, &compiled, &evaluation), NULL);
+	fail_unless(1 == incident.set(tag_c, (uint64_t)1), NULL);
+	fail_unless(!strcmp("R0", evaluate_incident_with_compiled_rules(&incident, &compiled, &evaluation)), NULL);
+
+	// an OR of 70 criteria spans two words
+	criteria_cache.clear();
+	for (unsigned int n = 0; n < 70; ++n) {
+		add_criteria(criteria_cache, 0x100 + n, tag_c, eEqual, n);
+		snprintf(id, sizeof(id), "%s%x", n ? "|" : "", 0x100 + n);
+		expression += id;
+	}
+	rules.clear();
+	add_rule(rules, "R", 0, expression.c_str());
+	fail_unless(1 == compile_rule_set(&rules, &criteria_cache, &compiled), NULL);
+	fail_unless(70 == compiled.criteria_count, NULL);
+
+	incident.clear();
+	fail_unless(1 == incident.set(tag_c, (uint64_t)69), NULL);
+	fail_unless(!strcmp("R", evaluate_incident_with_compiled_rules(&incident, &compiled, &evaluation)), NULL);
+	fail_unless(2 == evaluation.touched.size(), NULL);
+	fail_unless((~0ULL == evaluation.known[0]) && (0x3F == evaluation.known[1]), NULL);
+	fail_unless((0 == evaluation.value[0]) && (0x20 == evaluation.value[1]), NULL);
+
+	fail_unless(1 == incident.set(tag_c, (uint64_t)0), NULL);
+	fail_unless(!strcmp("R", evaluate_incident_with_compiled_rules(&incident, &compiled, &evaluation)), NULL);
+	fail_unless((1 == evaluation.touched.size()) && (0 == evaluation.touched[0]), NULL);
+	fail_unless((1 == evaluation.known[0]) && (1 == evaluation.value[0]), NULL);
+	fail_unless((0 == evaluation.known[1]) && (0 == evaluation.value[1]), NULL);
+
+	fail_unless(1 == incident.set(tag_c, (uint64_t)70), NULL);
+	fail_unless(NULL == evaluate_incident_with_compiled_rules(&incident, &compiled, &evaluation), NULL);
+	fail_unless((0 == evaluation.value[0]) && (0 == evaluation.value[1]), NULL);
+}
+END_TEST
+
+/*
+ * Test that Event keeps its tags sorted whatever order they are set
+ * in, and its capacity.
+ */
+START_TEST(test_event)
+{
+	unsigned int seed = 42;
+	uint32_t tags[EVENT_MAX_TAGS];
+	const struct TagInstance *instance;
+	Event incident;
+	uint32_t tmp;
+	int n;
+	int k;
+
+	fail_unless(0 == incident.size(), NULL);
+	fail_unless(NULL == incident.find(1), NULL);
+
+	// ascending
+	for (n = 1; n <= EVENT_MAX_TAGS; ++n)
+		fail_unless(1 == incident.set(2*n, (uint64_t)(10*n)), NULL);
+	fail_unless(EVENT_MAX_TAGS == incident.size(), NULL);
+	for (n = 1; n <= EVENT_MAX_TAGS; ++n) {
+		instance = incident.find(2*n);
+		fail_unless(instance && ((uint64_t)(10*n) == instance->int_value), NULL);
+		fail_unless(NULL == incident.find(2*n - 1), NULL);
+	}
+	fail_unless(NULL == incident.find(2*EVENT_MAX_TAGS + 1), NULL);
+
+	// full, before, between and after the held tags
+	fail_unless(0 == incident.set(1, (uint64_t)1), NULL);
+	fail_unless(0 == incident.set(3, (uint64_t)1), NULL);
+	fail_unless(0 == incident.set(2*EVENT_MAX_TAGS + 1, (uint64_t)1), NULL);
+	fail_unless(EVENT_MAX_TAGS == incident.size(), NULL);
+	fail_unless(NULL == incident.find(3), NULL);
+
+	// overwriting is possible when full
+	fail_unless(1 == incident.set(2, (uint64_t)7), NULL);
+	fail_unless(1 == incident.set(2*EVENT_MAX_TAGS, (void*)&seed), NULL);
+	fail_unless(EVENT_MAX_TAGS == incident.size(), NULL);
+	fail_unless(7 == incident.find(2)->int_value, NULL);
+	fail_unless(((void*)&seed == incident.find(2*EVENT_MAX_TAGS)->ptr_value) && (0 == incident.find(2*EVENT_MAX_TAGS)->int_value), NULL);
+	fail_unless(20 == incident.find(4)->int_value, NULL);
+
+	incident.clear();
+	fail_unless(0 == incident.size(), NULL);
+	fail_unless(NULL == incident.find(2), NULL);
+
+	// descending
+	for (n = EVENT_MAX_TAGS; n > 0; --n)
+		fail_unless(1 == incident.set(n, (uint64_t)(10*n)), NULL);
+	fail_unless(EVENT_MAX_TAGS == incident.size(), NULL);
+	for (n = 1; n <= EVENT_MAX_TAGS; ++n)
+		fail_unless((uint64_t)(10*n) == incident.find(n)->int_value, NULL);
+	fail_unless(0 == incident.set(0, (uint64_t)1), NULL);
+	fail_unless(NULL == incident.find(0), NULL);
+
+	// random order and overwriting of earlier tags
+	for (k = 0; k < 100; ++k) {
+		for (n = 0; n < EVENT_MAX_TAGS; ++n)
+			tags[n] = 1000*n + rand_r(&seed) % 1000;
+		for (n = EVENT_MAX_TAGS - 1; n > 0; --n) {
+			const int m = rand_r(&seed) % (n + 1);
+
+			tmp = tags[n];
+			tags[n] = tags[m];
+			tags[m] = tmp;
+		}
+		incident.clear();
+		for (n = 0; n < EVENT_MAX_TAGS; ++n) {
+			fail_unless(1 == incident.set(tags[n], (uint64_t)n), NULL);
+			fail_unless((size_t)(n + 1) == incident.size(), NULL);
+			if (n) {
+				fail_unless(1 == incident.set(tags[n/2], (uint64_t)(n/2 + 1000)), NULL);
+				fail_unless((size_t)(n + 1) == incident.size(), NULL);
+				fail_unless(1 == incident.set(tags[n/2], (uint64_t)(n/2)), NULL);
+			}
+		}
+		for (n = 0; n < EVENT_MAX_TAGS; ++n)
+			fail_unless((uint64_t)n == incident.find(tags[n])->int_value, NULL);
+	}
+}
+END_TEST
+
+/*
+ * Test that the batch evaluations give the same results as
+ * evaluating one Event at a time.
+ */
+START_TEST(test_rule_batch)
+{
+	unsigned int seed = 1234;
+	CriteriaCache criteria_cache;
+	std::vector<std::string> expressions;
+	RuleSet rules;
+	CompiledRuleSet compiled;
+	RuleEvaluation evaluation;
+	Event incidents[100];
+	const char *results[100];
+	const size_t count = sizeof(incidents)/sizeof(incidents[0]);
+
+	for (int n = 0; n < 200; ++n) {
+		random_criteria(&seed, criteria_cache);
+		random_rule_set(&seed, expressions, rules);
+		for (size_t k = 0; k < count; ++k)
+			random_event(&seed, incidents[k]);
+
+		fail_unless(1 == compile_rule_set(&rules, &criteria_cache, &compiled), NULL);
+		evaluate_incidents_with_compiled_rules(incidents, count, &compiled, &evaluation, results);
+		for (size_t k = 0; k < count; ++k)
+			fail_unless(results[k] == evaluate_incident_with_compiled_rules(&incidents[k], &compiled), NULL);
+
+		memset(results, 0xFF, sizeof(results));
+		fail_unless(1 == evaluate_incidents_with_rules(incidents, count, &rules, &criteria_cache, results), NULL);
+		for (size_t k = 0; k < count; ++k)
+			fail_unless(results[k] == reference_evaluate(&incidents[k], &rules, &criteria_cache), NULL);
+	}
+
+	rules[0].expression = (char*)"1+";
+	fail_unless(0 == evaluate_incidents_with_rules(incidents, count, &rules, &criteria_cache, results), NULL);
+}
+END_TEST
+
+// evaluator threads of test_rule_domain
+#define DOMAIN_EVALUATORS (4)
+
+struct domain_evaluator_args {
+	ConcurrentRuleDomain *domain;
+	int stop;
+	int ok;
+	uint64_t evaluations;
+};
+
+static void*
+domain_evaluator(void *arg)
+{
+	struct domain_evaluator_args * const args = (struct domain_evaluator_args*)arg;
+	const RuleDomainSnapshot *snapshot;
+	RuleEvaluation evaluation;
+	Event incident;
+	const char *id;
+	unsigned long generation;
+	unsigned long last_generation = 0;
+	char *end;
+	int evaluator;
+
+	evaluator = args->domain->register_evaluator();
+	if (-1 == evaluator)
+		return NULL;
+	incident.set(TAG(vt_uint32, 1), (uint64_t)1);
+
+	while (!__atomic_load_n(&args->stop, __ATOMIC_ACQUIRE)) {
+		snapshot = args->domain->read_lock(evaluator);
+
+		// the generation of RuleSet 1 never goes back
+		id = evaluate_incident_in_domain(snapshot, 1, &incident, &evaluation);
+		if (id) {
+			generation = ('G' == id[0]) ? strtoul(id + 1, &end, 10) : 0;
+			if (!generation || *end || (9 != strlen(id)) || (generation < last_generation))
+				goto err;
+			last_generation = generation;
+		}
+
+		// RuleSet 2 comes and goes
+		id = evaluate_incident_in_domain(snapshot, 2, &incident, &evaluation);
+		if (id && strcmp("W", id))
+			goto err;
+
+		args->domain->read_unlock(evaluator);
+		++args->evaluations;
+	}
+	args->domain->unregister_evaluator(evaluator);
+	args->ok = (0 != last_generation);
+
+	return NULL;
+err:
+	args->domain->read_unlock(evaluator);
+	args->domain->unregister_evaluator(evaluator);
+
+	return NULL;
+}
+
+static int
+publish_definition(ConcurrentRuleDomain & domain,
+		   const unsigned int rule_set_id,
+		   const char * const text)
+{
+	struct RuleSetDefinition *definition = new RuleSetDefinition;
+
+	if (!parse_rule_set_definition(text, definition))
+		goto err;
+	if (!domain.publish(rule_set_id, definition))
+		goto err;
+
+	return 1;
+err:
+	delete definition;
+
+	return 0;
+}
+
+/*
+ * Test that evaluators see consistent RuleSets while RuleSets are
+ * published and withdrawn.
+ */
+START_TEST(test_rule_domain)
+{
+	ConcurrentRuleDomain domain;
+	struct domain_evaluator_args args[DOMAIN_EVALUATORS];
+	pthread_t threads[DOMAIN_EVALUATORS];
+	char text[128];
+	int n;
+
+	memset(args, 0, sizeof(args));
+	fail_unless(1 == publish_definition(domain, 1, "C 1 5000001 eq 1\nR G00000001 0 0 0 1\n"), NULL);
+	for (n = 0; n < DOMAIN_EVALUATORS; ++n) {
+		args[n].domain = &domain;
+		fail_unless(!pthread_create(&threads[n], NULL, domain_evaluator, &args[n]), NULL);
+	}
+
+	for (n = 2; n < 20000; ++n) {
+		snprintf(text, sizeof(text), "C 1 5000001 eq 1\nC 2 5000002 gt 3\nR X 0 0 0 2\nR G%08d 0 0 0 1\n", n);
+		fail_unless(1 == publish_definition(domain, 1, text), NULL);
+		if (!(n % 2))
+			fail_unless(1 == publish_definition(domain, 2, "C 7 5000001 ne 2\nR W 0 0 0 7\n"), NULL);
+		else
+			fail_unless(1 == domain.withdraw(2), NULL);
+	}
+
+	for (n = 0; n < DOMAIN_EVALUATORS; ++n)
+		__atomic_store_n(&args[n].stop, 1, __ATOMIC_RELEASE);
+	for (n = 0; n < DOMAIN_EVALUATORS; ++n) {
+		fail_unless(!pthread_join(threads[n], NULL), NULL);
+		fail_unless(args[n].ok, NULL);
+	}
+
+	// malformed definitions are not published and nothing changes
+	fail_unless(0 == publish_definition(domain, 1, "C 1 5000001 eq 1\nR Y 0 0 0 1+\n"), NULL);
+	fail_unless(0 == publish_definition(domain, 1, "C 1 5000001 xx 1\nR Y 0 0 0 1\n"), NULL);
+	fail_unless(0 == publish_definition(domain, 1, "R Y 0 0 2 1\n"), NULL);
+	fail_unless(0 == domain.withdraw(2), NULL);
+	fail_unless(0 == domain.withdraw(3), NULL);
+
+	n = domain.register_evaluator();
+	fail_unless(-1 != n, NULL);
+	{
+		const RuleDomainSnapshot * const snapshot = domain.read_lock(n);
+		RuleEvaluation evaluation;
+		Event incident;
+
+		incident.set(TAG(vt_uint32, 1), (uint64_t)1);
+		fail_unless(1 == snapshot->size(), NULL);
+		fail_unless(!strcmp("G00019999", evaluate_incident_in_domain(snapshot, 1, &incident, &evaluation)), NULL);
+		fail_unless(NULL == evaluate_incident_in_domain(snapshot, 2, &incident, &evaluation), NULL);
+		domain.read_unlock(n);
+	}
+	domain.unregister_evaluator(n);
+	fail_unless(1 == domain.withdraw(1), NULL);
+}
+END_TEST
+
+/*
+ * Returns the ID of the rule matching incident in rule_set_id of
+ * domain, or NULL.
+ */
+static const char*
+evaluate_in_domain(ConcurrentRuleDomain & domain,
+		   const unsigned int rule_set_id,
+		   const Event & incident)
+{
+	static char id[32];
+	const int evaluator = domain.register_evaluator();
+	const RuleDomainSnapshot *snapshot;
+	RuleEvaluation evaluation;
+	const char *retv;
+
+	fail_unless(-1 != evaluator, NULL);
+	snapshot = domain.read_lock(evaluator);
+	retv = evaluate_incident_in_domain(snapshot, rule_set_id, &incident, &evaluation);
+	if (retv) {
+		snprintf(id, sizeof(id), "%s", retv);
+		retv = id;
+	}
+	domain.read_unlock(evaluator);
+	domain.unregister_evaluator(evaluator);
+
+	return retv;
+}
+
+/*
+ * Test the ge and le conditions of published RuleSets on integers
+ * and strings.
+ */
+START_TEST(test_rule_domain_conditions)
+{
+	ConcurrentRuleDomain domain;
+	Event incident;
+	const char *id;
+
+	fail_unless(1 == publish_definition(domain, 1, "C 1 5000001 ge 10\nR GE 0 0 0 1\n"), NULL);
+	fail_unless(1 == publish_definition(domain, 2, "C 1 5000001 le 10\nR LE 0 0 0 1\n"), NULL);
+	fail_unless(1 == publish_definition(domain, 3, "C 1 A000002 ge abc\nC 2 B000003 le ABC\nR S 0 0 0 1+2\n"), NULL);
+
+	fail_unless(1 == incident.set(TAG(vt_uint32, 1), (uint64_t)9), NULL);
+	fail_unless(NULL == evaluate_in_domain(domain, 1, incident), NULL);
+	id = evaluate_in_domain(domain, 2, incident);
+	fail_unless(id && !strcmp("LE", id), NULL);
+
+	fail_unless(1 == incident.set(TAG(vt_uint32, 1), (uint64_t)10), NULL);
+	id = evaluate_in_domain(domain, 1, incident);
+	fail_unless(id && !strcmp("GE", id), NULL);
+	id = evaluate_in_domain(domain, 2, incident);
+	fail_unless(id && !strcmp("LE", id), NULL);
+
+	fail_unless(1 == incident.set(TAG(vt_uint32, 1), (uint64_t)11), NULL);
+	id = evaluate_in_domain(domain, 1, incident);
+	fail_unless(id && !strcmp("GE", id), NULL);
+	fail_unless(NULL == evaluate_in_domain(domain, 2, incident), NULL);
+
+	// case sensitive ge, case insensitive le
+	fail_unless(1 == incident.set(TAG(vt_ASCIIString, 2), (void*)"abc"), NULL);
+	fail_unless(1 == incident.set(TAG(vt_ASCIIStringNoCase, 3), (void*)"abc"), NULL);
+	id = evaluate_in_domain(domain, 3, incident);
+	fail_unless(id && !strcmp("S", id), NULL);
+	fail_unless(1 == incident.set(TAG(vt_ASCIIString, 2), (void*)"abb"), NULL);
+	fail_unless(NULL == evaluate_in_domain(domain, 3, incident), NULL);
+	fail_unless(1 == incident.set(TAG(vt_ASCIIString, 2), (void*)"abd"), NULL);
+	fail_unless(1 == incident.set(TAG(vt_ASCIIStringNoCase, 3), (void*)"abD"), NULL);
+	fail_unless(NULL == evaluate_in_domain(domain, 3, incident), NULL);
+	fail_unless(1 == incident.set(TAG(vt_ASCIIStringNoCase, 3), (void*)"AB"), NULL);
+	id = evaluate_in_domain(domain, 3, incident);
+	fail_unless(id && !strcmp("S", id), NULL);
+
+	fail_unless(1 == domain.withdraw(1), NULL);
+	fail_unless(1 == domain.withdraw(2), NULL);
+	fail_unless(1 == domain.withdraw(3), NULL);
+}
+END_TEST
+
+Suite*
+rule_engine_suite(void)
+{
+	Suite *s = suite_create("RULE ENGINE");
+
+	/* Core test case */
+	TCase *tc_core = tcase_create("Core");
+
+	tcase_set_timeout(tc_core, 60);
+
+	tcase_add_test(tc_core, test_rule_compiler);
+	tcase_add_test(tc_core, test_rule_compiler_random);
+	tcase_add_test(tc_core, test_rule_index);
+	tcase_add_test(tc_core, test_rule_evaluation_memo);
+	tcase_add_test(tc_core, test_event);
+	tcase_add_test(tc_core, test_rule_batch);
+	tcase_add_test(tc_core, test_rule_domain);
+	tcase_add_test(tc_core, test_rule_domain_conditions);
+	suite_add_tcase(s, tc_core);
+
+	return s;
+}
+
+int
+main(int /* argc */, char ** /* argv */)
+{
+	int number_failed;
+	Suite *s = rule_engine_suite();
+	SRunner *sr = srunner_create(s);
+
+	srunner_run_all(sr, CK_VERBOSE);
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,434 @@
+/*
+ *    Copyright (C) 2013, Jules Colding <jcolding@gmail.com>.
+ *
+ *    All Rights Reserved.
+ */
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 
+ *     (1) Redistributions of source code must retain the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer.
+ * 
+ *     (2) Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *     
+ *     (3) Neither the name of the copyright holder nor the names of
+ *     its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written
+ *     permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS
+ * OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifdef HAVE_CONFIG_H
+    #include "ac_config.h"
+#endif
+#include <string.h>
+#include <ctype.h>
+#include "rule_domain.h"
+
+RuleSetDefinition::~RuleSetDefinition()
+{
+	for (RuleSet::size_type n = 0; n < rules.size(); ++n) {
+		free(rules[n].expression);
+		free(rules[n].id);
+	}
+	for (CriteriaCache::iterator it = criteria.begin(); it != criteria.end(); ++it) {
+		switch (it->second.tag >> 24) {
+		case vt_ASCIIString:
+		case vt_ASCIIStringNoCase:
+		case vt_UTF8String:
+		case vt_UTF8StringNoCase:
+			free(it->second.ptr_value);
+			break;
+		default:
+			break;
+		}
+	}
+}
+
+/*
+ * Copies the next whitespace delimited token into a malloc()'ed
+ * string. Returns NULL if there is no token or memory is exhausted.
+ */
+static char*
+next_token(const char **pos)
+{
+	const char *start;
+
+	while ((' ' == **pos) || ('\t' == **pos))
+		++(*pos);
+	start = *pos;
+	while (**pos && !isspace((unsigned char)**pos))
+		++(*pos);
+	if (start == *pos)
+		return NULL;
+
+	return strndup(start, *pos - start);
+}
+
+static int
+parse_condition(const char * const str,
+		enum Evaluation & cond)
+{
+	static const struct {
+		const char *name;
+		enum Evaluation cond;
+	} conditions[] = {
+		{ "eq", eEqual },
+		{ "gt", eGreaterThan },
+		{ "ge", eGreaterThanOrEqual },
+		{ "lt", eLessThan },
+		{ "le", eLessThanOrEqual },
+		{ "ne", eNotEqual },
+		{ "true", eTrue },
+		{ "false", eFalse },
+	};
+
+	for (size_t n = 0; n < sizeof(conditions)/sizeof(conditions[0]); ++n) {
+		if (!strcmp(conditions[n].name, str)) {
+			cond = conditions[n].cond;
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+static int
+parse_criteria(const char **pos,
+	       struct RuleSetDefinition * const definition)
+{
+	struct Criteria criteria;
+	unsigned long criteria_id;
+	char *token[4] = { NULL, NULL, NULL, NULL };
+	char *end;
+	int retv = 0;
+
+	for (int n = 0; n < 4; ++n) {
+		token[n] = next_token(pos);
+		if (!token[n])
+			goto out;
+	}
+
+	criteria_id = strtoul(token[0], &end, 16);
+	if (*end)
+		goto out;
+	criteria.tag = strtoul(token[1], &end, 16);
+	if (*end)
+		goto out;
+	if (!parse_condition(token[2], criteria.cond))
+		goto out;
+
+	switch (criteria.tag >> 24) {
+	case vt_ASCIIString:
+	case vt_ASCIIStringNoCase:
+	case vt_UTF8String:
+	case vt_UTF8StringNoCase:
+		criteria.int_value = 0;
+		criteria.ptr_value = token[3];
+		token[3] = NULL;
+		break;
+	default:
+		criteria.int_value = strtoull(token[3], &end, 0);
+		criteria.ptr_value = NULL;
+		if (*end)
+			goto out;
+		break;
+	}
+
+	if (definition->criteria.count(criteria_id)) {
+		d("Criteria %lx defined twice", criteria_id);
+		free(criteria.ptr_value);
+		goto out;
+	}
+	definition->criteria[criteria_id] = criteria;
+	retv = 1;
+out:
+	for (int n = 0; n < 4; ++n)
+		free(token[n]);
+
+	return retv;
+}
+
+static int
+parse_rule(const char **pos,
+	   struct RuleSetDefinition * const definition)
+{
+	struct Rule rule;
+	char *token[4] = { NULL, NULL, NULL, NULL };
+	const char *line_end;
+	char *end;
+	int retv = 0;
+
+	rule.id = NULL;
+	rule.expression = NULL;
+
+	for (int n = 0; n < 4; ++n) {
+		token[n] = next_token(pos);
+		if (!token[n])
+			goto out;
+	}
+	rule.priority = strtoul(token[1], &end, 0);
+	if (*end)
+		goto out;
+	rule.action = strtoul(token[2], &end, 0);
+	if (*end)
+		goto out;
+	if (strcmp("0", token[3]) && strcmp("1", token[3]))
+		goto out;
+	rule.negate = ('1' == token[3][0]);
+
+	while ((' ' == **pos) || ('\t' == **pos))
+		++(*pos);
+	line_end = strchr(*pos, '\n');
+	if (!line_end)
+		line_end = *pos + strlen(*pos);
+	rule.expression = strndup(*pos, line_end - *pos);
+	if (!rule.expression)
+		goto out;
+	*pos = line_end;
+
+	rule.id = token[0];
+	token[0] = NULL;
+	definition->rules.push_back(rule);
+	rule.id = NULL;
+	rule.expression = NULL;
+	retv = 1;
+out:
+	free(rule.id);
+	free(rule.expression);
+	for (int n = 0; n < 4; ++n)
+		free(token[n]);
+
+	return retv;
+}
+
+int
+parse_rule_set_definition(const char * const text,
+			  struct RuleSetDefinition * const definition)
+{
+	const char *pos = text;
+
+	try {
+		while (*pos) {
+			while (isspace((unsigned char)*pos))
+				++pos;
+
+			switch (*pos) {
+			case '\0':
+				break;
+			case 'C':
+				++pos;
+				if (!parse_criteria(&pos, definition))
+					goto err;
+				break;
+			case 'R':
+				++pos;
+				if (!parse_rule(&pos, definition))
+					goto err;
+				break;
+			default:
+				goto err;
+			}
+
+			// nothing but whitespace may follow on the line
+			while ((' ' == *pos) || ('\t' == *pos))
+				++pos;
+			if (*pos && ('\n' != *pos))
+				goto err;
+		}
+	}
+	catch (...) {
+		return 0;
+	}
+
+	return 1;
+err:
+	d("Malformed RuleSet definition at: %.32s", pos);
+
+	return 0;
+}
+
+const char*
+evaluate_incident_in_domain(const RuleDomainSnapshot * const snapshot,
+			    const unsigned int rule_set_id,
+			    const Event * const incident,
+			    RuleEvaluation * const evaluation)
+{
+	RuleDomainSnapshot::const_iterator it = snapshot->find(rule_set_id);
+	if (snapshot->end() == it)
+		return NULL;
+
+	return evaluate_incident_with_compiled_rules(incident, &it->second->compiled, evaluation);
+}
+
+ConcurrentRuleDomain::ConcurrentRuleDomain(void)
+	: snapshot_(new RuleDomainSnapshot),
+	  epoch_(1)
+{
+	memset(evaluators_, 0, sizeof(evaluators_));
+	pthread_mutex_init(&publish_lock_, NULL);
+}
+
+ConcurrentRuleDomain::~ConcurrentRuleDomain()
+{
+	// no evaluators are left, so everything can go
+	for (size_t n = 0; n < retired_.size(); ++n) {
+		delete retired_[n].snapshot;
+		delete retired_[n].definition;
+	}
+	for (RuleDomainSnapshot::const_iterator it = snapshot_->begin(); it != snapshot_->end(); ++it)
+		delete it->second;
+	delete snapshot_;
+
+	pthread_mutex_destroy(&publish_lock_);
+}
+
+int
+ConcurrentRuleDomain::register_evaluator(void)
+{
+	for (int n = 0; n < RULE_DOMAIN_MAX_EVALUATORS; ++n) {
+		if (__sync_bool_compare_and_swap(&evaluators_[n].in_use, 0, 1))
+			return n;
+	}
+
+	return -1;
+}
+
+void
+ConcurrentRuleDomain::unregister_evaluator(const int evaluator)
+{
+	__atomic_store_n(&evaluators_[evaluator].epoch, 0, __ATOMIC_RELEASE);
+	__atomic_store_n(&evaluators_[evaluator].in_use, 0, __ATOMIC_RELEASE);
+}
+
+/*
+ * Must be called with publish_lock_ held. definition may be NULL to
+ * remove the RuleSet.
+ */
+int
+ConcurrentRuleDomain::replace(const unsigned int rule_set_id,
+			      const struct RuleSetDefinition * const definition)
+{
+	const RuleDomainSnapshot *old_snapshot = snapshot_;
+	RuleDomainSnapshot *new_snapshot = NULL;
+	struct retired_t retired;
+
+	try {
+		new_snapshot = new RuleDomainSnapshot(*old_snapshot);
+		retired_.reserve(retired_.size() + 1);
+	}
+	catch (...) {
+		delete new_snapshot;
+		return 0;
+	}
+
+	RuleDomainSnapshot::iterator it = new_snapshot->find(rule_set_id);
+	retired.definition = (new_snapshot->end() == it) ? NULL : it->second;
+	if (definition) {
+		try {
+			(*new_snapshot)[rule_set_id] = definition;
+		}
+		catch (...) {
+			delete new_snapshot;
+			return 0;
+		}
+	} else {
+		if (new_snapshot->end() == it) {
+			delete new_snapshot;
+			return 0;
+		}
+		new_snapshot->erase(it);
+	}
+
+	/*
+	 * An evaluator which loaded the old snapshot announced an
+	 * epoch before the swap and so before the increment.
+	 */
+	__atomic_store_n(&snapshot_, (const RuleDomainSnapshot*)new_snapshot, __ATOMIC_SEQ_CST);
+	retired.epoch = __atomic_add_fetch(&epoch_, 1, __ATOMIC_SEQ_CST);
+	retired.snapshot = old_snapshot;
+	retired_.push_back(retired); // capacity reserved above
+
+	reclaim_locked();
+
+	return 1;
+}
+
+int
+ConcurrentRuleDomain::publish(const unsigned int rule_set_id,
+			      struct RuleSetDefinition * const definition)
+{
+	int retv;
+
+	if (!compile_rule_set(&definition->rules, &definition->criteria, &definition->compiled))
+		return 0;
+
+	pthread_mutex_lock(&publish_lock_);
+	retv = replace(rule_set_id, definition);
+	pthread_mutex_unlock(&publish_lock_);
+
+	return retv;
+}
+
+int
+ConcurrentRuleDomain::withdraw(const unsigned int rule_set_id)
+{
+	int retv;
+
+	pthread_mutex_lock(&publish_lock_);
+	retv = replace(rule_set_id, NULL);
+	pthread_mutex_unlock(&publish_lock_);
+
+	return retv;
+}
+
+void
+ConcurrentRuleDomain::reclaim(void)
+{
+	pthread_mutex_lock(&publish_lock_);
+	reclaim_locked();
+	pthread_mutex_unlock(&publish_lock_);
+}
+
+void
+ConcurrentRuleDomain::reclaim_locked(void)
+{
+	uint64_t oldest = UINT64_MAX;
+	uint64_t epoch;
+	size_t kept = 0;
+
+	for (int n = 0; n < RULE_DOMAIN_MAX_EVALUATORS; ++n) {
+		epoch = __atomic_load_n(&evaluators_[n].epoch, __ATOMIC_SEQ_CST);
+		if (epoch && (epoch < oldest))
+			oldest = epoch;
+	}
+
+	for (size_t n = 0; n < retired_.size(); ++n) {
+		if (retired_[n].epoch <= oldest) {
+			delete retired_[n].snapshot;
+			delete retired_[n].definition;
+		} else {
+			retired_[kept++] = retired_[n];
+		}
+	}
+	retired_.resize(kept);
+}
@@ -0,0 +1,221 @@
+/*
+ *    Copyright (C) 2013, Jules Colding <jcolding@gmail.com>.
+ *
+ *    All Rights Reserved.
+ */
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 
+ *     (1) Redistributions of source code must retain the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer.
+ * 
+ *     (2) Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *     
+ *     (3) Neither the name of the copyright holder nor the names of
+ *     its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written
+ *     permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS
+ * OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#pragma once
+
+#ifdef HAVE_CONFIG_H
+    #include "ac_config.h"
+#endif
+#include <pthread.h>
+#include <vector>
+#include <map>
+#include "stdlib/disruptor/memsizes.h"
+#include "rule_engine.h"
+
+/*
+ * A thread safe RuleDomain.
+ *
+ * Any number of evaluator threads can evaluate RuleSets concurrently
+ * while new RuleSets are published. Evaluators work on an immutable
+ * snapshot of the domain and never block. A publisher compiles the
+ * new RuleSet, builds a new snapshot sharing all unchanged RuleSets
+ * and swaps it in. The replaced snapshot is reclaimed, RCU style,
+ * once every evaluator has left the epoch in which it could have
+ * seen it.
+ *
+ * Usage in an evaluator thread:
+ *
+ *    int evaluator = domain->register_evaluator();
+ *    RuleEvaluation scratch;
+ *    ...
+ *    const RuleDomainSnapshot *snapshot = domain->read_lock(evaluator);
+ *    const char *id = evaluate_incident_in_domain(snapshot, rule_set_id, &event, &scratch);
+ *    ... // id is valid until read_unlock()
+ *    domain->read_unlock(evaluator);
+ *    ...
+ *    domain->unregister_evaluator(evaluator);
+ *
+ * Read side critical sections must be short as nothing replaced
+ * while they are open can be freed.
+ */
+#define RULE_DOMAIN_MAX_EVALUATORS (64)
+
+/*
+ * A RuleSet together with everything it refers to. Owns the rule
+ * strings and the ptr_value of string criteria, which must all be
+ * malloc()'ed.
+ */
+struct RuleSetDefinition
+{
+	RuleSetDefinition(void)
+		{
+		};
+
+	~RuleSetDefinition();
+
+	CriteriaCache criteria;
+	RuleSet rules;       // evaluated in this order
+	CompiledRuleSet compiled;
+
+private:
+	RuleSetDefinition(const RuleSetDefinition &);
+	RuleSetDefinition & operator=(const RuleSetDefinition &);
+};
+
+typedef std::map</*RuleSetID*/unsigned int, const struct RuleSetDefinition*> RuleDomainSnapshot;
+
+/*
+ * Parses a textual RuleSet definition. One criteria or rule per
+ * line. Criteria must be defined before the rules using them.
+ *
+ *    C <criteria ID> <tag> <condition> <value>
+ *    R <rule ID> <priority> <action> <negate> <expression>
+ *
+ * Criteria IDs and tags are hexadecimal as in expressions. The
+ * condition is one of eq, gt, ge, lt, le, ne, true or false. The
+ * value is an integer, in any base strtoull() understands, or, for
+ * string tags, a string without whitespace. negate is 0 (zero) or
+ * 1 (one). The expression is the rest of the line.
+ *
+ * Returns 1 (one) if all is well, 0 (zero) if text is malformed or
+ * memory is exhausted.
+ */
+extern int
+parse_rule_set_definition(const char * const text,
+			  struct RuleSetDefinition * const definition);
+
+/*
+ * Evaluates incident using RuleSet rule_set_id of snapshot. Returns
+ * the ID of the first matching rule or NULL if none matched or if
+ * there is no such RuleSet.
+ */
+extern const char*
+evaluate_incident_in_domain(const RuleDomainSnapshot * const snapshot,
+			    const unsigned int rule_set_id,
+			    const Event * const incident,
+			    RuleEvaluation * const evaluation);
+
+class ConcurrentRuleDomain
+{
+public:
+	ConcurrentRuleDomain(void);
+
+	~ConcurrentRuleDomain();
+
+	/*
+	 * Returns an evaluator ID to be used by the calling thread
+	 * or -1 (minus one) if RULE_DOMAIN_MAX_EVALUATORS are
+	 * registered already.
+	 */
+	int register_evaluator(void);
+
+	void unregister_evaluator(const int evaluator);
+
+	/*
+	 * Opens a read side critical section and returns the current
+	 * snapshot. It stays valid until read_unlock(). Critical
+	 * sections of the same evaluator must not nest.
+	 */
+	const RuleDomainSnapshot *read_lock(const int evaluator)
+		{
+			uint64_t epoch = __atomic_load_n(&epoch_, __ATOMIC_SEQ_CST);
+
+			__atomic_store_n(&evaluators_[evaluator].epoch, epoch, __ATOMIC_SEQ_CST);
+
+			return __atomic_load_n(&snapshot_, __ATOMIC_SEQ_CST);
+		};
+
+	void read_unlock(const int evaluator)
+		{
+			__atomic_store_n(&evaluators_[evaluator].epoch, 0, __ATOMIC_RELEASE);
+		};
+
+	/*
+	 * Compiles definition and makes it RuleSet rule_set_id,
+	 * replacing any previous RuleSet with that ID. The domain
+	 * takes ownership of definition if, and only if, all is
+	 * well. Publishers are serialized but never wait for
+	 * evaluators.
+	 *
+	 * Returns 1 (one) if all is well, 0 (zero) if definition did
+	 * not compile or memory is exhausted.
+	 */
+	int publish(const unsigned int rule_set_id,
+		    struct RuleSetDefinition * const definition);
+
+	/*
+	 * Removes RuleSet rule_set_id.
+	 *
+	 * Returns 1 (one) if all is well, 0 (zero) if there is no such
+	 * RuleSet or memory is exhausted.
+	 */
+	int withdraw(const unsigned int rule_set_id);
+
+	/*
+	 * Frees replaced snapshots and RuleSets which no evaluator can
+	 * see anymore. Invoked by publish() and withdraw().
+	 */
+	void reclaim(void);
+
+private:
+	struct evaluator_t {
+		uint64_t epoch; // 0 (zero) when outside a critical section
+		int in_use;
+		uint8_t padding[CACHE_LINE_SIZE - sizeof(uint64_t) - sizeof(int)];
+	} __attribute__((aligned(CACHE_LINE_SIZE)));
+
+	struct retired_t {
+		uint64_t epoch; // may be freed when all evaluators are beyond this epoch
+		const RuleDomainSnapshot *snapshot;
+		const struct RuleSetDefinition *definition;
+	};
+
+	int replace(const unsigned int rule_set_id,
+		    const struct RuleSetDefinition * const definition);
+	void reclaim_locked(void);
+
+	ConcurrentRuleDomain(const ConcurrentRuleDomain &);
+	ConcurrentRuleDomain & operator=(const ConcurrentRuleDomain &);
+
+	struct evaluator_t evaluators_[RULE_DOMAIN_MAX_EVALUATORS];
+	const RuleDomainSnapshot *snapshot_;
+	uint64_t epoch_;
+	pthread_mutex_t publish_lock_;
+	std::vector<struct retired_t> retired_;
+};
@@ -42,6 +42,7 @@
 #endif
 #include <string.h>
 #include <errno.h>
+#include <iterator>
 #include "rule_engine.h"
 
 static bool
@@ -55,8 +56,12 @@ eval_string_case(const void * const lval,
 		return (0 == strcmp((const char*)lval, (const char*)rval));
 	case eGreaterThan:
 		return (0 < strcmp((const char*)lval, (const char*)rval));
+	case eGreaterThanOrEqual:
+		return (0 <= strcmp((const char*)lval, (const char*)rval));
 	case eLessThan:
 		return (0 > strcmp((const char*)lval, (const char*)rval));
+	case eLessThanOrEqual:
+		return (0 >= strcmp((const char*)lval, (const char*)rval));
 	case eNotEqual:
 		return (0 != strcmp((const char*)lval, (const char*)rval));
 	case eTrue:
@@ -80,8 +85,12 @@ eval_string_no_case(const void * const lval,
 		return (0 == strcasecmp((const char*)lval, (const char*)rval));
 	case eGreaterThan:
 		return (0 < strcasecmp((const char*)lval, (const char*)rval));
+	case eGreaterThanOrEqual:
+		return (0 <= strcasecmp((const char*)lval, (const char*)rval));
 	case eLessThan:
 		return (0 > strcasecmp((const char*)lval, (const char*)rval));
+	case eLessThanOrEqual:
+		return (0 >= strcasecmp((const char*)lval, (const char*)rval));
 	case eNotEqual:
 		return (0 != strcasecmp((const char*)lval, (const char*)rval));
 	case eTrue:
@@ -131,8 +140,12 @@ eval_generic(const void * const lval,
 		return (*(T*)lval == *(T*)rval);
 	case eGreaterThan:
 		return (*(T*)lval > *(T*)rval);
+	case eGreaterThanOrEqual:
+		return (*(T*)lval >= *(T*)rval);
 	case eLessThan:
 		return (*(T*)lval < *(T*)rval);
+	case eLessThanOrEqual:
+		return (*(T*)lval <= *(T*)rval);
 	case eNotEqual:
 		return (*(T*)lval != *(T*)rval);
 	case eTrue:
@@ -145,209 +158,545 @@ eval_generic(const void * const lval,
 	return false;
 }
 
+template<class T> static bool
+eval_integer(const struct TagInstance * const lval,
+	     const struct Criteria * const criteria)
+{
+	return eval_generic<T>(&lval->int_value,
+			       criteria->cond,
+			       &criteria->int_value);
+}
+
 static bool
-evaluate_criteria(char **expression,
-		  const Event * const incident,
-		  const CriteriaCache * const criteria_cache)
+eval_ascii_string(const struct TagInstance * const lval,
+		  const struct Criteria * const criteria)
 {
-//	const CriteriaCache & cc = *criteria_cache;
+	return eval_string_case(lval->ptr_value,
+				criteria->cond,
+				criteria->ptr_value);
+}
 
-	// extract criteria ID
-	const unsigned int criteria_id = strtoul(*expression, expression, 16);
-	if (!criteria_id && (EINVAL == errno))
-	{
-		d("BUUUUG! Criteria ID = %u", criteria_id);
-		return false; // BUG - log and scream or else?
-	}
+static bool
+eval_ascii_string_no_case(const struct TagInstance * const lval,
+			  const struct Criteria * const criteria)
+{
+	return eval_string_no_case(lval->ptr_value,
+				   criteria->cond,
+				   criteria->ptr_value);
+}
 
-	// find criteria
-	CriteriaCache::const_iterator cit = criteria_cache->find(criteria_id);
-	if (criteria_cache->end() == cit)
+/*
+ * Returns 1 (one) if the evaluators have a branch for cond, 0 (zero)
+ * if not.
+ */
+static int
+condition_is_supported(const enum Evaluation cond)
+{
+	switch (cond)
 	{
-		d("Error! Criteria ID = %u", criteria_id);
-		return false; // configuration error - log
+	case eEqual:
+	case eGreaterThan:
+	case eGreaterThanOrEqual:
+	case eLessThan:
+	case eLessThanOrEqual:
+	case eNotEqual:
+	case eTrue:
+	case eFalse:
+		return 1;
+	default:
+		break;
 	}
 
-	// find TagInstance in Event
-	Event::const_iterator eit = incident->find(cit->second.tag);
-	if (incident->end() == eit)
-	{
-		d("Tag not found in event: %#.8x", cit->second.tag);
-		return false;
-	}
-	switch (cit->second.tag >> 24)
+	return 0;
+}
+
+/*
+ * Returns the evaluator for the value type of the tag and the
+ * condition of criteria or NULL if either is not supported.
+ */
+static criteria_evaluator
+resolve_evaluator(const struct Criteria * const criteria)
+{
+	if (!condition_is_supported(criteria->cond))
+		return NULL;
+
+	switch (criteria->tag >> 24)
 	{
 	case vt_boolean:
-		return eval_generic<bool>(&eit->second.int_value,
-					  cit->second.cond,
-					  &cit->second.int_value);
+		return eval_integer<bool>;
 	case vt_uint8:
-		return eval_generic<uint8_t>(&eit->second.int_value,
-					     cit->second.cond,
-					     &cit->second.int_value);
-		break;
+		return eval_integer<uint8_t>;
 	case vt_int8:
-
-		return eval_generic<int8_t>(&eit->second.int_value,
-					    cit->second.cond,
-					    &cit->second.int_value);
+		return eval_integer<int8_t>;
 	case vt_uint16:
-		return eval_generic<uint16_t>(&eit->second.int_value,
-					      cit->second.cond,
-					      &cit->second.int_value);
+		return eval_integer<uint16_t>;
 	case vt_int16:
-		return eval_generic<int16_t>(&eit->second.int_value,
-					     cit->second.cond,
-					     &cit->second.int_value);
+		return eval_integer<int16_t>;
 	case vt_uint32:
-		return eval_generic<uint32_t>(&eit->second.int_value,
-					      cit->second.cond,
-					      &cit->second.int_value);
+		return eval_integer<uint32_t>;
 	case vt_int32:
-		return eval_generic<int32_t>(&eit->second.int_value,
-					     cit->second.cond,
-					     &cit->second.int_value);
+		return eval_integer<int32_t>;
 	case vt_ASCIIString:
-		return eval_string_case(eit->second.ptr_value,
-					cit->second.cond,
-					cit->second.ptr_value);
+		return eval_ascii_string;
 	case vt_ASCIIStringNoCase:
-		return eval_string_no_case(eit->second.ptr_value,
-					   cit->second.cond,
-					   cit->second.ptr_value);
+		return eval_ascii_string_no_case;
 	// case vt_ieee754:
-	// 	break;
 	// case vt_UTF8String:
-	// 	return eval_string_utf8((*incident)[tag].value,
-	// 				(*criteria_cache)[criteria_id].cond,
-	// 				(*criteria_cache)[criteria_id].fixed_value);
-	// 	break;
 	// case vt_UTF8StringNoCase:
-	// 	return eval_string_utf8_no_case((*incident)[tag].value,
-	// 					(*criteria_cache)[criteria_id].cond,
-	// 					(*criteria_cache)[criteria_id].fixed_value);
-	// 	break;
 	default:
-		d("BUG!\n");
 		break;
 	}
 
-	return false; // BUG - log, scream and crash?
+	return NULL;
 }
 
 static inline void
-skip_forward_over_block(char **expression)
+skip_space(const char **expression)
 {
-	unsigned int par_cnt = 1;
-
-	do {
+	while (' ' == **expression)
 		++(*expression);
-		switch (**expression) {
-		case PAR_END:
-			--par_cnt;
-			if (!par_cnt)
-				return;
-		case PAR_START:
-			++par_cnt;
-			break;
-		default:
-			break;
-		}
-	} while (**expression);
 }
 
-
 static inline void
-skip_forward_to_OR(char **expression)
+patch_jumps(std::vector<struct RuleInstruction> & code,
+	    std::vector<size_t> & jumps)
 {
-	do {
-		switch (**expression) {
-		case '\0':
-		case OR:
-			return;
-		case PAR_START:
-			skip_forward_over_block(expression);
-		default:
-			break;
-		}
-		++(*expression);
-	} while (**expression);
+	for (size_t n = 0; n < jumps.size(); ++n)
+		code[jumps[n]].target = code.size();
+	jumps.clear();
 }
 
-static inline void
-skip_forward_to_AND(char **expression)
+/*
+ * Normalizes an integer value to the value type of tag, so that
+ * values which compare equal in eval_generic() are equal as keys.
+ *
+ * Returns 1 (one) if the value type can be indexed, 0 (zero) if not.
+ */
+static int
+normalize_index_value(const uint32_t tag,
+		      const uint64_t value,
+		      uint64_t & normalized)
 {
-	do {
-		switch (**expression) {
-		case '\0':
-		case AND:
-			return;
-		case PAR_START:
-			skip_forward_over_block(expression);
-		default:
-			break;
-		}
+	switch (tag >> 24)
+	{
+	case vt_boolean:
+	case vt_uint8:
+		normalized = (uint8_t)value;
+		return 1;
+	case vt_int8:
+		normalized = (uint64_t)(int64_t)(int8_t)value;
+		return 1;
+	case vt_uint16:
+		normalized = (uint16_t)value;
+		return 1;
+	case vt_int16:
+		normalized = (uint64_t)(int64_t)(int16_t)value;
+		return 1;
+	case vt_uint32:
+		normalized = (uint32_t)value;
+		return 1;
+	case vt_int32:
+		normalized = (uint64_t)(int64_t)(int32_t)value;
+		return 1;
+	default:
+		break;
+	}
+
+	return 0;
+}
+
+/*
+ * Criteria which must be true for an expression to be true, sorted
+ * by address.
+ */
+typedef std::vector<const struct Criteria*> RequiredCriteria;
+
+struct rule_compiler
+{
+	const CriteriaCache *criteria_cache;
+	std::vector<struct RuleInstruction> *code;
+	std::map<const struct Criteria*, uint32_t> slots;
+};
+
+static size_t
+emit(std::vector<struct RuleInstruction> & code,
+     const enum RuleOpcode op,
+     const uint32_t slot,
+     const struct Criteria * const criteria,
+     const criteria_evaluator eval)
+{
+	struct RuleInstruction instr;
+
+	instr.op = op;
+	instr.target = 0;
+	instr.slot = slot;
+	instr.criteria = criteria;
+	instr.eval = eval;
+	code.push_back(instr);
+
+	return code.size() - 1;
+}
+
+static int
+compile_group(const char **expression,
+	      struct rule_compiler & rc,
+	      const int nested,
+	      RequiredCriteria & required);
+
+static int
+compile_operand(const char **expression,
+		struct rule_compiler & rc,
+		RequiredCriteria & required)
+{
+	criteria_evaluator eval;
+	uint32_t slot;
+	char *end;
+
+	skip_space(expression);
+	if (PAR_START == **expression) {
 		++(*expression);
-	} while (**expression);
+		return compile_group(expression, rc, 1, required);
+	}
+
+	const unsigned long criteria_id = strtoul(*expression, &end, 16);
+	if (end == *expression)
+	{
+		d("Malformed expression at: %s", *expression);
+		return 0;
+	}
+	*expression = end;
+
+	CriteriaCache::const_iterator cit = rc.criteria_cache->find(criteria_id);
+	if (rc.criteria_cache->end() == cit)
+	{
+		d("Error! Criteria ID = %lu", criteria_id);
+		return 0;
+	}
+
+	eval = resolve_evaluator(&cit->second);
+	if (!eval)
+	{
+		d("Unsupported condition %d or value type of tag %#.8x", cit->second.cond, cit->second.tag);
+		return 0;
+	}
+
+	std::map<const struct Criteria*, uint32_t>::const_iterator sit = rc.slots.find(&cit->second);
+	if (rc.slots.end() == sit)
+	{
+		slot = rc.slots.size();
+		rc.slots[&cit->second] = slot;
+	}
+	else
+	{
+		slot = sit->second;
+	}
+	emit(*rc.code, op_test, slot, &cit->second, eval);
+
+	required.assign(1, &cit->second);
+
+	return 1;
 }
 
-static bool
-evaluate_expression(char **expression,
-		    const Event * const incident,
-		    const CriteriaCache * const criteria_cache)
+/*
+ * Compiles operands separated by operators until the end of the
+ * expression or, if nested, the matching PAR_END.
+ *
+ * A pending op_jump_if_false of an AND is taken when the register is
+ * false, so it goes to the next OR, which will then evaluate its
+ * right hand operand. Likewise for op_jump_if_true of an OR and the
+ * next AND.
+ *
+ * As evaluation is left to right the criteria required by "x AND y"
+ * are those required by x or by y, and the criteria required by
+ * "x OR y" are those required by both.
+ */
+static int
+compile_group(const char **expression,
+	      struct rule_compiler & rc,
+	      const int nested,
+	      RequiredCriteria & required)
 {
-	bool retv = false;
+	std::vector<size_t> and_jumps;
+	std::vector<size_t> or_jumps;
+	RequiredCriteria operand;
+	RequiredCriteria merged;
+	char op;
 
-	while (**expression) {
-		if (PAR_START == **expression)
-			++(*expression);
+	if (!compile_operand(expression, rc, required))
+		return 0;
 
-		switch (**expression) {
+	for (;;) {
+		skip_space(expression);
+		op = **expression;
+		switch (op) {
 		case '\0':
-			return retv;
-		case PAR_END:
-			++(*expression);
-			continue;
-		case AND:
-			++(*expression);
-			if (!retv)
+			if (nested)
 			{
-				skip_forward_to_OR(expression);
+				d("Missing %c", PAR_END);
+				return 0;
 			}
-			if (PAR_START == **expression)
-			{
-				retv = retv && evaluate_expression(expression, incident, criteria_cache);
-			}
-			else
+			goto out;
+		case PAR_END:
+			if (!nested)
 			{
-				retv = retv && evaluate_criteria(expression, incident, criteria_cache);
+				d("Unbalanced %c", PAR_END);
+				return 0;
 			}
+			++(*expression);
+			goto out;
+		case AND:
+			patch_jumps(*rc.code, or_jumps);
+			and_jumps.push_back(emit(*rc.code, op_jump_if_false, 0, NULL, NULL));
 			break;
 		case OR:
-			++(*expression);
-			if (retv) {
-				skip_forward_to_AND(expression);
-				continue;
-			}
-			if (PAR_START == **expression)
+			patch_jumps(*rc.code, and_jumps);
+			or_jumps.push_back(emit(*rc.code, op_jump_if_true, 0, NULL, NULL));
+			break;
+		default:
+			d("Malformed expression at: %s", *expression);
+			return 0;
+		}
+		++(*expression);
+
+		if (!compile_operand(expression, rc, operand))
+			return 0;
+
+		merged.clear();
+		if (AND == op)
+			std::set_union(required.begin(), required.end(),
+				       operand.begin(), operand.end(),
+				       std::back_inserter(merged));
+		else
+			std::set_intersection(required.begin(), required.end(),
+					      operand.begin(), operand.end(),
+					      std::back_inserter(merged));
+		required.swap(merged);
+	}
+out:
+	patch_jumps(*rc.code, and_jumps);
+	patch_jumps(*rc.code, or_jumps);
+
+	return 1;
+}
+
+/*
+ * Adds rule to the index under one of the required equality
+ * criteria. A criteria on an already indexed tag is preferred to
+ * keep the number of tags looked up per Event down.
+ */
+static void
+index_rule(CompiledRuleSet * const compiled,
+	   const uint32_t rule,
+	   const RequiredCriteria & required)
+{
+	const struct Criteria *key_criteria = NULL;
+	struct RuleIndexKey key;
+	uint64_t value;
+
+	for (size_t n = 0; n < required.size(); ++n) {
+		if (eEqual != required[n]->cond)
+			continue;
+		if (!normalize_index_value(required[n]->tag, required[n]->int_value, value))
+			continue;
+		if (!key_criteria)
+			key_criteria = required[n];
+		if (compiled->index_tags.end() != std::find(compiled->index_tags.begin(), compiled->index_tags.end(), required[n]->tag))
+		{
+			key_criteria = required[n];
+			break;
+		}
+	}
+
+	if (!key_criteria)
+	{
+		compiled->unindexed.push_back(rule);
+		return;
+	}
+
+	if (compiled->index_tags.end() == std::find(compiled->index_tags.begin(), compiled->index_tags.end(), key_criteria->tag))
+		compiled->index_tags.push_back(key_criteria->tag);
+
+	key.tag = key_criteria->tag;
+	normalize_index_value(key_criteria->tag, key_criteria->int_value, key.value);
+	compiled->index[key].push_back(rule);
+}
+
+int
+compile_rule_set(const RuleSet * const rules,
+		 const CriteriaCache * const criteria_cache,
+		 CompiledRuleSet * const compiled)
+{
+	struct rule_compiler rc;
+	struct CompiledRule rule;
+	RequiredCriteria required;
+	const char *expr;
+
+	compiled->code.clear();
+	compiled->rules.clear();
+	compiled->criteria_count = 0;
+	compiled->index.clear();
+	compiled->index_tags.clear();
+	compiled->unindexed.clear();
+
+	rc.criteria_cache = criteria_cache;
+	rc.code = &compiled->code;
+
+	try {
+		for (RuleSet::size_type n = 0; n < rules->size(); ++n) {
+			rule.negate = (*rules)[n].negate;
+			rule.priority = (*rules)[n].priority;
+			rule.action = (*rules)[n].action;
+			rule.id = (*rules)[n].id;
+			rule.entry = compiled->code.size();
+
+			// an empty expression is false
+			required.clear();
+			expr = (*rules)[n].expression;
+			skip_space(&expr);
+			if (*expr)
 			{
-				retv = retv || evaluate_expression(expression, incident, criteria_cache);
+				if (!compile_group(&expr, rc, 0, required))
+				{
+					d("Rule %s did not compile", (*rules)[n].id);
+					goto err;
+				}
 			}
+			emit(compiled->code, op_end, 0, NULL, NULL);
+			compiled->rules.push_back(rule);
+
+			// a negated rule matches when its criteria do not
+			if (rule.negate)
+				compiled->unindexed.push_back(n);
 			else
-			{
-				retv = retv || evaluate_criteria(expression, incident, criteria_cache);
+				index_rule(compiled, n, required);
+		}
+	}
+	catch (...) {
+		goto err;
+	}
+	compiled->criteria_count = rc.slots.size();
+
+	return 1;
+err:
+	compiled->code.clear();
+	compiled->rules.clear();
+	compiled->index.clear();
+	compiled->index_tags.clear();
+	compiled->unindexed.clear();
+
+	return 0;
+}
+
+static inline bool
+run_rule(const Event * const incident,
+	 const struct RuleInstruction * const code,
+	 uint32_t pc,
+	 RuleEvaluation * const evaluation)
+{
+	uint64_t * const known = evaluation->known.data();
+	uint64_t * const value = evaluation->value.data();
+	const struct TagInstance *instance;
+	uint64_t bit;
+	uint32_t word;
+	bool reg = false;
+
+	for (;;) {
+		switch (code[pc].op) {
+		case op_test:
+			word = code[pc].slot / 64;
+			bit = 1ULL << (code[pc].slot % 64);
+			if (known[word] & bit) {
+				reg = (0 != (value[word] & bit));
+			} else {
+				instance = incident->find(code[pc].criteria->tag);
+				reg = instance && code[pc].eval(instance, code[pc].criteria);
+				if (!known[word])
+					evaluation->touched.push_back(word); // capacity reserved
+				known[word] |= bit;
+				if (reg)
+					value[word] |= bit;
 			}
+			++pc;
 			break;
-		case PAR_START:
-			retv = evaluate_expression(expression, incident, criteria_cache);
+		case op_jump_if_false:
+			pc = reg ? pc + 1 : code[pc].target;
 			break;
-		default:
-			retv = evaluate_criteria(expression, incident, criteria_cache);
+		case op_jump_if_true:
+			pc = reg ? code[pc].target : pc + 1;
 			break;
+		case op_end:
+			return reg;
+		}
+	}
+}
+
+const char*
+evaluate_incident_with_compiled_rules(const Event * const incident,
+				      const CompiledRuleSet * const compiled,
+				      RuleEvaluation * const evaluation)
+{
+	const struct RuleInstruction * const code = compiled->code.data();
+	const size_t words = (compiled->criteria_count + 63) / 64;
+	std::vector<uint32_t> & candidates = evaluation->candidates;
+	const struct TagInstance *instance;
+	RuleIndex::const_iterator iit;
+	struct RuleIndexKey key;
+	uint32_t rule;
+	bool retv;
+
+	try {
+		candidates.assign(compiled->unindexed.begin(), compiled->unindexed.end());
+		for (size_t n = 0; n < compiled->index_tags.size(); ++n) {
+			key.tag = compiled->index_tags[n];
+			instance = incident->find(key.tag);
+			if (!instance)
+				continue;
+			normalize_index_value(key.tag, instance->int_value, key.value);
+			iit = compiled->index.find(key);
+			if (compiled->index.end() == iit)
+				continue;
+			candidates.insert(candidates.end(), iit->second.begin(), iit->second.end());
+		}
+		evaluation->known.resize(words);
+		evaluation->value.resize(words);
+		evaluation->touched.reserve(words);
+	}
+	catch (...) {
+		return NULL;
+	}
+	if (candidates.empty())
+		return NULL;
+
+	// first match in RuleSet order
+	if (compiled->index_tags.size())
+		std::sort(candidates.begin(), candidates.end());
+
+	// only clear what the previous evaluation used
+	for (size_t n = 0; n < evaluation->touched.size(); ++n) {
+		if (evaluation->touched[n] < words) {
+			evaluation->known[evaluation->touched[n]] = 0;
+			evaluation->value[evaluation->touched[n]] = 0;
 		}
 	}
+	evaluation->touched.clear();
 
-	return retv;
+	for (size_t n = 0; n < candidates.size(); ++n) {
+		rule = candidates[n];
+		retv = run_rule(incident, code, compiled->rules[rule].entry, evaluation);
+		if (compiled->rules[rule].negate ? !retv : retv)
+			return compiled->rules[rule].id;
+	}
+
+	return NULL;
+}
+
+const char*
+evaluate_incident_with_compiled_rules(const Event * const incident,
+				      const CompiledRuleSet * const compiled)
+{
+	RuleEvaluation evaluation;
+
+	return evaluate_incident_with_compiled_rules(incident, compiled, &evaluation);
 }
 
 const char*
@@ -355,22 +704,39 @@ evaluate_incident_with_rules(const Event * const incident,
 			     const RuleSet * const rules,
 			     const CriteriaCache * const criteria_cache)
 {
-	RuleSet::size_type len = rules->size();
-	if (!len)
+	CompiledRuleSet compiled;
+
+	if (!compile_rule_set(rules, criteria_cache, &compiled))
 		return NULL;
 
-	bool retv;
-	char *expr;
-	for (RuleSet::size_type n = 0; n < len; ++n) {
-		expr = (char*)(*rules)[n].expression;
-		d("Initial expression: %s\n", expr);
-		retv = evaluate_expression(&expr, incident, criteria_cache);
-		retv = (*rules)[n].negate ? !retv : retv;
-		if (retv)
-			return (*rules)[n].id;
-		else
-			d("Rule %s did not match", (*rules)[n].id);
-	}
+	return evaluate_incident_with_compiled_rules(incident, &compiled);
+}
 
-	return NULL;
+void
+evaluate_incidents_with_compiled_rules(const Event * const incidents,
+				       const size_t count,
+				       const CompiledRuleSet * const compiled,
+				       RuleEvaluation * const evaluation,
+				       const char **results)
+{
+	for (size_t n = 0; n < count; ++n)
+		results[n] = evaluate_incident_with_compiled_rules(&incidents[n], compiled, evaluation);
+}
+
+int
+evaluate_incidents_with_rules(const Event * const incidents,
+			      const size_t count,
+			      const RuleSet * const rules,
+			      const CriteriaCache * const criteria_cache,
+			      const char **results)
+{
+	CompiledRuleSet compiled;
+	RuleEvaluation evaluation;
+
+	if (!compile_rule_set(rules, criteria_cache, &compiled))
+		return 0;
+
+	evaluate_incidents_with_compiled_rules(incidents, count, &compiled, &evaluation, results);
+
+	return 1;
 }
@@ -51,6 +51,7 @@
 #include <algorithm>
 #include <vector>
 #include <map>
+#include <unordered_map>
 
 #define d(msg__, ...) do { printf("%s@%d: " msg__"\n", __FILE__, __LINE__, ## __VA_ARGS__); } while (0)
 
@@ -100,7 +101,127 @@ struct TagInstance
 	uint64_t int_value; // internal fixed integer lvalue
 	void *ptr_value;    // internal fixed pointer lvalue
 };
-typedef std::map< /*tag*/ uint32_t, /*value*/ struct TagInstance> Event;
+
+/*
+ * An Event is a small array of TagInstances sorted by tag. It never
+ * allocates, so it can live on the stack or be reused and filled
+ * field by field while traversing a message with
+ * FIXMessageRX::next_field(). Call clear() before reusing it.
+ *
+ * Tags are the 32 bits rule tags described at struct Criteria below,
+ * not FIX tags, so the caller decides the value type of each field
+ * it copies into the Event.
+ */
+#define EVENT_MAX_TAGS (64)
+
+class Event
+{
+public:
+	Event(void)
+		: count_(0)
+		{
+		};
+
+	void clear(void)
+		{
+			count_ = 0;
+		};
+
+	size_t size(void) const
+		{
+			return count_;
+		};
+
+	/*
+	 * Sets or overwrites the instance of tag.
+	 *
+	 * Returns 1 (one) if all is well, 0 (zero) if the Event already
+	 * holds EVENT_MAX_TAGS other tags.
+	 */
+	int set(const uint32_t tag,
+		const struct TagInstance & instance)
+		{
+			uint32_t pos;
+
+			// fields mostly arrive in ascending tag order
+			if ((!count_ || (tags_[count_ - 1] < tag)) && (EVENT_MAX_TAGS > count_)) {
+				tags_[count_] = tag;
+				values_[count_] = instance;
+				++count_;
+				return 1;
+			}
+
+			pos = lower_bound(tag);
+			if ((pos < count_) && (tag == tags_[pos])) {
+				values_[pos] = instance;
+				return 1;
+			}
+			if (EVENT_MAX_TAGS == count_)
+				return 0;
+
+			for (uint32_t n = count_; n > pos; --n) {
+				tags_[n] = tags_[n - 1];
+				values_[n] = values_[n - 1];
+			}
+			tags_[pos] = tag;
+			values_[pos] = instance;
+			++count_;
+
+			return 1;
+		};
+
+	int set(const uint32_t tag,
+		const uint64_t int_value)
+		{
+			struct TagInstance instance = { int_value, NULL };
+
+			return set(tag, instance);
+		};
+
+	int set(const uint32_t tag,
+		void * const ptr_value)
+		{
+			struct TagInstance instance = { 0, ptr_value };
+
+			return set(tag, instance);
+		};
+
+	/*
+	 * Returns the instance of tag or NULL if tag is not in the
+	 * Event.
+	 */
+	const struct TagInstance *find(const uint32_t tag) const
+		{
+			uint32_t pos = lower_bound(tag);
+
+			if ((pos < count_) && (tag == tags_[pos]))
+				return &values_[pos];
+
+			return NULL;
+		};
+
+private:
+	uint32_t lower_bound(const uint32_t tag) const
+		{
+			uint32_t lo = 0;
+			uint32_t hi = count_;
+			uint32_t mid;
+
+			while (lo < hi) {
+				mid = (lo + hi) / 2;
+				if (tags_[mid] < tag)
+					lo = mid + 1;
+				else
+					hi = mid;
+			}
+
+			return lo;
+		};
+
+	uint32_t count_;
+	uint32_t tags_[EVENT_MAX_TAGS];
+	struct TagInstance values_[EVENT_MAX_TAGS];
+};
 
 /*
  * A single criteria. It has a pointer to an evaluator function, a
@@ -170,8 +291,163 @@ typedef std::map</*RuleSetID*/unsigned int, RuleSet> RuleDomain;
  * Evaluates an Event, or instantiation of tags, using a specific
  * RuleSet, The CriteriaCache must contain all criteria used in the
  * RuleSet. The function returns the ID of the first matching rule.
+ *
+ * The RuleSet is compiled on every invocation. Use
+ * compile_rule_set() and evaluate_incident_with_compiled_rules() if
+ * the same RuleSet is evaluated more than once.
  */
 extern const char*
 evaluate_incident_with_rules(const Event * const incident,
 			     const RuleSet * const rules,
 			     const CriteriaCache * const criteria_cache);
+
+/*
+ * Compiled rules.
+ *
+ * An expression is compiled into a flat sequence of instructions
+ * operating on a single boolean register. Operators have equal
+ * precedence and are evaluated left to right, so the right hand
+ * operand of an AND is only evaluated if the register is true and
+ * then simply replaces it, and vice versa for OR. Short-circuiting
+ * is a conditional jump forward to the next operator of the other
+ * kind on the same paranthesis level, or to the end of that level.
+ *
+ * Criteria are resolved to pointers into the CriteriaCache and to an
+ * evaluator function specific to the value type and condition, so
+ * the evaluator does no parsing and no CriteriaCache lookups. The
+ * CriteriaCache must therefore outlive the CompiledRuleSet and must
+ * not be modified while it is in use.
+ */
+enum RuleOpcode
+{
+	op_test,          // register = evaluate(criteria)
+	op_jump_if_false, // if (!register) goto target
+	op_jump_if_true,  // if (register) goto target
+	op_end,           // register is the value of the expression
+};
+
+typedef bool (*criteria_evaluator)(const struct TagInstance * const lval,
+				   const struct Criteria * const criteria);
+
+struct RuleInstruction
+{
+	enum RuleOpcode op;
+	uint32_t target;                 // op_jump_if_*
+	uint32_t slot;                   // op_test - index of criteria in the RuleEvaluation bitsets
+	const struct Criteria *criteria; // op_test
+	criteria_evaluator eval;         // op_test
+};
+
+struct CompiledRule
+{
+	int negate;
+	unsigned int priority;
+	unsigned int action;
+	const char *id;  // points into the source RuleSet
+	uint32_t entry;  // first instruction
+};
+
+/*
+ * Rules are indexed by an equality criteria on an integer tag which
+ * must be true for the rule to match. Only rules found in the index
+ * under the values of the indexed tags in the Event, and the rules
+ * which could not be indexed, are candidates for evaluation.
+ */
+struct RuleIndexKey
+{
+	uint32_t tag;
+	uint64_t value; // normalized to the value type of tag
+
+	bool operator==(const RuleIndexKey & other) const
+		{
+			return ((tag == other.tag) && (value == other.value));
+		};
+};
+
+struct RuleIndexKeyHash
+{
+	size_t operator()(const RuleIndexKey & key) const
+		{
+			return (size_t)((key.value * 0x9E3779B97F4A7C15ULL) ^ key.tag);
+		};
+};
+
+typedef std::unordered_map<struct RuleIndexKey, std::vector<uint32_t>, struct RuleIndexKeyHash> RuleIndex;
+
+struct CompiledRuleSet
+{
+	std::vector<struct RuleInstruction> code;
+	std::vector<struct CompiledRule> rules; // in RuleSet order
+	uint32_t criteria_count;                // distinct criteria referenced by code
+
+	RuleIndex index;                        // rule indices by required criteria
+	std::vector<uint32_t> index_tags;       // distinct tags in index
+	std::vector<uint32_t> unindexed;        // rule indices which are always candidates
+};
+
+/*
+ * Scratch memory of an evaluation. The known and value bitsets
+ * memoize the result of each distinct criteria, so a criteria shared
+ * by many rules is evaluated at most once per Event. One instance per
+ * evaluating thread can be reused for any number of evaluations
+ * without allocating.
+ */
+struct RuleEvaluation
+{
+	std::vector<uint64_t> known;
+	std::vector<uint64_t> value;
+	std::vector<uint32_t> touched; // words of known set by the last evaluation
+	std::vector<uint32_t> candidates;
+};
+
+/*
+ * Compiles rules into compiled. The RuleSet must outlive compiled as
+ * the rule IDs are not copied.
+ *
+ * Returns 1 (one) if all is well, 0 (zero) if an expression is
+ * malformed, refers to a criteria not in criteria_cache or to a
+ * criteria of an unsupported condition or value type, or if memory
+ * is exhausted.
+ */
+extern int
+compile_rule_set(const RuleSet * const rules,
+		 const CriteriaCache * const criteria_cache,
+		 CompiledRuleSet * const compiled);
+
+/*
+ * Evaluates an Event using a compiled RuleSet. Returns the ID of the
+ * first matching rule or NULL if none matched or if memory is
+ * exhausted.
+ *
+ * The variant without a RuleEvaluation allocates one per invocation.
+ */
+extern const char*
+evaluate_incident_with_compiled_rules(const Event * const incident,
+				      const CompiledRuleSet * const compiled,
+				      RuleEvaluation * const evaluation);
+
+extern const char*
+evaluate_incident_with_compiled_rules(const Event * const incident,
+				      const CompiledRuleSet * const compiled);
+
+/*
+ * Batch variants. Evaluates count Events and stores the ID of the
+ * first matching rule, or NULL, of incidents[n] in results[n].
+ *
+ * The RuleSet variant compiles the rules once for the whole batch. It
+ * returns 1 (one) if all is well, 0 (zero) if the RuleSet did not
+ * compile. results are undefined in that case.
+ */
+extern void
+evaluate_incidents_with_compiled_rules(const Event * const incidents,
+				       const size_t count,
+				       const CompiledRuleSet * const compiled,
+				       RuleEvaluation * const evaluation,
+				       const char **results);
+
+extern int
+evaluate_incidents_with_rules(const Event * const incidents,
+			      const size_t count,
+			      const RuleSet * const rules,
+			      const CriteriaCache * const criteria_cache,
+			      const char **results);
@@ -0,0 +1,185 @@
+/*
+ *    Copyright (C) 2013, Jules Colding <jcolding@gmail.com>.
+ *
+ *    All Rights Reserved.
+ */
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     (1) Redistributions of source code must retain the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer.
+ *
+ *     (2) Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *
+ *     (3) Neither the name of the copyright holder nor the names of
+ *     its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written
+ *     permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS
+ * OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <check.h>
+
+#ifdef HAVE_CONFIG_H
+    #include "ac_config.h"
+#endif
+#include <string>
+#include "stdlib/log/log.h"
+#include "config_item_fix_session.h"
+
+/*
+ * A complete session configuration without any placement keys.
+ */
+static const char * const session_line =
+        "IS_DUPLEX:YES "
+        "INITIATE_LOGON:YES "
+        "RESET_SEQ_NUMBERS_AT_LOGON:NO "
+        "SESSION_DAYS:MO,TU,WE,TH,FR "
+        "FIX_APPLICATION_VERSION:FIX_4_2 "
+        "FIX_SESSION_VERSION:NO_FIXT "
+        "HEARTBEAT_INTERVAL:30 "
+        "TEST_REQUEST_DELAY:5 "
+        "SESSION_WARM_UP_TIME:60 "
+        "SESSION_START:08:00 "
+        "SESSION_END:17:00 "
+        "TIMEZONE:Europe/Copenhagen "
+        "ENDPOINT_IN_OUT:4C127.0.0.1|5000";
+
+/*
+ * Reads session_line followed by placement into session_config.
+ */
+static bool
+get_session_config(const char * const placement,
+                   struct FIX_Session_Config & session_config)
+{
+        bool retv;
+        ConfigItemFIXSession ci_session;
+        std::string line(session_line);
+
+        if (placement) {
+                line += " ";
+                line += placement;
+        }
+        fail_unless(ci_session.fill(Config::File, line.c_str()), NULL);
+
+        session_config.timezone = NULL;
+        retv = ci_session.get(session_config);
+        free(session_config.timezone);
+        session_config.timezone = NULL;
+
+        return retv;
+}
+
+START_TEST(test_thread_placement)
+{
+        unsigned int n;
+        struct FIX_Session_Config session_config;
+        static const char * const malformed[] = {
+                "PUSHER_CPU:0",
+                "PUSHER_CPU:-1",
+                "PUSHER_CPU:+1",
+                "PUSHER_CPU:abc",
+                "PUSHER_CPU:2x",
+                "PUSHER_CPU:2147483648",
+                "PUSHER_CPU:99999999999999999999999",
+                "SUCKER_CPU:1.5",
+                "SPLITTER_CPU:0x2",
+                "PUSHER_FIFO_PRIORITY:0",
+                "SUCKER_FIFO_PRIORITY:100",
+                "SUCKER_FIFO_PRIORITY:-10",
+                "SPLITTER_FIFO_PRIORITY:high",
+                "SPLITTER_FIFO_PRIORITY:50%",
+        };
+
+        // no placement keys
+        memset(&session_config.pusher_placement, 0xFF, sizeof(session_config.pusher_placement));
+        memset(&session_config.sucker_placement, 0xFF, sizeof(session_config.sucker_placement));
+        memset(&session_config.splitter_placement, 0xFF, sizeof(session_config.splitter_placement));
+        fail_unless(get_session_config(NULL, session_config), NULL);
+        fail_unless(0 == session_config.pusher_placement.cpu_tag, NULL);
+        fail_unless(0 == session_config.pusher_placement.fifo_priority, NULL);
+        fail_unless(0 == session_config.sucker_placement.cpu_tag, NULL);
+        fail_unless(0 == session_config.sucker_placement.fifo_priority, NULL);
+        fail_unless(0 == session_config.splitter_placement.cpu_tag, NULL);
+        fail_unless(0 == session_config.splitter_placement.fifo_priority, NULL);
+
+        // all placement keys
+        fail_unless(get_session_config("PUSHER_CPU:2 PUSHER_FIFO_PRIORITY:1 "
+                                       "SUCKER_CPU:3 SUCKER_FIFO_PRIORITY:50 "
+                                       "SPLITTER_CPU:2147483647 SPLITTER_FIFO_PRIORITY:99", session_config), NULL);
+        fail_unless(2 == session_config.pusher_placement.cpu_tag, NULL);
+        fail_unless(1 == session_config.pusher_placement.fifo_priority, NULL);
+        fail_unless(3 == session_config.sucker_placement.cpu_tag, NULL);
+        fail_unless(50 == session_config.sucker_placement.fifo_priority, NULL);
+        fail_unless(2147483647 == session_config.splitter_placement.cpu_tag, NULL);
+        fail_unless(99 == session_config.splitter_placement.fifo_priority, NULL);
+
+        // a CPU without a priority and the other way around
+        fail_unless(get_session_config("PUSHER_CPU:4 SUCKER_FIFO_PRIORITY:7", session_config), NULL);
+        fail_unless(4 == session_config.pusher_placement.cpu_tag, NULL);
+        fail_unless(0 == session_config.pusher_placement.fifo_priority, NULL);
+        fail_unless(0 == session_config.sucker_placement.cpu_tag, NULL);
+        fail_unless(7 == session_config.sucker_placement.fifo_priority, NULL);
+        fail_unless(0 == session_config.splitter_placement.cpu_tag, NULL);
+        fail_unless(0 == session_config.splitter_placement.fifo_priority, NULL);
+
+        for (n = 0; n < sizeof(malformed)/sizeof(malformed[0]); ++n)
+                fail_unless(!get_session_config(malformed[n], session_config), malformed[n]);
+}
+END_TEST
+
+Suite*
+config_suite(void)
+{
+        Suite *s = suite_create("Config");
+
+        /* Core test case */
+        TCase *tc_core = tcase_create("Core");
+
+        tcase_set_timeout(tc_core, 20);
+
+        tcase_add_test(tc_core, test_thread_placement);
+        suite_add_tcase(s, tc_core);
+
+        return s;
+}
+
+int
+main(int /* argc */, char ** /* argv */)
+{
+        int number_failed;
+        Suite *s = config_suite();
+        SRunner *sr = srunner_create(s);
+
+        // initiate logging
+        if (!init_logging(false, "check_config")) {
+                fprintf(stderr, "could not initiate logging\n");
+                return EXIT_FAILURE;
+        }
+
+        // run the tests
+        srunner_run_all(sr, CK_VERBOSE);
+        number_failed = srunner_ntests_failed(sr);
+        srunner_free(sr);
+
+        return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -43,7 +43,10 @@
 #include <map>
 #include <list>
 #include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
 #include <errno.h>
+#include <limits.h>
 #include "stdlib/log/log.h"
 #include "utillib/config/config_item_network.h"
 #include "config_item_fix_session.h"
@@ -64,6 +67,15 @@
 #define ENDPOINT_OUT_GOING_KEY         "ENDPOINT_OUT_GOING"
 #define ENDPOINT_IN_OUT_KEY            "ENDPOINT_IN_OUT"
 
+// Optional thread placement. A thread is not pinned and runs with the
+// default scheduling policy if its keys are absent.
+#define PUSHER_CPU_KEY                 "PUSHER_CPU"              // CPU number, 1 being the first, as a positive integer number
+#define PUSHER_FIFO_PRIORITY_KEY       "PUSHER_FIFO_PRIORITY"    // SCHED_FIFO priority, 1 through 99
+#define SUCKER_CPU_KEY                 "SUCKER_CPU"              // CPU number, 1 being the first, as a positive integer number
+#define SUCKER_FIFO_PRIORITY_KEY       "SUCKER_FIFO_PRIORITY"    // SCHED_FIFO priority, 1 through 99
+#define SPLITTER_CPU_KEY               "SPLITTER_CPU"            // CPU number, 1 being the first, as a positive integer number
+#define SPLITTER_FIFO_PRIORITY_KEY     "SPLITTER_FIFO_PRIORITY"  // SCHED_FIFO priority, 1 through 99
+
 #define SUNDAY    "SU"
 #define MONDAY    "MO"
 #define TUESDAY   "TU"
@@ -184,6 +196,60 @@ make_vector(std::vector<std::string> & strings,
         return retv;
 }
 
+/*
+ * As str_to_ulong() but str must hold nothing but the decimal digits.
+ */
+static bool
+str_to_ulong_strict(const char * const str,
+                    unsigned long & val)
+{
+        char *end;
+
+        if (!isdigit((unsigned char)*str))
+                return false;
+
+        errno = 0;
+        val = strtoul(str, &end, 10);
+
+        return (!errno && ('\0' == *end));
+}
+
+/*
+ * Reads the optional placement of one thread.
+ */
+static bool
+get_thread_placement(std::map<std::string, std::string> & session_props,
+                     const char * const cpu_key,
+                     const char * const fifo_priority_key,
+                     struct thread_placement_t & placement)
+{
+        unsigned long val;
+        std::map<std::string, std::string>::iterator it;
+
+        placement.cpu_tag = 0;
+        placement.fifo_priority = 0;
+
+        it = session_props.find(cpu_key);
+        if (session_props.end() != it) {
+                if (!str_to_ulong_strict(it->second.c_str(), val) || !val || (INT_MAX < val)) {
+                        M_CRITICAL("invalid value of %s", cpu_key);
+                        return false;
+                }
+                placement.cpu_tag = (int)val;
+        }
+
+        it = session_props.find(fifo_priority_key);
+        if (session_props.end() != it) {
+                if (!str_to_ulong_strict(it->second.c_str(), val) || !val || (99 < val)) {
+                        M_CRITICAL("invalid value of %s", fifo_priority_key);
+                        return false;
+                }
+                placement.fifo_priority = (int)val;
+        }
+
+        return true;
+}
+
 static bool
 check_session_props(std::map<std::string, std::string> session_props)
 {
@@ -422,6 +488,13 @@ ConfigItemFIXSession::get(struct FIX_Session_Config & session_config)
         if (!session_config.timezone)
                 goto err;
 
+        if (!get_thread_placement(session_props, PUSHER_CPU_KEY, PUSHER_FIFO_PRIORITY_KEY, session_config.pusher_placement))
+                goto err;
+        if (!get_thread_placement(session_props, SUCKER_CPU_KEY, SUCKER_FIFO_PRIORITY_KEY, session_config.sucker_placement))
+                goto err;
+        if (!get_thread_placement(session_props, SPLITTER_CPU_KEY, SPLITTER_FIFO_PRIORITY_KEY, session_config.splitter_placement))
+                goto err;
+
         switch (session_config.is_duplex) {
         case true:
                 ci_network.fill(data_source_, session_props[ENDPOINT_IN_OUT_KEY].c_str());
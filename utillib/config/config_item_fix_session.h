@@ -44,6 +44,7 @@
 #endif
 #include "stdlib/config/config.h"
 #include "stdlib/network/net_types.h"
+#include "stdlib/process/threads.h"
 #include "utillib/config/config_item_string_vector.h"
 
 class ConfigItemFIXSession;
@@ -81,6 +82,9 @@ struct FIX_Session_Config
         char *timezone;                     // the timezone in which the times above are stated (ISO name)
         endpoint_t in_going;
         endpoint_t out_going;
+        struct thread_placement_t pusher_placement;   // FIX_Pusher::set_thread_placement()
+        struct thread_placement_t sucker_placement;   // FIX_Popper::set_thread_placement(SUCKER_THREAD, ...)
+        struct thread_placement_t splitter_placement; // FIX_Popper::set_thread_placement(SPLITTER_THREAD, ...)
 };
 
 /*
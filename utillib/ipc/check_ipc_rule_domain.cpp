@@ -0,0 +1,210 @@
+/*
+ *    Copyright (C) 2013, Jules Colding <jcolding@gmail.com>.
+ *
+ *    All Rights Reserved.
+ */
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     (1) Redistributions of source code must retain the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer.
+ *
+ *     (2) Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *
+ *     (3) Neither the name of the copyright holder nor the names of
+ *     its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written
+ *     permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS
+ * OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <check.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#ifdef HAVE_CONFIG_H
+    #include "ac_config.h"
+#endif
+#include "stdlib/log/log.h"
+#include "stdlib/marshal/marshal.h"
+#include "ipc_rule_domain.h"
+
+static int sock[2] = { -1, -1 };
+static uint8_t buf[IPC_BUFFER_SIZE];
+
+/*
+ * Receives one IPC packet into buf. recv_cmd() is not used as it
+ * waits for a full buffer.
+ */
+static void
+recv_packet(const int fd)
+{
+	fail_unless(IPC_HEADER_SIZE == recv(fd, buf, IPC_HEADER_SIZE, MSG_WAITALL), NULL);
+	if (ipcdata_get_datalen((ipcdata_t)buf))
+		fail_unless(ipcdata_get_datalen((ipcdata_t)buf) == recv(fd, buf + IPC_HEADER_SIZE, ipcdata_get_datalen((ipcdata_t)buf), MSG_WAITALL), NULL);
+}
+
+/*
+ * Lets the handler act on the command in buf and returns the result
+ * it sends back.
+ */
+static IPC_ReturnCode
+handle_packet(ConcurrentRuleDomain & domain)
+{
+	fail_unless(handle_rule_domain_cmd(sock[0], (ipcdata_t)buf, &domain), NULL);
+	recv_packet(sock[1]);
+	fail_unless(CMD_RESULT == ipcdata_get_cmd((ipcdata_t)buf), NULL);
+
+	return ipcdata_get_return_code((ipcdata_t)buf);
+}
+
+/*
+ * Lets the handler act on a command sent over sock[1] by send_cmd()
+ * and returns the result it sends back.
+ */
+static IPC_ReturnCode
+handle_cmd(ConcurrentRuleDomain & domain)
+{
+	recv_packet(sock[0]);
+
+	return handle_packet(domain);
+}
+
+/*
+ * Returns the ID of the rule in rule_set_id matching tag 1 being 1
+ * (one), or NULL.
+ */
+static const char*
+evaluate(ConcurrentRuleDomain & domain,
+	 const unsigned int rule_set_id)
+{
+	static char id[32];
+	const int evaluator = domain.register_evaluator();
+	const RuleDomainSnapshot *snapshot;
+	RuleEvaluation evaluation;
+	Event incident;
+	const char *retv;
+
+	fail_unless(-1 != evaluator, NULL);
+	fail_unless(1 == incident.set(0x05000001, (uint64_t)1), NULL);
+
+	snapshot = domain.read_lock(evaluator);
+	retv = evaluate_incident_in_domain(snapshot, rule_set_id, &incident, &evaluation);
+	if (retv) {
+		snprintf(id, sizeof(id), "%s", retv);
+		retv = id;
+	}
+	domain.read_unlock(evaluator);
+	domain.unregister_evaluator(evaluator);
+
+	return retv;
+}
+
+/*
+ * Test CMD_PUBLISH_RULE_SET and CMD_WITHDRAW_RULE_SET payloads.
+ */
+START_TEST(test_rule_domain_cmd)
+{
+	ConcurrentRuleDomain domain;
+	const char *text = "C 1 5000001 eq 1\nR R1 0 0 0 1\n";
+	const char *id;
+	uint32_t count;
+
+	fail_unless(!socketpair(AF_UNIX, SOCK_STREAM, 0, sock), NULL);
+
+	fail_unless(0 != send_cmd(sock[1], CMD_PUBLISH_RULE_SET, CMD_PUBLISH_RULE_SET_FORMAT, (uint32_t)7, text), NULL);
+	fail_unless(RES_OK == handle_cmd(domain), NULL);
+	id = evaluate(domain, 7);
+	fail_unless(id && !strcmp("R1", id), NULL);
+
+	// replaces RuleSet 7
+	fail_unless(0 != send_cmd(sock[1], CMD_PUBLISH_RULE_SET, CMD_PUBLISH_RULE_SET_FORMAT, (uint32_t)7, "C 2 5000001 ne 2\nR R2 0 0 0 2\n"), NULL);
+	fail_unless(RES_OK == handle_cmd(domain), NULL);
+	id = evaluate(domain, 7);
+	fail_unless(id && !strcmp("R2", id), NULL);
+
+	// malformed definitions leave RuleSet 7 alone
+	fail_unless(0 != send_cmd(sock[1], CMD_PUBLISH_RULE_SET, CMD_PUBLISH_RULE_SET_FORMAT, (uint32_t)7, "C 1 5000001 eq 1\nR R3 0 0 0 1+3\n"), NULL);
+	fail_unless(RES_FAILURE == handle_cmd(domain), NULL);
+	fail_unless(0 != send_cmd(sock[1], CMD_PUBLISH_RULE_SET, CMD_PUBLISH_RULE_SET_FORMAT, (uint32_t)7, "X"), NULL);
+	fail_unless(RES_FAILURE == handle_cmd(domain), NULL);
+	id = evaluate(domain, 7);
+	fail_unless(id && !strcmp("R2", id), NULL);
+
+	// an unterminated definition
+	fail_unless(marshal(buf + IPC_HEADER_SIZE, sizeof(buf) - IPC_HEADER_SIZE, &count, CMD_PUBLISH_RULE_SET_FORMAT, (uint32_t)8, text), NULL);
+	ipcdata_set_header(CMD_PUBLISH_RULE_SET, count - 1, (ipcdata_t)buf);
+	fail_unless(RES_FAILURE == handle_packet(domain), NULL);
+	fail_unless(NULL == evaluate(domain, 8), NULL);
+
+	// withdraw
+	fail_unless(0 != send_cmd(sock[1], CMD_WITHDRAW_RULE_SET, CMD_WITHDRAW_RULE_SET_FORMAT, (uint32_t)7), NULL);
+	fail_unless(RES_OK == handle_cmd(domain), NULL);
+	fail_unless(NULL == evaluate(domain, 7), NULL);
+	fail_unless(0 != send_cmd(sock[1], CMD_WITHDRAW_RULE_SET, CMD_WITHDRAW_RULE_SET_FORMAT, (uint32_t)7), NULL);
+	fail_unless(RES_FAILURE == handle_cmd(domain), NULL);
+
+	// other commands are left to the caller
+	ipcdata_set_header(CMD_PING, 0, (ipcdata_t)buf);
+	fail_unless(!handle_rule_domain_cmd(sock[0], (ipcdata_t)buf, &domain), NULL);
+
+	close(sock[0]);
+	close(sock[1]);
+}
+END_TEST
+
+Suite*
+ipc_suite(void)
+{
+	Suite *s = suite_create("IPC");
+
+	/* Core test case */
+	TCase *tc_core = tcase_create("Core");
+
+	tcase_set_timeout(tc_core, 20);
+
+	tcase_add_test(tc_core, test_rule_domain_cmd);
+	suite_add_tcase(s, tc_core);
+
+	return s;
+}
+
+int
+main(int /* argc */, char ** /* argv */)
+{
+	int number_failed;
+	Suite *s = ipc_suite();
+	SRunner *sr = srunner_create(s);
+
+	// initiate logging
+	if (!init_logging(false, "check_ipc")) {
+		fprintf(stderr, "could not initiate logging\n");
+		return EXIT_FAILURE;
+	}
+
+	// run the tests
+	srunner_run_all(sr, CK_VERBOSE);
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
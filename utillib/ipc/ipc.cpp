@@ -41,6 +41,7 @@
     #include "ac_config.h"
 #endif
 #include <errno.h>
+#include <pthread.h>
 #include "stdlib/log/log.h"
 #include "stdlib/macros/macros.h"
 #include "stdlib/marshal/marshal.h"
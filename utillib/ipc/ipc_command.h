@@ -65,6 +65,8 @@ enum IPC_Command {
 	CMD_RESULT  = 0x00000001,
 	CMD_MESSAGE = 0x00000002,
 	CMD_PING    = 0x00000003,
+	CMD_PUBLISH_RULE_SET  = 0x00000004,
+	CMD_WITHDRAW_RULE_SET = 0x00000005,
 };
 
 /*
@@ -155,3 +157,29 @@ command_is_oneway(const IPC_Command cmd)
 #define CMD_PING_FORMAT_ARG_COUNT (0)
 #define CMD_RESULT_RETURN_FORMAT "%ul"
 #define CMD_RESULT_RETURN_FORMAT_VALUE_COUNT (1)
+
+/*
+ * CMD_PUBLISH_RULE_SET
+ *
+ * Publishes a RuleSet in the rule domain of the recipient, replacing
+ * any RuleSet with the same ID, without restarting it. The first
+ * argument is the RuleSet ID, the second the RuleSet definition as
+ * described at parse_rule_set_definition() in
+ * stdlib/rule_engine/rule_domain.h.
+ *
+ * Expects RES_OK back if the RuleSet was parsed, compiled and
+ * published, RES_FAILURE if not.
+ */
+#define CMD_PUBLISH_RULE_SET_FORMAT "%ul%s"
+#define CMD_PUBLISH_RULE_SET_FORMAT_ARG_COUNT (2)
+
+/*
+ * CMD_WITHDRAW_RULE_SET
+ *
+ * Removes a RuleSet from the rule domain of the recipient.
+ *
+ * Expects RES_OK back if the RuleSet was removed, RES_FAILURE if
+ * there is no such RuleSet.
+ */
+#define CMD_WITHDRAW_RULE_SET_FORMAT "%ul"
+#define CMD_WITHDRAW_RULE_SET_FORMAT_ARG_COUNT (1)
@@ -0,0 +1,133 @@
+/*
+ *    Copyright (C) 2013, Jules Colding <jcolding@gmail.com>.
+ *
+ *    All Rights Reserved.
+ */
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 
+ *     (1) Redistributions of source code must retain the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer.
+ * 
+ *     (2) Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *     
+ *     (3) Neither the name of the copyright holder nor the names of
+ *     its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written
+ *     permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS
+ * OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifdef HAVE_CONFIG_H
+    #include "ac_config.h"
+#endif
+#include <new>
+#include "stdlib/log/log.h"
+#include "stdlib/marshal/marshal.h"
+#include "ipc_rule_domain.h"
+
+static IPC_ReturnCode
+publish_rule_set(const ipcdata_t const ipcdata,
+		 ConcurrentRuleDomain * const domain)
+{
+	const uint8_t * const data = ipcdata_get_data(ipcdata);
+	const uint32_t len = ipcdata_get_datalen(ipcdata);
+	IPC_ReturnCode res = RES_FAILURE;
+	struct RuleSetDefinition *definition = NULL;
+	uint32_t rule_set_id;
+	char *text = NULL;
+
+	// unmarshal() strdup()s the definition
+	if (!len || data[len - 1]) {
+		M_WARNING("unterminated RuleSet definition");
+		return RES_FAILURE;
+	}
+	if (CMD_PUBLISH_RULE_SET_FORMAT_ARG_COUNT != unmarshal(data, len, CMD_PUBLISH_RULE_SET_FORMAT, &rule_set_id, &text)) {
+		M_WARNING("error unmarshalling");
+		goto out;
+	}
+
+	definition = new (std::nothrow) RuleSetDefinition;
+	if (!definition) {
+		M_ALERT("no memory");
+		goto out;
+	}
+	if (!parse_rule_set_definition(text, definition)) {
+		M_WARNING("malformed definition of RuleSet %u", rule_set_id);
+		goto out;
+	}
+	if (!domain->publish(rule_set_id, definition)) {
+		M_WARNING("could not publish RuleSet %u", rule_set_id);
+		goto out;
+	}
+	definition = NULL; // owned by domain
+	M_INFO("published RuleSet %u", rule_set_id);
+	res = RES_OK;
+out:
+	delete definition;
+	free(text);
+
+	return res;
+}
+
+static IPC_ReturnCode
+withdraw_rule_set(const ipcdata_t const ipcdata,
+		  ConcurrentRuleDomain * const domain)
+{
+	uint32_t rule_set_id;
+
+	if (CMD_WITHDRAW_RULE_SET_FORMAT_ARG_COUNT != unmarshal(ipcdata_get_data(ipcdata),
+								ipcdata_get_datalen(ipcdata),
+								CMD_WITHDRAW_RULE_SET_FORMAT,
+								&rule_set_id)) {
+		M_WARNING("error unmarshalling");
+		return RES_FAILURE;
+	}
+	if (!domain->withdraw(rule_set_id)) {
+		M_WARNING("could not withdraw RuleSet %u", rule_set_id);
+		return RES_FAILURE;
+	}
+	M_INFO("withdrew RuleSet %u", rule_set_id);
+
+	return RES_OK;
+}
+
+bool
+handle_rule_domain_cmd(int sock,
+		       const ipcdata_t const ipcdata,
+		       ConcurrentRuleDomain * const domain)
+{
+	IPC_ReturnCode res;
+
+	switch (ipcdata_get_cmd(ipcdata)) {
+	case CMD_PUBLISH_RULE_SET:
+		res = publish_rule_set(ipcdata, domain);
+		break;
+	case CMD_WITHDRAW_RULE_SET:
+		res = withdraw_rule_set(ipcdata, domain);
+		break;
+	default:
+		return false;
+	}
+
+	return send_result(sock, res);
+}